@@ -70,9 +70,83 @@ static struct option long_options[] = {
 
 
 
+SamplePlanes::SamplePlanes(int b)
+{
+  border = b;
+  width = height = stride = 0;
+
+  plane_8 = NULL;
+  for (int i=0;i<8;i++) {
+    planes[i] = NULL;
+  }
+}
+
+
+SamplePlanes::~SamplePlanes()
+{
+  delete[] plane_8;
+  for (int i=0;i<8;i++) {
+    delete[] planes[i];
+  }
+}
+
+
+void SamplePlanes::set(std::shared_ptr<const de265_image> img)
+{
+  int w = img->get_width(0);
+  int h = img->get_height(0);
+
+  if (w != width || h != height) {
+    width  = w;
+    height = h;
+    stride = w + 2*border;
+
+    delete[] plane_8;
+    plane_8 = new uint8_t[stride*(h+2*border)];
+
+    for (int i=0;i<8;i++) {
+      delete[] planes[i];
+      planes[i] = new uint16_t[stride*(h+2*border)];
+    }
+  }
+
+  int istride = img->get_luma_stride();
+  const uint8_t* luma = img->get_image_plane_at_pos(0,0,0);
+
+  for (int y=-border;y<h+border;y++)
+    for (int x=-border;x<w+border;x++) {
+      int cx = libde265_max(0, libde265_min(w-1, x));
+      int cy = libde265_max(0, libde265_min(h-1, y));
+
+      int v    = luma[cx + cy*istride];
+      int vlow = luma[(w-1-cx) + (h-1-cy)*istride];
+
+      int pos = (x+border) + (y+border)*stride;
+
+      plane_8[pos] = v;
+
+      for (int i=0;i<8;i++) {
+        int bitDepth = 9+i;
+        planes[i][pos] = (v << (bitDepth-8)) | (vlow >> (16-bitDepth));
+      }
+    }
+}
+
+
+
 DSPFunc* DSPFunc::first = NULL;
 
 
+bool DSPFunc::isSupportedByCPU() const
+{
+  if (requiresAVX2) {
+    return __builtin_cpu_supports("avx2");
+  }
+
+  return true;
+}
+
+
 bool DSPFunc::runOnImage(std::shared_ptr<const de265_image> img, bool compareToReference)
 {
   int w = img->get_width(0);
@@ -176,6 +250,11 @@ int main(int argc, char** argv)
     exit(10);
   }
 
+  if (!algo->isSupportedByCPU()) {
+    fprintf(stderr,"the selected function is not supported by this CPU.\n");
+    exit(10);
+  }
+
   if (do_check && !algo->referenceImplementation()) {
     fprintf(stderr,"cannot check function result: no reference function defined for the selected function.\n");
     exit(10);
@@ -38,14 +38,50 @@
 #include "libde265/image-io.h"
 
 
+/* The luma plane of the input frame with replicated borders, as 8-bit samples and
+   expanded to 9-16 bit. The low bits of the high bit depth samples are filled from
+   the pixel at the mirrored position.
+ */
+class SamplePlanes
+{
+public:
+  SamplePlanes(int border);
+  ~SamplePlanes();
+
+  void set(std::shared_ptr<const de265_image> img);
+
+  int getWidth()  const { return width; }
+  int getHeight() const { return height; }
+  int getStride() const { return stride; }
+
+  const uint8_t* pixels_8(int x,int y) const {
+    return plane_8 + (x+border) + (y+border)*stride;
+  }
+
+  const uint16_t* pixels(int bitDepth, int x,int y) const {
+    return planes[bitDepth-9] + (x+border) + (y+border)*stride;
+  }
+
+private:
+  int border;
+  int width, height;
+  int stride;
+
+  uint8_t*  plane_8;
+  uint16_t* planes[8]; // 9-16 bit
+};
+
+
 class DSPFunc
 {
 public:
-  DSPFunc() { next = first; first = this; }
+  DSPFunc() { next = first; first = this; requiresAVX2 = false; }
   virtual ~DSPFunc() { }
 
   virtual const char* name() const = 0;
 
+  bool isSupportedByCPU() const;
+
   virtual int getBlkWidth() const = 0;
   virtual int getBlkHeight() const = 0;
 
@@ -59,6 +95,9 @@ public:
 
   static DSPFunc* first;
   DSPFunc* next;
+
+protected:
+  bool requiresAVX2;
 };
 
 
@@ -0,0 +1,38 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "libde265/x86/avx2-dct.h"
+#include "dct.h"
+#include "dct-scalar.h"
+
+
+DSPFunc_AddResidual add_residual_avx2_8_func("ADD-RESIDUAL-AVX2-8", ff_hevc_add_residual_8_avx2,
+                                             &add_residual_scalar_8, true);
+DSPFunc_AddResidual add_residual_avx2_16_func("ADD-RESIDUAL-AVX2-16", ff_hevc_add_residual_16_avx2,
+                                              &add_residual_scalar_16, true);
+
+DSPFunc_Residual residual_avx2_func("RESIDUAL-AVX2",
+                                    ff_hevc_transform_skip_residual_avx2,
+                                    ff_hevc_rdpcm_v_avx2, ff_hevc_rdpcm_h_avx2,
+                                    ff_hevc_transform_bypass_avx2,
+                                    ff_hevc_transform_bypass_rdpcm_v_avx2,
+                                    ff_hevc_transform_bypass_rdpcm_h_avx2,
+                                    &residual_scalar, true);
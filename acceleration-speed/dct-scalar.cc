@@ -31,3 +31,29 @@ DSPFunc_IDCT_Scalar_4x4   idct_scalar_4x4;
 DSPFunc_IDCT_Scalar_8x8   idct_scalar_8x8;
 DSPFunc_IDCT_Scalar_16x16 idct_scalar_16x16;
 DSPFunc_IDCT_Scalar_32x32 idct_scalar_32x32;
+
+DSPFunc_IDST_Scalar_4x4   idst_scalar_4x4;
+
+
+DSPFunc_IDCT_Sparse idct_sparse_scalar_4x4_8("IDCT-Scalar-4x4-sparse", 4, transform_4x4_add_sparse_8_fallback);
+DSPFunc_IDCT_Sparse idct_sparse_scalar_8x8_8("IDCT-Scalar-8x8-sparse", 8, transform_8x8_add_sparse_8_fallback);
+DSPFunc_IDCT_Sparse idct_sparse_scalar_16x16_8("IDCT-Scalar-16x16-sparse", 16, transform_16x16_add_sparse_8_fallback);
+DSPFunc_IDCT_Sparse idct_sparse_scalar_32x32_8("IDCT-Scalar-32x32-sparse", 32, transform_32x32_add_sparse_8_fallback);
+
+DSPFunc_IDCT_Sparse idct_sparse_scalar_4x4_16("IDCT-Scalar-4x4-sparse-16", 4, transform_4x4_add_sparse_16_fallback);
+DSPFunc_IDCT_Sparse idct_sparse_scalar_8x8_16("IDCT-Scalar-8x8-sparse-16", 8, transform_8x8_add_sparse_16_fallback);
+DSPFunc_IDCT_Sparse idct_sparse_scalar_16x16_16("IDCT-Scalar-16x16-sparse-16", 16, transform_16x16_add_sparse_16_fallback);
+DSPFunc_IDCT_Sparse idct_sparse_scalar_32x32_16("IDCT-Scalar-32x32-sparse-16", 32, transform_32x32_add_sparse_16_fallback);
+
+
+DSPFunc_AddResidual add_residual_scalar_8("ADD-RESIDUAL-Scalar-8", add_residual_fallback<uint8_t>);
+DSPFunc_AddResidual add_residual_scalar_16("ADD-RESIDUAL-Scalar-16", add_residual_fallback<uint16_t>);
+
+DSPFunc_Residual residual_scalar("RESIDUAL-Scalar",
+                                 transform_skip_residual_fallback, rdpcm_v_fallback, rdpcm_h_fallback,
+                                 transform_bypass_fallback, transform_bypass_rdpcm_v_fallback,
+                                 transform_bypass_rdpcm_h_fallback);
+
+DSPFunc_Dequant dequant_scalar("DEQUANT-Scalar", dequant_flat_fallback, dequant_scaled_fallback, false);
+DSPFunc_Dequant dequant_table("DEQUANT-Table", dequant_flat_fallback, dequant_scaled_fallback, true,
+                              &dequant_scalar);
@@ -143,6 +143,19 @@ public:
   }
 };
 
+class DSPFunc_IDST_Scalar_4x4 : public DSPFunc_IDCT_Base
+{
+public:
+  DSPFunc_IDST_Scalar_4x4() : DSPFunc_IDCT_Base(4) { }
+
+  virtual const char* name() const { return "IDST-Scalar-4x4"; }
+
+  virtual void runOnBlock(int x,int y) {
+    memset(out,0,4*4);
+    transform_4x4_luma_add_8_fallback(out, xy2coeff(x,y), 4);
+  }
+};
+
 
 extern DSPFunc_FDCT_Scalar_4x4   fdct_scalar_4x4;
 extern DSPFunc_FDCT_Scalar_8x8   fdct_scalar_8x8;
@@ -155,4 +168,22 @@ extern DSPFunc_IDCT_Scalar_8x8   idct_scalar_8x8;
 extern DSPFunc_IDCT_Scalar_16x16 idct_scalar_16x16;
 extern DSPFunc_IDCT_Scalar_32x32 idct_scalar_32x32;
 
+extern DSPFunc_IDST_Scalar_4x4   idst_scalar_4x4;
+
+
+extern DSPFunc_IDCT_Sparse idct_sparse_scalar_4x4_8;
+extern DSPFunc_IDCT_Sparse idct_sparse_scalar_8x8_8;
+extern DSPFunc_IDCT_Sparse idct_sparse_scalar_16x16_8;
+extern DSPFunc_IDCT_Sparse idct_sparse_scalar_32x32_8;
+
+extern DSPFunc_IDCT_Sparse idct_sparse_scalar_4x4_16;
+extern DSPFunc_IDCT_Sparse idct_sparse_scalar_8x8_16;
+extern DSPFunc_IDCT_Sparse idct_sparse_scalar_16x16_16;
+extern DSPFunc_IDCT_Sparse idct_sparse_scalar_32x32_16;
+
+extern DSPFunc_AddResidual add_residual_scalar_8;
+extern DSPFunc_AddResidual add_residual_scalar_16;
+extern DSPFunc_Residual    residual_scalar;
+extern DSPFunc_Dequant     dequant_scalar;
+
 #endif
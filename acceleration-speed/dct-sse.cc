@@ -84,10 +84,62 @@ public:
   }
 };
 
+class DSPFunc_IDST_SSE_4x4 : public DSPFunc_IDCT_Base
+{
+public:
+  DSPFunc_IDST_SSE_4x4() : DSPFunc_IDCT_Base(4) { }
+
+  virtual const char* name() const { return "IDST-SSE-4x4"; }
+
+  virtual DSPFunc* referenceImplementation() const { return &idst_scalar_4x4; }
+
+  virtual void runOnBlock(int x,int y) {
+    memset(out,0,4*4);
+    ff_hevc_transform_4x4_luma_add_8_sse4(out, xy2coeff(x,y), 4);
+  }
+};
+
 DSPFunc_IDCT_SSE_4x4   idct_sse_4x4;
 DSPFunc_IDCT_SSE_8x8   idct_sse_8x8;
 DSPFunc_IDCT_SSE_16x16 idct_sse_16x16;
 DSPFunc_IDCT_SSE_32x32 idct_sse_32x32;
+DSPFunc_IDST_SSE_4x4   idst_sse_4x4;
+
+
+DSPFunc_IDCT_Sparse idct_sparse_sse_4x4_8("IDCT-SSE-4x4-sparse", 4, ff_hevc_transform_4x4_add_sparse_8_sse4,
+                                          &idct_sparse_scalar_4x4_8);
+DSPFunc_IDCT_Sparse idct_sparse_sse_8x8_8("IDCT-SSE-8x8-sparse", 8, ff_hevc_transform_8x8_add_sparse_8_sse4,
+                                          &idct_sparse_scalar_8x8_8);
+DSPFunc_IDCT_Sparse idct_sparse_sse_16x16_8("IDCT-SSE-16x16-sparse", 16, ff_hevc_transform_16x16_add_sparse_8_sse4,
+                                            &idct_sparse_scalar_16x16_8);
+DSPFunc_IDCT_Sparse idct_sparse_sse_32x32_8("IDCT-SSE-32x32-sparse", 32, ff_hevc_transform_32x32_add_sparse_8_sse4,
+                                            &idct_sparse_scalar_32x32_8);
+
+DSPFunc_IDCT_Sparse idct_sparse_sse_4x4_16("IDCT-SSE-4x4-sparse-16", 4, ff_hevc_transform_4x4_add_sparse_16_sse4,
+                                           &idct_sparse_scalar_4x4_16);
+DSPFunc_IDCT_Sparse idct_sparse_sse_8x8_16("IDCT-SSE-8x8-sparse-16", 8, ff_hevc_transform_8x8_add_sparse_16_sse4,
+                                           &idct_sparse_scalar_8x8_16);
+DSPFunc_IDCT_Sparse idct_sparse_sse_16x16_16("IDCT-SSE-16x16-sparse-16", 16, ff_hevc_transform_16x16_add_sparse_16_sse4,
+                                             &idct_sparse_scalar_16x16_16);
+DSPFunc_IDCT_Sparse idct_sparse_sse_32x32_16("IDCT-SSE-32x32-sparse-16", 32, ff_hevc_transform_32x32_add_sparse_16_sse4,
+                                             &idct_sparse_scalar_32x32_16);
+
+
+DSPFunc_AddResidual add_residual_sse_8_func("ADD-RESIDUAL-SSE-8", ff_hevc_add_residual_8_sse4,
+                                            &add_residual_scalar_8);
+DSPFunc_AddResidual add_residual_sse_16_func("ADD-RESIDUAL-SSE-16", ff_hevc_add_residual_16_sse4,
+                                             &add_residual_scalar_16);
+
+DSPFunc_Residual residual_sse_func("RESIDUAL-SSE",
+                                   ff_hevc_transform_skip_residual_sse4,
+                                   ff_hevc_rdpcm_v_sse4, ff_hevc_rdpcm_h_sse4,
+                                   ff_hevc_transform_bypass_sse4,
+                                   ff_hevc_transform_bypass_rdpcm_v_sse4,
+                                   ff_hevc_transform_bypass_rdpcm_h_sse4,
+                                   &residual_scalar);
+
+DSPFunc_Dequant dequant_sse_func("DEQUANT-SSE", ff_hevc_dequant_flat_sse4, ff_hevc_dequant_scaled_sse4,
+                                 true, &dequant_scalar);
 
 
 
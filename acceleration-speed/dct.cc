@@ -142,3 +142,563 @@ bool DSPFunc_IDCT_Base::prepareNextImage(std::shared_ptr<const de265_image> img)
 
   return true;
 }
+
+
+
+// --- sparse IDCT ---
+
+static const int sparse_extents[IDCT_SPARSE_OUTPUTS] = { 1,4,8 };
+static const int coeff_scales[4] = { 1,8,64,1024 };
+
+
+void DSPFunc_IDCT_Sparse::init(const char* name, int nT, DSPFunc* ref, bool avx2)
+{
+  funcName = name;
+  refImpl  = ref;
+  requiresAVX2 = avx2;
+
+  func_8  = NULL;
+  func_16 = NULL;
+
+  blkSize  = nT;
+  bitDepth = 8;
+  nOutputs = 0;
+
+  blksPerRow = blksPerImage = 0;
+  frameCounter = -1;
+
+  coeffs = new int16_t[nT*nT];
+  out = new uint8_t[IDCT_SPARSE_OUTPUTS*nT*nT*2]();
+}
+
+
+DSPFunc_IDCT_Sparse::DSPFunc_IDCT_Sparse(const char* name, int nT, sparse_8_func f,
+                                         DSPFunc* ref, bool avx2)
+  : samples(IDCT_SPARSE_BORDER)
+{
+  init(name,nT,ref,avx2);
+  func_8 = f;
+}
+
+
+DSPFunc_IDCT_Sparse::DSPFunc_IDCT_Sparse(const char* name, int nT, sparse_16_func f,
+                                         DSPFunc* ref, bool avx2)
+  : samples(IDCT_SPARSE_BORDER)
+{
+  init(name,nT,ref,avx2);
+  func_16 = f;
+}
+
+
+int DSPFunc_IDCT_Sparse::sample(int x,int y) const
+{
+  if (bitDepth==8) return *samples.pixels_8(x,y);
+  else             return *samples.pixels(bitDepth, x,y);
+}
+
+
+template <class pixel_t>
+void DSPFunc_IDCT_Sparse::fillPrediction(pixel_t* dst, int x,int y) const
+{
+  for (int yy=0;yy<blkSize;yy++)
+    for (int xx=0;xx<blkSize;xx++) {
+      dst[xx+yy*blkSize] = sample(x+xx,y+yy);
+    }
+}
+
+
+void DSPFunc_IDCT_Sparse::runOnBlock(int x,int y)
+{
+  int n = x/blkSize + y/blkSize*blksPerRow + frameCounter*blksPerImage;
+
+  bitDepth = (func_16 ? 9 + n%8 : 8);
+  int scale = coeff_scales[(n/8) % 4];
+
+  nOutputs = 0;
+  for (int i=0;i<IDCT_SPARSE_OUTPUTS;i++) {
+    int extent = sparse_extents[i];
+    if (extent >= blkSize) {
+      break;
+    }
+
+    // coefficients outside of the top-left corner are zero
+
+    for (int yy=0;yy<blkSize;yy++)
+      for (int xx=0;xx<blkSize;xx++) {
+        int c = 0;
+        if (xx<extent && yy<extent) {
+          c = (sample(x+xx,y+yy) - sample(x+xx+1,y+yy)) * scale;
+        }
+
+        coeffs[xx+yy*blkSize] = libde265_max(-32768, libde265_min(32767, c));
+      }
+
+    uint8_t* dst = output(nOutputs++);
+
+    if (func_8) {
+      fillPrediction(dst, x,y);
+      func_8(dst, coeffs, blkSize, extent);
+    }
+    else {
+      fillPrediction((uint16_t*)dst, x,y);
+      func_16((uint16_t*)dst, coeffs, blkSize, extent, bitDepth);
+    }
+  }
+}
+
+
+bool DSPFunc_IDCT_Sparse::compareToReferenceImplementation()
+{
+  DSPFunc_IDCT_Sparse* ref = dynamic_cast<DSPFunc_IDCT_Sparse*>(referenceImplementation());
+
+  if (nOutputs != ref->nOutputs) {
+    return false;
+  }
+
+  const int bytesPerSample = (func_8 ? 1 : 2);
+
+  for (int i=0;i<nOutputs;i++) {
+    if (memcmp(output(i), ref->output(i), blkSize*blkSize*bytesPerSample) != 0) {
+      fprintf(stderr,"%s: mismatch for extent %d, %d bit\n",
+              name(), sparse_extents[i], bitDepth);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+bool DSPFunc_IDCT_Sparse::prepareNextImage(std::shared_ptr<const de265_image> img)
+{
+  samples.set(img);
+
+  blksPerRow   = samples.getWidth() /blkSize;
+  blksPerImage = samples.getHeight()/blkSize * blksPerRow;
+
+  frameCounter++;
+
+  return true;
+}
+
+
+
+// --- residuals ---
+
+static const int residual_scales[4] = { 1,16,256,4096 };
+
+
+static int16_t clip_int16(int v)
+{
+  return libde265_max(-32768, libde265_min(32767, v));
+}
+
+
+void DSPFunc_AddResidual::init(const char* name, DSPFunc* ref, bool avx2)
+{
+  funcName = name;
+  refImpl  = ref;
+  requiresAVX2 = avx2;
+
+  func_8  = NULL;
+  func_16 = NULL;
+
+  bitDepth = 8;
+
+  blksPerRow = blksPerImage = 0;
+  frameCounter = -1;
+
+  residual = new int32_t[RESIDUAL_BLK_SIZE*RESIDUAL_BLK_SIZE];
+  out = new uint8_t[4*RESIDUAL_BLK_SIZE*RESIDUAL_BLK_SIZE*2]();
+}
+
+
+DSPFunc_AddResidual::DSPFunc_AddResidual(const char* name, add_8_func f,
+                                         DSPFunc* ref, bool avx2)
+  : samples(RESIDUAL_BORDER)
+{
+  init(name,ref,avx2);
+  func_8 = f;
+}
+
+
+DSPFunc_AddResidual::DSPFunc_AddResidual(const char* name, add_16_func f,
+                                         DSPFunc* ref, bool avx2)
+  : samples(RESIDUAL_BORDER)
+{
+  init(name,ref,avx2);
+  func_16 = f;
+}
+
+
+int DSPFunc_AddResidual::sample(int x,int y) const
+{
+  if (bitDepth==8) return *samples.pixels_8(x,y);
+  else             return *samples.pixels(bitDepth, x,y);
+}
+
+
+void DSPFunc_AddResidual::runOnBlock(int x,int y)
+{
+  int n = x/RESIDUAL_BLK_SIZE + y/RESIDUAL_BLK_SIZE*blksPerRow + frameCounter*blksPerImage;
+
+  bitDepth = (func_16 ? 9 + n%8 : 8);
+  int scale = residual_scales[(n/8) % 4];
+
+  // the prediction is written with the stride of the largest block
+
+  for (int i=0;i<4;i++) {
+    int nT = 4<<i;
+
+    for (int yy=0;yy<nT;yy++)
+      for (int xx=0;xx<nT;xx++) {
+        residual[xx+yy*nT] = clip_int16((sample(x+xx,y+yy+1) - sample(x+xx,y+yy)) * scale);
+      }
+
+    if (func_8) {
+      uint8_t* dst = output(i);
+      for (int yy=0;yy<nT;yy++)
+        for (int xx=0;xx<nT;xx++) {
+          dst[xx+yy*RESIDUAL_BLK_SIZE] = sample(x+xx,y+yy);
+        }
+
+      func_8(dst, RESIDUAL_BLK_SIZE, residual, nT, bitDepth);
+    }
+    else {
+      uint16_t* dst = (uint16_t*)output(i);
+      for (int yy=0;yy<nT;yy++)
+        for (int xx=0;xx<nT;xx++) {
+          dst[xx+yy*RESIDUAL_BLK_SIZE] = sample(x+xx,y+yy);
+        }
+
+      func_16(dst, RESIDUAL_BLK_SIZE, residual, nT, bitDepth);
+    }
+  }
+}
+
+
+bool DSPFunc_AddResidual::compareToReferenceImplementation()
+{
+  DSPFunc_AddResidual* ref = dynamic_cast<DSPFunc_AddResidual*>(referenceImplementation());
+
+  // the output blocks are compared completely, samples outside of the block must not change
+
+  for (int i=0;i<4;i++) {
+    if (memcmp(output(i), ref->output(i), RESIDUAL_BLK_SIZE*RESIDUAL_BLK_SIZE*2) != 0) {
+      fprintf(stderr,"%s: mismatch in %dx%d block, %d bit\n",
+              name(), 4<<i, 4<<i, bitDepth);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+bool DSPFunc_AddResidual::prepareNextImage(std::shared_ptr<const de265_image> img)
+{
+  samples.set(img);
+
+  blksPerRow   = samples.getWidth() /RESIDUAL_BLK_SIZE;
+  blksPerImage = samples.getHeight()/RESIDUAL_BLK_SIZE * blksPerRow;
+
+  frameCounter++;
+
+  return true;
+}
+
+
+
+static const char* residual_func_names[6] = {
+  "transform_skip_residual", "rdpcm_v", "rdpcm_h",
+  "transform_bypass", "transform_bypass_rdpcm_v", "transform_bypass_rdpcm_h"
+};
+
+
+DSPFunc_Residual::DSPFunc_Residual(const char* name,
+                                   shift_func skip, shift_func rdpcm_v, shift_func rdpcm_h,
+                                   bypass_func bypass, bypass_func bypass_rdpcm_v,
+                                   bypass_func bypass_rdpcm_h,
+                                   DSPFunc* ref, bool avx2)
+  : samples(RESIDUAL_BORDER)
+{
+  funcName = name;
+  refImpl  = ref;
+  requiresAVX2 = avx2;
+
+  func_shift[0] = skip;
+  func_shift[1] = rdpcm_v;
+  func_shift[2] = rdpcm_h;
+  func_bypass[0] = bypass;
+  func_bypass[1] = bypass_rdpcm_v;
+  func_bypass[2] = bypass_rdpcm_h;
+
+  bitDepth = 8;
+
+  blksPerRow = blksPerImage = 0;
+  frameCounter = -1;
+
+  coeffs = new int16_t[RESIDUAL_BLK_SIZE*RESIDUAL_BLK_SIZE];
+  out = new int32_t[4*6*RESIDUAL_BLK_SIZE*RESIDUAL_BLK_SIZE]();
+}
+
+
+void DSPFunc_Residual::runOnBlock(int x,int y)
+{
+  int n = x/RESIDUAL_BLK_SIZE + y/RESIDUAL_BLK_SIZE*blksPerRow + frameCounter*blksPerImage;
+
+  bitDepth = 8 + n%9;
+  int scale = residual_scales[(n/9) % 4];
+
+  for (int i=0;i<4;i++) {
+    int log2nT = 2+i;
+    int nT = 1<<log2nT;
+
+    for (int yy=0;yy<nT;yy++)
+      for (int xx=0;xx<nT;xx++) {
+        int d = *samples.pixels_8(x+xx,y+yy) - *samples.pixels_8(x+xx+1,y+yy);
+        coeffs[xx+yy*nT] = clip_int16(d * scale);
+      }
+
+    int bdShift = 20 - bitDepth;
+    int tsShift = 5 + log2nT;
+
+    for (int f=0;f<3;f++) {
+      func_shift[f] (output(6*i+f),   coeffs, nT, tsShift, bdShift);
+      func_bypass[f](output(6*i+3+f), coeffs, nT);
+    }
+  }
+}
+
+
+bool DSPFunc_Residual::compareToReferenceImplementation()
+{
+  DSPFunc_Residual* ref = dynamic_cast<DSPFunc_Residual*>(referenceImplementation());
+
+  for (int i=0;i<4*6;i++) {
+    if (memcmp(output(i), ref->output(i),
+               RESIDUAL_BLK_SIZE*RESIDUAL_BLK_SIZE*sizeof(int32_t)) != 0) {
+      fprintf(stderr,"%s: mismatch in %s, %dx%d block, %d bit\n",
+              name(), residual_func_names[i%6], 4<<(i/6), 4<<(i/6), bitDepth);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+bool DSPFunc_Residual::prepareNextImage(std::shared_ptr<const de265_image> img)
+{
+  samples.set(img);
+
+  blksPerRow   = samples.getWidth() /RESIDUAL_BLK_SIZE;
+  blksPerImage = samples.getHeight()/RESIDUAL_BLK_SIZE * blksPerRow;
+
+  frameCounter++;
+
+  return true;
+}
+
+
+
+// --- dequantization ---
+
+static const int dequant_counts[8] = { 1,2,7,8,9,15,33,1024 };
+
+
+DSPFunc_Dequant::DSPFunc_Dequant(const char* name, flat_func flat, scaled_func scaled,
+                                 bool table_, DSPFunc* ref, bool avx2)
+  : samples(RESIDUAL_BORDER)
+{
+  funcName = name;
+  refImpl  = ref;
+  requiresAVX2 = avx2;
+
+  func_flat   = flat;
+  func_scaled = scaled;
+  useTable    = table_;
+
+  bitDepth = 8;
+  nOutputs = 0;
+
+  blksPerRow = blksPerImage = 0;
+  frameCounter = -1;
+
+  table = new int16_t[DEQUANT_SCALE_TABLE_SIZE];
+  coeffList = new int16_t[DEQUANT_BLK_SIZE*DEQUANT_BLK_SIZE];
+  coeffPos  = new int16_t[DEQUANT_BLK_SIZE*DEQUANT_BLK_SIZE];
+  out = new int16_t[DEQUANT_MAX_OUTPUTS*DEQUANT_BLK_SIZE*DEQUANT_BLK_SIZE]();
+}
+
+
+int DSPFunc_Dequant::codedFactor(int x,int y) const
+{
+  return 1 + *samples.pixels_8(x % samples.getWidth(), y % samples.getHeight()) % 255;
+}
+
+
+/* Scaling lists as they are derived from the coded lists (7.4.5): the coded 8x8 lists
+   of the 16x16 and 32x32 matrices are upsampled, with a separate DC factor. The coded
+   factors (1-255) are taken from the frame, from different areas for each list.
+ */
+void DSPFunc_Dequant::fillScalingLists(int n)
+{
+  if (n&1) {
+    set_default_scaling_lists(&scalingLists);
+    return;
+  }
+
+  const int row = 8*((n/2) % 8);
+
+  for (int matrixId=0;matrixId<6;matrixId++) {
+    const int col = 8*matrixId;
+
+    for (int y=0;y<32;y++)
+      for (int x=0;x<32;x++) {
+        if (x<4 && y<4) {
+          scalingLists.ScalingFactor_Size0[matrixId][y][x] = codedFactor(col+x, row+y);
+        }
+
+        if (x<8 && y<8) {
+          scalingLists.ScalingFactor_Size1[matrixId][y][x] = codedFactor(col+x, row+y+48);
+        }
+
+        if (x<16 && y<16) {
+          scalingLists.ScalingFactor_Size2[matrixId][y][x] = codedFactor(col+x/2, row+y/2+96);
+        }
+
+        if (matrixId==0 || matrixId==3) {
+          scalingLists.ScalingFactor_Size3[matrixId/3][y][x] = codedFactor(col+x/4, row+y/4+144);
+        }
+      }
+
+    // DC factors
+
+    scalingLists.ScalingFactor_Size2[matrixId][0][0] = codedFactor(col, row+192);
+
+    if (matrixId==0 || matrixId==3) {
+      scalingLists.ScalingFactor_Size3[matrixId/3][0][0] = codedFactor(col+1, row+192);
+    }
+  }
+}
+
+
+void DSPFunc_Dequant::computeScalingFactors(int16_t* m, int qP, int log2nT, int matrixId) const
+{
+  const int nT = 1<<log2nT;
+
+  for (int y=0;y<nT;y++)
+    for (int x=0;x<nT;x++) {
+      int f;
+      switch (log2nT) {
+      case 2: f = scalingLists.ScalingFactor_Size0[matrixId][y][x]; break;
+      case 3: f = scalingLists.ScalingFactor_Size1[matrixId][y][x]; break;
+      case 4: f = scalingLists.ScalingFactor_Size2[matrixId][y][x]; break;
+      default:
+        if (matrixId==0 || matrixId==3) {
+          f = scalingLists.ScalingFactor_Size3[matrixId/3][y][x];
+        }
+        else {
+          // 32x32 chroma: the coded 8x8 list of the 16x16 matrix, upsampled by 4, and its DC
+          if (x==0 && y==0) { f = scalingLists.ScalingFactor_Size2[matrixId][0][0]; }
+          else { f = scalingLists.ScalingFactor_Size2[matrixId][(y/4)*2+1][(x/4)*2+1]; }
+        }
+        break;
+      }
+
+      m[x+y*nT] = f * levelScale[qP%6];
+    }
+}
+
+
+void DSPFunc_Dequant::runOnBlock(int x,int y)
+{
+  int n = x/DEQUANT_BLK_SIZE + y/DEQUANT_BLK_SIZE*blksPerRow + frameCounter*blksPerImage;
+
+  bitDepth = 8 + n%9;
+  int scale = residual_scales[(n/9) % 4];
+  int maxQP = 51 + 6*(bitDepth-8);
+
+  fillScalingLists(n);
+  if (useTable) {
+    fill_dequant_scale_table(table, &scalingLists);
+  }
+
+  int16_t m[DEQUANT_BLK_SIZE*DEQUANT_BLK_SIZE];
+
+  nOutputs = 0;
+  for (int log2nT=2;log2nT<=5;log2nT++) {
+    const int nT = 1<<log2nT;
+    const int bdShift = bitDepth + log2nT - 5;
+
+    for (int qP = n%6; qP<=maxQP; qP+=6) {
+      // distinct positions in a pseudo-random order, the number of coefficients varies
+
+      int nCoeff = libde265_min(nT*nT, dequant_counts[(n+qP) % 8]);
+      int step = 2*((n+qP) % 16)+1;
+
+      for (int i=0;i<nCoeff;i++) {
+        coeffPos[i] = (i*step + qP) % (nT*nT);
+
+        int d = *samples.pixels_8(x + i%32, y + i/32) - *samples.pixels_8(x + i%32 + 1, y + i/32);
+        coeffList[i] = clip_int16(d * scale);
+      }
+
+      // flat scaling and the six scaling matrices
+
+      for (int matrixId=-1;matrixId<6;matrixId++) {
+        int16_t* coeffBuf = output(nOutputs++);
+        memset(coeffBuf, 0, nT*nT*sizeof(int16_t));
+
+        if (matrixId<0) {
+          func_flat(coeffBuf, coeffList, coeffPos, nCoeff, 16*levelScale[qP%6], qP/6, bdShift);
+        }
+        else {
+          const int16_t* factors = m;
+          if (useTable) {
+            factors = table + dequant_scale_table_offset(qP, log2nT, matrixId);
+          }
+          else {
+            computeScalingFactors(m, qP, log2nT, matrixId);
+          }
+
+          func_scaled(coeffBuf, coeffList, coeffPos, nCoeff, factors, qP/6, bdShift);
+        }
+      }
+    }
+  }
+}
+
+
+bool DSPFunc_Dequant::compareToReferenceImplementation()
+{
+  DSPFunc_Dequant* ref = dynamic_cast<DSPFunc_Dequant*>(referenceImplementation());
+
+  if (nOutputs != ref->nOutputs) {
+    return false;
+  }
+
+  for (int i=0;i<nOutputs;i++) {
+    if (memcmp(output(i), ref->output(i),
+               DEQUANT_BLK_SIZE*DEQUANT_BLK_SIZE*sizeof(int16_t)) != 0) {
+      fprintf(stderr,"%s: mismatch in output %d, %d bit\n", name(), i, bitDepth);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+bool DSPFunc_Dequant::prepareNextImage(std::shared_ptr<const de265_image> img)
+{
+  samples.set(img);
+
+  blksPerRow   = samples.getWidth() /DEQUANT_BLK_SIZE;
+  blksPerImage = samples.getHeight()/DEQUANT_BLK_SIZE * blksPerRow;
+
+  frameCounter++;
+
+  return true;
+}
@@ -23,6 +23,7 @@
 
 #include "acceleration-speed.h"
 #include "libde265/fallback-dct.h"
+#include "libde265/sps.h"
 
 
 class DSPFunc_FDCT_Base : public DSPFunc
@@ -108,4 +109,241 @@ protected:
 };
 
 
+
+
+/* iDCT of blocks with non-zero coefficients only in the top-left 'extent' x 'extent'
+   corner. Each block is transformed with all extents that are smaller than the block
+   size (1, 4, 8), as in the decoder, and added to a prediction block taken from the
+   frame. The coefficients are differences between neighboring samples, scaled with
+   a factor that increases with the block number up to the int16 range, such that the
+   results are clipped.
+ */
+
+#define IDCT_SPARSE_BORDER  16
+#define IDCT_SPARSE_OUTPUTS 3
+
+class DSPFunc_IDCT_Sparse : public DSPFunc
+{
+public:
+  typedef void (*sparse_8_func)(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent);
+  typedef void (*sparse_16_func)(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                 int extent, int bit_depth);
+
+  DSPFunc_IDCT_Sparse(const char* name, int nT, sparse_8_func f,
+                      DSPFunc* ref=NULL, bool avx2=false);
+  DSPFunc_IDCT_Sparse(const char* name, int nT, sparse_16_func f,
+                      DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual const char* name() const { return funcName; }
+
+  virtual int getBlkWidth()  const { return blkSize; }
+  virtual int getBlkHeight() const { return blkSize; }
+
+  virtual void runOnBlock(int x,int y);
+  virtual DSPFunc* referenceImplementation() const { return refImpl; }
+
+  virtual bool compareToReferenceImplementation();
+  virtual bool prepareNextImage(std::shared_ptr<const de265_image> img);
+
+private:
+  void init(const char* name, int nT, DSPFunc* ref, bool avx2);
+
+  template <class pixel_t> void fillPrediction(pixel_t* dst, int x,int y) const;
+
+  int sample(int x,int y) const;
+
+  uint8_t* output(int i) const { return out + i*blkSize*blkSize*2; }
+
+  const char* funcName;
+  DSPFunc*    refImpl;
+
+  sparse_8_func  func_8;
+  sparse_16_func func_16;
+
+  int blkSize;
+  int bitDepth;
+  int nOutputs;
+
+  SamplePlanes samples;
+  int blksPerRow;
+  int blksPerImage;
+  int frameCounter;
+
+  int16_t* coeffs;
+  uint8_t* out; // [IDCT_SPARSE_OUTPUTS][blkSize*blkSize] 16-bit samples
+};
+
+
+
+/* Residuals without transform and adding the residual to the prediction. All block
+   sizes are run for each block, with bit depth 8 or 9-16. The coefficients and the
+   residuals are differences between neighboring samples, scaled with a factor that
+   increases with the block number up to the int16 range.
+ */
+
+#define RESIDUAL_BLK_SIZE 32
+#define RESIDUAL_BORDER   16
+
+
+// add_residual for all block sizes, the prediction is taken from the frame
+
+class DSPFunc_AddResidual : public DSPFunc
+{
+public:
+  typedef void (*add_8_func)(uint8_t *dst, ptrdiff_t stride, const int32_t* r, int nT,
+                             int bit_depth);
+  typedef void (*add_16_func)(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT,
+                              int bit_depth);
+
+  DSPFunc_AddResidual(const char* name, add_8_func f, DSPFunc* ref=NULL, bool avx2=false);
+  DSPFunc_AddResidual(const char* name, add_16_func f, DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual const char* name() const { return funcName; }
+
+  virtual int getBlkWidth()  const { return RESIDUAL_BLK_SIZE; }
+  virtual int getBlkHeight() const { return RESIDUAL_BLK_SIZE; }
+
+  virtual void runOnBlock(int x,int y);
+  virtual DSPFunc* referenceImplementation() const { return refImpl; }
+
+  virtual bool compareToReferenceImplementation();
+  virtual bool prepareNextImage(std::shared_ptr<const de265_image> img);
+
+private:
+  void init(const char* name, DSPFunc* ref, bool avx2);
+
+  int sample(int x,int y) const;
+
+  uint8_t* output(int i) const { return out + i*RESIDUAL_BLK_SIZE*RESIDUAL_BLK_SIZE*2; }
+
+  const char* funcName;
+  DSPFunc*    refImpl;
+
+  add_8_func  func_8;
+  add_16_func func_16;
+
+  int bitDepth;
+
+  SamplePlanes samples;
+  int blksPerRow;
+  int blksPerImage;
+  int frameCounter;
+
+  int32_t* residual;
+  uint8_t* out; // [4 block sizes][RESIDUAL_BLK_SIZE*RESIDUAL_BLK_SIZE] 16-bit samples
+};
+
+
+// transform_skip_residual, rdpcm_v/h, transform_bypass and transform_bypass_rdpcm_v/h
+// for all block sizes, with the shifts of the decoder for the selected bit depth
+
+class DSPFunc_Residual : public DSPFunc
+{
+public:
+  typedef void (*shift_func)(int32_t* residual, const int16_t* coeffs, int nT,
+                             int tsShift,int bdShift);
+  typedef void (*bypass_func)(int32_t* residual, const int16_t* coeffs, int nT);
+
+  DSPFunc_Residual(const char* name,
+                   shift_func skip, shift_func rdpcm_v, shift_func rdpcm_h,
+                   bypass_func bypass, bypass_func bypass_rdpcm_v, bypass_func bypass_rdpcm_h,
+                   DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual const char* name() const { return funcName; }
+
+  virtual int getBlkWidth()  const { return RESIDUAL_BLK_SIZE; }
+  virtual int getBlkHeight() const { return RESIDUAL_BLK_SIZE; }
+
+  virtual void runOnBlock(int x,int y);
+  virtual DSPFunc* referenceImplementation() const { return refImpl; }
+
+  virtual bool compareToReferenceImplementation();
+  virtual bool prepareNextImage(std::shared_ptr<const de265_image> img);
+
+private:
+  int32_t* output(int i) const { return out + i*RESIDUAL_BLK_SIZE*RESIDUAL_BLK_SIZE; }
+
+  const char* funcName;
+  DSPFunc*    refImpl;
+
+  shift_func  func_shift[3];  // skip, rdpcm_v, rdpcm_h
+  bypass_func func_bypass[3]; // bypass, bypass_rdpcm_v, bypass_rdpcm_h
+
+  int bitDepth;
+
+  SamplePlanes samples;
+  int blksPerRow;
+  int blksPerImage;
+  int frameCounter;
+
+  int16_t* coeffs;
+  int32_t* out; // [4 block sizes][6 functions][RESIDUAL_BLK_SIZE*RESIDUAL_BLK_SIZE]
+};
+
+
+
+/* Dequantization of coefficient lists with dequant_flat and dequant_scaled. Each block
+   is run for all block sizes, all six matrices and every qP of the block's bit depth
+   (8-16) with the same qP%6. The scaling lists alternate between the default lists and
+   lists with factors from the frame. The reference takes the scaling factors directly
+   from the scaling lists (7.4.5), the other variants use the table of the PPS
+   (fill_dequant_scale_table), such that the table is checked as well.
+ */
+
+#define DEQUANT_BLK_SIZE    32
+#define DEQUANT_MAX_OUTPUTS (4*17*7) // block sizes * qPs * (flat + 6 matrices)
+
+class DSPFunc_Dequant : public DSPFunc
+{
+public:
+  typedef void (*flat_func)(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos,
+                            int nCoeff, int m, int qPdiv6, int bdShift);
+  typedef void (*scaled_func)(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos,
+                              int nCoeff, const int16_t* m, int qPdiv6, int bdShift);
+
+  DSPFunc_Dequant(const char* name, flat_func flat, scaled_func scaled, bool useTable,
+                  DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual const char* name() const { return funcName; }
+
+  virtual int getBlkWidth()  const { return DEQUANT_BLK_SIZE; }
+  virtual int getBlkHeight() const { return DEQUANT_BLK_SIZE; }
+
+  virtual void runOnBlock(int x,int y);
+  virtual DSPFunc* referenceImplementation() const { return refImpl; }
+
+  virtual bool compareToReferenceImplementation();
+  virtual bool prepareNextImage(std::shared_ptr<const de265_image> img);
+
+private:
+  void fillScalingLists(int n);
+  int  codedFactor(int x,int y) const;
+  void computeScalingFactors(int16_t* m, int qP, int log2nT, int matrixId) const;
+
+  int16_t* output(int i) const { return out + i*DEQUANT_BLK_SIZE*DEQUANT_BLK_SIZE; }
+
+  const char* funcName;
+  DSPFunc*    refImpl;
+
+  flat_func   func_flat;
+  scaled_func func_scaled;
+  bool        useTable;
+
+  int bitDepth;
+  int nOutputs;
+
+  SamplePlanes samples;
+  int blksPerRow;
+  int blksPerImage;
+  int frameCounter;
+
+  scaling_list_data scalingLists;
+  int16_t* table;  // DEQUANT_SCALE_TABLE_SIZE
+
+  int16_t* coeffList;
+  int16_t* coeffPos;
+  int16_t* out; // [DEQUANT_MAX_OUTPUTS][DEQUANT_BLK_SIZE*DEQUANT_BLK_SIZE]
+};
+
+
 #endif
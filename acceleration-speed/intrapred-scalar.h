@@ -0,0 +1,30 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACCELERATION_SPEED_INTRAPRED_SCALAR_H
+#define ACCELERATION_SPEED_INTRAPRED_SCALAR_H
+
+#include "intrapred.h"
+
+
+extern DSPFunc_IntraPred intrapred_scalar_8;
+extern DSPFunc_IntraPred intrapred_scalar_16;
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "libde265/x86/sse-intrapred.h"
+#include "intrapred.h"
+#include "intrapred-scalar.h"
+
+
+DSPFunc_IntraPred intrapred_sse_8_func("INTRAPRED-SSE-8",
+                                       ff_hevc_intra_filter_8_sse, ff_hevc_intra_pred_planar_8_sse,
+                                       ff_hevc_intra_pred_dc_8_sse, ff_hevc_intra_pred_angular_8_sse,
+                                       &intrapred_scalar_8);
+DSPFunc_IntraPred intrapred_sse_16_func("INTRAPRED-SSE-16",
+                                        ff_hevc_intra_filter_16_sse, ff_hevc_intra_pred_planar_16_sse,
+                                        ff_hevc_intra_pred_dc_16_sse, ff_hevc_intra_pred_angular_16_sse,
+                                        &intrapred_scalar_16);
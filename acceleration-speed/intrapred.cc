@@ -0,0 +1,223 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "intrapred.h"
+
+
+static const int intra_sizes[4] = { 4,8,16,32 };
+
+// reference samples are stored with some padding on both sides
+#define INTRA_BORDER_SIZE (4*INTRA_BLK_SIZE+1 + 2*16)
+
+
+void DSPFunc_IntraPred::init(const char* name, DSPFunc* ref, bool avx2)
+{
+  funcName = name;
+  refImpl  = ref;
+  requiresAVX2 = avx2;
+
+  func_filter_8   = NULL;
+  func_planar_8   = NULL;
+  func_dc_8       = NULL;
+  func_angular_8  = NULL;
+  func_filter_16  = NULL;
+  func_planar_16  = NULL;
+  func_dc_16      = NULL;
+  func_angular_16 = NULL;
+
+  highBitDepth = false;
+  bitDepth = 8;
+  nT = INTRA_BLK_SIZE;
+  nOutputs = 0;
+
+  blksPerRow = blksPerImage = 0;
+  frameCounter = -1;
+
+  out = new uint8_t[INTRA_MAX_OUTPUTS*INTRA_BLK_SIZE*INTRA_BLK_SIZE*2]();
+}
+
+
+DSPFunc_IntraPred::DSPFunc_IntraPred(const char* name, filter_8_func filter,
+                                     planar_8_func planar, dc_8_func dc,
+                                     angular_8_func angular, DSPFunc* ref, bool avx2)
+  : samples(INTRA_BORDER)
+{
+  init(name,ref,avx2);
+
+  func_filter_8  = filter;
+  func_planar_8  = planar;
+  func_dc_8      = dc;
+  func_angular_8 = angular;
+}
+
+
+DSPFunc_IntraPred::DSPFunc_IntraPred(const char* name, filter_16_func filter,
+                                     planar_16_func planar, dc_16_func dc,
+                                     angular_16_func angular, DSPFunc* ref, bool avx2)
+  : samples(INTRA_BORDER)
+{
+  init(name,ref,avx2);
+
+  func_filter_16  = filter;
+  func_planar_16  = planar;
+  func_dc_16      = dc;
+  func_angular_16 = angular;
+
+  highBitDepth = true;
+}
+
+
+template <class pixel_t>
+void DSPFunc_IntraPred::fillBorder(pixel_t* border, int x,int y, bool extreme) const
+{
+  const int maxval = (1<<bitDepth)-1;
+  const int w = samples.getWidth();
+  const int h = samples.getHeight();
+
+  // the top-right and bottom-left reference samples wrap around at the frame border
+
+  for (int i=-2*nT;i<=2*nT;i++) {
+    int v;
+
+    if (extreme) {
+      v = (((i*7) ^ (x+y)) & 4) ? maxval : 0;
+    }
+    else {
+      int sx = (i>=0 ? (x-1+i) % w : x-1);
+      int sy = (i>=0 ? y-1 : (y-1-i) % h);
+
+      if (bitDepth==8) v = *samples.pixels_8(sx,sy);
+      else             v = *samples.pixels(bitDepth, sx,sy);
+    }
+
+    border[i] = v;
+  }
+}
+
+
+template <class pixel_t>
+void DSPFunc_IntraPred::predict(pixel_t* border, pixel_t* filtered)
+{
+  nOutputs = 0;
+
+  // reference sample filters, the filtered samples are written to the output
+
+  const int borderBytes = (4*nT+1)*sizeof(pixel_t);
+
+  for (int strong=0; strong <= (nT==32); strong++) {
+    memcpy(filtered-2*nT, border-2*nT, borderBytes);
+
+    if (highBitDepth) func_filter_16((uint16_t*)filtered, nT, strong);
+    else              func_filter_8 ((uint8_t*)filtered, nT, strong);
+
+    memcpy(output(nOutputs++), filtered-2*nT, borderBytes);
+  }
+
+  // predictions from the filtered (luma) and unfiltered (chroma) reference samples
+
+  for (int cIdx=0;cIdx<2;cIdx++) {
+    const pixel_t* b = (cIdx==0 ? filtered : border);
+
+    if (highBitDepth) {
+      func_planar_16((uint16_t*)output(nOutputs++), INTRA_BLK_SIZE,
+                     (const uint16_t*)b, nT, bitDepth);
+      func_dc_16((uint16_t*)output(nOutputs++), INTRA_BLK_SIZE,
+                 (const uint16_t*)b, nT, cIdx, bitDepth);
+    }
+    else {
+      func_planar_8(output(nOutputs++), INTRA_BLK_SIZE, (const uint8_t*)b, nT);
+      func_dc_8(output(nOutputs++), INTRA_BLK_SIZE, (const uint8_t*)b, nT, cIdx);
+    }
+
+    for (int mode=2;mode<=34;mode++)
+      for (int disableBoundaryFilter=0;disableBoundaryFilter<2;disableBoundaryFilter++) {
+        if (highBitDepth) {
+          func_angular_16((uint16_t*)output(nOutputs++), INTRA_BLK_SIZE,
+                          (const uint16_t*)b, nT, mode, cIdx, disableBoundaryFilter, bitDepth);
+        }
+        else {
+          func_angular_8(output(nOutputs++), INTRA_BLK_SIZE,
+                         (const uint8_t*)b, nT, mode, cIdx, disableBoundaryFilter);
+        }
+      }
+  }
+}
+
+
+void DSPFunc_IntraPred::runOnBlock(int x,int y)
+{
+  int n = x/INTRA_BLK_SIZE + y/INTRA_BLK_SIZE*blksPerRow + frameCounter*blksPerImage;
+
+  bitDepth = (highBitDepth ? 9 + n%8 : 8);
+  nT = intra_sizes[(n/8) % 4];
+  bool extreme = ((n/32) & 1);
+
+  if (highBitDepth) {
+    uint16_t border[INTRA_BORDER_SIZE] = { 0 };
+    uint16_t filtered[INTRA_BORDER_SIZE] = { 0 };
+
+    fillBorder(border + INTRA_BORDER_SIZE/2, x,y, extreme);
+    predict(border + INTRA_BORDER_SIZE/2, filtered + INTRA_BORDER_SIZE/2);
+  }
+  else {
+    uint8_t border[INTRA_BORDER_SIZE] = { 0 };
+    uint8_t filtered[INTRA_BORDER_SIZE] = { 0 };
+
+    fillBorder(border + INTRA_BORDER_SIZE/2, x,y, extreme);
+    predict(border + INTRA_BORDER_SIZE/2, filtered + INTRA_BORDER_SIZE/2);
+  }
+}
+
+
+bool DSPFunc_IntraPred::compareToReferenceImplementation()
+{
+  DSPFunc_IntraPred* ref = dynamic_cast<DSPFunc_IntraPred*>(referenceImplementation());
+
+  if (nOutputs != ref->nOutputs) {
+    return false;
+  }
+
+  // the outputs are compared completely, the prediction must not write outside of the block
+
+  const int outputBytes = INTRA_BLK_SIZE*INTRA_BLK_SIZE*2;
+
+  for (int i=0;i<nOutputs;i++) {
+    if (memcmp(output(i), ref->output(i), outputBytes) != 0) {
+      fprintf(stderr,"%s: mismatch in output %d, %dx%d block, %d bit\n",
+              name(), i, nT,nT, bitDepth);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+bool DSPFunc_IntraPred::prepareNextImage(std::shared_ptr<const de265_image> img)
+{
+  samples.set(img);
+
+  blksPerRow   = samples.getWidth() /INTRA_BLK_SIZE;
+  blksPerImage = samples.getHeight()/INTRA_BLK_SIZE * blksPerRow;
+
+  frameCounter++;
+
+  return true;
+}
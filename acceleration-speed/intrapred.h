@@ -0,0 +1,113 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACCELERATION_SPEED_INTRAPRED_H
+#define ACCELERATION_SPEED_INTRAPRED_H
+
+#include "acceleration-speed.h"
+#include "libde265/fallback-intrapred.h"
+
+
+/* Intra prediction. The reference samples of each block are taken from the row above
+   and the column to the left of the block. Every other group of 32 blocks gets reference
+   samples alternating between 0 and the maximum value instead, to cover the value
+   range of the arithmetic. Each block is run through the reference sample filters,
+   planar and DC prediction, and all angular modes.
+ */
+
+#define INTRA_BLK_SIZE    32  // also the row stride of the output blocks
+#define INTRA_BORDER      16  // padding around the sample planes
+#define INTRA_MAX_OUTPUTS (2+2+2+33*4)
+
+
+class DSPFunc_IntraPred : public DSPFunc
+{
+public:
+  typedef void (*filter_8_func)(uint8_t *border, int nT, bool strong);
+  typedef void (*planar_8_func)(uint8_t *dst, ptrdiff_t dststride,
+                                const uint8_t *border, int nT);
+  typedef void (*dc_8_func)(uint8_t *dst, ptrdiff_t dststride,
+                            const uint8_t *border, int nT, int cIdx);
+  typedef void (*angular_8_func)(uint8_t *dst, ptrdiff_t dststride,
+                                 const uint8_t *border, int nT, int mode, int cIdx,
+                                 bool disableBoundaryFilter);
+
+  typedef void (*filter_16_func)(uint16_t *border, int nT, bool strong);
+  typedef void (*planar_16_func)(uint16_t *dst, ptrdiff_t dststride,
+                                 const uint16_t *border, int nT, int bit_depth);
+  typedef void (*dc_16_func)(uint16_t *dst, ptrdiff_t dststride,
+                             const uint16_t *border, int nT, int cIdx, int bit_depth);
+  typedef void (*angular_16_func)(uint16_t *dst, ptrdiff_t dststride,
+                                  const uint16_t *border, int nT, int mode, int cIdx,
+                                  bool disableBoundaryFilter, int bit_depth);
+
+  DSPFunc_IntraPred(const char* name, filter_8_func filter, planar_8_func planar,
+                    dc_8_func dc, angular_8_func angular,
+                    DSPFunc* ref=NULL, bool avx2=false);
+  DSPFunc_IntraPred(const char* name, filter_16_func filter, planar_16_func planar,
+                    dc_16_func dc, angular_16_func angular,
+                    DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual const char* name() const { return funcName; }
+
+  virtual int getBlkWidth()  const { return INTRA_BLK_SIZE; }
+  virtual int getBlkHeight() const { return INTRA_BLK_SIZE; }
+
+  virtual void runOnBlock(int x,int y);
+  virtual DSPFunc* referenceImplementation() const { return refImpl; }
+
+  virtual bool compareToReferenceImplementation();
+  virtual bool prepareNextImage(std::shared_ptr<const de265_image> img);
+
+private:
+  void init(const char* name, DSPFunc* ref, bool avx2);
+
+  template <class pixel_t> void fillBorder(pixel_t* border, int x,int y, bool extreme) const;
+  template <class pixel_t> void predict(pixel_t* border, pixel_t* filtered);
+
+  uint8_t* output(int i) const { return out + i*INTRA_BLK_SIZE*INTRA_BLK_SIZE*2; }
+
+  const char* funcName;
+  DSPFunc*    refImpl;
+
+  filter_8_func   func_filter_8;
+  planar_8_func   func_planar_8;
+  dc_8_func       func_dc_8;
+  angular_8_func  func_angular_8;
+  filter_16_func  func_filter_16;
+  planar_16_func  func_planar_16;
+  dc_16_func      func_dc_16;
+  angular_16_func func_angular_16;
+
+  bool highBitDepth;
+  int  bitDepth;
+  int  nT;
+  int  nOutputs;
+
+  SamplePlanes samples;
+  int blksPerRow;
+  int blksPerImage;
+  int frameCounter;
+
+  uint8_t* out; // [INTRA_MAX_OUTPUTS][INTRA_BLK_SIZE*INTRA_BLK_SIZE] 16-bit samples
+};
+
+
+#endif
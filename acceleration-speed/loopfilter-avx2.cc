@@ -0,0 +1,57 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "libde265/x86/avx2-deblock.h"
+#include "libde265/x86/avx2-sao.h"
+#include "loopfilter.h"
+#include "loopfilter-scalar.h"
+
+
+DSPFunc_Deblock deblock_luma_v_avx2_8_func("DEBLOCK-LUMA-V-AVX2-8", ff_hevc_deblock_luma_v_8_avx2, true,
+                                           &deblock_luma_v_scalar_8, true);
+DSPFunc_Deblock deblock_luma_h_avx2_8_func("DEBLOCK-LUMA-H-AVX2-8", ff_hevc_deblock_luma_h_8_avx2, false,
+                                           &deblock_luma_h_scalar_8, true);
+DSPFunc_Deblock deblock_chroma_v_avx2_8_func("DEBLOCK-CHROMA-V-AVX2-8", ff_hevc_deblock_chroma_v_8_avx2, true,
+                                             &deblock_chroma_v_scalar_8, true);
+DSPFunc_Deblock deblock_chroma_h_avx2_8_func("DEBLOCK-CHROMA-H-AVX2-8", ff_hevc_deblock_chroma_h_8_avx2, false,
+                                             &deblock_chroma_h_scalar_8, true);
+
+DSPFunc_Deblock deblock_luma_v_avx2_16_func("DEBLOCK-LUMA-V-AVX2-16", ff_hevc_deblock_luma_v_16_avx2, true,
+                                            &deblock_luma_v_scalar_16, true);
+DSPFunc_Deblock deblock_luma_h_avx2_16_func("DEBLOCK-LUMA-H-AVX2-16", ff_hevc_deblock_luma_h_16_avx2, false,
+                                            &deblock_luma_h_scalar_16, true);
+DSPFunc_Deblock deblock_chroma_v_avx2_16_func("DEBLOCK-CHROMA-V-AVX2-16", ff_hevc_deblock_chroma_v_16_avx2, true,
+                                              &deblock_chroma_v_scalar_16, true);
+DSPFunc_Deblock deblock_chroma_h_avx2_16_func("DEBLOCK-CHROMA-H-AVX2-16", ff_hevc_deblock_chroma_h_16_avx2, false,
+                                              &deblock_chroma_h_scalar_16, true);
+
+
+static const DSPFunc_SAO::edge_8_func sao_edge_8_avx2[4] = {
+  ff_hevc_sao_edge_0_8_avx2, ff_hevc_sao_edge_1_8_avx2, ff_hevc_sao_edge_2_8_avx2, ff_hevc_sao_edge_3_8_avx2
+};
+static const DSPFunc_SAO::edge_16_func sao_edge_16_avx2[4] = {
+  ff_hevc_sao_edge_0_16_avx2, ff_hevc_sao_edge_1_16_avx2, ff_hevc_sao_edge_2_16_avx2, ff_hevc_sao_edge_3_16_avx2
+};
+
+DSPFunc_SAO sao_band_avx2_8_func("SAO-BAND-AVX2-8", ff_hevc_sao_band_8_avx2, &sao_band_scalar_8, true);
+DSPFunc_SAO sao_edge_avx2_8_func("SAO-EDGE-AVX2-8", sao_edge_8_avx2, &sao_edge_scalar_8, true);
+DSPFunc_SAO sao_band_avx2_16_func("SAO-BAND-AVX2-16", ff_hevc_sao_band_16_avx2, &sao_band_scalar_16, true);
+DSPFunc_SAO sao_edge_avx2_16_func("SAO-EDGE-AVX2-16", sao_edge_16_avx2, &sao_edge_scalar_16, true);
@@ -0,0 +1,45 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "loopfilter-scalar.h"
+
+
+DSPFunc_Deblock deblock_luma_v_scalar_8("DEBLOCK-LUMA-V-Scalar-8", deblock_luma_v_8_fallback, true);
+DSPFunc_Deblock deblock_luma_h_scalar_8("DEBLOCK-LUMA-H-Scalar-8", deblock_luma_h_8_fallback, false);
+DSPFunc_Deblock deblock_chroma_v_scalar_8("DEBLOCK-CHROMA-V-Scalar-8", deblock_chroma_v_8_fallback, true);
+DSPFunc_Deblock deblock_chroma_h_scalar_8("DEBLOCK-CHROMA-H-Scalar-8", deblock_chroma_h_8_fallback, false);
+
+DSPFunc_Deblock deblock_luma_v_scalar_16("DEBLOCK-LUMA-V-Scalar-16", deblock_luma_v_16_fallback, true);
+DSPFunc_Deblock deblock_luma_h_scalar_16("DEBLOCK-LUMA-H-Scalar-16", deblock_luma_h_16_fallback, false);
+DSPFunc_Deblock deblock_chroma_v_scalar_16("DEBLOCK-CHROMA-V-Scalar-16", deblock_chroma_v_16_fallback, true);
+DSPFunc_Deblock deblock_chroma_h_scalar_16("DEBLOCK-CHROMA-H-Scalar-16", deblock_chroma_h_16_fallback, false);
+
+
+static const DSPFunc_SAO::edge_8_func sao_edge_8_fallback[4] = {
+  sao_edge_0_8_fallback, sao_edge_1_8_fallback, sao_edge_2_8_fallback, sao_edge_3_8_fallback
+};
+static const DSPFunc_SAO::edge_16_func sao_edge_16_fallback[4] = {
+  sao_edge_0_16_fallback, sao_edge_1_16_fallback, sao_edge_2_16_fallback, sao_edge_3_16_fallback
+};
+
+DSPFunc_SAO sao_band_scalar_8("SAO-BAND-Scalar-8", sao_band_8_fallback);
+DSPFunc_SAO sao_edge_scalar_8("SAO-EDGE-Scalar-8", sao_edge_8_fallback);
+DSPFunc_SAO sao_band_scalar_16("SAO-BAND-Scalar-16", sao_band_16_fallback);
+DSPFunc_SAO sao_edge_scalar_16("SAO-EDGE-Scalar-16", sao_edge_16_fallback);
@@ -0,0 +1,57 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "libde265/x86/sse-deblock.h"
+#include "libde265/x86/sse-sao.h"
+#include "loopfilter.h"
+#include "loopfilter-scalar.h"
+
+
+DSPFunc_Deblock deblock_luma_v_sse_8_func("DEBLOCK-LUMA-V-SSE-8", ff_hevc_deblock_luma_v_8_sse, true,
+                                          &deblock_luma_v_scalar_8);
+DSPFunc_Deblock deblock_luma_h_sse_8_func("DEBLOCK-LUMA-H-SSE-8", ff_hevc_deblock_luma_h_8_sse, false,
+                                          &deblock_luma_h_scalar_8);
+DSPFunc_Deblock deblock_chroma_v_sse_8_func("DEBLOCK-CHROMA-V-SSE-8", ff_hevc_deblock_chroma_v_8_sse, true,
+                                            &deblock_chroma_v_scalar_8);
+DSPFunc_Deblock deblock_chroma_h_sse_8_func("DEBLOCK-CHROMA-H-SSE-8", ff_hevc_deblock_chroma_h_8_sse, false,
+                                            &deblock_chroma_h_scalar_8);
+
+DSPFunc_Deblock deblock_luma_v_sse_16_func("DEBLOCK-LUMA-V-SSE-16", ff_hevc_deblock_luma_v_16_sse, true,
+                                           &deblock_luma_v_scalar_16);
+DSPFunc_Deblock deblock_luma_h_sse_16_func("DEBLOCK-LUMA-H-SSE-16", ff_hevc_deblock_luma_h_16_sse, false,
+                                           &deblock_luma_h_scalar_16);
+DSPFunc_Deblock deblock_chroma_v_sse_16_func("DEBLOCK-CHROMA-V-SSE-16", ff_hevc_deblock_chroma_v_16_sse, true,
+                                             &deblock_chroma_v_scalar_16);
+DSPFunc_Deblock deblock_chroma_h_sse_16_func("DEBLOCK-CHROMA-H-SSE-16", ff_hevc_deblock_chroma_h_16_sse, false,
+                                             &deblock_chroma_h_scalar_16);
+
+
+static const DSPFunc_SAO::edge_8_func sao_edge_8_sse[4] = {
+  ff_hevc_sao_edge_0_8_sse, ff_hevc_sao_edge_1_8_sse, ff_hevc_sao_edge_2_8_sse, ff_hevc_sao_edge_3_8_sse
+};
+static const DSPFunc_SAO::edge_16_func sao_edge_16_sse[4] = {
+  ff_hevc_sao_edge_0_16_sse, ff_hevc_sao_edge_1_16_sse, ff_hevc_sao_edge_2_16_sse, ff_hevc_sao_edge_3_16_sse
+};
+
+DSPFunc_SAO sao_band_sse_8_func("SAO-BAND-SSE-8", ff_hevc_sao_band_8_sse, &sao_band_scalar_8);
+DSPFunc_SAO sao_edge_sse_8_func("SAO-EDGE-SSE-8", sao_edge_8_sse, &sao_edge_scalar_8);
+DSPFunc_SAO sao_band_sse_16_func("SAO-BAND-SSE-16", ff_hevc_sao_band_16_sse, &sao_band_scalar_16);
+DSPFunc_SAO sao_edge_sse_16_func("SAO-EDGE-SSE-16", sao_edge_16_sse, &sao_edge_scalar_16);
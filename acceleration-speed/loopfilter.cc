@@ -0,0 +1,377 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "loopfilter.h"
+
+
+#define LF_AREA_SIZE  (LF_BLK_SIZE*LF_BLK_SIZE*2) // one plane of 16-bit samples, in bytes
+#define LF_CASE_SIZE  (2*LF_AREA_SIZE)
+
+// parameter values, in 8-bit units
+
+static const int beta_values[6] = { 0,6,16,30,47,64 };
+static const int tc_values[7]   = { 0,1,2,4,9,16,24 };
+static const int step_values[7] = { 0,3,10,-25,40,255,-255 };
+
+
+void DSPFunc_Deblock::init(const char* name, bool v, DSPFunc* ref, bool avx2)
+{
+  funcName = name;
+  refImpl  = ref;
+  requiresAVX2 = avx2;
+
+  func_luma_8    = NULL;
+  func_luma_16   = NULL;
+  func_chroma_8  = NULL;
+  func_chroma_16 = NULL;
+
+  vertical = v;
+  bitDepth = 8;
+
+  blksPerRow = blksPerImage = 0;
+  frameCounter = -1;
+
+  out = new uint8_t[LF_MAX_CASES*LF_CASE_SIZE]();
+}
+
+
+DSPFunc_Deblock::DSPFunc_Deblock(const char* name, luma_8_func f, bool v,
+                                 DSPFunc* ref, bool avx2)
+  : samples(LF_BORDER)
+{
+  init(name,v,ref,avx2);
+  func_luma_8 = f;
+}
+
+
+DSPFunc_Deblock::DSPFunc_Deblock(const char* name, luma_16_func f, bool v,
+                                 DSPFunc* ref, bool avx2)
+  : samples(LF_BORDER)
+{
+  init(name,v,ref,avx2);
+  func_luma_16 = f;
+}
+
+
+DSPFunc_Deblock::DSPFunc_Deblock(const char* name, chroma_8_func f, bool v,
+                                 DSPFunc* ref, bool avx2)
+  : samples(LF_BORDER)
+{
+  init(name,v,ref,avx2);
+  func_chroma_8 = f;
+}
+
+
+DSPFunc_Deblock::DSPFunc_Deblock(const char* name, chroma_16_func f, bool v,
+                                 DSPFunc* ref, bool avx2)
+  : samples(LF_BORDER)
+{
+  init(name,v,ref,avx2);
+  func_chroma_16 = f;
+}
+
+
+template <class pixel_t>
+void DSPFunc_Deblock::fillWorkArea(pixel_t* area, int x,int y, int step, bool flat) const
+{
+  int maxval = (1<<bitDepth)-1;
+
+  for (int yy=0;yy<LF_BLK_SIZE;yy++)
+    for (int xx=0;xx<LF_BLK_SIZE;xx++) {
+      int across = (vertical ? xx : yy);
+      bool qSide = (across >= LF_BLK_SIZE/2);
+
+      // flat areas take the sample next to the edge for the whole side
+      int sx = xx, sy = yy;
+      if (flat) {
+        int edgeSample = (qSide ? LF_BLK_SIZE/2 : LF_BLK_SIZE/2-1);
+        if (vertical) sx = edgeSample;
+        else          sy = edgeSample;
+      }
+
+      int v;
+      if (bitDepth==8) v = *samples.pixels_8(x+sx,y+sy);
+      else             v = *samples.pixels(bitDepth, x+sx,y+sy);
+
+      if (qSide) {
+        v = libde265_max(0, libde265_min(maxval, v+step));
+      }
+
+      area[xx+yy*LF_BLK_SIZE] = v;
+    }
+}
+
+
+void DSPFunc_Deblock::runOnBlock(int x,int y)
+{
+  int n = x/LF_BLK_SIZE + y/LF_BLK_SIZE*blksPerRow + frameCounter*blksPerImage;
+
+  bool highBitDepth = (func_luma_16 || func_chroma_16);
+  bitDepth = (highBitDepth ? 9 + n%8 : 8);
+
+  int scale = 1<<(bitDepth-8);
+
+  // the edge runs through the center of the work area, the segments start at sample 4
+
+  int edgeOffset = (vertical ? LF_BLK_SIZE/2 + 4*LF_BLK_SIZE : 4 + LF_BLK_SIZE/2*LF_BLK_SIZE);
+
+  // Cr is taken from the mirrored frame position
+
+  int crX = samples.getWidth()  - LF_BLK_SIZE - x;
+  int crY = samples.getHeight() - LF_BLK_SIZE - y;
+
+  for (int c=0;c<LF_MAX_CASES;c++) {
+    int beta[2], tc[2];
+    bool filterP[2], filterQ[2];
+
+    for (int s=0;s<2;s++) {
+      beta[s] = beta_values[(n + c + 3*s) % 6] * scale;
+      tc[s]   = tc_values[(3*n + c + s) % 7] * scale;
+      filterP[s] = !(c & (1<<(2*s)));
+      filterQ[s] = !(c & (2<<(2*s)));
+    }
+
+    int step = step_values[(n + 5*c) % 7] * scale;
+    bool flat = ((n + c/3) & 1);
+
+    uint8_t* area[2] = { out + c*LF_CASE_SIZE, out + c*LF_CASE_SIZE + LF_AREA_SIZE };
+
+    if (func_luma_8) {
+      fillWorkArea(area[0], x,y, step, flat);
+      func_luma_8(area[0] + edgeOffset, LF_BLK_SIZE, beta, tc, filterP, filterQ);
+    }
+    else if (func_luma_16) {
+      fillWorkArea((uint16_t*)area[0], x,y, step, flat);
+      func_luma_16((uint16_t*)area[0] + edgeOffset, LF_BLK_SIZE,
+                   beta, tc, filterP, filterQ, bitDepth);
+    }
+    else if (func_chroma_8) {
+      fillWorkArea(area[0], x,y, step, flat);
+      fillWorkArea(area[1], crX,crY, step, flat);
+      func_chroma_8(area[0] + edgeOffset, area[1] + edgeOffset, LF_BLK_SIZE,
+                    tc, filterP[0], filterQ[0]);
+    }
+    else {
+      fillWorkArea((uint16_t*)area[0], x,y, step, flat);
+      fillWorkArea((uint16_t*)area[1], crX,crY, step, flat);
+      func_chroma_16((uint16_t*)area[0] + edgeOffset, (uint16_t*)area[1] + edgeOffset,
+                     LF_BLK_SIZE, tc, filterP[0], filterQ[0], bitDepth);
+    }
+  }
+}
+
+
+bool DSPFunc_Deblock::compareToReferenceImplementation()
+{
+  DSPFunc_Deblock* ref = dynamic_cast<DSPFunc_Deblock*>(referenceImplementation());
+
+  for (int c=0;c<LF_MAX_CASES;c++) {
+    if (memcmp(out + c*LF_CASE_SIZE, ref->out + c*LF_CASE_SIZE, LF_CASE_SIZE) != 0) {
+      fprintf(stderr,"%s: mismatch in case %d, %d bit\n", name(), c, bitDepth);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+bool DSPFunc_Deblock::prepareNextImage(std::shared_ptr<const de265_image> img)
+{
+  samples.set(img);
+
+  blksPerRow   = samples.getWidth() /LF_BLK_SIZE;
+  blksPerImage = samples.getHeight()/LF_BLK_SIZE * blksPerRow;
+
+  frameCounter++;
+
+  return true;
+}
+
+
+
+// --- SAO ---
+
+#define SAO_CASE_SIZE (SAO_AREA_SIZE*SAO_AREA_SIZE*2)
+
+static const int sao_sizes[16] = { 64,63,1,2,7,8,9,15,16,17,31,32,33,48,55,62 };
+
+static const int8_t sao_offsets[8][5] = {
+  {   1,  2, 0, -2,  -1 },
+  {   7,  3, 0, -3,  -7 },
+  {  31, 15, 0, -15,-31 },
+  { 127, 64, 0, -64,-128},
+  {-128,-31, 0, 31, 127 },
+  {  -5,  0, 0,  0,   5 },
+  {   0,  0, 0,  0,   0 },
+  { 100,-100,0, 50, -50 }
+};
+
+
+void DSPFunc_SAO::init(const char* name, DSPFunc* ref, bool avx2)
+{
+  funcName = name;
+  refImpl  = ref;
+  requiresAVX2 = avx2;
+
+  func_band_8  = NULL;
+  func_band_16 = NULL;
+  for (int i=0;i<4;i++) {
+    func_edge_8[i]  = NULL;
+    func_edge_16[i] = NULL;
+  }
+
+  edge = false;
+  highBitDepth = false;
+  bitDepth = 8;
+  nCases = 0;
+
+  blksPerRow = blksPerImage = 0;
+  frameCounter = -1;
+
+  out = new uint8_t[4*SAO_MAX_CASES*SAO_CASE_SIZE]();
+}
+
+
+DSPFunc_SAO::DSPFunc_SAO(const char* name, band_8_func f, DSPFunc* ref, bool avx2)
+  : samples(LF_BORDER)
+{
+  init(name,ref,avx2);
+  func_band_8 = f;
+}
+
+
+DSPFunc_SAO::DSPFunc_SAO(const char* name, band_16_func f, DSPFunc* ref, bool avx2)
+  : samples(LF_BORDER)
+{
+  init(name,ref,avx2);
+  func_band_16 = f;
+  highBitDepth = true;
+}
+
+
+DSPFunc_SAO::DSPFunc_SAO(const char* name, const edge_8_func (&f)[4], DSPFunc* ref, bool avx2)
+  : samples(LF_BORDER)
+{
+  init(name,ref,avx2);
+  for (int i=0;i<4;i++) {
+    func_edge_8[i] = f[i];
+  }
+  edge = true;
+}
+
+
+DSPFunc_SAO::DSPFunc_SAO(const char* name, const edge_16_func (&f)[4], DSPFunc* ref, bool avx2)
+  : samples(LF_BORDER)
+{
+  init(name,ref,avx2);
+  for (int i=0;i<4;i++) {
+    func_edge_16[i] = f[i];
+  }
+  edge = true;
+  highBitDepth = true;
+}
+
+
+void DSPFunc_SAO::runOnBlock(int x,int y)
+{
+  int n = x/SAO_BLK_SIZE + y/SAO_BLK_SIZE*blksPerRow + frameCounter*blksPerImage;
+
+  bitDepth = (highBitDepth ? 9 + n%8 : 8);
+
+  // the border of the output area is set to a fixed value, the filtered area starts at (1,1)
+
+  memset(out, 0x5A, 4*SAO_MAX_CASES*SAO_CASE_SIZE);
+
+  const int outOffset = 1 + SAO_AREA_SIZE;
+  const int stride = samples.getStride();
+
+  nCases = 0;
+  for (int c=0;c<SAO_MAX_CASES;c++) {
+    int width  = sao_sizes[(n + c) % 16];
+    int height = sao_sizes[(n/16 + 3*c) % 16];
+
+    const int8_t* offsets = sao_offsets[(n + c) % 8];
+
+    if (!edge) {
+      // band offsets are the four entries around the center entry
+
+      int8_t bandOffsets[4] = { offsets[0], offsets[1], offsets[3], offsets[4] };
+      int bandPosition = (7*n + 5*c) % 32;
+
+      uint8_t* o = out + nCases*SAO_CASE_SIZE;
+      nCases++;
+
+      if (func_band_8) {
+        func_band_8(o + outOffset, SAO_AREA_SIZE, samples.pixels_8(x,y), stride,
+                    width,height, bandPosition, bandOffsets);
+      }
+      else {
+        func_band_16((uint16_t*)o + outOffset, SAO_AREA_SIZE,
+                     samples.pixels(bitDepth, x,y), stride,
+                     width,height, bandPosition, bandOffsets, bitDepth);
+      }
+    }
+    else {
+      for (int eoClass=0;eoClass<4;eoClass++) {
+        uint8_t* o = out + nCases*SAO_CASE_SIZE;
+        nCases++;
+
+        if (func_edge_8[0]) {
+          func_edge_8[eoClass](o + outOffset, SAO_AREA_SIZE, samples.pixels_8(x,y), stride,
+                               width,height, offsets);
+        }
+        else {
+          func_edge_16[eoClass]((uint16_t*)o + outOffset, SAO_AREA_SIZE,
+                                samples.pixels(bitDepth, x,y), stride,
+                                width,height, offsets, bitDepth);
+        }
+      }
+    }
+  }
+}
+
+
+bool DSPFunc_SAO::compareToReferenceImplementation()
+{
+  DSPFunc_SAO* ref = dynamic_cast<DSPFunc_SAO*>(referenceImplementation());
+
+  for (int c=0;c<nCases;c++) {
+    if (memcmp(out + c*SAO_CASE_SIZE, ref->out + c*SAO_CASE_SIZE, SAO_CASE_SIZE) != 0) {
+      fprintf(stderr,"%s: mismatch in case %d, %d bit\n", name(), c, bitDepth);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+bool DSPFunc_SAO::prepareNextImage(std::shared_ptr<const de265_image> img)
+{
+  samples.set(img);
+
+  blksPerRow   = samples.getWidth() /SAO_BLK_SIZE;
+  blksPerImage = samples.getHeight()/SAO_BLK_SIZE * blksPerRow;
+
+  frameCounter++;
+
+  return true;
+}
@@ -0,0 +1,175 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACCELERATION_SPEED_LOOPFILTER_H
+#define ACCELERATION_SPEED_LOOPFILTER_H
+
+#include "acceleration-speed.h"
+#include "libde265/fallback-deblock.h"
+#include "libde265/fallback-sao.h"
+
+
+/* In-loop filters. The filters are run on a copy of the frame area around each block
+   (the work area), which is compared completely, such that writes outside of the
+   filtered samples are detected as well.
+ */
+
+#define LF_BLK_SIZE 16
+#define LF_BORDER   16  // padding around the sample planes
+#define LF_MAX_CASES 16 // filter parameter sets per block
+
+
+// Filters an edge through the center of the work area with 16 parameter sets per block.
+// They cover all combinations of filterP/filterQ (PCM and transquant bypass), tc==0 for
+// one or both segments, beta and tc up to their maximum, flat and textured areas, and a
+// step across the edge that drives the samples on one side into the clipping range.
+
+class DSPFunc_Deblock : public DSPFunc
+{
+public:
+  typedef void (*luma_8_func)(uint8_t *ptr, ptrdiff_t stride,
+                              const int* beta, const int* tc,
+                              const bool* filterP, const bool* filterQ);
+  typedef void (*luma_16_func)(uint16_t *ptr, ptrdiff_t stride,
+                               const int* beta, const int* tc,
+                               const bool* filterP, const bool* filterQ, int bit_depth);
+  typedef void (*chroma_8_func)(uint8_t *cb, uint8_t *cr, ptrdiff_t stride,
+                                const int* tc, bool filterP, bool filterQ);
+  typedef void (*chroma_16_func)(uint16_t *cb, uint16_t *cr, ptrdiff_t stride,
+                                 const int* tc, bool filterP, bool filterQ, int bit_depth);
+
+  DSPFunc_Deblock(const char* name, luma_8_func f, bool vertical,
+                  DSPFunc* ref=NULL, bool avx2=false);
+  DSPFunc_Deblock(const char* name, luma_16_func f, bool vertical,
+                  DSPFunc* ref=NULL, bool avx2=false);
+  DSPFunc_Deblock(const char* name, chroma_8_func f, bool vertical,
+                  DSPFunc* ref=NULL, bool avx2=false);
+  DSPFunc_Deblock(const char* name, chroma_16_func f, bool vertical,
+                  DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual const char* name() const { return funcName; }
+
+  virtual int getBlkWidth()  const { return LF_BLK_SIZE; }
+  virtual int getBlkHeight() const { return LF_BLK_SIZE; }
+
+  virtual void runOnBlock(int x,int y);
+  virtual DSPFunc* referenceImplementation() const { return refImpl; }
+
+  virtual bool compareToReferenceImplementation();
+  virtual bool prepareNextImage(std::shared_ptr<const de265_image> img);
+
+private:
+  void init(const char* name, bool vertical, DSPFunc* ref, bool avx2);
+
+  // Copies the frame area at (x,y) into a work area, adding 'step' on the q side of the edge.
+  // 'flat' areas have constant samples on both sides of the edge, which selects the strong filter.
+  template <class pixel_t> void fillWorkArea(pixel_t* area, int x,int y, int step, bool flat) const;
+
+  const char* funcName;
+  DSPFunc*    refImpl;
+
+  luma_8_func    func_luma_8;
+  luma_16_func   func_luma_16;
+  chroma_8_func  func_chroma_8;
+  chroma_16_func func_chroma_16;
+
+  bool vertical;
+  int  bitDepth;
+
+  SamplePlanes samples;
+  int blksPerRow;
+  int blksPerImage;
+  int frameCounter;
+
+  uint8_t* out; // [LF_MAX_CASES][2 planes][LF_BLK_SIZE*LF_BLK_SIZE] 16-bit samples
+};
+
+
+
+#define SAO_BLK_SIZE  64
+#define SAO_AREA_SIZE (SAO_BLK_SIZE+2) // output area with a one-sample border
+#define SAO_MAX_CASES 8
+
+// Applies SAO to each 64x64 block with 8 parameter sets, all edge offset classes for the
+// edge offset kernels. The sizes of the filtered area include the odd sizes that remain
+// when the first or last row or column of a CTB is not filtered at picture and slice
+// borders, or when the CTB is cut off at the picture border. The offsets range up to the
+// int8 limits, such that the results are clipped. The output area has a border of one
+// sample, which must not be written (it is restored for PCM and bypass CUs by the caller).
+
+class DSPFunc_SAO : public DSPFunc
+{
+public:
+  typedef void (*band_8_func)(uint8_t *out, ptrdiff_t out_stride,
+                              const uint8_t *in, ptrdiff_t in_stride,
+                              int width, int height, int bandPosition, const int8_t* offsets);
+  typedef void (*band_16_func)(uint16_t *out, ptrdiff_t out_stride,
+                               const uint16_t *in, ptrdiff_t in_stride,
+                               int width, int height, int bandPosition, const int8_t* offsets,
+                               int bit_depth);
+  typedef void (*edge_8_func)(uint8_t *out, ptrdiff_t out_stride,
+                              const uint8_t *in, ptrdiff_t in_stride,
+                              int width, int height, const int8_t* offsets);
+  typedef void (*edge_16_func)(uint16_t *out, ptrdiff_t out_stride,
+                               const uint16_t *in, ptrdiff_t in_stride,
+                               int width, int height, const int8_t* offsets, int bit_depth);
+
+  DSPFunc_SAO(const char* name, band_8_func f, DSPFunc* ref=NULL, bool avx2=false);
+  DSPFunc_SAO(const char* name, band_16_func f, DSPFunc* ref=NULL, bool avx2=false);
+  DSPFunc_SAO(const char* name, const edge_8_func (&f)[4], DSPFunc* ref=NULL, bool avx2=false);
+  DSPFunc_SAO(const char* name, const edge_16_func (&f)[4], DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual const char* name() const { return funcName; }
+
+  virtual int getBlkWidth()  const { return SAO_BLK_SIZE; }
+  virtual int getBlkHeight() const { return SAO_BLK_SIZE; }
+
+  virtual void runOnBlock(int x,int y);
+  virtual DSPFunc* referenceImplementation() const { return refImpl; }
+
+  virtual bool compareToReferenceImplementation();
+  virtual bool prepareNextImage(std::shared_ptr<const de265_image> img);
+
+private:
+  void init(const char* name, DSPFunc* ref, bool avx2);
+
+  const char* funcName;
+  DSPFunc*    refImpl;
+
+  band_8_func  func_band_8;
+  band_16_func func_band_16;
+  edge_8_func  func_edge_8[4];
+  edge_16_func func_edge_16[4];
+
+  bool edge;
+  bool highBitDepth;
+  int  bitDepth;
+  int  nCases;
+
+  SamplePlanes samples;
+  int blksPerRow;
+  int blksPerImage;
+  int frameCounter;
+
+  uint8_t* out; // [SAO_MAX_CASES*4][SAO_AREA_SIZE*SAO_AREA_SIZE] 16-bit samples
+};
+
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "libde265/x86/avx2-motion.h"
+#include "motion.h"
+#include "motion-scalar.h"
+
+
+static const qpel_16_func qpel_avx2_16[4][4] = {
+  { ff_hevc_put_hevc_qpel_pixels_16_avx2,
+    ff_hevc_put_hevc_qpel_v_1_16_avx2,
+    ff_hevc_put_hevc_qpel_v_2_16_avx2,
+    ff_hevc_put_hevc_qpel_v_3_16_avx2 },
+  { ff_hevc_put_hevc_qpel_h_1_16_avx2,
+    ff_hevc_put_hevc_qpel_h_1_v_1_16_avx2,
+    ff_hevc_put_hevc_qpel_h_1_v_2_16_avx2,
+    ff_hevc_put_hevc_qpel_h_1_v_3_16_avx2 },
+  { ff_hevc_put_hevc_qpel_h_2_16_avx2,
+    ff_hevc_put_hevc_qpel_h_2_v_1_16_avx2,
+    ff_hevc_put_hevc_qpel_h_2_v_2_16_avx2,
+    ff_hevc_put_hevc_qpel_h_2_v_3_16_avx2 },
+  { ff_hevc_put_hevc_qpel_h_3_16_avx2,
+    ff_hevc_put_hevc_qpel_h_3_v_1_16_avx2,
+    ff_hevc_put_hevc_qpel_h_3_v_2_16_avx2,
+    ff_hevc_put_hevc_qpel_h_3_v_3_16_avx2 }
+};
+
+
+DSPFunc_QPel_16 qpel_avx2_16_func("QPEL-AVX2-16", qpel_avx2_16, &qpel_scalar_16, true);
+
+DSPFunc_EPel_16 epel_avx2_16_func("EPEL-AVX2-16",
+                                  ff_hevc_put_hevc_epel_pixels_16_avx2,
+                                  ff_hevc_put_hevc_epel_h_16_avx2,
+                                  ff_hevc_put_hevc_epel_v_16_avx2,
+                                  ff_hevc_put_hevc_epel_hv_16_avx2,
+                                  &epel_scalar_16, true);
+
+DSPFunc_Pred_16 pred_avx2_16_func("PRED-AVX2-16",
+                                  ff_hevc_put_unweighted_pred_16_avx2,
+                                  ff_hevc_put_weighted_pred_avg_16_avx2,
+                                  &pred_scalar_16, true);
+
+DSPFunc_Weighted_8  weighted_avx2_8_func("WEIGHTED-AVX2-8",
+                                         ff_hevc_put_weighted_pred_8_avx2,
+                                         ff_hevc_put_weighted_bipred_8_avx2,
+                                         &weighted_scalar_8, true);
+
+DSPFunc_Weighted_16 weighted_avx2_16_func("WEIGHTED-AVX2-16",
+                                          ff_hevc_put_weighted_pred_16_avx2,
+                                          ff_hevc_put_weighted_bipred_16_avx2,
+                                          &weighted_scalar_16, true);
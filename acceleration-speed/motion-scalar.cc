@@ -0,0 +1,50 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "motion-scalar.h"
+
+
+static const qpel_16_func qpel_fallback_16[4][4] = {
+  { put_qpel_0_0_fallback_16, put_qpel_0_1_fallback_16, put_qpel_0_2_fallback_16, put_qpel_0_3_fallback_16 },
+  { put_qpel_1_0_fallback_16, put_qpel_1_1_fallback_16, put_qpel_1_2_fallback_16, put_qpel_1_3_fallback_16 },
+  { put_qpel_2_0_fallback_16, put_qpel_2_1_fallback_16, put_qpel_2_2_fallback_16, put_qpel_2_3_fallback_16 },
+  { put_qpel_3_0_fallback_16, put_qpel_3_1_fallback_16, put_qpel_3_2_fallback_16, put_qpel_3_3_fallback_16 }
+};
+
+
+DSPFunc_QPel_16 qpel_scalar_16("QPEL-Scalar-16", qpel_fallback_16);
+
+DSPFunc_EPel_16 epel_scalar_16("EPEL-Scalar-16",
+                               put_epel_16_fallback,
+                               put_epel_hv_fallback<uint16_t>,
+                               put_epel_hv_fallback<uint16_t>,
+                               put_epel_hv_fallback<uint16_t>);
+
+DSPFunc_Pred_16 pred_scalar_16("PRED-Scalar-16",
+                               put_unweighted_pred_16_fallback,
+                               put_weighted_pred_avg_16_fallback);
+
+DSPFunc_Weighted_8  weighted_scalar_8("WEIGHTED-Scalar-8",
+                                      put_weighted_pred_8_fallback,
+                                      put_weighted_bipred_8_fallback);
+
+DSPFunc_Weighted_16 weighted_scalar_16("WEIGHTED-Scalar-16",
+                                       put_weighted_pred_16_fallback,
+                                       put_weighted_bipred_16_fallback);
@@ -0,0 +1,34 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACCELERATION_SPEED_MOTION_SCALAR_H
+#define ACCELERATION_SPEED_MOTION_SCALAR_H
+
+#include "motion.h"
+
+
+extern DSPFunc_QPel_16 qpel_scalar_16;
+extern DSPFunc_EPel_16 epel_scalar_16;
+extern DSPFunc_Pred_16 pred_scalar_16;
+
+extern DSPFunc_Weighted_8  weighted_scalar_8;
+extern DSPFunc_Weighted_16 weighted_scalar_16;
+
+#endif
@@ -0,0 +1,292 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "motion.h"
+
+
+static const int luma_sizes[8]   = { 4,8,12,16,24,32,48,64 };
+static const int chroma_sizes[8] = { 2,4,6,8,12,16,24,32 };
+
+
+DSPFunc_MC_Base::DSPFunc_MC_Base(const char* name, DSPFunc* ref, bool avx2)
+  : samples(MC_BORDER)
+{
+  funcName = name;
+  refImpl  = ref;
+  requiresAVX2 = avx2;
+
+  out = new int16_t[MC_MAX_OUTPUTS*MC_BLK_SIZE*MC_BLK_SIZE];
+  mcbuffer = new int16_t[MC_BLK_SIZE*(MC_BLK_SIZE+7)];
+  predSamples[0] = new int16_t[MC_BLK_SIZE*MC_BLK_SIZE];
+  predSamples[1] = new int16_t[MC_BLK_SIZE*MC_BLK_SIZE];
+
+  bitDepth = MC_MIN_BIT_DEPTH;
+  width = height = MC_BLK_SIZE;
+  nOutputs = 0;
+  bytesPerSample = 2;
+  stride = 0;
+  blksPerRow = blksPerImage = 0;
+  frameCounter = -1;
+}
+
+
+int DSPFunc_MC_Base::blockNumber(int x,int y) const
+{
+  return x/MC_BLK_SIZE + y/MC_BLK_SIZE*blksPerRow + frameCounter*blksPerImage;
+}
+
+
+void DSPFunc_MC_Base::selectBlockParameters(int x,int y, bool chroma, bool highBitDepth)
+{
+  int n = blockNumber(x,y);
+
+  const int* sizes = (chroma ? chroma_sizes : luma_sizes);
+
+  bitDepth = (highBitDepth ? MC_MIN_BIT_DEPTH + n % MC_NUM_BIT_DEPTHS : 8);
+  width  = sizes[ (n/MC_NUM_BIT_DEPTHS) % 8 ];
+  height = sizes[ (n/MC_NUM_BIT_DEPTHS + n/(MC_NUM_BIT_DEPTHS*8)) % 8 ];
+}
+
+
+void DSPFunc_MC_Base::computePredSamples(int x,int y)
+{
+  if (bitDepth==8) {
+    put_qpel_1_3_fallback(predSamples[0], MC_BLK_SIZE, pixels_8(x,y), stride,
+                          width, height, mcbuffer);
+    put_qpel_2_2_fallback(predSamples[1], MC_BLK_SIZE, pixels_8(x,y), stride,
+                          width, height, mcbuffer);
+  }
+  else {
+    put_qpel_1_3_fallback_16(predSamples[0], MC_BLK_SIZE, pixels(x,y), stride,
+                             width, height, mcbuffer, bitDepth);
+    put_qpel_2_2_fallback_16(predSamples[1], MC_BLK_SIZE, pixels(x,y), stride,
+                             width, height, mcbuffer, bitDepth);
+  }
+}
+
+
+bool DSPFunc_MC_Base::compareToReferenceImplementation()
+{
+  DSPFunc_MC_Base* ref = dynamic_cast<DSPFunc_MC_Base*>(referenceImplementation());
+
+  if (nOutputs != ref->nOutputs ||
+      width != ref->width ||
+      height != ref->height) {
+    return false;
+  }
+
+  // output rows are 2*MC_BLK_SIZE bytes apart, also for 8-bit samples
+
+  for (int i=0;i<nOutputs;i++)
+    for (int y=0;y<height;y++) {
+      const uint8_t* row    = (const uint8_t*)(output(i)      + y*MC_BLK_SIZE);
+      const uint8_t* refrow = (const uint8_t*)(ref->output(i) + y*MC_BLK_SIZE);
+
+      if (memcmp(row, refrow, width*bytesPerSample) != 0) {
+        fprintf(stderr,"%s: mismatch in output %d, row %d, %dx%d block, %d bit\n",
+                name(), i, y, width,height, bitDepth);
+        return false;
+      }
+    }
+
+  return true;
+}
+
+
+bool DSPFunc_MC_Base::prepareNextImage(std::shared_ptr<const de265_image> img)
+{
+  samples.set(img);
+  stride = samples.getStride();
+
+  blksPerRow   = samples.getWidth() /MC_BLK_SIZE;
+  blksPerImage = samples.getHeight()/MC_BLK_SIZE * blksPerRow;
+
+  frameCounter++;
+
+  return true;
+}
+
+
+
+DSPFunc_QPel_16::DSPFunc_QPel_16(const char* name, const qpel_16_func (&f)[4][4],
+                                 DSPFunc* ref, bool avx2)
+  : DSPFunc_MC_Base(name, ref, avx2)
+{
+  for (int xFrac=0;xFrac<4;xFrac++)
+    for (int yFrac=0;yFrac<4;yFrac++) {
+      funcs[xFrac][yFrac] = f[xFrac][yFrac];
+    }
+}
+
+
+void DSPFunc_QPel_16::runOnBlock(int x,int y)
+{
+  selectBlockParameters(x,y, false);
+
+  nOutputs = 0;
+  for (int xFrac=0;xFrac<4;xFrac++)
+    for (int yFrac=0;yFrac<4;yFrac++) {
+      funcs[xFrac][yFrac](output(nOutputs++), MC_BLK_SIZE, pixels(x,y), stride,
+                          width, height, mcbuffer, bitDepth);
+    }
+}
+
+
+
+DSPFunc_EPel_16::DSPFunc_EPel_16(const char* name,
+                                 epel_16_func pixels, epel_16_func h,
+                                 epel_16_func v, epel_16_func hv,
+                                 DSPFunc* ref, bool avx2)
+  : DSPFunc_MC_Base(name, ref, avx2)
+{
+  func_pixels = pixels;
+  func_h  = h;
+  func_v  = v;
+  func_hv = hv;
+}
+
+
+void DSPFunc_EPel_16::runOnBlock(int x,int y)
+{
+  selectBlockParameters(x,y, true);
+
+  nOutputs = 0;
+  for (int mx=0;mx<8;mx++)
+    for (int my=0;my<8;my++) {
+      epel_16_func f;
+      if (mx==0 && my==0) { f = func_pixels; }
+      else if (my==0)     { f = func_h; }
+      else if (mx==0)     { f = func_v; }
+      else                { f = func_hv; }
+
+      f(output(nOutputs++), MC_BLK_SIZE, pixels(x,y), stride,
+        width, height, mx,my, mcbuffer, bitDepth);
+    }
+}
+
+
+
+DSPFunc_Pred_16::DSPFunc_Pred_16(const char* name, unweighted_func unweighted, avg_func avg,
+                                 DSPFunc* ref, bool avx2)
+  : DSPFunc_MC_Base(name, ref, avx2)
+{
+  func_unweighted = unweighted;
+  func_avg = avg;
+}
+
+
+void DSPFunc_Pred_16::runOnBlock(int x,int y)
+{
+  selectBlockParameters(x,y, false);
+  computePredSamples(x,y);
+
+  func_unweighted((uint16_t*)output(0), MC_BLK_SIZE, predSamples[0], MC_BLK_SIZE,
+                  width, height, bitDepth);
+  func_unweighted((uint16_t*)output(1), MC_BLK_SIZE, predSamples[1], MC_BLK_SIZE,
+                  width, height, bitDepth);
+  func_avg((uint16_t*)output(2), MC_BLK_SIZE, predSamples[0], predSamples[1], MC_BLK_SIZE,
+           width, height, bitDepth);
+
+  nOutputs = 3;
+}
+
+
+
+/* Weighted prediction parameters: each block is predicted with all 8 weight denominators
+   (luma_log2_weight_denom), the weight and offset deltas are taken from the full range
+   that can be signalled in the slice header.
+ */
+
+static const int weight_deltas[8] = { -128,-100,-33,-1,0,1,64,127 };
+static const int offsets[7]       = { -128,-77,-1,0,1,50,127 };
+
+
+DSPFunc_Weighted_8::DSPFunc_Weighted_8(const char* name, uni_func uni, bi_func bi,
+                                       DSPFunc* ref, bool avx2)
+  : DSPFunc_MC_Base(name, ref, avx2)
+{
+  func_uni = uni;
+  func_bi  = bi;
+
+  bytesPerSample = 1;
+}
+
+
+void DSPFunc_Weighted_8::runOnBlock(int x,int y)
+{
+  int n = blockNumber(x,y);
+
+  selectBlockParameters(x,y, n&1, false);
+  computePredSamples(x,y);
+
+  nOutputs = 0;
+  for (int denom=0;denom<8;denom++) {
+    int log2WD = denom + 14-8;
+
+    int w1 = (1<<denom) + weight_deltas[(n+denom)%8];
+    int w2 = (1<<denom) + weight_deltas[(n+3*denom+5)%8];
+    int o1 = offsets[(n+denom)%7];
+    int o2 = offsets[(n+2*denom+3)%7];
+
+    func_uni((uint8_t*)output(nOutputs++), 2*MC_BLK_SIZE, predSamples[0], MC_BLK_SIZE,
+             width, height, w1,o1, log2WD);
+    func_bi ((uint8_t*)output(nOutputs++), 2*MC_BLK_SIZE, predSamples[0], predSamples[1],
+             MC_BLK_SIZE, width, height, w1,o1, w2,o2, log2WD);
+  }
+}
+
+
+DSPFunc_Weighted_16::DSPFunc_Weighted_16(const char* name, uni_func uni, bi_func bi,
+                                         DSPFunc* ref, bool avx2)
+  : DSPFunc_MC_Base(name, ref, avx2)
+{
+  func_uni = uni;
+  func_bi  = bi;
+}
+
+
+void DSPFunc_Weighted_16::runOnBlock(int x,int y)
+{
+  int n = blockNumber(x,y);
+
+  selectBlockParameters(x,y, (n/MC_NUM_BIT_DEPTHS)&1);
+  computePredSamples(x,y);
+
+  nOutputs = 0;
+  for (int denom=0;denom<8;denom++) {
+    int log2WD = denom + 14-bitDepth;
+    int offsetScale = 1<<(bitDepth-8);
+
+    // small denominators cannot be used at bit depths above 13
+    if (log2WD < 1) {
+      continue;
+    }
+
+    int w1 = (1<<denom) + weight_deltas[(n+denom)%8];
+    int w2 = (1<<denom) + weight_deltas[(n+3*denom+5)%8];
+    int o1 = offsets[(n+denom)%7] * offsetScale;
+    int o2 = offsets[(n+2*denom+3)%7] * offsetScale;
+
+    func_uni((uint16_t*)output(nOutputs++), MC_BLK_SIZE, predSamples[0], MC_BLK_SIZE,
+             width, height, w1,o1, log2WD, bitDepth);
+    func_bi ((uint16_t*)output(nOutputs++), MC_BLK_SIZE, predSamples[0], predSamples[1],
+             MC_BLK_SIZE, width, height, w1,o1, w2,o2, log2WD, bitDepth);
+  }
+}
@@ -0,0 +1,211 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACCELERATION_SPEED_MOTION_H
+#define ACCELERATION_SPEED_MOTION_H
+
+#include "acceleration-speed.h"
+#include "libde265/fallback-motion.h"
+
+
+/* Motion compensation and weighted prediction.
+
+   Each block selects its bit depth and the size of the prediction block from its
+   position in the frame sequence, such that a few frames cover all combinations.
+   The kernels are run for all fractional positions or weighting parameters of a block.
+ */
+
+#define MC_BLK_SIZE       64  // also the row stride of the output blocks
+#define MC_BORDER         16  // padding around the sample planes for the filter taps
+#define MC_MIN_BIT_DEPTH   9
+#define MC_NUM_BIT_DEPTHS  8  // 9-16 bit
+#define MC_MAX_OUTPUTS    64  // output blocks per block (EPEL: 8x8 fractions)
+
+
+class DSPFunc_MC_Base : public DSPFunc
+{
+public:
+  DSPFunc_MC_Base(const char* name, DSPFunc* ref, bool avx2);
+
+  virtual const char* name() const { return funcName; }
+
+  virtual int getBlkWidth()  const { return MC_BLK_SIZE; }
+  virtual int getBlkHeight() const { return MC_BLK_SIZE; }
+
+  virtual DSPFunc* referenceImplementation() const { return refImpl; }
+
+  virtual bool compareToReferenceImplementation();
+  virtual bool prepareNextImage(std::shared_ptr<const de265_image> img);
+
+protected:
+  // Bit depth and prediction block size of the block at (x,y), chroma blocks are smaller.
+  // The bit depth is 8 for 'highBitDepth'==false.
+  void selectBlockParameters(int x,int y, bool chroma, bool highBitDepth=true);
+
+  // 'n'-th block in the frame sequence, for selecting parameters
+  int blockNumber(int x,int y) const;
+
+  const uint16_t* pixels(int x,int y) const { return samples.pixels(bitDepth, x,y); }
+  const uint8_t* pixels_8(int x,int y) const { return samples.pixels_8(x,y); }
+
+  // Fills 'predSamples' with the filtered samples at two different fractional positions,
+  // as input for the final prediction.
+  void computePredSamples(int x,int y);
+
+  int16_t* output(int i) const { return out + i*MC_BLK_SIZE*MC_BLK_SIZE; }
+
+  int bitDepth;
+  int width, height;
+  int nOutputs; // number of output blocks written for the current block
+  int bytesPerSample; // of the output blocks
+
+  SamplePlanes samples;
+  int          stride;   // of the sample planes
+  int16_t*     mcbuffer;
+
+  int16_t* predSamples[2];
+
+private:
+  const char* funcName;
+  DSPFunc*    refImpl;
+
+  int16_t* out;
+
+  int blksPerRow;
+  int blksPerImage;
+  int frameCounter;
+};
+
+
+
+typedef void (*qpel_16_func)(int16_t *dst, ptrdiff_t dststride,
+                             const uint16_t *src, ptrdiff_t srcstride,
+                             int width, int height, int16_t* mcbuffer, int bit_depth);
+
+typedef void (*epel_16_func)(int16_t *dst, ptrdiff_t dststride,
+                             const uint16_t *src, ptrdiff_t srcstride,
+                             int width, int height,
+                             int mx, int my, int16_t* mcbuffer, int bit_depth);
+
+
+// all 16 fractional positions, indexed with [xFrac][yFrac]
+
+class DSPFunc_QPel_16 : public DSPFunc_MC_Base
+{
+public:
+  DSPFunc_QPel_16(const char* name, const qpel_16_func (&f)[4][4],
+                  DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual void runOnBlock(int x,int y);
+
+private:
+  qpel_16_func funcs[4][4];
+};
+
+
+// all 64 fractional positions, with the full-sample, horizontal, vertical and 2D filters
+
+class DSPFunc_EPel_16 : public DSPFunc_MC_Base
+{
+public:
+  DSPFunc_EPel_16(const char* name,
+                  epel_16_func pixels, epel_16_func h, epel_16_func v, epel_16_func hv,
+                  DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual void runOnBlock(int x,int y);
+
+private:
+  epel_16_func func_pixels, func_h, func_v, func_hv;
+};
+
+
+// put_unweighted_pred_16 of two filtered blocks, and put_weighted_pred_avg_16 of both
+
+class DSPFunc_Pred_16 : public DSPFunc_MC_Base
+{
+public:
+  typedef void (*unweighted_func)(uint16_t *dst, ptrdiff_t dststride,
+                                  const int16_t *src, ptrdiff_t srcstride,
+                                  int width, int height, int bit_depth);
+  typedef void (*avg_func)(uint16_t *dst, ptrdiff_t dststride,
+                           const int16_t *src1, const int16_t *src2, ptrdiff_t srcstride,
+                           int width, int height, int bit_depth);
+
+  DSPFunc_Pred_16(const char* name, unweighted_func unweighted, avg_func avg,
+                  DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual void runOnBlock(int x,int y);
+
+private:
+  unweighted_func func_unweighted;
+  avg_func        func_avg;
+};
+
+
+// put_weighted_pred and put_weighted_bipred with all weight denominators and a range
+// of weights and offsets
+
+class DSPFunc_Weighted_8 : public DSPFunc_MC_Base
+{
+public:
+  typedef void (*uni_func)(uint8_t *dst, ptrdiff_t dststride,
+                           const int16_t *src, ptrdiff_t srcstride,
+                           int width, int height,
+                           int w,int o,int log2WD);
+  typedef void (*bi_func)(uint8_t *dst, ptrdiff_t dststride,
+                          const int16_t *src1, const int16_t *src2, ptrdiff_t srcstride,
+                          int width, int height,
+                          int w1,int o1, int w2,int o2, int log2WD);
+
+  DSPFunc_Weighted_8(const char* name, uni_func uni, bi_func bi,
+                     DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual void runOnBlock(int x,int y);
+
+private:
+  uni_func func_uni;
+  bi_func  func_bi;
+};
+
+
+class DSPFunc_Weighted_16 : public DSPFunc_MC_Base
+{
+public:
+  typedef void (*uni_func)(uint16_t *dst, ptrdiff_t dststride,
+                           const int16_t *src, ptrdiff_t srcstride,
+                           int width, int height,
+                           int w,int o,int log2WD, int bit_depth);
+  typedef void (*bi_func)(uint16_t *dst, ptrdiff_t dststride,
+                          const int16_t *src1, const int16_t *src2, ptrdiff_t srcstride,
+                          int width, int height,
+                          int w1,int o1, int w2,int o2, int log2WD, int bit_depth);
+
+  DSPFunc_Weighted_16(const char* name, uni_func uni, bi_func bi,
+                      DSPFunc* ref=NULL, bool avx2=false);
+
+  virtual void runOnBlock(int x,int y);
+
+private:
+  uni_func func_uni;
+  bi_func  func_bi;
+};
+
+
+#endif
@@ -45,6 +45,7 @@
 #endif
 
 #include "libde265/quality.h"
+#include "libde265/threads.h"
 
 #if HAVE_VIDEOGFX
 #include <libvideogfx.hh>
@@ -60,6 +61,7 @@ using namespace videogfx;
 #define NUM_THREADS 4
 
 int nThreads=0;
+int nFramesInFlight=1;
 bool nal_input=false;
 int quiet=0;
 bool check_hash=false;
@@ -82,10 +84,18 @@ int highestTID = 100;
 int verbosity=0;
 int disable_deblocking=0;
 int disable_sao=0;
+int continuation_tasks=0;
+int async_input_kb=0;
+int reference_border=0;
+int low_memory=0;
+int borrow_nal=0;
 
 static struct option long_options[] = {
   {"quiet",      no_argument,       0, 'q' },
   {"threads",    required_argument, 0, 't' },
+  {"frames-in-flight", required_argument, 0, 'F' },
+  {"async-input", required_argument, 0, 'I' },
+  {"reference-border", required_argument, 0, 'R' },
   {"check-hash", no_argument,       0, 'c' },
   {"profile",    no_argument,       0, 'p' },
   {"frames",     required_argument, 0, 'f' },
@@ -104,11 +114,20 @@ static struct option long_options[] = {
   {"verbose",    no_argument,       0, 'v' },
   {"disable-deblocking", no_argument, &disable_deblocking, 1 },
   {"disable-sao",        no_argument, &disable_sao, 1 },
+  {"continuation-tasks", no_argument, &continuation_tasks, 1 },
+  {"low-memory",         no_argument, &low_memory, 1 },
+  {"borrow-nal",         no_argument, &borrow_nal, 1 },
   {0,         0,                 0,  0 }
 };
 
 
 
+static void release_NAL_buffer(const void* data, void* user_data)
+{
+  free((void*)data);
+}
+
+
 static void write_picture(const de265_image* img)
 {
   static FILE* fh = NULL;
@@ -563,7 +582,7 @@ int main(int argc, char** argv)
   while (1) {
     int option_index = 0;
 
-    int c = getopt_long(argc, argv, "qt:chf:o:dLB:n0vT:m:se"
+    int c = getopt_long(argc, argv, "qt:F:I:R:chf:o:dLB:n0vT:m:se"
 #if HAVE_VIDEOGFX && HAVE_SDL
                         "V"
 #endif
@@ -574,6 +593,9 @@ int main(int argc, char** argv)
     switch (c) {
     case 'q': quiet++; break;
     case 't': nThreads=atoi(optarg); break;
+    case 'F': nFramesInFlight=atoi(optarg); break;
+    case 'I': async_input_kb=atoi(optarg); break;
+    case 'R': reference_border=atoi(optarg); break;
     case 'c': check_hash=true; break;
     case 'f': max_frames=atoi(optarg); break;
     case 'o': write_yuv=true; output_filename=optarg; break;
@@ -601,6 +623,9 @@ int main(int argc, char** argv)
     fprintf(stderr,"options:\n");
     fprintf(stderr,"  -q, --quiet       do not show decoded image\n");
     fprintf(stderr,"  -t, --threads N   set number of worker threads (0 - no threading)\n");
+    fprintf(stderr,"  -F, --frames-in-flight N  decode up to N pictures in parallel (needs -t)\n");
+    fprintf(stderr,"  -I, --async-input N  parse the input on a separate thread, queueing up to N KB\n");
+    fprintf(stderr,"  -R, --reference-border N  pad pictures by N luma pixels for motion compensation\n");
     fprintf(stderr,"  -c, --check-hash  perform hash check\n");
     fprintf(stderr,"  -n, --nal         input is a stream with 4-byte length prefixed NAL units\n");
     fprintf(stderr,"  -f, --frames N    set number of frames to process\n");
@@ -621,6 +646,9 @@ int main(int argc, char** argv)
     fprintf(stderr,"  -T, --highest-TID select highest temporal sublayer to decode\n");
     fprintf(stderr,"      --disable-deblocking   disable deblocking filter\n");
     fprintf(stderr,"      --disable-sao          disable sample-adaptive offset filter\n");
+    fprintf(stderr,"      --continuation-tasks   do not block worker threads on CTB dependencies\n");
+    fprintf(stderr,"      --low-memory           release decoding metadata of finished pictures\n");
+    fprintf(stderr,"      --borrow-nal           decode NAL input (-n) without copying it\n");
     fprintf(stderr,"  -h, --help        show help\n");
 
     exit(show_help ? 0 : 5);
@@ -637,6 +665,12 @@ int main(int argc, char** argv)
   de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_DISABLE_DEBLOCKING, disable_deblocking);
   de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_DISABLE_SAO, disable_sao);
 
+  de265_set_parameter_int(ctx, DE265_DECODER_PARAM_MAX_FRAMES_IN_FLIGHT, nFramesInFlight);
+  de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_CONTINUATION_TASKS, continuation_tasks);
+  de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_LOW_MEMORY, low_memory);
+  de265_set_parameter_int(ctx, DE265_DECODER_PARAM_ASYNC_INPUT_QUEUE_SIZE, async_input_kb*1024);
+  de265_set_parameter_int(ctx, DE265_DECODER_PARAM_REFERENCE_BORDER, reference_border);
+
   if (dump_headers) {
     de265_set_parameter_int(ctx, DE265_DECODER_PARAM_DUMP_SPS_HEADERS, 1);
     de265_set_parameter_int(ctx, DE265_DECODER_PARAM_DUMP_VPS_HEADERS, 1);
@@ -707,7 +741,6 @@ int main(int argc, char** argv)
 
         uint8_t* buf = (uint8_t*)malloc(length);
         n = fread(buf,1,length,fh);
-        err = de265_push_NAL(ctx, buf,n,  pos, (void*)1);
 
         if (write_bytestream) {
           uint8_t sc[3] = { 0,0,1 };
@@ -715,7 +748,15 @@ int main(int argc, char** argv)
           fwrite(buf,1,n,bytestream_fh);
         }
 
-        free(buf);
+        if (borrow_nal) {
+          // 'buf' is freed by the decoder when it has finished with the NAL
+          err = de265_push_NAL_borrowed(ctx, buf,n,  pos, (void*)1, release_NAL_buffer);
+        }
+        else {
+          err = de265_push_NAL(ctx, buf,n,  pos, (void*)1);
+          free(buf);
+        }
+
         pos+=n;
       }
       else {
@@ -828,6 +869,14 @@ int main(int argc, char** argv)
   if (quiet<=1) fprintf(stderr,"nFrames decoded: %d (%dx%d @ %5.2f fps)\n",framecnt,
                         width,height,framecnt/secs);
 
+  if (quiet<=1 && verbosity>0) {
+    int64_t nSleeps, sleepTime_us;
+    de265_get_progress_sleep_statistics(&nSleeps, &sleepTime_us);
+
+    fprintf(stderr,"threads slept %d times waiting for decoding progress (%.1f ms in total)\n",
+            (int)nSleeps, sleepTime_us/1000.0);
+  }
+
 
   return err==DE265_OK ? 0 : 10;
 }
@@ -138,6 +138,18 @@ struct acceleration_functions
                      int16_t* mcbuffer, int dX,int dY, int bit_depth) const;
 
 
+  // --- dequantization ---
+
+  // Scales the 'nCoeff' coefficients in 'coeffList' and stores them at 'coeffPos' in 'coeffBuf':
+  //   Clip3(-32768,32767, (c * (m << qPdiv6) + (1<<(bdShift-1))) >> bdShift)
+  // 'm' is 16*levelScale[qP%6] for flat scaling, or the per-position ScalingFactor*levelScale[qP%6].
+
+  void (*dequant_flat)(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos, int nCoeff,
+                       int m, int qPdiv6, int bdShift);
+  void (*dequant_scaled)(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos, int nCoeff,
+                         const int16_t* m, int qPdiv6, int bdShift);
+
+
   // --- inverse transforms ---
 
   void (*transform_bypass)(int32_t *residual, const int16_t *coeffs, int nT);
@@ -158,6 +170,13 @@ struct acceleration_functions
   void (*transform_4x4_dst_add_16)(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth); // iDST
   void (*transform_add_16[4])(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth); // iDCT
 
+  // iDCT of blocks that have non-zero coefficients only in the top-left 'extent' x 'extent'
+  // corner (1: DC only, 4 or 8), indexed with (log2TbSize-2). 'extent' is always smaller
+  // than the block size, i.e. the 4x4 entry only accepts extent 1 and the 8x8 entry 1 or 4.
+
+  void (*transform_add_sparse_8[4])(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent);
+  void (*transform_add_sparse_16[4])(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth);
+
 
   void (*rotate_coefficients)(int16_t *coeff, int nT);
 
@@ -184,7 +203,95 @@ struct acceleration_functions
   template <class pixel_t> void transform_skip_rdpcm_h(pixel_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride, int bit_depth) const;
   template <class pixel_t> void transform_4x4_dst_add(pixel_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth) const;
   template <class pixel_t> void transform_add(int sizeIdx, pixel_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth) const;
-
+  template <class pixel_t> void transform_add_sparse(int sizeIdx, pixel_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth) const;
+
+
+
+  // --- deblocking ---
+
+  // Luma: two 4-line segments (8 lines) of an edge, 'ptr' points to the first q0 sample.
+  // Chroma: one 4-line segment in both chroma planes. Segments with tc==0 are not modified.
+  // Indexed with 'vertical'.
+
+  void (*deblock_luma_8[2])(uint8_t *ptr, ptrdiff_t stride, const int* beta, const int* tc,
+                            const bool* filterP, const bool* filterQ);
+  void (*deblock_chroma_8[2])(uint8_t *cb, uint8_t *cr, ptrdiff_t stride, const int* tc,
+                              bool filterP, bool filterQ);
+
+  void (*deblock_luma_16[2])(uint16_t *ptr, ptrdiff_t stride, const int* beta, const int* tc,
+                             const bool* filterP, const bool* filterQ, int bit_depth);
+  void (*deblock_chroma_16[2])(uint16_t *cb, uint16_t *cr, ptrdiff_t stride, const int* tc,
+                               bool filterP, bool filterQ, int bit_depth);
+
+  template <class pixel_t> void deblock_luma(bool vertical, pixel_t *ptr, ptrdiff_t stride,
+                                             const int* beta, const int* tc,
+                                             const bool* filterP, const bool* filterQ,
+                                             int bit_depth) const;
+  template <class pixel_t> void deblock_chroma(bool vertical, pixel_t *cb, pixel_t *cr,
+                                               ptrdiff_t stride, const int* tc,
+                                               bool filterP, bool filterQ, int bit_depth) const;
+
+
+  // --- SAO ---
+
+  // Applied to a block of samples, reading from 'in' (including a one-sample border for
+  // edge offsets) and writing to 'out'. See fallback-sao.h for the offset tables.
+  // Edge offset kernels are indexed with SaoEoClass.
+
+  void (*sao_band_8)(uint8_t *out, ptrdiff_t out_stride, const uint8_t *in, ptrdiff_t in_stride,
+                     int width, int height, int bandPosition, const int8_t* offsets);
+  void (*sao_edge_8[4])(uint8_t *out, ptrdiff_t out_stride, const uint8_t *in, ptrdiff_t in_stride,
+                        int width, int height, const int8_t* offsets);
+
+  void (*sao_band_16)(uint16_t *out, ptrdiff_t out_stride, const uint16_t *in, ptrdiff_t in_stride,
+                      int width, int height, int bandPosition, const int8_t* offsets,
+                      int bit_depth);
+  void (*sao_edge_16[4])(uint16_t *out, ptrdiff_t out_stride, const uint16_t *in, ptrdiff_t in_stride,
+                         int width, int height, const int8_t* offsets, int bit_depth);
+
+  template <class pixel_t> void sao_band(pixel_t *out, ptrdiff_t out_stride,
+                                         const pixel_t *in, ptrdiff_t in_stride,
+                                         int width, int height, int bandPosition,
+                                         const int8_t* offsets, int bit_depth) const;
+  template <class pixel_t> void sao_edge(int eoClass, pixel_t *out, ptrdiff_t out_stride,
+                                         const pixel_t *in, ptrdiff_t in_stride,
+                                         int width, int height,
+                                         const int8_t* offsets, int bit_depth) const;
+
+
+  // --- intra prediction ---
+
+  // nT x nT blocks (4 to 32), 'border' points to the corner reference sample.
+  // See fallback-intrapred.h for the layout.
+
+  void (*intra_filter_8)(uint8_t *border, int nT, bool strong);
+  void (*intra_pred_planar_8)(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT);
+  void (*intra_pred_dc_8)(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT,
+                          int cIdx);
+  void (*intra_pred_angular_8)(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT,
+                               int mode, int cIdx, bool disableBoundaryFilter);
+
+  void (*intra_filter_16)(uint16_t *border, int nT, bool strong);
+  void (*intra_pred_planar_16)(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border,
+                               int nT, int bit_depth);
+  void (*intra_pred_dc_16)(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT,
+                           int cIdx, int bit_depth);
+  void (*intra_pred_angular_16)(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border,
+                                int nT, int mode, int cIdx, bool disableBoundaryFilter,
+                                int bit_depth);
+
+  template <class pixel_t> void intra_filter(pixel_t *border, int nT, bool strong) const;
+  template <class pixel_t> void intra_pred_planar(pixel_t *dst, ptrdiff_t dststride,
+                                                  const pixel_t *border, int nT,
+                                                  int bit_depth) const;
+  template <class pixel_t> void intra_pred_dc(pixel_t *dst, ptrdiff_t dststride,
+                                              const pixel_t *border, int nT, int cIdx,
+                                              int bit_depth) const;
+  template <class pixel_t> void intra_pred_angular(pixel_t *dst, ptrdiff_t dststride,
+                                                   const pixel_t *border, int nT,
+                                                   int mode, int cIdx,
+                                                   bool disableBoundaryFilter,
+                                                   int bit_depth) const;
 
 
   // --- forward transforms ---
@@ -353,7 +460,34 @@ template <> inline void acceleration_functions::transform_4x4_dst_add<uint16_t>(
 template <> inline void acceleration_functions::transform_add<uint8_t>(int sizeIdx, uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth) const { transform_add_8[sizeIdx](dst,coeffs,stride); }
 template <> inline void acceleration_functions::transform_add<uint16_t>(int sizeIdx, uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth) const { transform_add_16[sizeIdx](dst,coeffs,stride,bit_depth); }
 
+template <> inline void acceleration_functions::transform_add_sparse<uint8_t>(int sizeIdx, uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth) const { transform_add_sparse_8[sizeIdx](dst,coeffs,stride,extent); }
+template <> inline void acceleration_functions::transform_add_sparse<uint16_t>(int sizeIdx, uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth) const { transform_add_sparse_16[sizeIdx](dst,coeffs,stride,extent,bit_depth); }
+
 template <> inline void acceleration_functions::add_residual(uint8_t *dst,  ptrdiff_t stride, const int32_t* r, int nT, int bit_depth) const { add_residual_8(dst,stride,r,nT,bit_depth); }
 template <> inline void acceleration_functions::add_residual(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth) const { add_residual_16(dst,stride,r,nT,bit_depth); }
 
+template <> inline void acceleration_functions::deblock_luma(bool vertical, uint8_t *ptr, ptrdiff_t stride, const int* beta, const int* tc, const bool* filterP, const bool* filterQ, int bit_depth) const { deblock_luma_8[vertical](ptr,stride,beta,tc,filterP,filterQ); }
+template <> inline void acceleration_functions::deblock_luma(bool vertical, uint16_t *ptr, ptrdiff_t stride, const int* beta, const int* tc, const bool* filterP, const bool* filterQ, int bit_depth) const { deblock_luma_16[vertical](ptr,stride,beta,tc,filterP,filterQ,bit_depth); }
+
+template <> inline void acceleration_functions::deblock_chroma(bool vertical, uint8_t *cb, uint8_t *cr, ptrdiff_t stride, const int* tc, bool filterP, bool filterQ, int bit_depth) const { deblock_chroma_8[vertical](cb,cr,stride,tc,filterP,filterQ); }
+template <> inline void acceleration_functions::deblock_chroma(bool vertical, uint16_t *cb, uint16_t *cr, ptrdiff_t stride, const int* tc, bool filterP, bool filterQ, int bit_depth) const { deblock_chroma_16[vertical](cb,cr,stride,tc,filterP,filterQ,bit_depth); }
+
+template <> inline void acceleration_functions::sao_band(uint8_t *out, ptrdiff_t out_stride, const uint8_t *in, ptrdiff_t in_stride, int width, int height, int bandPosition, const int8_t* offsets, int bit_depth) const { sao_band_8(out,out_stride,in,in_stride,width,height,bandPosition,offsets); }
+template <> inline void acceleration_functions::sao_band(uint16_t *out, ptrdiff_t out_stride, const uint16_t *in, ptrdiff_t in_stride, int width, int height, int bandPosition, const int8_t* offsets, int bit_depth) const { sao_band_16(out,out_stride,in,in_stride,width,height,bandPosition,offsets,bit_depth); }
+
+template <> inline void acceleration_functions::sao_edge(int eoClass, uint8_t *out, ptrdiff_t out_stride, const uint8_t *in, ptrdiff_t in_stride, int width, int height, const int8_t* offsets, int bit_depth) const { sao_edge_8[eoClass](out,out_stride,in,in_stride,width,height,offsets); }
+template <> inline void acceleration_functions::sao_edge(int eoClass, uint16_t *out, ptrdiff_t out_stride, const uint16_t *in, ptrdiff_t in_stride, int width, int height, const int8_t* offsets, int bit_depth) const { sao_edge_16[eoClass](out,out_stride,in,in_stride,width,height,offsets,bit_depth); }
+
+template <> inline void acceleration_functions::intra_filter(uint8_t *border, int nT, bool strong) const { intra_filter_8(border,nT,strong); }
+template <> inline void acceleration_functions::intra_filter(uint16_t *border, int nT, bool strong) const { intra_filter_16(border,nT,strong); }
+
+template <> inline void acceleration_functions::intra_pred_planar(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int bit_depth) const { intra_pred_planar_8(dst,dststride,border,nT); }
+template <> inline void acceleration_functions::intra_pred_planar(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int bit_depth) const { intra_pred_planar_16(dst,dststride,border,nT,bit_depth); }
+
+template <> inline void acceleration_functions::intra_pred_dc(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int cIdx, int bit_depth) const { intra_pred_dc_8(dst,dststride,border,nT,cIdx); }
+template <> inline void acceleration_functions::intra_pred_dc(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int cIdx, int bit_depth) const { intra_pred_dc_16(dst,dststride,border,nT,cIdx,bit_depth); }
+
+template <> inline void acceleration_functions::intra_pred_angular(uint8_t *dst, ptrdiff_t dststride, const uint8_t *border, int nT, int mode, int cIdx, bool disableBoundaryFilter, int bit_depth) const { intra_pred_angular_8(dst,dststride,border,nT,mode,cIdx,disableBoundaryFilter); }
+template <> inline void acceleration_functions::intra_pred_angular(uint16_t *dst, ptrdiff_t dststride, const uint16_t *border, int nT, int mode, int cIdx, bool disableBoundaryFilter, int bit_depth) const { intra_pred_angular_16(dst,dststride,border,nT,mode,cIdx,disableBoundaryFilter,bit_depth); }
+
 #endif
@@ -28,6 +28,12 @@
 
 
 void bitreader_init(bitreader* br, unsigned char* buffer, int len)
+{
+  bitreader_init_skipped(br, buffer, len, NULL, 0);
+}
+
+void bitreader_init_skipped(bitreader* br, unsigned char* buffer, int len,
+                            const int* skipped_pos, int nSkipped)
 {
   br->data = buffer;
   br->bytes_remaining = len;
@@ -35,6 +41,11 @@ void bitreader_init(bitreader* br, unsigned char* buffer, int len)
   br->nextbits=0;
   br->nextbits_cnt=0;
 
+  br->skipped.base = buffer;
+  br->skipped.pos  = skipped_pos;
+  br->skipped.num  = nSkipped;
+  br->skipped.next = 0;
+
   bitreader_refill(br);
 }
 
@@ -43,6 +54,13 @@ void bitreader_refill(bitreader* br)
   int shift = 64-br->nextbits_cnt;
 
   while (shift >= 8 && br->bytes_remaining) {
+    if (br->data == next_skipped_byte(&br->skipped)) {
+      br->data++;
+      br->bytes_remaining--;
+      br->skipped.next++;
+      continue;
+    }
+
     uint64_t newval = *br->data++;
     br->bytes_remaining--;
 
@@ -122,9 +140,20 @@ void prepare_for_CABAC(bitreader* br)
 {
   skip_to_byte_boundary(br);
 
-  int rewind = br->nextbits_cnt/8;
-  br->data -= rewind;
-  br->bytes_remaining += rewind;
+  // step back over the bytes that are still in 'nextbits', and over the skipped bytes between them
+
+  for (int rewind = br->nextbits_cnt/8; rewind>0; rewind--) {
+    br->data--;
+    br->bytes_remaining++;
+
+    if (br->skipped.next > 0 &&
+        br->data - 1 == br->skipped.base + br->skipped.pos[br->skipped.next-1] &&
+        rewind > 1) {
+      br->data--;
+      br->bytes_remaining++;
+      br->skipped.next--;
+    }
+  }
   br->nextbits = 0;
   br->nextbits_cnt = 0;
 }
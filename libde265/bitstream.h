@@ -36,15 +36,36 @@
 #define UVLC_ERROR -99999
 
 
+/* Emulation-prevention bytes that are still contained in the data and that have
+   to be skipped while reading. The positions are sorted and relative to 'base'.
+   'next' is the first entry that has not been passed yet.
+ */
+typedef struct {
+  uint8_t*   base;
+  const int* pos;
+  int num;
+  int next;
+} skipped_bytes_list;
+
+static inline uint8_t* next_skipped_byte(const skipped_bytes_list* list)
+{
+  return (list->next < list->num) ? list->base + list->pos[list->next] : NULL;
+}
+
+
 typedef struct {
   uint8_t* data;
   int bytes_remaining;
 
   uint64_t nextbits; // left-aligned bits
   int nextbits_cnt;
+
+  skipped_bytes_list skipped; // empty, unless reading data with emulation prevention
 } bitreader;
 
 void bitreader_init(bitreader*, unsigned char* buffer, int len);
+void bitreader_init_skipped(bitreader*, unsigned char* buffer, int len,
+                            const int* skipped_pos, int nSkipped);
 void bitreader_refill(bitreader*); // refill to at least 56+1 bits
 int  next_bit(bitreader*);
 int  next_bit_norefill(bitreader*);
@@ -133,26 +133,85 @@ static const uint8_t next_state_LPS[64] =
 int logcnt=1;
 #endif
 
-void init_CABAC_decoder(CABAC_decoder* decoder, uint8_t* bitstream, int length)
+static void update_CABAC_segment_end(CABAC_decoder* decoder)
+{
+  // skip list entries that lie before the current read position
+
+  uint8_t* skip;
+  while ((skip = next_skipped_byte(&decoder->skipped)) != NULL &&
+         skip < decoder->bitstream_curr) {
+    decoder->skipped.next++;
+  }
+
+  if (skip != NULL && skip < decoder->bitstream_end) {
+    decoder->bitstream_segment_end = skip;
+  }
+  else {
+    decoder->bitstream_segment_end = decoder->bitstream_end;
+  }
+}
+
+/* Called when the end of the current segment has been reached. Steps over the skipped byte
+   and returns whether there is more input data.
+ */
+static bool pass_skipped_byte(CABAC_decoder* decoder)
+{
+  while (decoder->bitstream_curr == decoder->bitstream_segment_end &&
+         decoder->bitstream_curr < decoder->bitstream_end) {
+    decoder->bitstream_curr++;
+    decoder->skipped.next++;
+    update_CABAC_segment_end(decoder);
+  }
+
+  return decoder->bitstream_curr < decoder->bitstream_segment_end;
+}
+
+static inline bool CABAC_input_available(CABAC_decoder* decoder)
+{
+  return (likely(decoder->bitstream_curr < decoder->bitstream_segment_end) ||
+          pass_skipped_byte(decoder));
+}
+
+
+void init_CABAC_decoder(CABAC_decoder* decoder, uint8_t* bitstream, int length,
+                        const skipped_bytes_list* skipped)
 {
   assert(length >= 0);
 
   decoder->bitstream_start = bitstream;
   decoder->bitstream_curr  = bitstream;
   decoder->bitstream_end   = bitstream+length;
+
+  if (skipped) {
+    decoder->skipped = *skipped;
+  }
+  else {
+    decoder->skipped.base = NULL;
+    decoder->skipped.pos  = NULL;
+    decoder->skipped.num  = 0;
+    decoder->skipped.next = 0;
+  }
+
+  update_CABAC_segment_end(decoder);
 }
 
 void init_CABAC_decoder_2(CABAC_decoder* decoder)
 {
-  int length = decoder->bitstream_end - decoder->bitstream_curr;
+  // the read position may have been moved (PCM samples)
+  update_CABAC_segment_end(decoder);
 
   decoder->range = 510;
   decoder->bits_needed = 8;
 
   decoder->value = 0;
 
-  if (length>0) { decoder->value  = (*decoder->bitstream_curr++) << 8;  decoder->bits_needed-=8; }
-  if (length>1) { decoder->value |= (*decoder->bitstream_curr++);       decoder->bits_needed-=8; }
+  if (CABAC_input_available(decoder)) {
+    decoder->value  = (*decoder->bitstream_curr++) << 8;  decoder->bits_needed-=8;
+
+    if (CABAC_input_available(decoder)) {
+      decoder->value |= (*decoder->bitstream_curr++);  decoder->bits_needed-=8;
+    }
+  }
 
   logtrace(LogCABAC,"[%3d] init_CABAC_decode_2 r:%x v:%x\n", logcnt, decoder->range, decoder->value);
 }
@@ -190,7 +249,7 @@ int  decode_CABAC_bit(CABAC_decoder* decoder, context_model* model)
           if (decoder->bits_needed == 0)
             {
               decoder->bits_needed = -8;
-              if (decoder->bitstream_curr < decoder->bitstream_end)
+              if (CABAC_input_available(decoder))
                 { decoder->value |= *decoder->bitstream_curr++; }
             }
         }
@@ -223,7 +282,7 @@ int  decode_CABAC_bit(CABAC_decoder* decoder, context_model* model)
       if (decoder->bits_needed >= 0)
         {
           logtrace(LogCABAC,"bits_needed: %d\n", decoder->bits_needed);
-          if (decoder->bitstream_curr < decoder->bitstream_end)
+          if (CABAC_input_available(decoder))
             { decoder->value |= (*decoder->bitstream_curr++) << decoder->bits_needed; }
 
           decoder->bits_needed -= 8;
@@ -263,7 +322,7 @@ int  decode_CABAC_term_bit(CABAC_decoder* decoder)
             {
               decoder->bits_needed = -8;
 
-              if (decoder->bitstream_curr < decoder->bitstream_end) {
+              if (CABAC_input_available(decoder)) {
                 decoder->value += (*decoder->bitstream_curr++);
               }
             }
@@ -284,7 +343,7 @@ int  decode_CABAC_bypass(CABAC_decoder* decoder)
 
   if (decoder->bits_needed >= 0)
     {
-      if (decoder->bitstream_end > decoder->bitstream_curr) {
+      if (CABAC_input_available(decoder)) {
         decoder->bits_needed = -8;
         decoder->value |= *decoder->bitstream_curr++;
       }
@@ -346,7 +405,7 @@ int  decode_CABAC_FL_bypass_parallel(CABAC_decoder* decoder, int nBits)
 
   if (decoder->bits_needed >= 0)
     {
-      if (decoder->bitstream_end > decoder->bitstream_curr) {
+      if (CABAC_input_available(decoder)) {
         int input = *decoder->bitstream_curr++;
         input <<= decoder->bits_needed;
 
@@ -23,6 +23,7 @@
 
 #include <stdint.h>
 #include "contextmodel.h"
+#include "bitstream.h"
 
 
 typedef struct {
@@ -30,13 +31,20 @@ typedef struct {
   uint8_t* bitstream_curr;
   uint8_t* bitstream_end;
 
+  // Bytes before this can be read directly. It is either bitstream_end or the next skipped byte.
+  uint8_t* bitstream_segment_end;
+  skipped_bytes_list skipped;
+
   uint32_t range;
   uint32_t value;
   int16_t  bits_needed;
 } CABAC_decoder;
 
 
-void init_CABAC_decoder(CABAC_decoder* decoder, uint8_t* bitstream, int length);
+/* 'skipped' lists the emulation-prevention bytes that are still in the bitstream data.
+   It may be NULL if they have already been removed. */
+void init_CABAC_decoder(CABAC_decoder* decoder, uint8_t* bitstream, int length,
+                        const skipped_bytes_list* skipped = NULL);
 void init_CABAC_decoder_2(CABAC_decoder* decoder);
 int  decode_CABAC_bit(CABAC_decoder* decoder, context_model* model);
 int  decode_CABAC_TU(CABAC_decoder* decoder, int cMax, context_model* model);
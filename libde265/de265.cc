@@ -339,6 +339,18 @@ LIBDE265_API de265_error de265_push_NAL(de265_decoder_context* de265ctx,
 }
 
 
+LIBDE265_API de265_error de265_push_NAL_borrowed(de265_decoder_context* de265ctx,
+                                                 const void* data8, int len,
+                                                 de265_PTS pts, void* user_data,
+                                                 de265_release_NAL_func release_func)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+  const uint8_t* data = (const uint8_t*)data8;
+
+  return ctx->nal_parser.push_NAL_borrowed(data,len,pts,user_data,release_func);
+}
+
+
 LIBDE265_API de265_error de265_decode(de265_decoder_context* de265ctx, int* more)
 {
   decoder_context* ctx = (decoder_context*)de265ctx;
@@ -498,6 +510,14 @@ LIBDE265_API void de265_set_parameter_bool(de265_decoder_context* de265ctx, enum
       ctx->param_disable_sao = !!value;
       break;
 
+    case DE265_DECODER_PARAM_CONTINUATION_TASKS:
+      ctx->param_continuation_tasks = !!value;
+      break;
+
+    case DE265_DECODER_PARAM_LOW_MEMORY:
+      ctx->param_low_memory = !!value;
+      break;
+
       /*
     case DE265_DECODER_PARAM_DISABLE_MC_RESIDUAL_IDCT:
       ctx->param_disable_mc_residual_idct = !!value;
@@ -541,6 +561,19 @@ LIBDE265_API void de265_set_parameter_int(de265_decoder_context* de265ctx, enum
       ctx->set_acceleration_functions((enum de265_acceleration)value);
       break;
 
+    case DE265_DECODER_PARAM_MAX_FRAMES_IN_FLIGHT:
+      ctx->param_max_frames_in_flight = (value<1 ? 1 : value);
+      break;
+
+    case DE265_DECODER_PARAM_ASYNC_INPUT_QUEUE_SIZE:
+      // if the ingestion thread cannot be started, the input is parsed synchronously
+      ctx->nal_parser.set_asynchronous_parsing(value<0 ? 0 : value);
+      break;
+
+    case DE265_DECODER_PARAM_REFERENCE_BORDER:
+      ctx->param_reference_border = (value<0 ? 0 : value);
+      break;
+
     default:
       assert(false);
       break;
@@ -568,6 +601,12 @@ LIBDE265_API int de265_get_parameter_bool(de265_decoder_context* de265ctx, enum
     case DE265_DECODER_PARAM_DISABLE_SAO:
       return ctx->param_disable_sao;
 
+    case DE265_DECODER_PARAM_CONTINUATION_TASKS:
+      return ctx->param_continuation_tasks;
+
+    case DE265_DECODER_PARAM_LOW_MEMORY:
+      return ctx->param_low_memory;
+
       /*
     case DE265_DECODER_PARAM_DISABLE_MC_RESIDUAL_IDCT:
       return ctx->param_disable_mc_residual_idct;
@@ -245,6 +245,20 @@ LIBDE265_API void        de265_push_end_of_frame(de265_decoder_context*);
 LIBDE265_API de265_error de265_push_NAL(de265_decoder_context*, const void* data, int length,
                                         de265_PTS pts, void* user_data);
 
+/* Called when the decoder does not access the data of a borrowed NAL anymore.
+   This may happen on any decoder thread. */
+typedef void (*de265_release_NAL_func)(const void* data, void* user_data);
+
+/* Like de265_push_NAL(), but the decoder reads the NAL directly from the caller's buffer
+   instead of copying it. Stuffing bytes are skipped while reading.
+   The data must remain valid and unmodified until 'release_func' is called with
+   'data' and 'user_data'. This also happens when the NAL cannot be pushed.
+ */
+LIBDE265_API de265_error de265_push_NAL_borrowed(de265_decoder_context*,
+                                                 const void* data, int length,
+                                                 de265_PTS pts, void* user_data,
+                                                 de265_release_NAL_func release_func);
+
 /* Indicate the end-of-stream. All data pending at the decoder input will be
    pushed into the decoder and the decoded picture queue will be completely emptied.
  */
@@ -252,6 +266,8 @@ LIBDE265_API de265_error de265_flush_data(de265_decoder_context*);
 
 /* Return number of bytes pending at the decoder input.
    Can be used to avoid overflowing the decoder with too much data.
+   With DE265_DECODER_PARAM_ASYNC_INPUT_QUEUE_SIZE, this includes the queued input that
+   has not been parsed yet. The push functions block while this queue is full.
  */
 LIBDE265_API int de265_get_number_of_input_bytes_pending(de265_decoder_context*);
 
@@ -382,9 +398,15 @@ enum de265_param {
   DE265_DECODER_PARAM_SUPPRESS_FAULTY_PICTURES=6, // (bool)  do not output frames with decoding errors, default: no (output all images)
 
   DE265_DECODER_PARAM_DISABLE_DEBLOCKING=7,   // (bool)  disable deblocking
-  DE265_DECODER_PARAM_DISABLE_SAO=8           // (bool)  disable SAO filter
+  DE265_DECODER_PARAM_DISABLE_SAO=8,          // (bool)  disable SAO filter
   //DE265_DECODER_PARAM_DISABLE_MC_RESIDUAL_IDCT=9,     // (bool)  disable decoding of IDCT residuals in MC blocks
   //DE265_DECODER_PARAM_DISABLE_INTRA_RESIDUAL_IDCT=10  // (bool)  disable decoding of IDCT residuals in MC blocks
+
+  DE265_DECODER_PARAM_MAX_FRAMES_IN_FLIGHT=11, // (int)  number of pictures decoded in parallel when worker threads are used, default: 1
+  DE265_DECODER_PARAM_CONTINUATION_TASKS=12,   // (bool) tasks waiting for neighbouring CTBs release their worker thread instead of blocking, default: no
+  DE265_DECODER_PARAM_ASYNC_INPUT_QUEUE_SIZE=13, // (int)  parse the input on a separate thread, queueing up to this many bytes, default: 0 (parse in the push functions)
+  DE265_DECODER_PARAM_REFERENCE_BORDER=14,      // (int)  allocate pictures with a border of this many luma pixels (rounded up to 16) so that motion compensation can read outside the picture directly, default: 0. Only used with the built-in image allocation.
+  DE265_DECODER_PARAM_LOW_MEMORY=15             // (bool) release the per-picture decoding metadata as soon as a picture is finished and reuse it for the next picture, default: no. The metadata visualization functions cannot be used on output pictures in this mode.
 };
 
 // sorted such that a large ID includes all optimizations from lower IDs
@@ -395,7 +417,7 @@ enum de265_acceleration {
   de265_acceleration_SSE2 = 30,
   de265_acceleration_SSE4 = 40,
   de265_acceleration_AVX  = 50,    // not implemented yet
-  de265_acceleration_AVX2 = 60,    // not implemented yet
+  de265_acceleration_AVX2 = 60,    // when supported by the CPU, SSE4 for kernels without AVX2 version
   de265_acceleration_ARM  = 70,
   de265_acceleration_NEON = 80,
   de265_acceleration_AUTO = 10000
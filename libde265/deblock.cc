@@ -127,7 +127,7 @@ void markPredictionBlockBoundary(de265_image* img, int x0,int y0,
 }
 
 
-bool derive_edgeFlags_CTBRow(de265_image* img, int ctby)
+bool derive_edgeFlags_CTB(de265_image* img, int ctbx, int ctby)
 {
   const seq_parameter_set& sps = img->get_sps();
   const pic_parameter_set& pps = img->get_pps();
@@ -140,13 +140,16 @@ bool derive_edgeFlags_CTBRow(de265_image* img, int ctby)
   int ctbshift = sps.Log2CtbSizeY;
 
 
+  int cb_x_start = ( ctbx    << sps.Log2CtbSizeY) >> sps.Log2MinCbSizeY;
+  int cb_x_end   = ((ctbx+1) << sps.Log2CtbSizeY) >> sps.Log2MinCbSizeY;
   int cb_y_start = ( ctby    << sps.Log2CtbSizeY) >> sps.Log2MinCbSizeY;
   int cb_y_end   = ((ctby+1) << sps.Log2CtbSizeY) >> sps.Log2MinCbSizeY;
 
+  cb_x_end = std::min(cb_x_end, sps.PicWidthInMinCbsY);
   cb_y_end = std::min(cb_y_end, sps.PicHeightInMinCbsY);
 
   for (int cb_y=cb_y_start;cb_y<cb_y_end;cb_y++)
-    for (int cb_x=0;cb_x<img->get_sps().PicWidthInMinCbsY;cb_x++)
+    for (int cb_x=cb_x_start;cb_x<cb_x_end;cb_x++)
       {
         int log2CbSize = img->get_log2CbSize_cbUnits(cb_x,cb_y);
         if (log2CbSize==0) {
@@ -225,18 +228,6 @@ bool derive_edgeFlags_CTBRow(de265_image* img, int ctby)
 }
 
 
-bool derive_edgeFlags(de265_image* img)
-{
-  bool deblocking_enabled=false;
-
-  for (int y=0;y<img->get_sps().PicHeightInCtbsY;y++) {
-    deblocking_enabled |= derive_edgeFlags_CTBRow(img,y);
-  }
-
-  return deblocking_enabled;
-}
-
-
 // 8.7.2.3 (both, EDGE_VER and EDGE_HOR)
 void derive_boundaryStrength(de265_image* img, bool vertical, int yStart,int yEnd,
                              int xStart,int xEnd)
@@ -400,301 +391,104 @@ static uint8_t table_8_23_tc[54] = {
 
 
 
-// 8.7.2.4
-template <class pixel_t>
-void edge_filtering_luma_internal(de265_image* img, bool vertical,
-                                  int yStart,int yEnd, int xStart,int xEnd)
+// 8.7.2.5.3
+/* Derives the filter parameters of the 4-line luma edge segment at (xDi;yDi).
+   tc is set to zero if the segment is not filtered.
+ */
+static void luma_segment_parameters(const de265_image* img, bool vertical, int xDi,int yDi,
+                                    int* beta, int* tc, bool* filterP, bool* filterQ)
 {
-  //printf("luma %d-%d %d-%d\n",xStart,xEnd,yStart,yEnd);
+  int bS = img->get_deblk_bS(xDi,yDi);
 
-  const seq_parameter_set& sps = img->get_sps();
-
-  int xIncr = vertical ? 2 : 1;
-  int yIncr = vertical ? 1 : 2;
+  logtrace(LogDeblock,"deblock POC=%d %c --- x:%d y:%d bS:%d---\n",
+           img->PicOrderCntVal,vertical ? 'V':'H',xDi,yDi,bS);
 
-  const int stride = img->get_image_stride(0);
+  if (bS==0) {
+    *tc = 0;
+    return;
+  }
 
+  const seq_parameter_set& sps = img->get_sps();
   int bitDepth_Y = sps.BitDepth_Y;
 
-  xEnd = libde265_min(xEnd,img->get_deblk_width());
-  yEnd = libde265_min(yEnd,img->get_deblk_height());
-
-  for (int y=yStart;y<yEnd;y+=yIncr)
-    for (int x=xStart;x<xEnd;x+=xIncr) {
-      // x;y in deblocking units (4x4 pixels)
-
-      int xDi = x<<2; // *4 -> pixel resolution
-      int yDi = y<<2; // *4 -> pixel resolution
-      int bS = img->get_deblk_bS(xDi,yDi);
+  int xP = vertical ? xDi-1 : xDi;
+  int yP = vertical ? yDi   : yDi-1;
 
-      //printf("x,y:%d,%d  xDi,yDi:%d,%d\n",x,y,xDi,yDi);
-
-      logtrace(LogDeblock,"deblock POC=%d %c --- x:%d y:%d bS:%d---\n",
-               img->PicOrderCntVal,vertical ? 'V':'H',xDi,yDi,bS);
-
-#if 0
-      {
-        uint8_t* ptr = img->y + stride*yDi + xDi;
+  int QP_Q = img->get_QPY(xDi,yDi);
+  int QP_P = img->get_QPY(xP,yP);
+  int qP_L = (QP_Q+QP_P+1)>>1;
 
-        for (int dy=-4;dy<4;dy++) {
-          for (int dx=-4;dx<4;dx++) {
-            printf("%02x ", ptr[dy*stride + dx]);
-            if (dx==-1) printf("| ");
-          }
-          printf("\n");
-          if (dy==-1) printf("-------------------------\n");
-        }
-      }
-#endif
+  logtrace(LogDeblock,"QP: %d & %d -> %d\n",QP_Q,QP_P,qP_L);
 
-#if 0
-      if (!vertical)
-        {
-          uint8_t* ptr = img->y + stride*yDi + xDi;
+  int sliceIndexQ00 = img->get_SliceHeaderIndex(xDi,yDi);
+  int beta_offset = img->slices[sliceIndexQ00]->slice_beta_offset;
+  int tc_offset   = img->slices[sliceIndexQ00]->slice_tc_offset;
 
-          for (int dy=-4;dy<4;dy++) {
-            for (int dx=0;dx<4;dx++) {
-              printf("%02x ", ptr[dy*stride + dx]);
-              if (dx==-1) printf("| ");
-            }
-            printf("\n");
-            if (dy==-1) printf("-------------------------\n");
-          }
-        }
-#endif
+  int Q_beta = Clip3(0,51, qP_L + beta_offset);
+  int betaPrime = table_8_23_beta[Q_beta];
+  *beta = betaPrime * (1<<(bitDepth_Y - 8));
 
-      if (bS>0) {
+  int Q_tc = Clip3(0,53, qP_L + 2*(bS-1) + tc_offset);
+  int tcPrime = table_8_23_tc[Q_tc];
+  *tc = tcPrime * (1<<(bitDepth_Y - 8));
 
-        // 8.7.2.4.3
+  logtrace(LogDeblock,"beta: %d (%d)  tc: %d (%d)\n",*beta,beta_offset, *tc,tc_offset);
 
-        pixel_t* ptr = img->get_image_plane_at_pos_NEW<pixel_t>(0, xDi,yDi);
+  *filterP = true;
+  if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xP,yP)) *filterP=false;
+  if (img->get_cu_transquant_bypass(xP,yP)) *filterP=false;
 
-        pixel_t q[4][4], p[4][4];
-        for (int k=0;k<4;k++)
-          for (int i=0;i<4;i++)
-            {
-              if (vertical) {
-                q[k][i] = ptr[ i  +k*stride];
-                p[k][i] = ptr[-i-1+k*stride];
-              }
-              else {
-                q[k][i] = ptr[k + i   *stride];
-                p[k][i] = ptr[k -(i+1)*stride];
-              }
-            }
-
-#if 0
-        for (int k=0;k<4;k++)
-          {
-            for (int i=0;i<4;i++)
-              {
-                printf("%02x ", p[k][3-i]);
-              }
-
-            printf("| ");
-
-            for (int i=0;i<4;i++)
-              {
-                printf("%02x ", q[k][i]);
-              }
-            printf("\n");
-          }
-#endif
-
-
-        int QP_Q = img->get_QPY(xDi,yDi);
-        int QP_P = (vertical ?
-                    img->get_QPY(xDi-1,yDi) :
-                    img->get_QPY(xDi,yDi-1) );
-        int qP_L = (QP_Q+QP_P+1)>>1;
-
-        logtrace(LogDeblock,"QP: %d & %d -> %d\n",QP_Q,QP_P,qP_L);
-
-        int sliceIndexQ00 = img->get_SliceHeaderIndex(xDi,yDi);
-        int beta_offset = img->slices[sliceIndexQ00]->slice_beta_offset;
-        int tc_offset   = img->slices[sliceIndexQ00]->slice_tc_offset;
-
-        int Q_beta = Clip3(0,51, qP_L + beta_offset);
-        int betaPrime = table_8_23_beta[Q_beta];
-        int beta = betaPrime * (1<<(bitDepth_Y - 8));
-
-        int Q_tc = Clip3(0,53, qP_L + 2*(bS-1) + tc_offset);
-        int tcPrime = table_8_23_tc[Q_tc];
-        int tc = tcPrime * (1<<(bitDepth_Y - 8));
-
-        logtrace(LogDeblock,"beta: %d (%d)  tc: %d (%d)\n",beta,beta_offset, tc,tc_offset);
-
-        int dE=0, dEp=0, dEq=0;
-
-        if (vertical || !vertical) {
-          int dp0 = abs_value(p[0][2] - 2*p[0][1] + p[0][0]);
-          int dp3 = abs_value(p[3][2] - 2*p[3][1] + p[3][0]);
-          int dq0 = abs_value(q[0][2] - 2*q[0][1] + q[0][0]);
-          int dq3 = abs_value(q[3][2] - 2*q[3][1] + q[3][0]);
-
-          int dpq0 = dp0 + dq0;
-          int dpq3 = dp3 + dq3;
-
-          int dp = dp0 + dp3;
-          int dq = dq0 + dq3;
-          int d  = dpq0+ dpq3;
-
-          if (d<beta) {
-            //int dpq = 2*dpq0;
-            bool dSam0 = (2*dpq0 < (beta>>2) &&
-                          abs_value(p[0][3]-p[0][0])+abs_value(q[0][0]-q[0][3]) < (beta>>3) &&
-                          abs_value(p[0][0]-q[0][0]) < ((5*tc+1)>>1));
-
-            bool dSam3 = (2*dpq3 < (beta>>2) &&
-                          abs_value(p[3][3]-p[3][0])+abs_value(q[3][0]-q[3][3]) < (beta>>3) &&
-                          abs_value(p[3][0]-q[3][0]) < ((5*tc+1)>>1));
-
-            if (dSam0 && dSam3) {
-              dE=2;
-            }
-            else {
-              dE=1;
-            }
-
-            if (dp < ((beta + (beta>>1))>>3)) { dEp=1; }
-            if (dq < ((beta + (beta>>1))>>3)) { dEq=1; }
-
-            logtrace(LogDeblock,"dE:%d dEp:%d dEq:%d\n",dE,dEp,dEq);
-          }
-        }
-        else {
-          // TODO
-          assert(0);
-        }
-
-
-        // 8.7.2.4.4
-
-        if (dE != 0) {
-          bool filterP = true;
-          bool filterQ = true;
-
-          if (vertical) {
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xDi-1,yDi)) filterP=false;
-            if (img->get_cu_transquant_bypass(xDi-1,yDi)) filterP=false;
-
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xDi,yDi)) filterQ=false;
-            if (img->get_cu_transquant_bypass(xDi,yDi)) filterQ=false;
-          }
-          else {
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xDi,yDi-1)) filterP=false;
-            if (img->get_cu_transquant_bypass(xDi,yDi-1)) filterP=false;
-
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xDi,yDi)) filterQ=false;
-            if (img->get_cu_transquant_bypass(xDi,yDi)) filterQ=false;
-          }
-
-          for (int k=0;k<4;k++) {
-            //int nDp,nDq;
-
-            logtrace(LogDeblock,"line:%d\n",k);
-
-            const pixel_t p0 = p[k][0];
-            const pixel_t p1 = p[k][1];
-            const pixel_t p2 = p[k][2];
-            const pixel_t p3 = p[k][3];
-            const pixel_t q0 = q[k][0];
-            const pixel_t q1 = q[k][1];
-            const pixel_t q2 = q[k][2];
-            const pixel_t q3 = q[k][3];
-
-            if (dE==2) {
-              // strong filtering
-
-              //nDp=nDq=3;
-
-              pixel_t pnew[3],qnew[3];
-              pnew[0] = Clip3(p0-2*tc,p0+2*tc, (p2 + 2*p1 + 2*p0 + 2*q0 + q1 +4)>>3);
-              pnew[1] = Clip3(p1-2*tc,p1+2*tc, (p2 + p1 + p0 + q0+2)>>2);
-              pnew[2] = Clip3(p2-2*tc,p2+2*tc, (2*p3 + 3*p2 + p1 + p0 + q0 + 4)>>3);
-              qnew[0] = Clip3(q0-2*tc,q0+2*tc, (p1+2*p0+2*q0+2*q1+q2+4)>>3);
-              qnew[1] = Clip3(q1-2*tc,q1+2*tc, (p0+q0+q1+q2+2)>>2);
-              qnew[2] = Clip3(q2-2*tc,q2+2*tc, (p0+q0+q1+3*q2+2*q3+4)>>3);
-
-              logtrace(LogDeblock,"strong filtering\n");
-
-              if (vertical) {
-                for (int i=0;i<3;i++) {
-                  if (filterP) { ptr[-i-1+k*stride] = pnew[i]; }
-                  if (filterQ) { ptr[ i + k*stride] = qnew[i]; }
-                }
-
-                // ptr[-1+k*stride] = ptr[ 0+k*stride] = 200;
-              }
-              else {
-                for (int i=0;i<3;i++) {
-                  if (filterP) { ptr[ k -(i+1)*stride] = pnew[i]; }
-                  if (filterQ) { ptr[ k + i   *stride] = qnew[i]; }
-                }
-              }
-            }
-            else {
-              // weak filtering
-
-              //nDp=nDq=0;
+  *filterQ = true;
+  if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xDi,yDi)) *filterQ=false;
+  if (img->get_cu_transquant_bypass(xDi,yDi)) *filterQ=false;
+}
 
-              int delta = (9*(q0-p0) - 3*(q1-p1) + 8)>>4;
-              logtrace(LogDeblock,"delta=%d, tc=%d\n",delta,tc);
 
-              if (abs_value(delta) < tc*10) {
+// 8.7.2.4
+/* The edges are filtered in units of two 4-line segments. Since the picture size is a
+   multiple of the minimum CB size (at least 8), there is always an even number of
+   segments along an edge.
+ */
+template <class pixel_t>
+void edge_filtering_luma_internal(de265_image* img, bool vertical,
+                                  int yStart,int yEnd, int xStart,int xEnd)
+{
+  //printf("luma %d-%d %d-%d\n",xStart,xEnd,yStart,yEnd);
 
-                delta = Clip3(-tc,tc,delta);
-                logtrace(LogDeblock," deblk + %d;%d [%02x->%02x]  - %d;%d [%02x->%02x] delta:%d\n",
-                         vertical ? xDi-1 : xDi+k,
-                         vertical ? yDi+k : yDi-1, p0,Clip_BitDepth(p0+delta, bitDepth_Y),
-                         vertical ? xDi   : xDi+k,
-                         vertical ? yDi+k : yDi,   q0,Clip_BitDepth(q0-delta, bitDepth_Y),
-                         delta);
+  const seq_parameter_set& sps = img->get_sps();
+  const acceleration_functions& acceleration = img->decctx->acceleration;
 
-                if (vertical) {
-                  if (filterP) { ptr[-0-1+k*stride] = Clip_BitDepth(p0+delta, bitDepth_Y); }
-                  if (filterQ) { ptr[ 0  +k*stride] = Clip_BitDepth(q0-delta, bitDepth_Y); }
-                }
-                else {
-                  if (filterP) { ptr[ k -1*stride] = Clip_BitDepth(p0+delta, bitDepth_Y); }
-                  if (filterQ) { ptr[ k +0*stride] = Clip_BitDepth(q0-delta, bitDepth_Y); }
-                }
+  const int stride = img->get_image_stride(0);
 
-                //ptr[ 0+k*stride] = 200;
+  int bitDepth_Y = sps.BitDepth_Y;
 
-                if (dEp==1 && filterP) {
-                  int delta_p = Clip3(-(tc>>1), tc>>1, (((p2+p0+1)>>1)-p1+delta)>>1);
+  xEnd = libde265_min(xEnd,img->get_deblk_width());
+  yEnd = libde265_min(yEnd,img->get_deblk_height());
 
-                  logtrace(LogDeblock," deblk dEp %d;%d delta:%d\n",
-                           vertical ? xDi-2 : xDi+k,
-                           vertical ? yDi+k : yDi-2,
-                           delta_p);
+  for (int y=yStart;y<yEnd;y+=2)
+    for (int x=xStart;x<xEnd;x+=2) {
+      // x;y in deblocking units (4x4 pixels)
 
-                  if (vertical) { ptr[-1-1+k*stride] = Clip_BitDepth(p1+delta_p, bitDepth_Y); }
-                  else          { ptr[ k  -2*stride] = Clip_BitDepth(p1+delta_p, bitDepth_Y); }
-                }
+      int xDi = x<<2; // *4 -> pixel resolution
+      int yDi = y<<2; // *4 -> pixel resolution
 
-                if (dEq==1 && filterQ) {
-                  int delta_q = Clip3(-(tc>>1), tc>>1, (((q2+q0+1)>>1)-q1-delta)>>1);
+      int beta[2], tc[2];
+      bool filterP[2], filterQ[2];
 
-                  logtrace(LogDeblock," delkb dEq %d;%d delta:%d\n",
-                           vertical ? xDi+1 : xDi+k,
-                           vertical ? yDi+k : yDi+1,
-                           delta_q);
+      for (int s=0;s<2;s++) {
+        luma_segment_parameters(img, vertical,
+                                vertical ? xDi : xDi+4*s,
+                                vertical ? yDi+4*s : yDi,
+                                &beta[s], &tc[s], &filterP[s], &filterQ[s]);
+      }
 
-                  if (vertical) { ptr[ 1  +k*stride] = Clip_BitDepth(q1+delta_q, bitDepth_Y); }
-                  else          { ptr[ k  +1*stride] = Clip_BitDepth(q1+delta_q, bitDepth_Y); }
-                }
+      if (tc[0]==0 && tc[1]==0) {
+        continue;
+      }
 
-                //nDp = dEp+1;
-                //nDq = dEq+1;
+      pixel_t* ptr = img->get_image_plane_at_pos_NEW<pixel_t>(0, xDi,yDi);
 
-                //logtrace(LogDeblock,"weak filtering (%d:%d)\n",nDp,nDq);
-              }
-            }
-          }
-        }
-      }
+      acceleration.deblock_luma(vertical, ptr, stride, beta, tc, filterP, filterQ, bitDepth_Y);
     }
 }
 
@@ -734,6 +528,7 @@ void edge_filtering_chroma_internal(de265_image* img, bool vertical,
   //printf("chroma %d-%d %d-%d\n",xStart,xEnd,yStart,yEnd);
 
   const seq_parameter_set& sps = img->get_sps();
+  const acceleration_functions& acceleration = img->decctx->acceleration;
 
   const int SubWidthC  = sps.SubWidthC;
   const int SubHeightC = sps.SubHeightC;
@@ -763,53 +558,23 @@ void edge_filtering_chroma_internal(de265_image* img, bool vertical,
       if (bS>1) {
         // 8.7.2.4.5
 
+        int QP_Q = img->get_QPY(SubWidthC*xDi,SubHeightC*yDi);
+        int QP_P = (vertical ?
+                    img->get_QPY(SubWidthC*xDi-1,SubHeightC*yDi) :
+                    img->get_QPY(SubWidthC*xDi,SubHeightC*yDi-1));
+
+        int sliceIndexQ00 = img->get_SliceHeaderIndex(SubWidthC*xDi,SubHeightC*yDi);
+        int tc_offset   = img->slices[sliceIndexQ00]->slice_tc_offset;
+
+        int tc[2];
+
         for (int cplane=0;cplane<2;cplane++) {
           int cQpPicOffset = (cplane==0 ?
                               img->get_pps().pic_cb_qp_offset :
                               img->get_pps().pic_cr_qp_offset);
 
-          pixel_t* ptr = img->get_image_plane_at_pos_NEW<pixel_t>(cplane+1, xDi,yDi);
-
-          pixel_t p[2][4];
-          pixel_t q[2][4];
-
           logtrace(LogDeblock,"-%s- %d %d\n",cplane==0 ? "Cb" : "Cr",xDi,yDi);
 
-          for (int i=0;i<2;i++)
-            for (int k=0;k<4;k++)
-              {
-                if (vertical) {
-                  q[i][k] = ptr[ i  +k*stride];
-                  p[i][k] = ptr[-i-1+k*stride];
-                }
-                else {
-                  q[i][k] = ptr[k + i   *stride];
-                  p[i][k] = ptr[k -(i+1)*stride];
-                }
-              }
-
-#if 0
-          for (int k=0;k<4;k++)
-            {
-              for (int i=0;i<2;i++)
-                {
-                  printf("%02x ", p[1-i][k]);
-                }
-
-              printf("| ");
-
-              for (int i=0;i<2;i++)
-                {
-                  printf("%02x ", q[i][k]);
-                }
-              printf("\n");
-            }
-#endif
-
-          int QP_Q = img->get_QPY(SubWidthC*xDi,SubHeightC*yDi);
-          int QP_P = (vertical ?
-                      img->get_QPY(SubWidthC*xDi-1,SubHeightC*yDi) :
-                      img->get_QPY(SubWidthC*xDi,SubHeightC*yDi-1));
           int qP_i = ((QP_Q+QP_P+1)>>1) + cQpPicOffset;
           int QP_C;
           if (sps.ChromaArrayType == CHROMA_420) {
@@ -823,49 +588,29 @@ void edge_filtering_chroma_internal(de265_image* img, bool vertical,
           logtrace(LogDeblock,"%d %d: ((%d+%d+1)>>1) + %d = qP_i=%d  (QP_C=%d)\n",
                    SubWidthC*xDi,SubHeightC*yDi, QP_Q,QP_P,cQpPicOffset,qP_i,QP_C);
 
-          int sliceIndexQ00 = img->get_SliceHeaderIndex(SubWidthC*xDi,SubHeightC*yDi);
-          int tc_offset   = img->slices[sliceIndexQ00]->slice_tc_offset;
-
           int Q = Clip3(0,53, QP_C + 2*(bS-1) + tc_offset);
 
           int tcPrime = table_8_23_tc[Q];
-          int tc = tcPrime * (1<<(sps.BitDepth_C - 8));
+          tc[cplane] = tcPrime * (1<<(sps.BitDepth_C - 8));
 
-          logtrace(LogDeblock,"tc_offset=%d Q=%d tc'=%d tc=%d\n",tc_offset,Q,tcPrime,tc);
+          logtrace(LogDeblock,"tc_offset=%d Q=%d tc'=%d tc=%d\n",tc_offset,Q,tcPrime,tc[cplane]);
+        }
 
-          if (vertical) {
-            bool filterP = true;
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(SubWidthC*xDi-1,SubHeightC*yDi)) filterP=false;
-            if (img->get_cu_transquant_bypass(SubWidthC*xDi-1,SubHeightC*yDi)) filterP=false;
+        int xP = vertical ? SubWidthC*xDi-1 : SubWidthC*xDi;
+        int yP = vertical ? SubHeightC*yDi  : SubHeightC*yDi-1;
 
-            bool filterQ = true;
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
-            if (img->get_cu_transquant_bypass(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
+        bool filterP = true;
+        if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(xP,yP)) filterP=false;
+        if (img->get_cu_transquant_bypass(xP,yP)) filterP=false;
 
+        bool filterQ = true;
+        if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
+        if (img->get_cu_transquant_bypass(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
 
-            for (int k=0;k<4;k++) {
-              int delta = Clip3(-tc,tc, ((((q[0][k]-p[0][k])<<2)+p[1][k]-q[1][k]+4)>>3));
-              logtrace(LogDeblock,"delta=%d\n",delta);
-              if (filterP) { ptr[-1+k*stride] = Clip_BitDepth(p[0][k]+delta, bitDepth_C); }
-              if (filterQ) { ptr[ 0+k*stride] = Clip_BitDepth(q[0][k]-delta, bitDepth_C); }
-            }
-          }
-          else {
-            bool filterP = true;
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(SubWidthC*xDi,SubHeightC*yDi-1)) filterP=false;
-            if (img->get_cu_transquant_bypass(SubWidthC*xDi,SubHeightC*yDi-1)) filterP=false;
-
-            bool filterQ = true;
-            if (sps.pcm_loop_filter_disable_flag && img->get_pcm_flag(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
-            if (img->get_cu_transquant_bypass(SubWidthC*xDi,SubHeightC*yDi)) filterQ=false;
-
-            for (int k=0;k<4;k++) {
-              int delta = Clip3(-tc,tc, ((((q[0][k]-p[0][k])<<2)+p[1][k]-q[1][k]+4)>>3));
-              if (filterP) { ptr[ k-1*stride] = Clip_BitDepth(p[0][k]+delta, bitDepth_C); }
-              if (filterQ) { ptr[ k+0*stride] = Clip_BitDepth(q[0][k]-delta, bitDepth_C); }
-            }
-          }
-        }
+        pixel_t* cb = img->get_image_plane_at_pos_NEW<pixel_t>(1, xDi,yDi);
+        pixel_t* cr = img->get_image_plane_at_pos_NEW<pixel_t>(2, xDi,yDi);
+
+        acceleration.deblock_chroma(vertical, cb,cr, stride, tc, filterP, filterQ, bitDepth_C);
       }
     }
 }
@@ -895,164 +640,26 @@ void edge_filtering_chroma_CTB(de265_image* img, bool vertical, int xCtb,int yCt
 
 
 
-class thread_task_deblock_CTBRow : public thread_task
+void deblock_CTB(de265_image* img, bool vertical, int xCtb,int yCtb)
 {
-public:
-  struct de265_image* img;
-  int  ctb_y;
-  bool vertical;
-
-  virtual void work();
-  virtual std::string name() const {
-    char buf[100];
-    sprintf(buf,"deblock-%d",ctb_y);
-    return buf;
-  }
-};
-
-
-void thread_task_deblock_CTBRow::work()
-{
-  state = Running;
-  img->thread_run(this);
-
-  int xStart=0;
-  int xEnd = img->get_deblk_width();
-
-  int ctbSize = img->get_sps().CtbSizeY;
-  int deblkSize = ctbSize/4;
-
-  int first =  ctb_y    * deblkSize;
-  int last  = (ctb_y+1) * deblkSize;
-  if (last > img->get_deblk_height()) {
-    last = img->get_deblk_height();
-  }
-
-  int finalProgress = CTB_PROGRESS_DEBLK_V;
-  if (!vertical) finalProgress = CTB_PROGRESS_DEBLK_H;
-
-  int rightCtb = img->get_sps().PicWidthInCtbsY-1;
-
-  if (vertical) {
-    // pass 1: vertical
-
-    int CtbRow = std::min(ctb_y+1 , img->get_sps().PicHeightInCtbsY-1);
-    img->wait_for_progress(this, rightCtb,CtbRow, CTB_PROGRESS_PREFILTER);
-  }
-  else {
-    // pass 2: horizontal
-
-    if (ctb_y>0) {
-      img->wait_for_progress(this, rightCtb,ctb_y-1, CTB_PROGRESS_DEBLK_V);
-    }
-
-    img->wait_for_progress(this, rightCtb,ctb_y,  CTB_PROGRESS_DEBLK_V);
-
-    if (ctb_y+1<img->get_sps().PicHeightInCtbsY) {
-      img->wait_for_progress(this, rightCtb,ctb_y+1, CTB_PROGRESS_DEBLK_V);
-    }
-  }
-
-  //printf("deblock %d to %d orientation: %d\n",first,last,vertical);
-
   bool deblocking_enabled;
 
   // first pass: check edge flags and whether we have to deblock
   if (vertical) {
-    deblocking_enabled = derive_edgeFlags_CTBRow(img, ctb_y);
-
-    //for (int x=0;x<=rightCtb;x++) {
-    int x=0; img->set_CtbDeblockFlag(x,ctb_y, deblocking_enabled);
-    //}
+    deblocking_enabled = derive_edgeFlags_CTB(img, xCtb,yCtb);
+    img->set_CtbDeblockFlag(xCtb,yCtb, deblocking_enabled);
   }
   else {
-    int x=0; deblocking_enabled=img->get_CtbDeblockFlag(x,ctb_y);
+    deblocking_enabled = img->get_CtbDeblockFlag(xCtb,yCtb);
   }
 
   if (deblocking_enabled) {
-    derive_boundaryStrength(img, vertical, first,last, xStart,xEnd);
+    derive_boundaryStrength_CTB(img, vertical, xCtb,yCtb);
 
-    edge_filtering_luma(img, vertical, first,last, xStart,xEnd);
+    edge_filtering_luma_CTB(img, vertical, xCtb,yCtb);
 
     if (img->get_sps().ChromaArrayType != CHROMA_MONO) {
-      edge_filtering_chroma(img, vertical, first,last, xStart,xEnd);
+      edge_filtering_chroma_CTB(img, vertical, xCtb,yCtb);
     }
   }
-
-  for (int x=0;x<=rightCtb;x++) {
-    const int CtbWidth = img->get_sps().PicWidthInCtbsY;
-    img->ctb_progress[x+ctb_y*CtbWidth].set_progress(finalProgress);
-  }
-
-  state = Finished;
-  img->thread_finishes(this);
-}
-
-
-void add_deblocking_tasks(image_unit* imgunit)
-{
-  de265_image* img = imgunit->img;
-  decoder_context* ctx = img->decctx;
-
-  int nRows = img->get_sps().PicHeightInCtbsY;
-
-  int n=0;
-  img->thread_start(nRows*2);
-
-  for (int pass=0;pass<2;pass++)
-    {
-      for (int y=0;y<img->get_sps().PicHeightInCtbsY;y++)
-        {
-          thread_task_deblock_CTBRow* task = new thread_task_deblock_CTBRow;
-
-          task->img   = img;
-          task->ctb_y = y;
-          task->vertical = (pass==0);
-
-          imgunit->tasks.push_back(task);
-          add_task(&ctx->thread_pool_, task);
-          n++;
-        }
-    }
-}
-
-
-void apply_deblocking_filter(de265_image* img) // decoder_context* ctx)
-{
-  decoder_context* ctx = img->decctx;
-
-  char enabled_deblocking = derive_edgeFlags(img);
-
-  if (enabled_deblocking)
-    {
-      // vertical filtering
-
-      logtrace(LogDeblock,"VERTICAL\n");
-      derive_boundaryStrength(img, true ,0,img->get_deblk_height(),0,img->get_deblk_width());
-      edge_filtering_luma    (img, true ,0,img->get_deblk_height(),0,img->get_deblk_width());
-
-      if (img->get_sps().ChromaArrayType != CHROMA_MONO) {
-        edge_filtering_chroma  (img, true ,0,img->get_deblk_height(),0,img->get_deblk_width());
-      }
-#if 0
-      char buf[1000];
-      sprintf(buf,"lf-after-V-%05d.yuv", ctx->img->PicOrderCntVal);
-      write_picture_to_file(ctx->img, buf);
-#endif
-
-      // horizontal filtering
-
-      logtrace(LogDeblock,"HORIZONTAL\n");
-      derive_boundaryStrength(img, false ,0,img->get_deblk_height(),0,img->get_deblk_width());
-      edge_filtering_luma    (img, false ,0,img->get_deblk_height(),0,img->get_deblk_width());
-
-      if (img->get_sps().ChromaArrayType != CHROMA_MONO) {
-        edge_filtering_chroma  (img, false ,0,img->get_deblk_height(),0,img->get_deblk_width());
-      }
-
-#if 0
-      sprintf(buf,"lf-after-H-%05d.yuv", ctx->img->PicOrderCntVal);
-      write_picture_to_file(ctx->img, buf);
-#endif
-    }
 }
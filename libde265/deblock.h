@@ -23,7 +23,11 @@
 
 #include "libde265/decctx.h"
 
-void add_deblocking_tasks(image_unit* imgunit);
-void apply_deblocking_filter(de265_image* img); //decoder_context* ctx);
+/* Deblocks the edges of one CTB in one direction. The vertical pass of the CTB to the
+   right modifies the left samples of this CTB, and the horizontal pass modifies the
+   last lines of the CTB above. Hence, the horizontal pass has to wait for the vertical
+   pass of the right neighbors of this and of the above CTB.
+ */
+void deblock_CTB(de265_image* img, bool vertical, int xCtb,int yCtb);
 
 #endif
@@ -20,9 +20,8 @@
 
 #include "decctx.h"
 #include "util.h"
-#include "sao.h"
 #include "sei.h"
-#include "deblock.h"
+#include "loopfilter.h"
 
 #include <string.h>
 #include <assert.h>
@@ -121,6 +120,8 @@ thread_context::thread_context()
   imgunit = NULL;
   sliceunit = NULL;
 
+  ctb_recon = NULL;
+
 
   //memset(this,0,sizeof(thread_context));
 
@@ -214,6 +215,10 @@ decoder_context::decoder_context()
 
   param_disable_deblocking = false;
   param_disable_sao = false;
+  param_max_frames_in_flight = 1;
+  param_continuation_tasks = false;
+  param_reference_border = 0;
+  param_low_memory = false;
   //param_disable_mc_residual_idct = false;
   //param_disable_intra_residual_idct = false;
 
@@ -322,6 +327,50 @@ decoder_context::~decoder_context()
     delete image_units.back();
     image_units.pop_back();
   }
+
+  for (size_t i=0;i<metadata_pool.size();i++) {
+    delete metadata_pool[i];
+  }
+}
+
+
+void decoder_context::release_picture_metadata(de265_image* img)
+{
+  if (!img->has_mv_info()) {
+    return;
+  }
+
+  image_metadata_buffers* buffers = new image_metadata_buffers;
+
+  if (param_low_memory) {
+    img->swap_decoding_metadata(*buffers);
+  }
+  else {
+    // later pictures only use the compressed motion field
+    img->swap_mv_info(buffers->pb_info);
+  }
+
+  metadata_pool.push_back(buffers);
+}
+
+
+void decoder_context::take_metadata_from_pool(de265_image* img)
+{
+  if (metadata_pool.empty()) {
+    return;
+  }
+
+  image_metadata_buffers* buffers = metadata_pool.back();
+  metadata_pool.pop_back();
+
+  if (param_low_memory) {
+    img->swap_decoding_metadata(*buffers);
+  }
+  else {
+    img->swap_mv_info(buffers->pb_info);
+  }
+
+  delete buffers;
 }
 
 
@@ -355,6 +404,7 @@ void decoder_context::stop_thread_pool()
 {
   if (get_num_worker_threads()>0) {
     //flush_thread_pool(&ctx->thread_pool);
+    finish_image_units_in_flight();
     ::stop_thread_pool(&thread_pool_);
   }
 }
@@ -364,6 +414,7 @@ void decoder_context::reset()
 {
   if (num_worker_threads>0) {
     //flush_thread_pool(&ctx->thread_pool);
+    finish_image_units_in_flight();
     ::stop_thread_pool(&thread_pool_);
   }
 
@@ -443,6 +494,9 @@ void base_context::set_acceleration_functions(enum de265_acceleration l)
   if (l>=de265_acceleration_SSE) {
     init_acceleration_functions_sse(&acceleration);
   }
+  if (l>=de265_acceleration_AVX2) {
+    init_acceleration_functions_avx2(&acceleration);
+  }
 #endif
 #ifdef HAVE_ARM
   if (l>=de265_acceleration_ARM) {
@@ -652,10 +706,14 @@ de265_error decoder_context::read_slice_NAL(bitreader& reader, NAL_unit* nal, na
 
   // modify entry_point_offsets
 
-  int headerLength = reader.data - nal->data();
-  for (int i=0;i<shdr->num_entry_point_offsets;i++) {
-    shdr->entry_point_offset[i] -= nal->num_skipped_bytes_before(shdr->entry_point_offset[i],
-                                                                 headerLength);
+  // (not when the stuffing bytes are still in the data, the offsets count them)
+
+  if (!nal->skipped_bytes_in_data()) {
+    int headerLength = reader.data - nal->data();
+    for (int i=0;i<shdr->num_entry_point_offsets;i++) {
+      shdr->entry_point_offset[i] -= nal->num_skipped_bytes_before(shdr->entry_point_offset[i],
+                                                                   headerLength);
+    }
   }
 
 
@@ -708,6 +766,9 @@ de265_error decoder_context::decode_some(bool* did_work)
 
   if (image_units.empty()) { return DE265_OK; }  // nothing to do
 
+  if (task_based_decoding()) {
+    return decode_some_frame_parallel(did_work);
+  }
 
   // decode something if there is work to do
 
@@ -726,8 +787,7 @@ de265_error decoder_context::decode_some(bool* did_work)
 
       *did_work = true;
 
-      //err = decode_slice_unit_sequential(imgunit, sliceunit);
-      err = decode_slice_unit_parallel(imgunit, sliceunit);
+      err = decode_slice_unit_single_threaded(imgunit, sliceunit);
       if (err) {
         return err;
       }
@@ -743,8 +803,7 @@ de265_error decoder_context::decode_some(bool* did_work)
 
   if ( ( image_units.size()>=2 && image_units[0]->all_slice_segments_processed()) ||
        ( image_units.size()>=1 && image_units[0]->all_slice_segments_processed() &&
-         nal_parser.number_of_NAL_units_pending()==0 &&
-         (nal_parser.is_end_of_stream() || nal_parser.is_end_of_frame()) )) {
+         nal_parser.is_end_of_input(true) )) {
 
     image_unit* imgunit = image_units[0];
 
@@ -753,9 +812,6 @@ de265_error decoder_context::decode_some(bool* did_work)
 
     // mark all CTBs as decoded even if they are not, because faulty input
     // streams could miss part of the picture
-    // TODO: this will not work when slice decoding is parallel to post-filtering,
-    // so we will have to replace this with keeping track of which CTB should have
-    // been decoded (but aren't because of the input stream being faulty)
 
     imgunit->img->mark_all_CTB_progress(CTB_PROGRESS_PREFILTER);
 
@@ -763,10 +819,11 @@ de265_error decoder_context::decode_some(bool* did_work)
 
     // run post-processing filters (deblocking & SAO)
 
-    if (img->decctx->num_worker_threads)
-      run_postprocessing_filters_parallel(imgunit);
-    else
-      run_postprocessing_filters_sequential(imgunit->img);
+    run_postprocessing_filters_sequential(imgunit->img);
+
+    imgunit->img->mark_all_CTB_progress(CTB_PROGRESS_COMPLETE);
+
+    release_picture_metadata(imgunit->img);
 
     // process suffix SEIs
 
@@ -829,13 +886,14 @@ de265_error decoder_context::decode_slice_unit_sequential(image_unit* imgunit,
 
   init_CABAC_decoder(&tctx.cabac_decoder,
                      sliceunit->reader.data,
-                     sliceunit->reader.bytes_remaining);
+                     sliceunit->reader.bytes_remaining,
+                     &sliceunit->reader.skipped);
 
   // alloc CABAC-model array if entropy_coding_sync is enabled
 
   if (imgunit->img->get_pps().entropy_coding_sync_enabled_flag &&
       sliceunit->shdr->first_slice_segment_in_pic_flag) {
-    imgunit->ctx_models.resize( (img->get_sps().PicHeightInCtbsY-1) ); //* CONTEXT_MODEL_TABLE_LENGTH );
+    imgunit->ctx_models.resize( (imgunit->img->get_sps().PicHeightInCtbsY-1) ); //* CONTEXT_MODEL_TABLE_LENGTH );
   }
 
   sliceunit->nThreads=1;
@@ -865,21 +923,32 @@ void decoder_context::mark_whole_slice_as_processed(image_unit* imgunit,
            nextSegment->shdr->slice_segment_address);
     */
 
-    for (int ctb=sliceunit->shdr->slice_segment_address;
-         ctb < nextSegment->shdr->slice_segment_address;
-         ctb++)
+    // slice segments cover a range of CTBs in tile-scan order
+
+    const pic_parameter_set& pps = imgunit->img->get_pps();
+
+    if (sliceunit  ->shdr->slice_segment_address >= pps.CtbAddrRStoTS.size() ||
+        nextSegment->shdr->slice_segment_address >= pps.CtbAddrRStoTS.size()) {
+      return;
+    }
+
+    for (int ctbTS=pps.CtbAddrRStoTS[sliceunit->shdr->slice_segment_address];
+         ctbTS < pps.CtbAddrRStoTS[nextSegment->shdr->slice_segment_address];
+         ctbTS++)
       {
-        if (ctb >= imgunit->img->number_of_ctbs())
+        if (ctbTS >= imgunit->img->number_of_ctbs())
           break;
 
-        imgunit->img->ctb_progress[ctb].set_progress(progress);
+        imgunit->img->ctb_progress[ pps.CtbAddrTStoRS[ctbTS] ].set_progress(progress);
       }
   }
 }
 
 
-de265_error decoder_context::decode_slice_unit_parallel(image_unit* imgunit,
-                                                        slice_unit* sliceunit)
+// Decodes the slice segment in the calling thread (without worker threads) and
+// updates the CTB progress around it.
+de265_error decoder_context::decode_slice_unit_single_threaded(image_unit* imgunit,
+                                                               slice_unit* sliceunit)
 {
   de265_error err = DE265_OK;
 
@@ -893,25 +962,9 @@ de265_error decoder_context::decode_slice_unit_parallel(image_unit* imgunit,
   */
 
   de265_image* img = imgunit->img;
-  const pic_parameter_set& pps = img->get_pps();
 
   sliceunit->state = slice_unit::InProgress;
 
-  bool use_WPP = (img->decctx->num_worker_threads > 0 &&
-                  pps.entropy_coding_sync_enabled_flag);
-
-  bool use_tiles = (img->decctx->num_worker_threads > 0 &&
-                    pps.tiles_enabled_flag);
-
-
-  // TODO: remove this warning later when we do frame-parallel decoding
-  if (img->decctx->num_worker_threads > 0 &&
-      pps.entropy_coding_sync_enabled_flag == false &&
-      pps.tiles_enabled_flag == false) {
-
-    img->decctx->add_warning(DE265_WARNING_NO_WPP_CANNOT_USE_MULTITHREADING, true);
-  }
-
 
   // If this is the first slice segment, mark all CTBs before this as processed
   // (the real first slice segment could be missing).
@@ -938,46 +991,15 @@ de265_error decoder_context::decode_slice_unit_parallel(image_unit* imgunit,
   }
 
 
-  // TODO: even though we cannot split this into several tasks, we should run it
-  // as a background thread
-  if (!use_WPP && !use_tiles) {
-    //printf("SEQ\n");
-    err = decode_slice_unit_sequential(imgunit, sliceunit);
-    sliceunit->state = slice_unit::Decoded;
-    mark_whole_slice_as_processed(imgunit,sliceunit,CTB_PROGRESS_PREFILTER);
-    return err;
-  }
-
-
-  if (use_WPP && use_tiles) {
-    // TODO: this is not allowed ... output some warning or error
-
-    return DE265_WARNING_PPS_HEADER_INVALID;
-  }
-
-
-  if (use_WPP) {
-    //printf("WPP\n");
-    err = decode_slice_unit_WPP(imgunit, sliceunit);
-    sliceunit->state = slice_unit::Decoded;
-    mark_whole_slice_as_processed(imgunit,sliceunit,CTB_PROGRESS_PREFILTER);
-    return err;
-  }
-  else if (use_tiles) {
-    //printf("TILE\n");
-    err = decode_slice_unit_tiles(imgunit, sliceunit);
-    sliceunit->state = slice_unit::Decoded;
-    mark_whole_slice_as_processed(imgunit,sliceunit,CTB_PROGRESS_PREFILTER);
-    return err;
-  }
-
-  assert(false);
+  err = decode_slice_unit_sequential(imgunit, sliceunit);
+  sliceunit->state = slice_unit::Decoded;
+  mark_whole_slice_as_processed(imgunit,sliceunit,CTB_PROGRESS_PREFILTER);
   return err;
 }
 
 
-de265_error decoder_context::decode_slice_unit_WPP(image_unit* imgunit,
-                                                   slice_unit* sliceunit)
+de265_error decoder_context::add_tasks_decode_slice_unit_WPP(image_unit* imgunit,
+                                                            slice_unit* sliceunit)
 {
   de265_error err = DE265_OK;
 
@@ -989,9 +1011,6 @@ de265_error decoder_context::decode_slice_unit_WPP(image_unit* imgunit,
   int ctbsWidth = img->get_sps().PicWidthInCtbsY;
 
 
-  assert(img->num_threads_active() == 0);
-
-
   // reserve space to store entropy coding context models for each CTB row
 
   if (shdr->first_slice_segment_in_pic_flag) {
@@ -1057,7 +1076,8 @@ de265_error decoder_context::decode_slice_unit_WPP(image_unit* imgunit,
 
     init_CABAC_decoder(&tctx->cabac_decoder,
                        &sliceunit->reader.data[dataStartIndex],
-                       dataEnd-dataStartIndex);
+                       dataEnd-dataStartIndex,
+                       &sliceunit->reader.skipped);
 
     // add task
 
@@ -1067,31 +1087,12 @@ de265_error decoder_context::decode_slice_unit_WPP(image_unit* imgunit,
     add_task_decode_CTB_row(tctx, entryPt==0, ctbRow);
   }
 
-#if 0
-  for (;;) {
-    printf("q:%d r:%d b:%d f:%d\n",
-           img->nThreadsQueued,
-           img->nThreadsRunning,
-           img->nThreadsBlocked,
-           img->nThreadsFinished);
-
-    if (img->debug_is_completed()) break;
-
-    usleep(1000);
-  }
-#endif
-
-  img->wait_for_completion();
-
-  for (int i=0;i<imgunit->tasks.size();i++)
-    delete imgunit->tasks[i];
-  imgunit->tasks.clear();
-
-  return DE265_OK;
+  return err;
 }
 
-de265_error decoder_context::decode_slice_unit_tiles(image_unit* imgunit,
-                                                     slice_unit* sliceunit)
+
+de265_error decoder_context::add_tasks_decode_slice_unit_tiles(image_unit* imgunit,
+                                                               slice_unit* sliceunit)
 {
   de265_error err = DE265_OK;
 
@@ -1103,8 +1104,6 @@ de265_error decoder_context::decode_slice_unit_tiles(image_unit* imgunit,
   int ctbsWidth = img->get_sps().PicWidthInCtbsY;
 
 
-  assert(img->num_threads_active() == 0);
-
   sliceunit->allocate_thread_contexts(nTiles);
 
 
@@ -1159,7 +1158,8 @@ de265_error decoder_context::decode_slice_unit_tiles(image_unit* imgunit,
 
     init_CABAC_decoder(&tctx->cabac_decoder,
                        &sliceunit->reader.data[dataStartIndex],
-                       dataEnd-dataStartIndex);
+                       dataEnd-dataStartIndex,
+                       &sliceunit->reader.skipped);
 
     // add task
 
@@ -1171,16 +1171,384 @@ de265_error decoder_context::decode_slice_unit_tiles(image_unit* imgunit,
                                   ctbAddrRS / ctbsWidth);
   }
 
+  return err;
+}
+
+
+de265_error decoder_context::add_task_decode_slice_unit_sequential(image_unit* imgunit,
+                                                                   slice_unit* sliceunit)
+{
+  de265_image* img = imgunit->img;
+  slice_segment_header* shdr = sliceunit->shdr;
+  const pic_parameter_set& pps = img->get_pps();
+
+  if (shdr->slice_segment_address >= pps.CtbAddrRStoTS.size()) {
+    return DE265_ERROR_CTB_OUTSIDE_IMAGE_AREA;
+  }
+
+  if (sliceunit->reader.bytes_remaining <= 0) {
+    return DE265_ERROR_PREMATURE_END_OF_SLICE;
+  }
+
+  sliceunit->allocate_thread_contexts(1);
+
+  thread_context* tctx = sliceunit->get_thread_context(0);
+
+  tctx->shdr    = shdr;
+  tctx->decctx  = this;
+  tctx->img     = img;
+  tctx->imgunit = imgunit;
+  tctx->sliceunit= sliceunit;
+  tctx->CtbAddrInTS = pps.CtbAddrRStoTS[shdr->slice_segment_address];
+
+  init_thread_context(tctx);
+
+  init_CABAC_decoder(&tctx->cabac_decoder,
+                     sliceunit->reader.data,
+                     sliceunit->reader.bytes_remaining,
+                     &sliceunit->reader.skipped);
+
+  // alloc CABAC-model array if entropy_coding_sync is enabled
+
+  if (pps.entropy_coding_sync_enabled_flag &&
+      shdr->first_slice_segment_in_pic_flag) {
+    imgunit->ctx_models.resize( (img->get_sps().PicHeightInCtbsY-1) );
+  }
+
+  thread_task_slice_segment_data* task = new thread_task_slice_segment_data;
+  task->tctx = tctx;
+  tctx->task = task;
+
+  img->thread_start(1);
+  sliceunit->nThreads++;
+
+  add_task(&thread_pool_, task);
+  imgunit->tasks.push_back(task);
+
+  return DE265_OK;
+}
+
+
+void decoder_context::add_tasks_reconstruct_CTB_rows(image_unit* imgunit, int finalProgress)
+{
+  de265_image* img = imgunit->img;
+  const int nRows = img->get_sps().PicHeightInCtbsY;
+
+  img->thread_start(nRows);
+
+  for (int y=0;y<nRows;y++) {
+    thread_context* tctx = new thread_context;
+    tctx->decctx  = this;
+    tctx->img     = img;
+    tctx->imgunit = imgunit;
+
+    thread_task_reconstruct_ctb_row* task = new thread_task_reconstruct_ctb_row;
+    task->tctx  = tctx;
+    task->ctb_y = y;
+    task->ctb_x = 0;
+    task->finalProgress = finalProgress;
+    tctx->task = task;
+
+    add_task(&thread_pool_, task);
+    imgunit->tasks.push_back(task);
+  }
+}
+
+
+/* Runs after all slice segments of a picture have been decoded. Marks all CTBs as decoded
+   (or parsed, with split reconstruction), even if they are not, because faulty input
+   streams could miss part of the picture.
+ */
+class thread_task_finish_slice_decoding : public thread_task
+{
+public:
+  image_unit* imgunit;
+  int progress;
+
+  virtual void work();
+  virtual std::string name() const { return "finish-slice-decoding"; }
+};
+
+
+void thread_task_finish_slice_decoding::work()
+{
+  de265_image* img = imgunit->img;
+
+  img->thread_run_or_resume(this);
+
+  for (int i=0;i<imgunit->slice_units.size();i++) {
+    slice_unit* sliceunit = imgunit->slice_units[i];
+    if (!img->wait_for_progress_or_defer(this, &sliceunit->finished_threads, sliceunit->nThreads)) {
+      return;
+    }
+  }
+
+  if (progress == CTB_PROGRESS_COMPLETE) {
+    img->extend_borders(); // no loop filters, the picture is final
+  }
+
+  img->mark_all_CTB_progress(progress);
+
+  state = Finished;
+  img->thread_finishes(this);
+}
+
+
+/* Frame-parallel decoding: an image unit is started as soon as all of its slices have
+   been received, and up to 'param_max_frames_in_flight' image units are decoded at the
+   same time. They are finished (and output) in decoding order. With only one picture in
+   flight, this still overlaps the in-loop filters with the slice decoding.
+   The tasks of an image unit only wait for tasks that were queued earlier: the tasks of
+   previous pictures, and earlier tasks of the same picture.
+ */
+de265_error decoder_context::decode_some_frame_parallel(bool* did_work)
+{
+  de265_error err = DE265_OK;
+
+  // no more slices will be added to the last image unit
+
+  bool end_of_input = nal_parser.is_end_of_input(true);
+
+  while (!image_units.empty()) {
+
+    // start all complete image units, as long as we do not exceed the maximum
+
+    int  nInFlight = 0;
+    bool waitingForFreeSlot = false;
+
+    for (int i=0;i<image_units.size();i++) {
+      image_unit* imgunit = image_units[i];
+
+      if (imgunit->state != image_unit::Unprocessed) {
+        nInFlight++;
+        continue;
+      }
+
+      if (i==image_units.size()-1 && !end_of_input) {
+        break;
+      }
+
+      if (nInFlight >= param_max_frames_in_flight) {
+        waitingForFreeSlot = true;
+        break;
+      }
+
+      *did_work = true;
+      nInFlight++;
+
+      de265_error startErr = start_image_unit_decoding(imgunit);
+      if (startErr != DE265_OK) {
+        err = startErr;
+      }
+    }
+
+
+    // finish the oldest image unit if it is done, or if we cannot continue without it
+
+    image_unit* imgunit = image_units[0];
+
+    if (imgunit->state != image_unit::InProgress) {
+      break;
+    }
+
+    if (!waitingForFreeSlot && !end_of_input && !imgunit->img->is_completed()) {
+      break;
+    }
+
+    *did_work = true;
+
+    finish_image_unit_decoding(imgunit);
+
+    // at the end of the input, return to the caller after each finished picture
+
+    if (end_of_input) {
+      break;
+    }
+  }
+
+  return err;
+}
+
+
+de265_error decoder_context::start_image_unit_decoding(image_unit* imgunit)
+{
+  de265_error err = DE265_OK;
+
+  de265_image* img = imgunit->img;
+  const seq_parameter_set& sps = img->get_sps();
+  const pic_parameter_set& pps = img->get_pps();
+
+  imgunit->state = image_unit::InProgress;
+
+
+  // If the first slice segment is missing, mark all CTBs before it as processed.
+
+  slice_segment_header* firstShdr = imgunit->slice_units[0]->shdr;
+  if (firstShdr->slice_segment_address < pps.CtbAddrRStoTS.size()) {
+    for (int ctbTS=0; ctbTS < pps.CtbAddrRStoTS[firstShdr->slice_segment_address]; ctbTS++) {
+      img->ctb_progress[ pps.CtbAddrTStoRS[ctbTS] ].set_progress(CTB_PROGRESS_PREFILTER);
+    }
+  }
+
+
+  // Set the slice address of all CTBs in advance. Slices that are decoded in parallel
+  // use it to check whether a neighboring CTB belongs to the same slice, while the
+  // neighboring slice may still be decoding.
+
+  for (int i=0;i<imgunit->slice_units.size();i++) {
+    slice_segment_header* shdr = imgunit->slice_units[i]->shdr;
+    if (shdr->slice_segment_address >= pps.CtbAddrRStoTS.size()) {
+      continue;
+    }
+
+    int endTS = img->number_of_ctbs();
+    if (i+1 < imgunit->slice_units.size()) {
+      int nextAddr = imgunit->slice_units[i+1]->shdr->slice_segment_address;
+      if (nextAddr < pps.CtbAddrRStoTS.size()) {
+        endTS = libde265_min(endTS, pps.CtbAddrRStoTS[nextAddr]);
+      }
+    }
+
+    for (int ctbTS=pps.CtbAddrRStoTS[shdr->slice_segment_address]; ctbTS<endTS; ctbTS++) {
+      int ctbRS = pps.CtbAddrTStoRS[ctbTS];
+      img->set_SliceAddrRS(ctbRS % sps.PicWidthInCtbsY, ctbRS / sps.PicWidthInCtbsY,
+                           shdr->SliceAddrRS);
+    }
+  }
+
+
+  // When the slices are decoded in CTB order, the samples are reconstructed by
+  // separate tasks, so that the reconstruction can run on other cores than the parsing.
+
+  bool sequentialSlices = (pps.entropy_coding_sync_enabled_flag == pps.tiles_enabled_flag);
+  if (sequentialSlices) {
+    imgunit->ctb_reconstruction.resize(sps.PicSizeInCtbsY);
+  }
+
+
+  // queue slice decoding
+
+  for (int i=0;i<imgunit->slice_units.size();i++) {
+    slice_unit* sliceunit = imgunit->slice_units[i];
+
+    sliceunit->state = slice_unit::InProgress;
+
+    // WPP rows and tiles are decoded in parallel. Without both, the independent slices
+    // are decoded in parallel, and the slice segments within a slice in CTB order.
+    // Slices that use both WPP and tiles are also decoded in CTB order, as a single task.
+
+    de265_error sliceErr;
+    if (pps.entropy_coding_sync_enabled_flag && pps.tiles_enabled_flag) {
+      sliceErr = add_task_decode_slice_unit_sequential(imgunit, sliceunit);
+    }
+    else if (pps.entropy_coding_sync_enabled_flag) {
+      sliceErr = add_tasks_decode_slice_unit_WPP(imgunit, sliceunit);
+    }
+    else if (pps.tiles_enabled_flag) {
+      sliceErr = add_tasks_decode_slice_unit_tiles(imgunit, sliceunit);
+    }
+    else {
+      sliceErr = add_task_decode_slice_unit_sequential(imgunit, sliceunit);
+    }
+
+    if (sliceErr != DE265_OK) {
+      err = sliceErr;
+    }
+  }
+
+
+  // queue in-loop filters, they run in parallel to the slice decoding
+
+  bool deblocking = !param_disable_deblocking;
+  bool sao = (!param_disable_sao && sps.sample_adaptive_offset_enabled_flag);
+
+  int decodedProgress = ((deblocking || sao) ? CTB_PROGRESS_PREFILTER : CTB_PROGRESS_COMPLETE);
+
+  thread_task_finish_slice_decoding* finishTask = new thread_task_finish_slice_decoding;
+  finishTask->imgunit = imgunit;
+  finishTask->progress = (imgunit->split_reconstruction() ? CTB_PROGRESS_PARSED : decodedProgress);
+
+  img->thread_start(1);
+  add_task(&thread_pool_, finishTask);
+  imgunit->tasks.push_back(finishTask);
+
+  if (imgunit->split_reconstruction()) {
+    add_tasks_reconstruct_CTB_rows(imgunit, decodedProgress);
+  }
+
+  if (deblocking || sao) {
+    add_loop_filter_tasks(imgunit, deblocking, sao);
+  }
+
+  return err;
+}
+
+
+de265_error decoder_context::finish_image_unit_decoding(image_unit* imgunit)
+{
+  de265_error err = DE265_OK;
+
+  assert(imgunit == image_units[0]);
+
+  de265_image* img = imgunit->img;
+
   img->wait_for_completion();
 
-  for (int i=0;i<imgunit->tasks.size();i++)
-    delete imgunit->tasks[i];
-  imgunit->tasks.clear();
+  for (int i=0;i<imgunit->slice_units.size();i++) {
+    imgunit->slice_units[i]->state = slice_unit::Decoded;
+  }
+
+  // Deblocking and SAO are done. Pictures still decoding only read the CTB progress
+  // and the compressed motion field.
+
+  release_picture_metadata(img);
+
+
+  // Reference pictures are kept until the picture is finished, because pictures
+  // that are still decoding may access them.
+
+  for (int i=0;i<imgunit->slice_units.size();i++) {
+    remove_images_from_dpb(imgunit->slice_units[i]->shdr->RemoveReferencesList);
+  }
+
+  if (imgunit->slice_units[0]->flush_reorder_buffer) {
+    dpb.flush_reorder_buffer();
+  }
+
+
+  // process suffix SEIs
+
+  for (int i=0;i<imgunit->suffix_SEIs.size();i++) {
+    const sei_message& sei = imgunit->suffix_SEIs[i];
+
+    err = process_sei(&sei, img);
+    if (err != DE265_OK)
+      break;
+  }
+
+  push_picture_to_output_queue(imgunit);
+
+  // remove just decoded image unit from queue
+
+  delete imgunit;
+
+  pop_front(image_units);
 
   return err;
 }
 
 
+/* Wait for all pictures that are decoded in the background. This has to be done
+   before the thread pool is stopped and before the DPB is reallocated. */
+void decoder_context::finish_image_units_in_flight()
+{
+  while (!image_units.empty() &&
+         image_units[0]->state == image_unit::InProgress) {
+    finish_image_unit_decoding(image_units[0]);
+  }
+}
+
+
 de265_error decoder_context::decode_NAL(NAL_unit* nal)
 {
   //return decode_NAL_OLD(nal);
@@ -1190,7 +1558,13 @@ de265_error decoder_context::decode_NAL(NAL_unit* nal)
   de265_error err = DE265_OK;
 
   bitreader reader;
-  bitreader_init(&reader, nal->data(), nal->size());
+  if (nal->skipped_bytes_in_data()) {
+    bitreader_init_skipped(&reader, nal->data(), nal->size(),
+                           nal->skipped_byte_positions(), nal->num_skipped_bytes());
+  }
+  else {
+    bitreader_init(&reader, nal->data(), nal->size());
+  }
 
   nal_header nal_hdr;
   nal_hdr.read(&reader);
@@ -1269,10 +1643,13 @@ de265_error decoder_context::decode(int* more)
 {
   decoder_context* ctx = this;
 
+  // with asynchronous input parsing, wait until there is a NAL or all input has been parsed
+
+  ctx->nal_parser.wait_for_parsed_input();
+
   // if the stream has ended, and no more NALs are to be decoded, flush all pictures
 
-  if (ctx->nal_parser.get_NAL_queue_length() == 0 &&
-      (ctx->nal_parser.is_end_of_stream() || ctx->nal_parser.is_end_of_frame()) &&
+  if (ctx->nal_parser.is_end_of_input(false) &&
       ctx->image_units.empty()) {
 
     // flush all pending pictures into output queue
@@ -1300,6 +1677,11 @@ de265_error decoder_context::decode(int* more)
 
   // when there are no free image buffers in the DPB, pause decoding
   // -> output stalled
+  // (Pictures decoded in the background still hold on to their reference pictures.)
+
+  if (!ctx->dpb.has_free_dpb_picture(false)) {
+    finish_image_units_in_flight();
+  }
 
   if (!ctx->dpb.has_free_dpb_picture(false)) {
     if (more) *more = 1;
@@ -1415,6 +1797,10 @@ int decoder_context::generate_unavailable_reference_picture(const seq_parameter_
 
   std::shared_ptr<const seq_parameter_set> current_sps = this->sps[ (int)current_pps->seq_parameter_set_id ];
 
+  if (dpb.new_image_reallocates()) {
+    finish_image_units_in_flight();
+  }
+
   int idx = dpb.new_image(current_sps, this, 0,0, false);
   assert(idx>=0);
   //printf("-> fill with unavailable POC %d\n",POC);
@@ -1433,6 +1819,9 @@ int decoder_context::generate_unavailable_reference_picture(const seq_parameter_
   img->PicState = (longTerm ? UsedForLongTermReference : UsedForShortTermReference);
   img->integrity = INTEGRITY_UNAVAILABLE_REFERENCE;
 
+  img->extend_borders();
+  img->mark_all_CTB_progress(CTB_PROGRESS_COMPLETE);
+
   return idx;
 }
 
@@ -1876,17 +2265,15 @@ void decoder_context::run_postprocessing_filters_sequential(de265_image* img)
     write_picture_to_file(img, buf);
 #endif
 
-    if (!img->decctx->param_disable_deblocking) {
-      apply_deblocking_filter(img);
-    }
-
-#if SAVE_INTERMEDIATE_IMAGES
-    sprintf(buf,"pre-sao-%05d.yuv", img->PicOrderCntVal);
-    write_picture_to_file(img, buf);
-#endif
+    bool deblocking = !img->decctx->param_disable_deblocking;
+    bool sao = (!img->decctx->param_disable_sao &&
+                img->get_sps().sample_adaptive_offset_enabled_flag);
 
-    if (!img->decctx->param_disable_sao) {
-      apply_sample_adaptive_offset_sequential(img);
+    if (deblocking || sao) {
+      apply_loop_filters(img, deblocking, sao);
+    }
+    else {
+      img->extend_borders();
     }
 
 #if SAVE_INTERMEDIATE_IMAGES
@@ -1896,26 +2283,6 @@ void decoder_context::run_postprocessing_filters_sequential(de265_image* img)
 }
 
 
-void decoder_context::run_postprocessing_filters_parallel(image_unit* imgunit)
-{
-  de265_image* img = imgunit->img;
-
-  int saoWaitsForProgress = CTB_PROGRESS_PREFILTER;
-  bool waitForCompletion = false;
-
-  if (!img->decctx->param_disable_deblocking) {
-    add_deblocking_tasks(imgunit);
-    saoWaitsForProgress = CTB_PROGRESS_DEBLK_H;
-  }
-
-  if (!img->decctx->param_disable_sao) {
-    waitForCompletion |= add_sao_tasks(imgunit, saoWaitsForProgress);
-    //apply_sample_adaptive_offset(img);
-  }
-
-  img->wait_for_completion();
-}
-
 /*
 void decoder_context::push_current_picture_to_output_queue()
 {
@@ -2002,14 +2369,16 @@ bool decoder_context::process_slice_segment_header(slice_segment_header* hdr,
     current_image_poc_lsb = hdr->slice_pic_order_cnt_lsb;
 
 
-    seq_parameter_set* sps = current_sps.get();
+    // --- find and allocate image buffer for decoding ---
 
+    // the DPB must not be reallocated while pictures are decoded in the background
 
-    // --- find and allocate image buffer for decoding ---
+    if (dpb.new_image_reallocates()) {
+      finish_image_units_in_flight();
+    }
 
     int image_buffer_idx;
-    bool isOutputImage = (!sps->sample_adaptive_offset_enabled_flag || param_disable_sao);
-    image_buffer_idx = dpb.new_image(current_sps, this, pts, user_data, isOutputImage);
+    image_buffer_idx = dpb.new_image(current_sps, this, pts, user_data, true);
     if (image_buffer_idx == -1) {
       *err = DE265_ERROR_IMAGE_BUFFER_FULL;
       return false;
@@ -2088,6 +2457,11 @@ bool decoder_context::process_slice_segment_header(slice_segment_header* hdr,
     {
       bool success = construct_reference_picture_lists(hdr);
       if (!success) {
+        // the picture will not be decoded, do not let later pictures wait for it
+        if (hdr->first_slice_segment_in_pic_flag) {
+          img->mark_all_CTB_progress(CTB_PROGRESS_COMPLETE);
+        }
+
         return false;
       }
     }
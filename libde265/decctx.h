@@ -50,6 +50,60 @@ class slice_unit;
 class decoder_context;
 
 
+/* When parsing and reconstruction are split, the parser stores everything that is needed
+   to reconstruct the samples of a CTB here. The reconstruction replays the operations in
+   the order in which they were parsed.
+ */
+class ctb_reconstruction_data
+{
+public:
+  enum op_type { TransformBlock, PredictionBlock, PCMSamples };
+
+  struct transform_block {
+    int x0,y0;            // position of TU in frame (chroma adapted)
+    int xCUBase,yCUBase;  // position of CU in frame (chroma adapted)
+    int nT;
+    uint8_t cIdx;
+    uint8_t cuPredMode;
+    uint8_t cbf;
+    uint8_t transform_skip_flag;
+    uint8_t cu_transquant_bypass_flag;
+    uint8_t explicit_rdpcm_flag;
+    uint8_t explicit_rdpcm_dir;
+    int8_t  ResScaleVal;
+    int qPYPrime, qPCbPrime, qPCrPrime;
+    int nCoeff;
+    int firstCoeff;       // index into 'coeffs', the positions follow the values
+  };
+
+  struct prediction_block {
+    const slice_segment_header* shdr;
+    int xC,yC, xB,yB, nCS, nPbW,nPbH;
+    PBMotion vi;
+  };
+
+  struct pcm_samples {
+    int x0,y0, log2CbSize;
+    uint8_t* data;  // the samples are read again from the slice data
+    int bytes_remaining;
+    skipped_bytes_list skipped;
+  };
+
+  struct op {
+    enum op_type type;
+
+    union {
+      transform_block  tb;
+      prediction_block pb;
+      pcm_samples      pcm;
+    };
+  };
+
+  std::vector<op> ops;
+  std::vector<int16_t> coeffs;
+};
+
+
 class thread_context
 {
 public:
@@ -117,6 +171,9 @@ public:
   slice_unit* sliceunit;
   thread_task* task; // executing thread_task or NULL if not multi-threaded
 
+  // If set, the samples are not reconstructed while parsing, but recorded for the current CTB.
+  ctb_reconstruction_data* ctb_recon;
+
 private:
   thread_context(const thread_context&); // not allowed
   const thread_context& operator=(const thread_context&); // not allowed
@@ -197,7 +254,6 @@ public:
   ~image_unit();
 
   de265_image* img;
-  de265_image  sao_output; // if SAO is used, this is allocated and used as SAO output buffer
 
   std::vector<slice_unit*> slice_units;
   std::vector<sei_message> suffix_SEIs;
@@ -263,6 +319,18 @@ public:
 
   std::vector<thread_task*> tasks; // we are the owner
 
+  /* Reconstruction data of all CTBs, when parsing and reconstruction are split.
+     The slice-segment tasks only parse the CTBs (CTB_PROGRESS_PARSED), the samples
+     are reconstructed by separate tasks for each CTB row. Empty otherwise. */
+  std::vector<ctb_reconstruction_data> ctb_reconstruction;
+
+  bool split_reconstruction() const { return !ctb_reconstruction.empty(); }
+
+  // CTB progress after a CTB has been decoded by the slice-segment tasks
+  int decoded_CTB_progress() const {
+    return split_reconstruction() ? CTB_PROGRESS_PARSED : CTB_PROGRESS_PREFILTER;
+  }
+
   /* Saved context models for WPP.
      There is one saved model for the initialization of each CTB row.
      The array is unused for non-WPP streams. */
@@ -324,9 +392,18 @@ class decoder_context : public base_context {
   de265_error decode_some(bool* did_work);
 
   de265_error decode_slice_unit_sequential(image_unit* imgunit, slice_unit* sliceunit);
-  de265_error decode_slice_unit_parallel(image_unit* imgunit, slice_unit* sliceunit);
-  de265_error decode_slice_unit_WPP(image_unit* imgunit, slice_unit* sliceunit);
-  de265_error decode_slice_unit_tiles(image_unit* imgunit, slice_unit* sliceunit);
+  de265_error decode_slice_unit_single_threaded(image_unit* imgunit, slice_unit* sliceunit);
+
+  // decoding in the thread pool (also frame-parallel decoding)
+
+  de265_error decode_some_frame_parallel(bool* did_work);
+  de265_error start_image_unit_decoding(image_unit* imgunit);
+  de265_error finish_image_unit_decoding(image_unit* imgunit);
+  void        finish_image_units_in_flight();
+
+  void mark_whole_slice_as_processed(image_unit* imgunit,
+                                     slice_unit* sliceunit,
+                                     int progress);
 
 
   void process_nal_hdr(nal_header*);
@@ -338,6 +415,13 @@ class decoder_context : public base_context {
   //void push_current_picture_to_output_queue();
   de265_error push_picture_to_output_queue(image_unit*);
 
+  /* Move the metadata of a finished picture that later pictures do not access into
+     'metadata_pool', from where the next picture takes it. Normally, this is only the
+     full-resolution motion field. In low-memory mode, it is all decoding-only metadata. */
+  void release_picture_metadata(de265_image*);
+
+  void take_metadata_from_pool(de265_image*);
+
 
   // --- parameters ---
 
@@ -352,6 +436,11 @@ class decoder_context : public base_context {
 
   bool param_disable_deblocking;
   bool param_disable_sao;
+
+  int  param_max_frames_in_flight; // number of pictures that are decoded concurrently
+  bool param_continuation_tasks;   // tasks do not block on CTB progress, but are queued again
+  int  param_reference_border;     // border around the pictures in luma pixels, 0 = none
+  bool param_low_memory;           // release decoding metadata when a picture is finished
   //bool param_disable_mc_residual_idct;  // not implemented yet
   //bool param_disable_intra_residual_idct;  // not implemented yet
 
@@ -368,6 +457,14 @@ class decoder_context : public base_context {
 
   int get_num_worker_threads() const { return num_worker_threads; }
 
+  // With worker threads, all slice segments and in-loop filters of a picture are queued
+  // at once, such that the filters follow the slice decoding at CTB granularity.
+  bool task_based_decoding() const { return num_worker_threads > 0; }
+
+  bool frame_parallel_decoding() const {
+    return num_worker_threads > 0 && param_max_frames_in_flight > 1;
+  }
+
   /* */ de265_image* get_image(int dpb_index)       { return dpb.get_image(dpb_index); }
   const de265_image* get_image(int dpb_index) const { return dpb.get_image(dpb_index); }
 
@@ -508,9 +605,10 @@ class decoder_context : public base_context {
   void add_task_decode_slice_segment(thread_context* tctx, bool firstSliceSubstream,
                                      int ctbX,int ctbY);
 
-  void mark_whole_slice_as_processed(image_unit* imgunit,
-                                     slice_unit* sliceunit,
-                                     int progress);
+  de265_error add_tasks_decode_slice_unit_WPP(image_unit* imgunit, slice_unit* sliceunit);
+  de265_error add_tasks_decode_slice_unit_tiles(image_unit* imgunit, slice_unit* sliceunit);
+  de265_error add_task_decode_slice_unit_sequential(image_unit* imgunit, slice_unit* sliceunit);
+  void add_tasks_reconstruct_CTB_rows(image_unit* imgunit, int finalProgress);
 
   void process_picture_order_count(slice_segment_header* hdr);
   int generate_unavailable_reference_picture(const seq_parameter_set* sps,
@@ -521,7 +619,10 @@ class decoder_context : public base_context {
 
   void remove_images_from_dpb(const std::vector<int>& removeImageList);
   void run_postprocessing_filters_sequential(struct de265_image* img);
-  void run_postprocessing_filters_parallel(image_unit* img);
+
+  // Metadata arrays of finished pictures. There are at most as many as pictures have
+  // been decoding at the same time. Only used by the decoding thread.
+  std::vector<image_metadata_buffers*> metadata_pool;
 };
 
 
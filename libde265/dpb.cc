@@ -31,6 +31,9 @@ decoded_picture_buffer::decoded_picture_buffer()
 {
   max_images_in_DPB  = DPB_DEFAULT_MAX_IMAGES;
   norm_images_in_DPB = DPB_DEFAULT_MAX_IMAGES;
+
+  dpb.reserve(DPB_DEFAULT_MAX_IMAGES);
+  num_images = 0;
 }
 
 
@@ -73,6 +76,18 @@ bool decoded_picture_buffer::has_free_dpb_picture(bool high_priority) const
 }
 
 
+bool decoded_picture_buffer::new_image_reallocates() const
+{
+  for (int i=0;i<dpb.size();i++) {
+    if (dpb[i]->can_be_released()) {
+      return false;
+    }
+  }
+
+  return dpb.size() == dpb.capacity();
+}
+
+
 int decoded_picture_buffer::DPB_index_of_picture_with_POC(int poc, int currentID, bool preferLongTerm) const
 {
   logdebug(LogHeaders,"DPB_index_of_picture_with_POC POC=%d\n",poc);
@@ -213,9 +228,8 @@ int decoded_picture_buffer::new_image(std::shared_ptr<const seq_parameter_set> s
   int free_image_buffer_idx = -1;
   for (int i=0;i<dpb.size();i++) {
     if (dpb[i]->can_be_released()) {
-      dpb[i]->release(); /* TODO: this is surely not the best place to free the image, but
-                            we have to do it here because releasing it in de265_release_image()
-                            would break the API compatibility. */
+      /* The slot is not released here. alloc_image() keeps the pixel buffers when
+         the geometry did not change and frees the old slices. */
 
       free_image_buffer_idx = i;
       break;
@@ -232,6 +246,7 @@ int decoded_picture_buffer::new_image(std::shared_ptr<const seq_parameter_set> s
     {
       delete dpb.back();
       dpb.pop_back();
+      num_images.store(dpb.size(), std::memory_order_release);
     }
 
 
@@ -240,6 +255,7 @@ int decoded_picture_buffer::new_image(std::shared_ptr<const seq_parameter_set> s
   if (free_image_buffer_idx == -1) {
     free_image_buffer_idx = dpb.size();
     dpb.push_back(new de265_image);
+    num_images.store(dpb.size(), std::memory_order_release);
   }
 
 
@@ -26,6 +26,7 @@
 
 #include <deque>
 #include <vector>
+#include <atomic>
 
 class decoder_context;
 
@@ -47,20 +48,25 @@ public:
      are included in the check. */
   bool has_free_dpb_picture(bool high_priority) const;
 
+  /* Check whether new_image() has to enlarge the image list. This moves the list in
+     memory, which is not safe while other threads access the DPB. */
+  bool new_image_reallocates() const;
+
   /* Remove all pictures from DPB and queues. Decoding should be stopped while calling this. */
   void clear();
 
-  int size() const { return dpb.size(); }
+  int size() const { return num_images.load(std::memory_order_acquire); }
 
-  /* Raw access to the images. */
+  /* Raw access to the images. This may be called from worker threads while new images
+     are added, as long as the list is not reallocated (see new_image_reallocates()). */
 
   /* */ de265_image* get_image(int index)       {
-    if (index>=dpb.size()) return NULL;
+    if (index>=size()) return NULL;
     return dpb[index];
   }
 
   const de265_image* get_image(int index) const {
-    if (index>=dpb.size()) return NULL;
+    if (index>=size()) return NULL;
     return dpb[index];
   }
 
@@ -106,6 +112,7 @@ private:
   int norm_images_in_DPB;
 
   std::vector<struct de265_image*> dpb; // decoded picture buffer
+  std::atomic<int> num_images;          // dpb.size(), for reading from other threads
 
   std::vector<struct de265_image*> reorder_output_queue;
   std::deque<struct de265_image*>  image_output_queue;
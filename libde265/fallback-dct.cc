@@ -183,6 +183,34 @@ void transform_bypass_rdpcm_h_fallback(int32_t *dst, const int16_t *coeffs,int n
 }
 
 
+void dequant_flat_fallback(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos, int nCoeff,
+                           int m, int qPdiv6, int bdShift)
+{
+  const int64_t offset = (1<<(bdShift-1));
+  const int64_t fact = m << qPdiv6;
+
+  for (int i=0;i<nCoeff;i++) {
+    int64_t c = coeffList[i];
+    coeffBuf[ coeffPos[i] ] = Clip3(-32768,32767, (c*fact + offset) >> bdShift);
+  }
+}
+
+
+void dequant_scaled_fallback(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos, int nCoeff,
+                             const int16_t* m, int qPdiv6, int bdShift)
+{
+  const int64_t offset = (1<<(bdShift-1));
+
+  for (int i=0;i<nCoeff;i++) {
+    int pos = coeffPos[i];
+    int64_t c = coeffList[i];
+    int64_t fact = m[pos] << qPdiv6;
+
+    coeffBuf[pos] = Clip3(-32768,32767, (c*fact + offset) >> bdShift);
+  }
+}
+
+
 void rdpcm_v_fallback(int32_t* residual, const int16_t* coeffs, int nT,int tsShift,int bdShift)
 {
   int rnd = (1<<(bdShift-1));
@@ -510,7 +538,7 @@ void transform_idst_4x4_fallback(int32_t *dst, const int16_t *coeffs, int bdShif
 
 
 
-static int8_t mat_dct[32][32] = {
+const int8_t mat_dct[32][32] = {
   { 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64},
   { 90, 90, 88, 85, 82, 78, 73, 67, 61, 54, 46, 38, 31, 22, 13,  4,      -4,-13,-22,-31,-38,-46,-54,-61,-67,-73,-78,-82,-85,-88,-90,-90},
   { 90, 87, 80, 70, 57, 43, 25,  9, -9,-25,-43,-57,-70,-80,-87,-90,     -90,-87,-80,-70,-57,-43,-25, -9,  9, 25, 43, 57, 70, 80, 87, 90},
@@ -548,9 +576,10 @@ static int8_t mat_dct[32][32] = {
 
 
 
+// Only the top-left 'extent' x 'extent' coefficients may be non-zero.
 template <class pixel_t>
 void transform_idct_add(pixel_t *dst, ptrdiff_t stride,
-                        int nT, const int16_t *coeffs, int bit_depth)
+                        int nT, const int16_t *coeffs, int extent, int bit_depth)
 {
   /*
     The effective shift is
@@ -594,7 +623,7 @@ void transform_idct_add(pixel_t *dst, ptrdiff_t stride,
   /*
   printf("--- input\n");
   for (int r=0;r<nT;r++, printf("\n"))
-    for (int c=0;c<nT;c++) {
+    for (int c=0;c<extent;c++) {
       printf("%3d ",coeffs[c+r*nT]);
     }
   */
@@ -612,7 +641,7 @@ void transform_idct_add(pixel_t *dst, ptrdiff_t stride,
 
     // find last non-zero coefficient to reduce computations carried out in DCT
 
-    int lastCol = nT-1;
+    int lastCol = extent-1;
     for (;lastCol>=0;lastCol--) {
       if (coeffs[c+lastCol*nT]) { break; }
     }
@@ -665,7 +694,7 @@ void transform_idct_add(pixel_t *dst, ptrdiff_t stride,
 
     // find last non-zero coefficient to reduce computations carried out in DCT
 
-    int lastCol = nT-1;
+    int lastCol = extent-1;
     for (;lastCol>=0;lastCol--) {
       if (g[y*nT+lastCol]) { break; }
     }
@@ -864,43 +893,93 @@ void transform_idct_32x32_fallback(int32_t *dst, const int16_t *coeffs,
 
 void transform_4x4_add_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
 {
-  transform_idct_add<uint8_t>(dst,stride,  4, coeffs, 8);
+  transform_idct_add<uint8_t>(dst,stride,  4, coeffs, 4, 8);
 }
 
 void transform_8x8_add_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
 {
-  transform_idct_add<uint8_t>(dst,stride,  8, coeffs, 8);
+  transform_idct_add<uint8_t>(dst,stride,  8, coeffs, 8, 8);
 }
 
 void transform_16x16_add_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
 {
-  transform_idct_add<uint8_t>(dst,stride,  16, coeffs, 8);
+  transform_idct_add<uint8_t>(dst,stride,  16, coeffs, 16, 8);
 }
 
 void transform_32x32_add_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
 {
-  transform_idct_add<uint8_t>(dst,stride,  32, coeffs, 8);
+  transform_idct_add<uint8_t>(dst,stride,  32, coeffs, 32, 8);
 }
 
 
 void transform_4x4_add_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
 {
-  transform_idct_add<uint16_t>(dst,stride,  4, coeffs, bit_depth);
+  transform_idct_add<uint16_t>(dst,stride,  4, coeffs, 4, bit_depth);
 }
 
 void transform_8x8_add_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
 {
-  transform_idct_add<uint16_t>(dst,stride,  8, coeffs, bit_depth);
+  transform_idct_add<uint16_t>(dst,stride,  8, coeffs, 8, bit_depth);
 }
 
 void transform_16x16_add_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
 {
-  transform_idct_add<uint16_t>(dst,stride,  16, coeffs, bit_depth);
+  transform_idct_add<uint16_t>(dst,stride,  16, coeffs, 16, bit_depth);
 }
 
 void transform_32x32_add_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
 {
-  transform_idct_add<uint16_t>(dst,stride,  32, coeffs, bit_depth);
+  transform_idct_add<uint16_t>(dst,stride,  32, coeffs, 32, bit_depth);
+}
+
+
+void transform_4x4_add_sparse_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                         int extent)
+{
+  transform_idct_add<uint8_t>(dst,stride,  4, coeffs, extent, 8);
+}
+
+void transform_8x8_add_sparse_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                         int extent)
+{
+  transform_idct_add<uint8_t>(dst,stride,  8, coeffs, extent, 8);
+}
+
+void transform_16x16_add_sparse_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                           int extent)
+{
+  transform_idct_add<uint8_t>(dst,stride,  16, coeffs, extent, 8);
+}
+
+void transform_32x32_add_sparse_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                           int extent)
+{
+  transform_idct_add<uint8_t>(dst,stride,  32, coeffs, extent, 8);
+}
+
+
+void transform_4x4_add_sparse_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                          int extent, int bit_depth)
+{
+  transform_idct_add<uint16_t>(dst,stride,  4, coeffs, extent, bit_depth);
+}
+
+void transform_8x8_add_sparse_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                          int extent, int bit_depth)
+{
+  transform_idct_add<uint16_t>(dst,stride,  8, coeffs, extent, bit_depth);
+}
+
+void transform_16x16_add_sparse_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                            int extent, int bit_depth)
+{
+  transform_idct_add<uint16_t>(dst,stride,  16, coeffs, extent, bit_depth);
+}
+
+void transform_32x32_add_sparse_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                            int extent, int bit_depth)
+{
+  transform_idct_add<uint16_t>(dst,stride,  32, coeffs, extent, bit_depth);
 }
 
 
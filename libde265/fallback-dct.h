@@ -27,6 +27,11 @@
 #include "util.h"
 
 
+// DCT basis functions of the 32-point transform. Row j*32/nT holds basis function j
+// of the nT-point transform.
+extern const int8_t mat_dct[32][32];
+
+
 // --- decoding ---
 
 void transform_skip_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride);
@@ -43,6 +48,12 @@ void transform_8x8_add_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t
 void transform_16x16_add_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride);
 void transform_32x32_add_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride);
 
+// iDCT with non-zero coefficients only in the top-left 'extent' x 'extent' corner
+void transform_4x4_add_sparse_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent);
+void transform_8x8_add_sparse_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent);
+void transform_16x16_add_sparse_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent);
+void transform_32x32_add_sparse_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent);
+
 
 void transform_skip_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth);
 void transform_bypass_16_fallback(uint16_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride, int bit_depth);
@@ -53,6 +64,11 @@ void transform_8x8_add_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff
 void transform_16x16_add_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth);
 void transform_32x32_add_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth);
 
+void transform_4x4_add_sparse_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth);
+void transform_8x8_add_sparse_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth);
+void transform_16x16_add_sparse_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth);
+void transform_32x32_add_sparse_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth);
+
 void rotate_coefficients_fallback(int16_t *coeff, int nT);
 
 
@@ -73,6 +89,11 @@ void add_residual_fallback(pixel_t *dst, ptrdiff_t stride,
 }
 
 
+void dequant_flat_fallback(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos, int nCoeff,
+                           int m, int qPdiv6, int bdShift);
+void dequant_scaled_fallback(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos, int nCoeff,
+                             const int16_t* m, int qPdiv6, int bdShift);
+
 void rdpcm_v_fallback(int32_t* residual, const int16_t* coeffs, int nT, int tsShift,int bdShift);
 void rdpcm_h_fallback(int32_t* residual, const int16_t* coeffs, int nT, int tsShift,int bdShift);
 
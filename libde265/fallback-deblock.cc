@@ -0,0 +1,220 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fallback-deblock.h"
+#include "util.h"
+
+
+// 8.7.2.5.3 / 8.7.2.5.7
+// 'xstride' steps across the edge, 'ystride' along the edge.
+
+template <class pixel_t>
+static void deblock_luma_segment(pixel_t* ptr, ptrdiff_t xstride, ptrdiff_t ystride,
+                                 int beta, int tc, bool filterP, bool filterQ, int bitDepth)
+{
+  if (tc==0) {
+    return;
+  }
+
+#define P(k,i) ptr[(k)*ystride - ((i)+1)*xstride]
+#define Q(k,i) ptr[(k)*ystride + (i)*xstride]
+
+  int dp0 = abs_value(P(0,2) - 2*P(0,1) + P(0,0));
+  int dp3 = abs_value(P(3,2) - 2*P(3,1) + P(3,0));
+  int dq0 = abs_value(Q(0,2) - 2*Q(0,1) + Q(0,0));
+  int dq3 = abs_value(Q(3,2) - 2*Q(3,1) + Q(3,0));
+
+  int dpq0 = dp0 + dq0;
+  int dpq3 = dp3 + dq3;
+
+  int dp = dp0 + dp3;
+  int dq = dq0 + dq3;
+  int d  = dpq0+ dpq3;
+
+  if (d >= beta) {
+    return;
+  }
+
+  bool dSam0 = (2*dpq0 < (beta>>2) &&
+                abs_value(P(0,3)-P(0,0))+abs_value(Q(0,0)-Q(0,3)) < (beta>>3) &&
+                abs_value(P(0,0)-Q(0,0)) < ((5*tc+1)>>1));
+
+  bool dSam3 = (2*dpq3 < (beta>>2) &&
+                abs_value(P(3,3)-P(3,0))+abs_value(Q(3,0)-Q(3,3)) < (beta>>3) &&
+                abs_value(P(3,0)-Q(3,0)) < ((5*tc+1)>>1));
+
+  bool dEp = (dp < ((beta + (beta>>1))>>3));
+  bool dEq = (dq < ((beta + (beta>>1))>>3));
+
+  for (int k=0;k<4;k++) {
+    const int p0 = P(k,0);
+    const int p1 = P(k,1);
+    const int p2 = P(k,2);
+    const int p3 = P(k,3);
+    const int q0 = Q(k,0);
+    const int q1 = Q(k,1);
+    const int q2 = Q(k,2);
+    const int q3 = Q(k,3);
+
+    if (dSam0 && dSam3) {
+      // strong filtering
+
+      if (filterP) {
+        P(k,0) = Clip3(p0-2*tc,p0+2*tc, (p2 + 2*p1 + 2*p0 + 2*q0 + q1 +4)>>3);
+        P(k,1) = Clip3(p1-2*tc,p1+2*tc, (p2 + p1 + p0 + q0+2)>>2);
+        P(k,2) = Clip3(p2-2*tc,p2+2*tc, (2*p3 + 3*p2 + p1 + p0 + q0 + 4)>>3);
+      }
+      if (filterQ) {
+        Q(k,0) = Clip3(q0-2*tc,q0+2*tc, (p1+2*p0+2*q0+2*q1+q2+4)>>3);
+        Q(k,1) = Clip3(q1-2*tc,q1+2*tc, (p0+q0+q1+q2+2)>>2);
+        Q(k,2) = Clip3(q2-2*tc,q2+2*tc, (p0+q0+q1+3*q2+2*q3+4)>>3);
+      }
+    }
+    else {
+      // weak filtering
+
+      int delta = (9*(q0-p0) - 3*(q1-p1) + 8)>>4;
+
+      if (abs_value(delta) < tc*10) {
+        delta = Clip3(-tc,tc,delta);
+
+        if (filterP) {
+          P(k,0) = Clip_BitDepth(p0+delta, bitDepth);
+
+          if (dEp) {
+            int delta_p = Clip3(-(tc>>1), tc>>1, (((p2+p0+1)>>1)-p1+delta)>>1);
+            P(k,1) = Clip_BitDepth(p1+delta_p, bitDepth);
+          }
+        }
+
+        if (filterQ) {
+          Q(k,0) = Clip_BitDepth(q0-delta, bitDepth);
+
+          if (dEq) {
+            int delta_q = Clip3(-(tc>>1), tc>>1, (((q2+q0+1)>>1)-q1-delta)>>1);
+            Q(k,1) = Clip_BitDepth(q1+delta_q, bitDepth);
+          }
+        }
+      }
+    }
+  }
+
+#undef P
+#undef Q
+}
+
+
+// 8.7.2.5.5
+
+template <class pixel_t>
+static void deblock_chroma_segment(pixel_t* ptr, ptrdiff_t xstride, ptrdiff_t ystride,
+                                   int tc, bool filterP, bool filterQ, int bitDepth)
+{
+  if (tc==0) {
+    return;
+  }
+
+  for (int k=0;k<4;k++) {
+    pixel_t* p = ptr + k*ystride;
+
+    const int p0 = p[-xstride];
+    const int p1 = p[-2*xstride];
+    const int q0 = p[0];
+    const int q1 = p[xstride];
+
+    int delta = Clip3(-tc,tc, ((((q0-p0)*4)+p1-q1+4)>>3));
+
+    if (filterP) { p[-xstride] = Clip_BitDepth(p0+delta, bitDepth); }
+    if (filterQ) { p[0]        = Clip_BitDepth(q0-delta, bitDepth); }
+  }
+}
+
+
+template <class pixel_t>
+static void deblock_luma(pixel_t* ptr, ptrdiff_t stride, bool vertical,
+                         const int* beta, const int* tc,
+                         const bool* filterP, const bool* filterQ, int bitDepth)
+{
+  ptrdiff_t xstride = vertical ? 1 : stride;
+  ptrdiff_t ystride = vertical ? stride : 1;
+
+  for (int s=0;s<2;s++) {
+    deblock_luma_segment(ptr + 4*s*ystride, xstride, ystride,
+                         beta[s], tc[s], filterP[s], filterQ[s], bitDepth);
+  }
+}
+
+
+void deblock_luma_v_8_fallback(uint8_t *ptr, ptrdiff_t stride,
+                               const int* beta, const int* tc,
+                               const bool* filterP, const bool* filterQ)
+{
+  deblock_luma(ptr, stride, true, beta, tc, filterP, filterQ, 8);
+}
+
+void deblock_luma_h_8_fallback(uint8_t *ptr, ptrdiff_t stride,
+                               const int* beta, const int* tc,
+                               const bool* filterP, const bool* filterQ)
+{
+  deblock_luma(ptr, stride, false, beta, tc, filterP, filterQ, 8);
+}
+
+void deblock_luma_v_16_fallback(uint16_t *ptr, ptrdiff_t stride,
+                                const int* beta, const int* tc,
+                                const bool* filterP, const bool* filterQ, int bit_depth)
+{
+  deblock_luma(ptr, stride, true, beta, tc, filterP, filterQ, bit_depth);
+}
+
+void deblock_luma_h_16_fallback(uint16_t *ptr, ptrdiff_t stride,
+                                const int* beta, const int* tc,
+                                const bool* filterP, const bool* filterQ, int bit_depth)
+{
+  deblock_luma(ptr, stride, false, beta, tc, filterP, filterQ, bit_depth);
+}
+
+
+void deblock_chroma_v_8_fallback(uint8_t *cb, uint8_t *cr, ptrdiff_t stride,
+                                 const int* tc, bool filterP, bool filterQ)
+{
+  deblock_chroma_segment(cb, 1,stride, tc[0], filterP, filterQ, 8);
+  deblock_chroma_segment(cr, 1,stride, tc[1], filterP, filterQ, 8);
+}
+
+void deblock_chroma_h_8_fallback(uint8_t *cb, uint8_t *cr, ptrdiff_t stride,
+                                 const int* tc, bool filterP, bool filterQ)
+{
+  deblock_chroma_segment(cb, stride,1, tc[0], filterP, filterQ, 8);
+  deblock_chroma_segment(cr, stride,1, tc[1], filterP, filterQ, 8);
+}
+
+void deblock_chroma_v_16_fallback(uint16_t *cb, uint16_t *cr, ptrdiff_t stride,
+                                  const int* tc, bool filterP, bool filterQ, int bit_depth)
+{
+  deblock_chroma_segment(cb, 1,stride, tc[0], filterP, filterQ, bit_depth);
+  deblock_chroma_segment(cr, 1,stride, tc[1], filterP, filterQ, bit_depth);
+}
+
+void deblock_chroma_h_16_fallback(uint16_t *cb, uint16_t *cr, ptrdiff_t stride,
+                                  const int* tc, bool filterP, bool filterQ, int bit_depth)
+{
+  deblock_chroma_segment(cb, stride,1, tc[0], filterP, filterQ, bit_depth);
+  deblock_chroma_segment(cr, stride,1, tc[1], filterP, filterQ, bit_depth);
+}
@@ -0,0 +1,61 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FALLBACK_INTRAPRED_H
+#define FALLBACK_INTRAPRED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* Intra prediction of a nT x nT block. 'border' points to the corner
+   reference sample, the top reference samples are at border[1..2*nT] and the
+   left ones at border[-1..-2*nT].
+
+   intra_filter: reference sample filtering (in place), either the [1 2 1]
+   filter or strong intra smoothing (nT==32 only).
+   The DC and angular predictions apply the edge filters for luma blocks
+   smaller than 32x32, see the scalar versions in intrapred.h.
+ */
+
+// angle tables (8.4.4.2.6), indexed with the intra prediction mode and (mode-11)
+extern const int intraPredAngle_table[1+34];
+extern const int invAngle_table[25-10];
+
+
+void intra_filter_8_fallback(uint8_t *border, int nT, bool strong);
+void intra_pred_planar_8_fallback(uint8_t *dst, ptrdiff_t dststride,
+                                  const uint8_t *border, int nT);
+void intra_pred_dc_8_fallback(uint8_t *dst, ptrdiff_t dststride,
+                              const uint8_t *border, int nT, int cIdx);
+void intra_pred_angular_8_fallback(uint8_t *dst, ptrdiff_t dststride,
+                                   const uint8_t *border, int nT, int mode, int cIdx,
+                                   bool disableBoundaryFilter);
+
+void intra_filter_16_fallback(uint16_t *border, int nT, bool strong);
+void intra_pred_planar_16_fallback(uint16_t *dst, ptrdiff_t dststride,
+                                   const uint16_t *border, int nT, int bit_depth);
+void intra_pred_dc_16_fallback(uint16_t *dst, ptrdiff_t dststride,
+                               const uint16_t *border, int nT, int cIdx, int bit_depth);
+void intra_pred_angular_16_fallback(uint16_t *dst, ptrdiff_t dststride,
+                                    const uint16_t *border, int nT, int mode, int cIdx,
+                                    bool disableBoundaryFilter, int bit_depth);
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fallback-sao.h"
+#include "util.h"
+
+
+template <class pixel_t>
+static void sao_band(pixel_t *out, ptrdiff_t out_stride,
+                     const pixel_t *in, ptrdiff_t in_stride,
+                     int width, int height, int bandPosition, const int8_t* offsets,
+                     int bitDepth)
+{
+  const int bandShift = bitDepth-5;
+  const int maxPixelValue = (1<<bitDepth)-1;
+
+  int bandTable[32];
+  for (int k=0;k<32;k++) {
+    bandTable[k] = 0;
+  }
+
+  for (int k=0;k<4;k++) {
+    bandTable[ (k+bandPosition)&31 ] = offsets[k];
+  }
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x++) {
+      int offset = bandTable[ in[x]>>bandShift ];
+      out[x] = Clip3(0,maxPixelValue, in[x] + offset);
+    }
+
+    in  += in_stride;
+    out += out_stride;
+  }
+}
+
+
+// the neighbors of SaoEoClass 0-3
+static const int8_t hPos[4][2] = { { -1,1 }, {  0,0 }, { -1,1 }, { 1,-1 } };
+static const int8_t vPos[4][2] = { {  0,0 }, { -1,1 }, { -1,1 }, { -1,1 } };
+
+template <class pixel_t, int eoClass>
+static void sao_edge(pixel_t *out, ptrdiff_t out_stride,
+                     const pixel_t *in, ptrdiff_t in_stride,
+                     int width, int height, const int8_t* offsets,
+                     int bitDepth)
+{
+  const int maxPixelValue = (1<<bitDepth)-1;
+
+  const ptrdiff_t n0 = hPos[eoClass][0] + vPos[eoClass][0]*in_stride;
+  const ptrdiff_t n1 = hPos[eoClass][1] + vPos[eoClass][1]*in_stride;
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x++) {
+      int edgeIdx = Sign(in[x] - in[x+n0]) + Sign(in[x] - in[x+n1]);
+      out[x] = Clip3(0,maxPixelValue, in[x] + offsets[edgeIdx+2]);
+    }
+
+    in  += in_stride;
+    out += out_stride;
+  }
+}
+
+
+void sao_band_8_fallback(uint8_t *out, ptrdiff_t out_stride,
+                         const uint8_t *in, ptrdiff_t in_stride,
+                         int width, int height, int bandPosition, const int8_t* offsets)
+{
+  sao_band(out,out_stride, in,in_stride, width,height, bandPosition,offsets, 8);
+}
+
+void sao_band_16_fallback(uint16_t *out, ptrdiff_t out_stride,
+                          const uint16_t *in, ptrdiff_t in_stride,
+                          int width, int height, int bandPosition, const int8_t* offsets,
+                          int bit_depth)
+{
+  sao_band(out,out_stride, in,in_stride, width,height, bandPosition,offsets, bit_depth);
+}
+
+
+#define SAO_EDGE_FALLBACK(eoClass)                                      \
+  void sao_edge_ ## eoClass ## _8_fallback(uint8_t *out, ptrdiff_t out_stride, \
+                                           const uint8_t *in, ptrdiff_t in_stride, \
+                                           int width, int height, const int8_t* offsets) \
+  {                                                                     \
+    sao_edge<uint8_t,eoClass>(out,out_stride, in,in_stride, width,height, offsets, 8); \
+  }                                                                     \
+                                                                        \
+  void sao_edge_ ## eoClass ## _16_fallback(uint16_t *out, ptrdiff_t out_stride, \
+                                            const uint16_t *in, ptrdiff_t in_stride, \
+                                            int width, int height, const int8_t* offsets, \
+                                            int bit_depth)              \
+  {                                                                     \
+    sao_edge<uint16_t,eoClass>(out,out_stride, in,in_stride, width,height, offsets, bit_depth); \
+  }
+
+SAO_EDGE_FALLBACK(0)
+SAO_EDGE_FALLBACK(1)
+SAO_EDGE_FALLBACK(2)
+SAO_EDGE_FALLBACK(3)
+
+#undef SAO_EDGE_FALLBACK
@@ -0,0 +1,65 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FALLBACK_SAO_H
+#define FALLBACK_SAO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* SAO is applied to a block of width x height samples, reading the deblocked
+   samples from 'in' and writing the result to 'out'. For edge offsets, 'in'
+   also has to contain the one-sample border around the block. All samples
+   of the block are filtered, checks for unavailable neighbors or unfiltered
+   CUs are left to the caller.
+
+   Band offset: 'offsets' are the four offsets of the bands starting at
+   'bandPosition'.
+   Edge offset: the kernels are indexed with SaoEoClass, 'offsets' has five
+   entries indexed with edgeIdx+2 (the sum of the two neighbor signs plus 2),
+   the center entry being zero.
+ */
+
+void sao_band_8_fallback(uint8_t *out, ptrdiff_t out_stride,
+                         const uint8_t *in, ptrdiff_t in_stride,
+                         int width, int height, int bandPosition, const int8_t* offsets);
+void sao_band_16_fallback(uint16_t *out, ptrdiff_t out_stride,
+                          const uint16_t *in, ptrdiff_t in_stride,
+                          int width, int height, int bandPosition, const int8_t* offsets,
+                          int bit_depth);
+
+#define DECLARE_SAO_EDGE_FALLBACK(eoClass)                              \
+  void sao_edge_ ## eoClass ## _8_fallback(uint8_t *out, ptrdiff_t out_stride, \
+                                           const uint8_t *in, ptrdiff_t in_stride, \
+                                           int width, int height, const int8_t* offsets); \
+  void sao_edge_ ## eoClass ## _16_fallback(uint16_t *out, ptrdiff_t out_stride, \
+                                            const uint16_t *in, ptrdiff_t in_stride, \
+                                            int width, int height, const int8_t* offsets, \
+                                            int bit_depth);
+
+DECLARE_SAO_EDGE_FALLBACK(0)
+DECLARE_SAO_EDGE_FALLBACK(1)
+DECLARE_SAO_EDGE_FALLBACK(2)
+DECLARE_SAO_EDGE_FALLBACK(3)
+
+#undef DECLARE_SAO_EDGE_FALLBACK
+
+#endif
@@ -21,6 +21,9 @@
 #include "fallback.h"
 #include "fallback-motion.h"
 #include "fallback-dct.h"
+#include "fallback-deblock.h"
+#include "fallback-sao.h"
+#include "fallback-intrapred.h"
 
 
 void init_acceleration_functions_fallback(struct acceleration_functions* accel)
@@ -82,6 +85,9 @@ void init_acceleration_functions_fallback(struct acceleration_functions* accel)
 
 
 
+  accel->dequant_flat   = dequant_flat_fallback;
+  accel->dequant_scaled = dequant_scaled_fallback;
+
   accel->transform_skip_8 = transform_skip_8_fallback;
   accel->transform_skip_rdpcm_h_8 = transform_skip_rdpcm_h_8_fallback;
   accel->transform_skip_rdpcm_v_8 = transform_skip_rdpcm_v_8_fallback;
@@ -101,6 +107,16 @@ void init_acceleration_functions_fallback(struct acceleration_functions* accel)
   accel->transform_add_16[2] = transform_16x16_add_16_fallback;
   accel->transform_add_16[3] = transform_32x32_add_16_fallback;
 
+  accel->transform_add_sparse_8[0] = transform_4x4_add_sparse_8_fallback;
+  accel->transform_add_sparse_8[1] = transform_8x8_add_sparse_8_fallback;
+  accel->transform_add_sparse_8[2] = transform_16x16_add_sparse_8_fallback;
+  accel->transform_add_sparse_8[3] = transform_32x32_add_sparse_8_fallback;
+
+  accel->transform_add_sparse_16[0] = transform_4x4_add_sparse_16_fallback;
+  accel->transform_add_sparse_16[1] = transform_8x8_add_sparse_16_fallback;
+  accel->transform_add_sparse_16[2] = transform_16x16_add_sparse_16_fallback;
+  accel->transform_add_sparse_16[3] = transform_32x32_add_sparse_16_fallback;
+
   accel->rotate_coefficients = rotate_coefficients_fallback;
   accel->add_residual_8  = add_residual_fallback<uint8_t>;
   accel->add_residual_16 = add_residual_fallback<uint16_t>;
@@ -114,6 +130,38 @@ void init_acceleration_functions_fallback(struct acceleration_functions* accel)
   accel->transform_idct_16x16 = transform_idct_16x16_fallback;
   accel->transform_idct_32x32 = transform_idct_32x32_fallback;
 
+  accel->deblock_luma_8[0]   = deblock_luma_h_8_fallback;
+  accel->deblock_luma_8[1]   = deblock_luma_v_8_fallback;
+  accel->deblock_chroma_8[0] = deblock_chroma_h_8_fallback;
+  accel->deblock_chroma_8[1] = deblock_chroma_v_8_fallback;
+
+  accel->deblock_luma_16[0]   = deblock_luma_h_16_fallback;
+  accel->deblock_luma_16[1]   = deblock_luma_v_16_fallback;
+  accel->deblock_chroma_16[0] = deblock_chroma_h_16_fallback;
+  accel->deblock_chroma_16[1] = deblock_chroma_v_16_fallback;
+
+  accel->sao_band_8     = sao_band_8_fallback;
+  accel->sao_edge_8[0]  = sao_edge_0_8_fallback;
+  accel->sao_edge_8[1]  = sao_edge_1_8_fallback;
+  accel->sao_edge_8[2]  = sao_edge_2_8_fallback;
+  accel->sao_edge_8[3]  = sao_edge_3_8_fallback;
+
+  accel->sao_band_16    = sao_band_16_fallback;
+  accel->sao_edge_16[0] = sao_edge_0_16_fallback;
+  accel->sao_edge_16[1] = sao_edge_1_16_fallback;
+  accel->sao_edge_16[2] = sao_edge_2_16_fallback;
+  accel->sao_edge_16[3] = sao_edge_3_16_fallback;
+
+  accel->intra_filter_8       = intra_filter_8_fallback;
+  accel->intra_pred_planar_8  = intra_pred_planar_8_fallback;
+  accel->intra_pred_dc_8      = intra_pred_dc_8_fallback;
+  accel->intra_pred_angular_8 = intra_pred_angular_8_fallback;
+
+  accel->intra_filter_16       = intra_filter_16_fallback;
+  accel->intra_pred_planar_16  = intra_pred_planar_16_fallback;
+  accel->intra_pred_dc_16      = intra_pred_dc_16_fallback;
+  accel->intra_pred_angular_16 = intra_pred_angular_16_fallback;
+
   accel->fwd_transform_4x4_dst_8 = fdst_4x4_8_fallback;
   accel->fwd_transform_8[0] = fdct_4x4_8_fallback;
   accel->fwd_transform_8[1] = fdct_8x8_8_fallback;
@@ -26,6 +26,7 @@
 #include <assert.h>
 
 #include <limits>
+#include <algorithm>
 
 
 #ifdef HAVE_MALLOC_H
@@ -104,23 +105,43 @@ LIBDE265_API void de265_free_image_plane(struct de265_image* img, int cIdx)
 }
 
 
+/* Byte offset from the start of the allocated memory to the first pixel of the plane.
+   Non-zero when the plane is surrounded by a border (see de265_image::get_border()).
+ */
+static int plane_border_offset(const de265_image* img, int cIdx)
+{
+  int border = img->get_border(cIdx);
+  int bytes_per_pixel = ((cIdx==0 ? img->BitDepth_Y : img->BitDepth_C)+7)/8;
+
+  return (border * img->get_image_stride(cIdx) + border) * bytes_per_pixel;
+}
+
+
 static int  de265_image_get_buffer(de265_decoder_context* ctx,
                                    de265_image_spec* spec, de265_image* img, void* userdata)
 {
   const int rawChromaWidth  = spec->width  / img->SubWidthC;
   const int rawChromaHeight = spec->height / img->SubHeightC;
 
-  int luma_stride   = (spec->width    + spec->alignment-1) / spec->alignment * spec->alignment;
-  int chroma_stride = (rawChromaWidth + spec->alignment-1) / spec->alignment * spec->alignment;
+  const int luma_border   = img->get_border(0);
+  const int chroma_border = img->get_border(1);
+
+  int luma_stride   = ((spec->width    + 2*luma_border   + spec->alignment-1)
+                       / spec->alignment * spec->alignment);
+  int chroma_stride = ((rawChromaWidth + 2*chroma_border + spec->alignment-1)
+                       / spec->alignment * spec->alignment);
 
   assert(img->BitDepth_Y >= 8 && img->BitDepth_Y <= 16);
   assert(img->BitDepth_C >= 8 && img->BitDepth_C <= 16);
 
-  int luma_bpl   = luma_stride   * ((img->BitDepth_Y+7)/8);
-  int chroma_bpl = chroma_stride * ((img->BitDepth_C+7)/8);
+  int luma_bpp   = (img->BitDepth_Y+7)/8;
+  int chroma_bpp = (img->BitDepth_C+7)/8;
+
+  int luma_bpl   = luma_stride   * luma_bpp;
+  int chroma_bpl = chroma_stride * chroma_bpp;
 
-  int luma_height   = spec->height;
-  int chroma_height = rawChromaHeight;
+  int luma_height   = spec->height    + 2*luma_border;
+  int chroma_height = rawChromaHeight + 2*chroma_border;
 
   bool alloc_failed = false;
 
@@ -149,9 +170,14 @@ static int  de265_image_get_buffer(de265_decoder_context* ctx,
     return 0;
   }
 
-  img->set_image_plane(0, p[0], luma_stride, NULL);
-  img->set_image_plane(1, p[1], chroma_stride, NULL);
-  img->set_image_plane(2, p[2], chroma_stride, NULL);
+  // the plane pointers point to the first pixel inside the border
+
+  int luma_offset   = (luma_border   * luma_stride   + luma_border)   * luma_bpp;
+  int chroma_offset = (chroma_border * chroma_stride + chroma_border) * chroma_bpp;
+
+  img->set_image_plane(0, p[0] + luma_offset, luma_stride, NULL);
+  img->set_image_plane(1, p[1] ? p[1] + chroma_offset : NULL, chroma_stride, NULL);
+  img->set_image_plane(2, p[2] ? p[2] + chroma_offset : NULL, chroma_stride, NULL);
 
   return 1;
 }
@@ -162,7 +188,7 @@ static void de265_image_release_buffer(de265_decoder_context* ctx,
   for (int i=0;i<3;i++) {
     uint8_t* p = (uint8_t*)img->get_image_plane(i);
     if (p) {
-      FREE_ALIGNED(p);
+      FREE_ALIGNED(p - plane_border_offset(img,i));
     }
   }
 }
@@ -206,6 +232,7 @@ de265_image::de265_image()
   }
 
   width=height=0;
+  border=chroma_border=0;
 
   pts = 0;
   user_data = NULL;
@@ -242,9 +269,43 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
 
   if (sps) { this->sps = sps; }
 
-  release(); /* TODO: review code for efficient allocation when arrays are already
-                allocated to the requested size. Without the release, the old image-data
-                will not be freed. */
+  // Pixel planes from our own allocator are kept when the new picture has the same
+  // size and format. This makes the DPB slots work as a picture pool. Buffers from
+  // user-supplied allocators are always returned, because the application may attach
+  // its own per-frame data to them.
+
+  de265_image_allocation alloc_functions;
+  if (dctx && useCustomAllocFunc) {
+    alloc_functions = dctx->param_image_allocation_functions;
+  }
+  else {
+    alloc_functions = de265_image::default_image_allocation;
+  }
+
+  const uint8_t newBitDepth_Y = (sps==NULL) ? 8 : sps->BitDepth_Y;
+  const uint8_t newBitDepth_C = (sps==NULL) ? 8 : sps->BitDepth_C;
+
+  // Our own allocator can add a border around the planes for motion compensation.
+
+  int newBorder = 0;
+  if (dctx && alloc_functions.get_buffer == default_image_allocation.get_buffer) {
+    newBorder = (dctx->param_reference_border + STANDARD_ALIGNMENT-1)
+      / STANDARD_ALIGNMENT * STANDARD_ALIGNMENT;
+  }
+
+  bool reusePixels = (pixels[0] != NULL &&
+                      image_allocation_functions.get_buffer == default_image_allocation.get_buffer &&
+                      alloc_functions.get_buffer == default_image_allocation.get_buffer &&
+                      width == w && height == h && chroma_format == c &&
+                      BitDepth_Y == newBitDepth_Y && BitDepth_C == newBitDepth_C &&
+                      border == newBorder);
+
+  if (reusePixels) {
+    release_slices();
+  }
+  else {
+    release();
+  }
 
   ID = s_next_image_ID++;
   removed_at_picture_id = std::numeric_limits<int32_t>::max();
@@ -312,6 +373,13 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
     break;
   }
 
+  // The chroma border is kept a multiple of the alignment, so that all planes start
+  // on an aligned address.
+
+  border = newBorder;
+  chroma_border = (newBorder/SubWidthC + STANDARD_ALIGNMENT-1)
+    / STANDARD_ALIGNMENT * STANDARD_ALIGNMENT;
+
   if (chroma_format != de265_chroma_mono && sps) {
     assert(sps->SubWidthC  == SubWidthC);
     assert(sps->SubHeightC == SubHeightC);
@@ -343,8 +411,8 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
   spec.visible_height= height_confwin;
 
 
-  BitDepth_Y = (sps==NULL) ? 8 : sps->BitDepth_Y;
-  BitDepth_C = (sps==NULL) ? 8 : sps->BitDepth_C;
+  BitDepth_Y = newBitDepth_Y;
+  BitDepth_C = newBitDepth_C;
 
   bpp_shift[0] = (BitDepth_Y <= 8) ? 0 : 1;
   bpp_shift[1] = (BitDepth_C <= 8) ? 0 : 1;
@@ -371,19 +439,24 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
       image_allocation_functions.release_buffer = NULL;
     }
   }
-  else*/ if (decctx && useCustomAllocFunc) {
-    image_allocation_functions = decctx->param_image_allocation_functions;
-  }
-  else {
-    image_allocation_functions = de265_image::default_image_allocation;
-  }
+  else*/
+  image_allocation_functions = alloc_functions;
 
   bool mem_alloc_success = true;
 
-  if (image_allocation_functions.get_buffer != NULL) {
+  if (!reusePixels && image_allocation_functions.get_buffer != NULL) {
     mem_alloc_success = image_allocation_functions.get_buffer(decctx, &spec, this,
                                                               alloc_userdata);
 
+    // check for memory shortage
+
+    if (!mem_alloc_success)
+      {
+        return DE265_ERROR_OUT_OF_MEMORY;
+      }
+  }
+
+  if (pixels[0]) {
     pixels_confwin[0] = pixels[0] + left*WinUnitX + top*WinUnitY*stride;
 
     if (chroma_format != de265_chroma_mono) {
@@ -394,13 +467,6 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
       pixels_confwin[1] = NULL;
       pixels_confwin[2] = NULL;
     }
-
-    // check for memory shortage
-
-    if (!mem_alloc_success)
-      {
-        return DE265_ERROR_OUT_OF_MEMORY;
-      }
   }
 
   //alloc_functions = *allocfunc;
@@ -409,6 +475,12 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
   // --- allocate decoding info arrays ---
 
   if (allocMetadata) {
+    // reuse the arrays of a finished picture instead of allocating new ones
+
+    if (dctx && !has_mv_info()) {
+      dctx->take_metadata_from_pool(this);
+    }
+
     // intra pred mode
 
     mem_alloc_success &= intraPredMode.alloc(sps->PicWidthInMinPUs, sps->PicHeightInMinPUs,
@@ -429,6 +501,9 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
 
     mem_alloc_success &= pb_info.alloc(puWidth,puHeight, 2);
 
+    mem_alloc_success &= col_motion.alloc((sps->pic_width_in_luma_samples +15)/16,
+                                          (sps->pic_height_in_luma_samples+15)/16, 4);
+
 
     // tu info
 
@@ -455,6 +530,18 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
       }
 
 
+    // SAO line buffers
+
+    if (sps->sample_adaptive_offset_enabled_flag) {
+      for (int c=0;c<3;c++) {
+        int bitDepth = (c==0 ? sps->BitDepth_Y : sps->BitDepth_C);
+
+        sao_line_size[c] = get_width(c) * ((bitDepth+7)/8);
+        sao_line_buffer[c].resize(sao_line_size[c] * sps->PicHeightInCtbsY);
+      }
+    }
+
+
     // check for memory shortage
 
     if (!mem_alloc_success)
@@ -507,8 +594,12 @@ void de265_image::release()
         }
     }
 
-  // free slices
+  release_slices();
+}
+
 
+void de265_image::release_slices()
+{
   for (int i=0;i<slices.size();i++) {
     delete slices[i];
   }
@@ -516,6 +607,80 @@ void de265_image::release()
 }
 
 
+template <class pixel_t>
+static void extend_plane_border(pixel_t* plane, int stride, int w,int h, int border,
+                                int y0,int y1)
+{
+  for (int y=y0;y<y1;y++) {
+    pixel_t* line = plane + y*stride;
+
+    std::fill_n(line-border, border, line[0]);
+    std::fill_n(line+w,      border, line[w-1]);
+  }
+
+  // replicate the first and last line, including their left and right borders
+
+  if (y0==0) {
+    const pixel_t* src = plane - border;
+    for (int y=1;y<=border;y++) {
+      memcpy(plane - border - y*stride, src, (w+2*border)*sizeof(pixel_t));
+    }
+  }
+
+  if (y1==h) {
+    const pixel_t* src = plane + (h-1)*stride - border;
+    for (int y=1;y<=border;y++) {
+      memcpy(plane + (h-1+y)*stride - border, src, (w+2*border)*sizeof(pixel_t));
+    }
+  }
+}
+
+
+void de265_image::extend_borders_CTB_row(int ctbY)
+{
+  if (border==0) {
+    return;
+  }
+
+  const int log2CtbSize = sps->Log2CtbSizeY;
+
+  int y0 = ctbY << log2CtbSize;
+  int y1 = libde265_min(height, (ctbY+1) << log2CtbSize);
+
+  for (int c=0;c<3;c++) {
+    if (c>0 && chroma_format == de265_chroma_mono) {
+      break;
+    }
+
+    int plane_y0 = (c==0 ? y0 : y0/SubHeightC);
+    int plane_y1 = (c==0 ? y1 : y1/SubHeightC);
+
+    if (y1==height) { plane_y1 = get_height(c); }
+
+    if (bpp_shift[c]) {
+      extend_plane_border((uint16_t*)pixels[c], get_image_stride(c),
+                          get_width(c), get_height(c), get_border(c), plane_y0,plane_y1);
+    }
+    else {
+      extend_plane_border(pixels[c], get_image_stride(c),
+                          get_width(c), get_height(c), get_border(c), plane_y0,plane_y1);
+    }
+  }
+}
+
+
+void de265_image::extend_borders()
+{
+  if (border==0) {
+    return;
+  }
+
+  for (int y=0;y<sps->PicHeightInCtbsY;y++) {
+    extend_borders_CTB_row(y);
+  }
+}
+
+
 void de265_image::fill_image(int y,int cb,int cr)
 {
   if (y>=0) {
@@ -602,20 +767,6 @@ void de265_image::copy_lines_from(const de265_image* src, int first, int end)
 }
 
 
-void de265_image::exchange_pixel_data_with(de265_image& b)
-{
-  for (int i=0;i<3;i++) {
-    std::swap(pixels[i], b.pixels[i]);
-    std::swap(pixels_confwin[i], b.pixels_confwin[i]);
-    std::swap(plane_user_data[i], b.plane_user_data[i]);
-  }
-
-  std::swap(stride, b.stride);
-  std::swap(chroma_stride, b.chroma_stride);
-  std::swap(image_allocation_functions, b.image_allocation_functions);
-}
-
-
 void de265_image::thread_start(int nThreads)
 {
   de265_mutex_lock(&mutex);
@@ -640,6 +791,21 @@ void de265_image::thread_run(const thread_task* task)
   de265_mutex_unlock(&mutex);
 }
 
+bool de265_image::thread_run_or_resume(thread_task* task)
+{
+  if (task->state == thread_task::Blocked) {
+    // the task was deferred in wait_for_progress_or_defer()
+
+    task->state = thread_task::Running;
+    thread_unblocks();
+    return true;
+  }
+
+  task->state = thread_task::Running;
+  thread_run(task);
+  return false;
+}
+
 void de265_image::thread_blocks()
 {
   de265_mutex_lock(&mutex);
@@ -703,6 +869,65 @@ void de265_image::wait_for_progress(thread_task* task, int ctbAddrRS, int progre
 }
 
 
+bool de265_image::wait_for_progress_or_defer(thread_task* task, int ctbx,int ctby, int progress)
+{
+  const int ctbW = sps->PicWidthInCtbsY;
+
+  return wait_for_progress_or_defer(task, &ctb_progress[ctbx + ctbW*ctby], progress);
+}
+
+bool de265_image::wait_for_progress_or_defer(thread_task* task,
+                                             de265_progress_lock* progresslock, int progress)
+{
+  if (task==NULL) { return true; }
+
+  if (progresslock->get_progress() < progress) {
+    thread_blocks();
+    task->state = thread_task::Blocked;
+
+    if (!decctx->param_continuation_tasks) {
+      progresslock->wait_for_progress(progress);
+    }
+    else if (progresslock->defer_until_progress(progress, &decctx->thread_pool_, task)) {
+      return false;
+    }
+
+    // progress has been reached (in the meantime)
+
+    task->state = thread_task::Running;
+    thread_unblocks();
+  }
+
+  return true;
+}
+
+
+void de265_image::wait_for_reference_progress(int x,int y, int progress) const
+{
+  const int log2CtbSize = sps->Log2CtbSizeY;
+  const int ctbAddrRS = (x>>log2CtbSize) + (y>>log2CtbSize) * sps->PicWidthInCtbsY;
+
+  ctb_progress[ctbAddrRS].wait_for_progress(progress);
+}
+
+
+void de265_image::wait_for_reference_lines(int y0,int y1) const
+{
+  const int log2CtbSize = sps->Log2CtbSizeY;
+  const int ctbW = sps->PicWidthInCtbsY;
+  const int ctbH = sps->PicHeightInCtbsY;
+
+  // Since the filters process whole rows, we check the last CTB.
+
+  int firstRow = Clip3(0,ctbH-1, y0>>log2CtbSize);
+  int lastRow  = Clip3(0,ctbH-1, y1>>log2CtbSize);
+
+  for (int row=firstRow; row<=lastRow; row++) {
+    ctb_progress[ctbW-1 + row*ctbW].wait_for_progress(CTB_PROGRESS_COMPLETE);
+  }
+}
+
+
 void de265_image::wait_for_completion()
 {
   de265_mutex_lock(&mutex);
@@ -712,6 +937,15 @@ void de265_image::wait_for_completion()
   de265_mutex_unlock(&mutex);
 }
 
+bool de265_image::is_completed()
+{
+  de265_mutex_lock(&mutex);
+  bool completed = (nThreadsFinished==nThreadsTotal);
+  de265_mutex_unlock(&mutex);
+
+  return completed;
+}
+
 bool de265_image::debug_is_completed() const
 {
   return nThreadsFinished==nThreadsTotal;
@@ -728,6 +962,7 @@ void de265_image::clear_metadata()
   //tu_info.clear();  // done on the fly
   ctb_info.clear();
   deblk_info.clear();
+  col_motion.clear();  // CTBs missing in the stream have no collocated MVs
 
   // --- reset CTB progresses ---
 
@@ -737,6 +972,50 @@ void de265_image::clear_metadata()
 }
 
 
+void de265_image::swap_decoding_metadata(image_metadata_buffers& buffers)
+{
+  cb_info.swap(buffers.cb_info);
+  pb_info.swap(buffers.pb_info);
+  intraPredMode.swap(buffers.intraPredMode);
+  intraPredModeC.swap(buffers.intraPredModeC);
+  tu_info.swap(buffers.tu_info);
+  deblk_info.swap(buffers.deblk_info);
+
+  for (int c=0;c<3;c++) {
+    sao_line_buffer[c].swap(buffers.sao_line_buffer[c]);
+  }
+}
+
+
+void de265_image::compress_CTB_motion(int ctbX,int ctbY)
+{
+  const int log2CtbSize = sps->Log2CtbSizeY;
+
+  int x0 = ctbX << log2CtbSize;
+  int y0 = ctbY << log2CtbSize;
+  int x1 = libde265_min(x0 + (1<<log2CtbSize), sps->pic_width_in_luma_samples);
+  int y1 = libde265_min(y0 + (1<<log2CtbSize), sps->pic_height_in_luma_samples);
+
+  const int sliceIdx = get_SliceHeaderIndex(x0,y0);
+
+  // the top-left 4x4 block represents the 16x16 block (8.5.3.2.8)
+
+  for (int y=y0;y<y1;y+=16)
+    for (int x=x0;x<x1;x+=16) {
+      ColMotion& col = col_motion.get(x,y);
+
+      if (get_pred_mode(x,y) == MODE_INTRA) {
+        memset(&col.motion, 0, sizeof(PBMotion));
+      }
+      else {
+        col.motion = pb_info.get(x,y);
+      }
+
+      col.SliceHeaderIndex = sliceIdx;
+    }
+}
+
+
 void de265_image::set_mv_info(int x,int y, int nPbW,int nPbH, const PBMotion& mv)
 {
   int log2PuSize = 2;
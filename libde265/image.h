@@ -30,6 +30,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <memory>
+#include <vector>
+#include <algorithm>
 #ifdef HAVE_STDBOOL_H
 #include <stdbool.h>
 #endif
@@ -76,10 +78,11 @@ enum PictureState {
 
 
 #define CTB_PROGRESS_NONE      0
-#define CTB_PROGRESS_PREFILTER 1
-#define CTB_PROGRESS_DEBLK_V   2
-#define CTB_PROGRESS_DEBLK_H   3
-#define CTB_PROGRESS_SAO       4
+#define CTB_PROGRESS_PARSED    1  /* Only the syntax has been decoded (split reconstruction). */
+#define CTB_PROGRESS_PREFILTER 2
+#define CTB_PROGRESS_DEBLK_V   3
+#define CTB_PROGRESS_DEBLK_H   4
+#define CTB_PROGRESS_COMPLETE  5  /* All in-loop filters have been applied. */
 
 class decoder_context;
 
@@ -114,6 +117,14 @@ template <class DataUnit> class MetaDataArray
     if (data) memset(data, 0, sizeof(DataUnit) * data_size);
   }
 
+  void swap(MetaDataArray& other) {
+    std::swap(data, other.data);
+    std::swap(data_size, other.data_size);
+    std::swap(log2unitSize, other.log2unitSize);
+    std::swap(width_in_units, other.width_in_units);
+    std::swap(height_in_units, other.height_in_units);
+  }
+
   const DataUnit& get(int x,int y) const {
     int unitX = x>>log2unitSize;
     int unitY = y>>log2unitSize;
@@ -217,6 +228,31 @@ typedef struct {
 } CB_ref_info;
 
 
+/* Motion of a 16x16 block, which is all that is needed when the picture is used as
+   collocated picture (8.5.3.2.8). Intra blocks have both predFlags cleared.
+ */
+typedef struct {
+  PBMotion motion;
+  uint16_t SliceHeaderIndex;
+} ColMotion;
+
+
+/* Metadata arrays that are only used while the picture is decoded and filtered.
+   In low-memory mode, they are moved into a decoder-wide pool when the picture is
+   finished (see decoder_context::release_picture_metadata()).
+ */
+struct image_metadata_buffers
+{
+  MetaDataArray<CB_ref_info> cb_info;
+  MetaDataArray<PBMotion>    pb_info;
+  MetaDataArray<uint8_t>     intraPredMode;
+  MetaDataArray<uint8_t>     intraPredModeC;
+  MetaDataArray<uint8_t>     tu_info;
+  MetaDataArray<uint8_t>     deblk_info;
+  std::vector<uint8_t>       sao_line_buffer[3];
+};
+
+
 
 
 struct de265_image {
@@ -236,7 +272,7 @@ struct de265_image {
 
   bool is_allocated() const { return pixels[0] != NULL; }
 
-  void release();
+  void release();   // returns the pixel planes to the allocator and frees the slices
 
   void set_headers(std::shared_ptr<video_parameter_set> _vps,
                    std::shared_ptr<seq_parameter_set>   _sps,
@@ -247,9 +283,12 @@ struct de265_image {
   }
 
   void fill_image(int y,int u,int v);
+
+  // Fill the border of the CTB row (or of the whole picture) when its pixels are final.
+  void extend_borders_CTB_row(int ctbY);
+  void extend_borders();
   de265_error copy_image(const de265_image* src);
   void copy_lines_from(const de265_image* src, int first, int end);
-  void exchange_pixel_data_with(de265_image&);
 
   uint32_t get_ID() const { return ID; }
 
@@ -303,6 +342,11 @@ struct de265_image {
   int get_luma_stride() const { return stride; }
   int get_chroma_stride() const { return chroma_stride; }
 
+  /* Number of pixels around the plane that can be read by motion compensation.
+     The border is filled with copies of the picture edge by extend_borders().
+   */
+  int get_border(int cIdx) const { return cIdx==0 ? border : chroma_border; }
+
   int get_width (int cIdx=0) const { return cIdx==0 ? width  : chroma_width;  }
   int get_height(int cIdx=0) const { return cIdx==0 ? height : chroma_height; }
 
@@ -345,6 +389,8 @@ struct de265_image {
   }
 
 private:
+  void release_slices();
+
   uint32_t ID;
   static uint32_t s_next_image_ID;
 
@@ -357,6 +403,7 @@ private:
 
   int chroma_width, chroma_height;
   int stride, chroma_stride;
+  int border, chroma_border;
 
 public:
   uint8_t BitDepth_Y, BitDepth_C;
@@ -411,12 +458,17 @@ private:
 
   MetaDataArray<CTB_info>    ctb_info;
   MetaDataArray<CB_ref_info> cb_info;
-  MetaDataArray<PBMotion>    pb_info;
+  MetaDataArray<PBMotion>    pb_info;     // released when the picture is finished
+  MetaDataArray<ColMotion>   col_motion;  // compressed motion field for collocated MVs
   MetaDataArray<uint8_t>     intraPredMode;
   MetaDataArray<uint8_t>     intraPredModeC;
   MetaDataArray<uint8_t>     tu_info;
   MetaDataArray<uint8_t>     deblk_info;
 
+  // last line of each CTB row before SAO is applied (only allocated when SAO is enabled)
+  std::vector<uint8_t>       sao_line_buffer[3];
+  int                        sao_line_size[3]; // in bytes
+
 public:
   // --- meta information ---
 
@@ -452,6 +504,7 @@ public:
 
   void thread_start(int nThreads);
   void thread_run(const thread_task*);
+  bool thread_run_or_resume(thread_task*); // returns true if the task continues after being deferred
   void thread_blocks();
   void thread_unblocks();
   /* NOTE: you should not access any data in the thread_task after
@@ -462,7 +515,22 @@ public:
   void wait_for_progress(thread_task* task, int ctbx,int ctby, int progress);
   void wait_for_progress(thread_task* task, int ctbAddrRS, int progress);
 
+  /* With continuation tasks, the task is not blocked when the CTB has not reached
+     'progress' yet. Instead, false is returned and the task is added to the thread pool
+     again when the progress is reached. The task must then return from work() immediately
+     and continue at the same point when it is run again. Without continuation tasks,
+     this blocks like wait_for_progress() and always returns true. */
+  bool wait_for_progress_or_defer(thread_task* task, int ctbx,int ctby, int progress);
+  bool wait_for_progress_or_defer(thread_task* task, de265_progress_lock* progresslock, int progress);
+
+  /* Frame-parallel decoding: block until this picture, which is used as a reference,
+     has reached 'progress' at the CTB containing pixel (x,y), or until the luma lines
+     [y0;y1] are completely decoded. These do not count as blocking a task of this image. */
+  void wait_for_reference_progress(int x,int y, int progress) const;
+  void wait_for_reference_lines(int y0,int y1) const;
+
   void wait_for_completion();  // block until image is decoded by background threads
+  bool is_completed();         // check without blocking whether all background threads have finished
   bool debug_is_completed() const;
   int  num_threads_active() const { return nThreadsRunning + nThreadsBlocked; } // for debug only
 
@@ -801,6 +869,12 @@ public:
   }
 
 
+  uint8_t* get_sao_line_buffer(int cIdx, int ctbY)
+  {
+    return &sao_line_buffer[cIdx][ctbY * sao_line_size[cIdx]];
+  }
+
+
   bool get_CTB_has_pcm_or_cu_transquant_bypass(int ctbX,int ctbY) const
   {
     int idx = ctbX + ctbY*ctb_info.width_in_units;
@@ -855,6 +929,29 @@ public:
 
   void set_mv_info(int x,int y, int nPbW,int nPbH, const PBMotion& mv);
 
+  bool has_mv_info() const { return pb_info.data != NULL; }
+
+  const ColMotion& get_col_motion(int x,int y) const
+  {
+    return col_motion.get(x,y);
+  }
+
+  /* Store the motion of the CTB in the compressed motion field. Has to be called before
+     the CTB is marked as decoded, because following pictures read it from then on. */
+  void compress_CTB_motion(int ctbX,int ctbY);
+
+  /* Exchange the full-resolution motion field with 'buffer'. It is taken away when the
+     picture has been decoded and filtered. Only the compressed field remains for temporal
+     MV prediction. */
+  void swap_mv_info(MetaDataArray<PBMotion>& buffer) { pb_info.swap(buffer); }
+
+  /* Exchange the decoding-only metadata with 'buffers'. After the picture is finished,
+     this removes everything except the CTB info, the compressed motion field and the
+     slice headers, which are all that later pictures access. */
+  void swap_decoding_metadata(image_metadata_buffers& buffers);
+
+  bool has_decoding_metadata() const { return cb_info.data != NULL; }
+
   // --- value logging ---
 
   void printBlk(int x0,int y0, int cIdx, int log2BlkSize);
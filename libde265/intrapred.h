@@ -181,12 +181,13 @@ void print_border(pixel_t* data, uint8_t* available, int nT)
 #endif
 
 
-// (8.4.4.2.3)
+// (8.4.4.2.3) Returns 0 if the reference samples are not filtered, 1 for the
+// [1 2 1] filter and 2 for strong intra smoothing (bilinear interpolation).
 template <class pixel_t>
-void intra_prediction_sample_filtering(const seq_parameter_set& sps,
-                                       pixel_t* p,
-                                       int nT, int cIdx,
-                                       enum IntraPredMode intraPredMode)
+int intra_prediction_filter_type(const seq_parameter_set& sps,
+                                 const pixel_t* p,
+                                 int nT, int cIdx,
+                                 enum IntraPredMode intraPredMode)
 {
   int filterFlag;
 
@@ -212,44 +213,67 @@ void intra_prediction_sample_filtering(const seq_parameter_set& sps,
     }
   }
 
+  if (!filterFlag) {
+    return 0;
+  }
 
-  if (filterFlag) {
-    int biIntFlag = (sps.strong_intra_smoothing_enable_flag &&
-                     cIdx==0 &&
-                     nT==32 &&
-                     abs_value(p[0]+p[ 64]-2*p[ 32]) < (1<<(sps.bit_depth_luma-5)) &&
-                     abs_value(p[0]+p[-64]-2*p[-32]) < (1<<(sps.bit_depth_luma-5)))
-      ? 1 : 0;
+  int biIntFlag = (sps.strong_intra_smoothing_enable_flag &&
+                   cIdx==0 &&
+                   nT==32 &&
+                   abs_value(p[0]+p[ 64]-2*p[ 32]) < (1<<(sps.bit_depth_luma-5)) &&
+                   abs_value(p[0]+p[-64]-2*p[-32]) < (1<<(sps.bit_depth_luma-5)))
+    ? 1 : 0;
 
-    pixel_t  pF_mem[4*32+1];
-    pixel_t* pF = &pF_mem[2*32];
+  return biIntFlag ? 2 : 1;
+}
 
-    if (biIntFlag) {
-      pF[-2*nT] = p[-2*nT];
-      pF[ 2*nT] = p[ 2*nT];
-      pF[    0] = p[    0];
 
-      for (int i=1;i<=63;i++) {
-        pF[-i] = p[0] + ((i*(p[-64]-p[0])+32)>>6);
-        pF[ i] = p[0] + ((i*(p[ 64]-p[0])+32)>>6);
-      }
-    } else {
-      pF[-2*nT] = p[-2*nT];
-      pF[ 2*nT] = p[ 2*nT];
+// Filter the 4*nT+1 reference samples in place. Strong smoothing is only defined for nT==32.
+template <class pixel_t>
+void intra_prediction_filter_border(pixel_t* p, int nT, bool strong)
+{
+  pixel_t  pF_mem[4*32+1];
+  pixel_t* pF = &pF_mem[2*32];
 
-      for (int i=-(2*nT-1) ; i<=2*nT-1 ; i++)
-        {
-          pF[i] = (p[i+1] + 2*p[i] + p[i-1] + 2) >> 2;
-        }
-    }
+  if (strong) {
+    assert(nT==32);
 
+    pF[-2*nT] = p[-2*nT];
+    pF[ 2*nT] = p[ 2*nT];
+    pF[    0] = p[    0];
 
-    // copy back to original array
+    for (int i=1;i<=63;i++) {
+      pF[-i] = p[0] + ((i*(p[-64]-p[0])+32)>>6);
+      pF[ i] = p[0] + ((i*(p[ 64]-p[0])+32)>>6);
+    }
+  } else {
+    pF[-2*nT] = p[-2*nT];
+    pF[ 2*nT] = p[ 2*nT];
 
-    memcpy(p-2*nT, pF-2*nT, (4*nT+1) * sizeof(pixel_t));
+    for (int i=-(2*nT-1) ; i<=2*nT-1 ; i++)
+      {
+        pF[i] = (p[i+1] + 2*p[i] + p[i-1] + 2) >> 2;
+      }
   }
-  else {
-    // do nothing ?
+
+
+  // copy back to original array
+
+  memcpy(p-2*nT, pF-2*nT, (4*nT+1) * sizeof(pixel_t));
+}
+
+
+// (8.4.4.2.3)
+template <class pixel_t>
+void intra_prediction_sample_filtering(const seq_parameter_set& sps,
+                                       pixel_t* p,
+                                       int nT, int cIdx,
+                                       enum IntraPredMode intraPredMode)
+{
+  int filterType = intra_prediction_filter_type(sps, p, nT, cIdx, intraPredMode);
+
+  if (filterType) {
+    intra_prediction_filter_border(p, nT, filterType==2);
   }
 
 
@@ -262,7 +286,7 @@ void intra_prediction_sample_filtering(const seq_parameter_set& sps,
 template <class pixel_t>
 void intra_prediction_planar(pixel_t* dst, int dstStride,
                              int nT,int cIdx,
-                             pixel_t* border)
+                             const pixel_t* border)
 {
   int Log2_nT = Log2(nT);
 
@@ -289,7 +313,7 @@ void intra_prediction_planar(pixel_t* dst, int dstStride,
 template <class pixel_t>
 void intra_prediction_DC(pixel_t* dst, int dstStride,
                          int nT,int cIdx,
-                         pixel_t* border)
+                         const pixel_t* border)
 {
   int Log2_nT = Log2(nT);
 
@@ -334,7 +358,7 @@ void intra_prediction_angular(pixel_t* dst, int dstStride,
                               int xB0,int yB0,
                               enum IntraPredMode intraPredMode,
                               int nT,int cIdx,
-                              pixel_t* border)
+                              const pixel_t* border)
 {
   pixel_t  ref_mem[4*MAX_INTRA_PRED_BLOCK_SIZE+1]; // TODO: what is the required range here ?
   pixel_t* ref=&ref_mem[2*MAX_INTRA_PRED_BLOCK_SIZE];
@@ -484,6 +508,14 @@ void intra_border_computer<pixel_t>::preproc()
   int xRightCtb = (xBLuma+nT*SubWidth) >> log2CtbSize;
   int yTopCtb   = (yBLuma-1) >> log2CtbSize;
 
+  // A top-right neighbor in the next CTB of the same CTB row is not decoded yet.
+  // Do not even look at its slice address, it may be written concurrently by the
+  // slice parser when reconstruction runs in a separate task.
+
+  if (yTopCtb == yCurrCtb && xRightCtb != xCurrCtb) {
+    availableTopRight = false;
+  }
+
   int currCTBSlice = img->get_SliceAddrRS(xCurrCtb,yCurrCtb);
   int leftCTBSlice = availableLeft ? img->get_SliceAddrRS(xLeftCtb, yCurrCtb) : -1;
   int topCTBSlice  = availableTop ? img->get_SliceAddrRS(xCurrCtb, yTopCtb) : -1;
@@ -0,0 +1,193 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "loopfilter.h"
+#include "deblock.h"
+#include "sao.h"
+
+#include <algorithm>
+
+
+/* One step of CTB row 'ctbY', x = 0 .. PicWidthInCtbsY+1.
+   The vertical pass of CTB (x,y) modifies the CTB to the left, hence the horizontal pass
+   lags behind by one CTB. SAO needs the deblocked samples right and below of the CTB and
+   lags behind by another CTB and one CTB row.
+ */
+static void loop_filter_step(de265_image* img, int ctbX,int ctbY,
+                             bool deblocking, bool sao, sao_column_buffer* column)
+{
+  const seq_parameter_set& sps = img->get_sps();
+  const int ctbW = sps.PicWidthInCtbsY;
+  const int ctbH = sps.PicHeightInCtbsY;
+
+  if (ctbY<ctbH && ctbX<ctbW) {
+    if (deblocking) {
+      deblock_CTB(img, true, ctbX,ctbY);
+    }
+
+    img->ctb_progress[ctbX+ctbY*ctbW].set_progress(CTB_PROGRESS_DEBLK_V);
+  }
+
+  int x = ctbX-1;
+  if (ctbY<ctbH && x>=0 && x<ctbW) {
+    if (deblocking) {
+      deblock_CTB(img, false, x,ctbY);
+    }
+
+    img->ctb_progress[x+ctbY*ctbW].set_progress(CTB_PROGRESS_DEBLK_H);
+  }
+
+  x = ctbX-2;
+  int y = ctbY-1;
+  if (y>=0 && x>=0 && x<ctbW) {
+    if (sao) {
+      apply_sao_CTB_in_place(img, x,y, column);
+    }
+
+    // the CTB row is final now, references may read its border when it is marked complete
+
+    if (x==ctbW-1) {
+      img->extend_borders_CTB_row(y);
+    }
+
+    img->ctb_progress[x+y*ctbW].set_progress(CTB_PROGRESS_COMPLETE);
+  }
+}
+
+
+void apply_loop_filters(de265_image* img, bool deblocking, bool sao)
+{
+  const seq_parameter_set& sps = img->get_sps();
+
+  sao_column_buffer column;
+
+  for (int y=0;y<=sps.PicHeightInCtbsY;y++)
+    for (int x=0;x<=sps.PicWidthInCtbsY+1;x++) {
+      loop_filter_step(img, x,y, deblocking,sao, &column);
+    }
+}
+
+
+class thread_task_loop_filter_CTBRow : public thread_task
+{
+public:
+  struct de265_image* img;
+  int  ctb_y;
+  bool deblocking;
+  bool sao;
+
+  int  ctb_x; // next step, we continue there when the task was deferred
+
+  sao_column_buffer sao_column;
+
+  virtual void work();
+  virtual std::string name() const {
+    char buf[100];
+    sprintf(buf,"loop-filter-%d",ctb_y);
+    return buf;
+  }
+};
+
+
+void thread_task_loop_filter_CTBRow::work()
+{
+  img->thread_run_or_resume(this);
+
+  const seq_parameter_set& sps = img->get_sps();
+
+  const int rightCtb  = sps.PicWidthInCtbsY-1;
+  const int bottomCtb = sps.PicHeightInCtbsY-1;
+
+  for ( ; ctb_x<=rightCtb+2; ctb_x++) {
+
+    // All waits come before the filtering, because a deferred task is restarted at
+    // the beginning of the step.
+
+    // Vertical deblocking changes the samples of this CTB and of the one to the left.
+    // Wait until all CTBs that use these for intra prediction or whose metadata we read
+    // are decoded. This is the 3x3 CTB neighborhood, which also covers tiles decoded in
+    // parallel.
+
+    if (ctb_y<=bottomCtb && ctb_x<=rightCtb) {
+      for (int y=std::max(ctb_y-1,0); y<=std::min(ctb_y+1,bottomCtb); y++)
+        for (int x=std::min(ctb_x+1,rightCtb); x>=std::max(ctb_x-1,0); x--) {
+          if (!img->wait_for_progress_or_defer(this, x,y, CTB_PROGRESS_PREFILTER)) {
+            return; // we will be run again
+          }
+        }
+    }
+
+    // Horizontal deblocking of the top edge modifies the last lines of the CTB above.
+    // The vertical pass of its right neighbor has to be finished.
+
+    if (ctb_y>0 && ctb_y<=bottomCtb && ctb_x>=1) {
+      if (!img->wait_for_progress_or_defer(this, std::min(ctb_x,rightCtb),ctb_y-1,
+                                           CTB_PROGRESS_DEBLK_V)) {
+        return;
+      }
+    }
+
+    // SAO of CTB (x-2,y-1) needs its right neighbor deblocked and the CTB row above
+    // processed up to the upper right CTB.
+
+    if (ctb_y>0 && ctb_x>=2) {
+      int x = std::min(ctb_x-1,rightCtb);
+
+      if (!img->wait_for_progress_or_defer(this, x,ctb_y-1, CTB_PROGRESS_DEBLK_H)) {
+        return;
+      }
+
+      if (ctb_y>1 &&
+          !img->wait_for_progress_or_defer(this, x,ctb_y-2, CTB_PROGRESS_COMPLETE)) {
+        return;
+      }
+    }
+
+    loop_filter_step(img, ctb_x,ctb_y, deblocking,sao, &sao_column);
+  }
+
+  state = Finished;
+  img->thread_finishes(this);
+}
+
+
+void add_loop_filter_tasks(image_unit* imgunit, bool deblocking, bool sao)
+{
+  de265_image* img = imgunit->img;
+  decoder_context* ctx = img->decctx;
+
+  int nRows = img->get_sps().PicHeightInCtbsY;
+
+  img->thread_start(nRows+1);
+
+  for (int y=0;y<=nRows;y++)
+    {
+      thread_task_loop_filter_CTBRow* task = new thread_task_loop_filter_CTBRow;
+
+      task->img   = img;
+      task->ctb_y = y;
+      task->deblocking = deblocking;
+      task->sao   = sao;
+      task->ctb_x = 0;
+
+      imgunit->tasks.push_back(task);
+      add_task(&ctx->thread_pool_, task);
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DE265_LOOPFILTER_H
+#define DE265_LOOPFILTER_H
+
+#include "libde265/decctx.h"
+
+/* The in-loop filters (deblocking and SAO) are applied in a single pass over the CTBs.
+   CTB row y vertically deblocks CTB (x,y), horizontally deblocks CTB (x-1,y), and applies
+   SAO to CTB (x-2,y-1), which then has its final values (CTB_PROGRESS_COMPLETE).
+   SAO works in-place, the deblocked samples that it needs on the CTB boundaries are kept
+   in small line buffers.
+ */
+
+void apply_loop_filters(de265_image* img, bool deblocking, bool sao);
+
+/* Adds one task per CTB row (plus one for SAO of the last row). The tasks run in parallel
+   to the slice decoding, they wait for the CTBs they need.
+ */
+void add_loop_filter_tasks(image_unit* imgunit, bool deblocking, bool sao);
+
+#endif
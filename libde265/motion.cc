@@ -50,7 +50,7 @@ void mc_luma(const base_context* ctx,
              const seq_parameter_set* sps, int mv_x, int mv_y,
              int xP,int yP,
              int16_t* out, int out_stride,
-             const pixel_t* ref, int ref_stride,
+             const pixel_t* ref, int ref_stride, int ref_border,
              int nPbW, int nPbH, int bitDepth_L)
 {
   int xFracL = mv_x & 3;
@@ -68,12 +68,17 @@ void mc_luma(const base_context* ctx,
   int w = sps->pic_width_in_luma_samples;
   int h = sps->pic_height_in_luma_samples;
 
+  // The reference picture may be surrounded by a border that replicates its edge
+  // pixels. Blocks reading only inside this border do not need the padding buffer.
+
+  const int b = ref_border;
+
   ALIGNED_16(int16_t) mcbuffer[MAX_CU_SIZE * (MAX_CU_SIZE+7)];
 
   if (xFracL==0 && yFracL==0) {
 
-    if (xIntOffsL >= 0 && yIntOffsL >= 0 &&
-        nPbW+xIntOffsL <= w && nPbH+yIntOffsL <= h) {
+    if (xIntOffsL >= -b && yIntOffsL >= -b &&
+        nPbW+xIntOffsL <= w+b && nPbH+yIntOffsL <= h+b) {
 
       ctx->acceleration.put_hevc_qpel(out, out_stride,
                                       &ref[yIntOffsL*ref_stride + xIntOffsL],
@@ -131,10 +136,10 @@ void mc_luma(const base_context* ctx,
     const pixel_t* src_ptr;
     int src_stride;
 
-    if (-extra_left + xIntOffsL >= 0 &&
-        -extra_top  + yIntOffsL >= 0 &&
-        nPbW+extra_right  + xIntOffsL < w &&
-        nPbH+extra_bottom + yIntOffsL < h) {
+    if (-extra_left + xIntOffsL >= -b &&
+        -extra_top  + yIntOffsL >= -b &&
+        nPbW+extra_right  + xIntOffsL < w+b &&
+        nPbH+extra_bottom + yIntOffsL < h+b) {
       src_ptr = &ref[xIntOffsL + yIntOffsL*ref_stride];
       src_stride = ref_stride;
     }
@@ -176,7 +181,7 @@ void mc_chroma(const base_context* ctx,
                int mv_x, int mv_y,
                int xP,int yP,
                int16_t* out, int out_stride,
-               const pixel_t* ref, int ref_stride,
+               const pixel_t* ref, int ref_stride, int ref_border,
                int nPbWC, int nPbHC, int bit_depth_C)
 {
   // chroma sample interpolation process (8.5.3.2.2.2)
@@ -188,6 +193,8 @@ void mc_chroma(const base_context* ctx,
   int wC = sps->pic_width_in_luma_samples /sps->SubWidthC;
   int hC = sps->pic_height_in_luma_samples/sps->SubHeightC;
 
+  const int b = ref_border;
+
   mv_x *= 2 / sps->SubWidthC;
   mv_y *= 2 / sps->SubHeightC;
 
@@ -200,8 +207,8 @@ void mc_chroma(const base_context* ctx,
   ALIGNED_32(int16_t mcbuffer[MAX_CU_SIZE*(MAX_CU_SIZE+7)]);
 
   if (xFracC == 0 && yFracC == 0) {
-    if (xIntOffsC>=0 && nPbWC+xIntOffsC<=wC &&
-        yIntOffsC>=0 && nPbHC+yIntOffsC<=hC) {
+    if (xIntOffsC>=-b && nPbWC+xIntOffsC<=wC+b &&
+        yIntOffsC>=-b && nPbHC+yIntOffsC<=hC+b) {
       ctx->acceleration.put_hevc_epel(out, out_stride,
                                       &ref[xIntOffsC + yIntOffsC*ref_stride], ref_stride,
                                       nPbWC,nPbHC, 0,0, NULL, bit_depth_C);
@@ -229,8 +236,8 @@ void mc_chroma(const base_context* ctx,
     int extra_right  = 2;
     int extra_bottom = 2;
 
-    if (xIntOffsC>=1 && nPbWC+xIntOffsC<=wC-2 &&
-        yIntOffsC>=1 && nPbHC+yIntOffsC<=hC-2) {
+    if (xIntOffsC>=1-b && nPbWC+xIntOffsC<=wC+b-2 &&
+        yIntOffsC>=1-b && nPbHC+yIntOffsC<=hC+b-2) {
       src_ptr = &ref[xIntOffsC + yIntOffsC*ref_stride];
       src_stride = ref_stride;
     }
@@ -361,36 +368,51 @@ void generate_inter_prediction_samples(base_context* ctx,
                  l,vi->mv[l].x,vi->mv[l].y,refPic->PicOrderCntVal);
 
 
+        // In frame-parallel decoding, the reference picture may still be in progress.
+        // Wait until the lines needed by the interpolation filter are available.
+
+        if (img->decctx && img->decctx->frame_parallel_decoding()) {
+          int yInt = yP + (vi->mv[l].y>>2);
+          refPic->wait_for_reference_lines(yInt-3, yInt+nPbH+3);
+        }
+
+
         // TODO: must predSamples stride really be nCS or can it be somthing smaller like nPbW?
 
         if (img->high_bit_depth(0)) {
           mc_luma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                   predSamplesL[l],nCS,
                   (const uint16_t*)refPic->get_image_plane(0),
-                  refPic->get_luma_stride(), nPbW,nPbH, bit_depth_L);
+                  refPic->get_luma_stride(), refPic->get_border(0),
+                  nPbW,nPbH, bit_depth_L);
         }
         else {
           mc_luma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                   predSamplesL[l],nCS,
                   (const uint8_t*)refPic->get_image_plane(0),
-                  refPic->get_luma_stride(), nPbW,nPbH, bit_depth_L);
+                  refPic->get_luma_stride(), refPic->get_border(0),
+                  nPbW,nPbH, bit_depth_L);
         }
 
         if (img->high_bit_depth(0)) {
           mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                     predSamplesC[0][l],nCS, (const uint16_t*)refPic->get_image_plane(1),
-                    refPic->get_chroma_stride(), nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
+                    refPic->get_chroma_stride(), refPic->get_border(1),
+                    nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
           mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                     predSamplesC[1][l],nCS, (const uint16_t*)refPic->get_image_plane(2),
-                    refPic->get_chroma_stride(), nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
+                    refPic->get_chroma_stride(), refPic->get_border(1),
+                    nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
         }
         else {
           mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                     predSamplesC[0][l],nCS, (const uint8_t*)refPic->get_image_plane(1),
-                    refPic->get_chroma_stride(), nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
+                    refPic->get_chroma_stride(), refPic->get_border(1),
+                    nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
           mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                     predSamplesC[1][l],nCS, (const uint8_t*)refPic->get_image_plane(2),
-                    refPic->get_chroma_stride(), nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
+                    refPic->get_chroma_stride(), refPic->get_border(1),
+                    nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
         }
       }
     }
@@ -1100,12 +1122,21 @@ void derive_collocated_motion_vectors(base_context* ctx,
     return;
   }
 
-  enum PredMode predMode = colImg->get_pred_mode(xColPb,yColPb);
+  // in frame-parallel decoding, the collocated picture may still be in progress
+
+  if (img->decctx && img->decctx->frame_parallel_decoding()) {
+    colImg->wait_for_reference_progress(xColPb,yColPb, CTB_PROGRESS_PREFILTER);
+  }
+
+  // The collocated picture keeps only its compressed motion field.
+
+  const ColMotion& colMotion = colImg->get_col_motion(xColPb,yColPb);
+  const PBMotion& mvi = colMotion.motion;
 
 
   // collocated block is Intra -> no collocated MV
 
-  if (predMode == MODE_INTRA) {
+  if (mvi.predFlag[0]==0 && mvi.predFlag[1]==0) {
     out_mvLXCol->x = 0;
     out_mvLXCol->y = 0;
     *out_availableFlagLXCol = 0;
@@ -1131,7 +1162,6 @@ void derive_collocated_motion_vectors(base_context* ctx,
 
   // get the collocated MV
 
-  const PBMotion& mvi = colImg->get_mv_info(xColPb,yColPb);
   int listCol;
   int refIdxCol;
   MotionVector mvCol;
@@ -1211,7 +1241,7 @@ void derive_collocated_motion_vectors(base_context* ctx,
 
 
 
-  const slice_segment_header* colShdr = colImg->slices[ colImg->get_SliceHeaderIndex(xColPb,yColPb) ];
+  const slice_segment_header* colShdr = colImg->slices[ colMotion.SliceHeaderIndex ];
 
   if (shdr->LongTermRefPic[X][refIdxLX] !=
       colShdr->LongTermRefPic[listCol][refIdxCol]) {
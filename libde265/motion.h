@@ -104,6 +104,15 @@ void fill_luma_motion_vector_predictors(base_context* ctx,
                                         MotionVector out_mvpList[2]);
 
 
+// 8.5.3.1
+void motion_vectors_and_ref_indices(base_context* ctx,
+                                    const slice_segment_header* shdr,
+                                    de265_image* img,
+                                    const PBMotionCoding& motion,
+                                    int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH,
+                                    int partIdx,
+                                    PBMotion* out_vi);
+
 void decode_prediction_unit(base_context* ctx,const slice_segment_header* shdr,
                             de265_image* img, const PBMotionCoding& motion,
                             int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH, int partIdx);
@@ -29,6 +29,17 @@
 #include "config.h"
 #endif
 
+#if defined(HAVE_SSE4_1) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define DE265_NAL_SCAN_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+
+static int find_zero_byte_pair(const unsigned char* data, int len);
+
 
 NAL_unit::NAL_unit()
   : skipped_bytes(DE265_SKIPPED_BYTES_INITIAL_SIZE)
@@ -39,15 +50,21 @@ NAL_unit::NAL_unit()
   nal_data = NULL;
   data_size = 0;
   capacity = 0;
+
+  borrowed_data = NULL;
+  release_func = NULL;
 }
 
 NAL_unit::~NAL_unit()
 {
+  release_borrowed_data();
   free(nal_data);
 }
 
 void NAL_unit::clear()
 {
+  release_borrowed_data();
+
   header = nal_header();
   pts = 0;
   user_data = NULL;
@@ -97,6 +114,32 @@ bool LIBDE265_CHECK_RESULT NAL_unit::set_data(const unsigned char* in_data, int
   return true;
 }
 
+void NAL_unit::set_borrowed_data(const unsigned char* in_data, int n,
+                                 de265_release_NAL_func release)
+{
+  release_borrowed_data();
+
+  borrowed_data = (unsigned char*)in_data; // only read
+  data_size = n;
+  release_func = release;
+}
+
+void NAL_unit::release_borrowed_data()
+{
+  if (borrowed_data == NULL) {
+    return;
+  }
+
+  if (release_func) {
+    release_func(borrowed_data, user_data);
+  }
+
+  borrowed_data = NULL;
+  release_func = NULL;
+  data_size = 0;
+  skipped_bytes.clear();
+}
+
 void NAL_unit::insert_skipped_byte(int pos)
 {
   skipped_bytes.push_back(pos);
@@ -149,7 +192,25 @@ void NAL_unit::remove_stuffing_bytes()
 }
 
 
+void NAL_unit::mark_stuffing_bytes()
+{
+  const uint8_t* p = data();
+  int n = size();
 
+  skipped_bytes.clear();
+
+  for (int i=0; i+2 < n; ) {
+    i += find_zero_byte_pair(p+i, n-i);
+
+    if (i+2 < n && p[i]==0 && p[i+1]==0 && p[i+2]==3) {
+      insert_skipped_byte(i+2);
+      i += 3;
+    }
+    else {
+      i++;
+    }
+  }
+}
 
 
 NAL_Parser::NAL_Parser()
@@ -158,12 +219,37 @@ NAL_Parser::NAL_Parser()
   end_of_frame = false;
   input_push_state = 0;
   pending_input_NAL = NULL;
+  pending_input_NAL_size = -1;
   nBytes_in_NAL_queue = 0;
+
+  async_parsing = false;
+  ingestion_busy = false;
+  stop_ingestion = false;
+  ingestion_error = DE265_OK;
+  nBytes_in_input_queue = 0;
+  max_input_queue_bytes = 0;
+
+  de265_mutex_init(&mutex);
+  de265_cond_init(&cond);
 }
 
 
 NAL_Parser::~NAL_Parser()
 {
+  // --- stop the ingestion thread, the queued input is discarded ---
+
+  if (async_parsing) {
+    de265_mutex_lock(&mutex);
+    while (!input_queue.empty()) {
+      delete input_queue.front();
+      input_queue.pop_front();
+    }
+    nBytes_in_input_queue = 0;
+    de265_mutex_unlock(&mutex);
+
+    stop_ingestion_thread();
+  }
+
   // --- free NAL queues ---
 
   // empty NAL queue
@@ -184,6 +270,9 @@ NAL_Parser::~NAL_Parser()
   for (int i=0;i<NAL_free_list.size();i++) {
     delete NAL_free_list[i];
   }
+
+  de265_mutex_destroy(&mutex);
+  de265_cond_destroy(&cond);
 }
 
 
@@ -193,11 +282,19 @@ LIBDE265_CHECK_RESULT NAL_unit* NAL_Parser::alloc_NAL_unit(int size)
 
   // --- get NAL-unit object ---
 
+  de265_mutex_lock(&mutex);
+
   if (NAL_free_list.size() > 0) {
     nal = NAL_free_list.back();
     NAL_free_list.pop_back();
   }
   else {
+    nal = NULL;
+  }
+
+  de265_mutex_unlock(&mutex);
+
+  if (nal == NULL) {
     nal = new NAL_unit;
   }
 
@@ -216,39 +313,199 @@ void NAL_Parser::free_NAL_unit(NAL_unit* nal)
     // Allow calling with NULL just like regular "free()"
     return;
   }
+
+  // give borrowed data back to the caller now, not when the NAL_unit is reused
+  nal->release_borrowed_data();
+
+  de265_mutex_lock(&mutex);
+
   if (NAL_free_list.size() < DE265_NAL_FREE_LIST_SIZE) {
     NAL_free_list.push_back(nal);
+    nal = NULL;
   }
-  else {
-    delete nal;
-  }
+
+  de265_mutex_unlock(&mutex);
+
+  delete nal;
 }
 
 NAL_unit* NAL_Parser::pop_from_NAL_queue()
 {
-  if (NAL_queue.empty()) {
-    return NULL;
-  }
-  else {
-    NAL_unit* nal = NAL_queue.front();
+  NAL_unit* nal = NULL;
+
+  de265_mutex_lock(&mutex);
+
+  if (!NAL_queue.empty()) {
+    nal = NAL_queue.front();
     NAL_queue.pop();
 
     nBytes_in_NAL_queue -= nal->size();
-
-    return nal;
   }
+
+  de265_mutex_unlock(&mutex);
+
+  return nal;
 }
 
 void NAL_Parser::push_to_NAL_queue(NAL_unit* nal)
 {
+  de265_mutex_lock(&mutex);
+
   NAL_queue.push(nal);
   nBytes_in_NAL_queue += nal->size();
+
+  if (async_parsing) {
+    de265_cond_broadcast(&cond, &mutex);
+  }
+
+  de265_mutex_unlock(&mutex);
+}
+
+
+int NAL_Parser::bytes_in_input_queue() const
+{
+  de265_mutex_lock(&mutex);
+
+  int size = nBytes_in_NAL_queue + nBytes_in_input_queue;
+  if (pending_input_NAL_size > 0) { size += pending_input_NAL_size; }
+
+  de265_mutex_unlock(&mutex);
+
+  return size;
 }
 
+
+int NAL_Parser::number_of_NAL_units_pending() const
+{
+  de265_mutex_lock(&mutex);
+
+  int size = NAL_queue.size();
+  if (pending_input_NAL_size >= 0 || !input_parsed_locked()) { size++; }
+
+  de265_mutex_unlock(&mutex);
+
+  return size;
+}
+
+
+int NAL_Parser::get_NAL_queue_length() const
+{
+  de265_mutex_lock(&mutex);
+  int size = NAL_queue.size();
+  de265_mutex_unlock(&mutex);
+
+  return size;
+}
+
+
+// While there is still input to be parsed, the end has not been reached yet.
+
+bool NAL_Parser::is_end_of_stream() const
+{
+  de265_mutex_lock(&mutex);
+  bool eos = end_of_stream && input_parsed_locked();
+  de265_mutex_unlock(&mutex);
+
+  return eos;
+}
+
+
+bool NAL_Parser::is_end_of_frame() const
+{
+  de265_mutex_lock(&mutex);
+  bool eof = end_of_frame && input_parsed_locked();
+  de265_mutex_unlock(&mutex);
+
+  return eof;
+}
+
+
+bool NAL_Parser::is_end_of_input(bool includeIncompleteNAL) const
+{
+  de265_mutex_lock(&mutex);
+
+  bool end = ((end_of_stream || end_of_frame) &&
+              input_parsed_locked() &&
+              NAL_queue.empty() &&
+              !(includeIncompleteNAL && pending_input_NAL_size >= 0));
+
+  de265_mutex_unlock(&mutex);
+
+  return end;
+}
+
+
+void NAL_Parser::update_pending_input_NAL_size()
+{
+  de265_mutex_lock(&mutex);
+  pending_input_NAL_size = (pending_input_NAL ? pending_input_NAL->size() : -1);
+  de265_mutex_unlock(&mutex);
+}
+
+
 de265_error NAL_Parser::push_data(const unsigned char* data, int len,
                                   de265_PTS pts, void* user_data)
 {
+  if (async_parsing) {
+    input_chunk* chunk = new input_chunk;
+    chunk->type = input_chunk::Data;
+    chunk->data.assign(data, data+len);
+    chunk->pts = pts;
+    chunk->user_data = user_data;
+
+    return queue_input(chunk);
+  }
+
+  return push_data_internal(data,len,pts,user_data);
+}
+
+
+/* Returns the number of bytes before the first two consecutive zero bytes in 'data'.
+   These bytes can be copied to the NAL unit unchanged, because start-codes and
+   emulation-prevention bytes always begin with 00 00. The last byte is never included,
+   as we cannot know whether the next chunk starts with a zero.
+ */
+static int find_zero_byte_pair(const unsigned char* data, int len)
+{
+  int i=0;
+
+#if DE265_NAL_SCAN_SSE2
+  const __m128i zero = _mm_setzero_si128();
+
+  for (; i+17 <= len; i+=16) {
+    __m128i curr = _mm_loadu_si128((const __m128i*)(data+i));
+    __m128i next = _mm_loadu_si128((const __m128i*)(data+i+1));
+
+    int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(curr, zero),
+                                               _mm_cmpeq_epi8(next, zero)));
+    if (mask) {
+#ifdef _MSC_VER
+      unsigned long pos;
+      _BitScanForward(&pos, mask);
+      return i + pos;
+#else
+      return i + __builtin_ctz(mask);
+#endif
+    }
+  }
+#endif
+
+  for (; i+1 < len; i++) {
+    if (data[i]==0 && data[i+1]==0) {
+      return i;
+    }
+  }
+
+  return i;
+}
+
+
+de265_error NAL_Parser::push_data_internal(const unsigned char* data, int len,
+                                           de265_PTS pts, void* user_data)
+{
+  de265_mutex_lock(&mutex);
   end_of_frame = false;
+  de265_mutex_unlock(&mutex);
 
   if (pending_input_NAL == NULL) {
     pending_input_NAL = alloc_NAL_unit(len+3);
@@ -297,7 +554,17 @@ de265_error NAL_Parser::push_data(const unsigned char* data, int len,
 
     case 5:
       if (*data==0) { input_push_state=6; }
-      else { *out++ = *data; }
+      else {
+        // Copy all bytes up to the next 00 00 at once. It is at least the current byte.
+
+        int n = find_zero_byte_pair(data, len-i);
+        if (n<1) { n=1; }
+
+        memcpy(out, data, n);
+        out  += n;
+        data += n-1;
+        i    += n-1;
+      }
       break;
 
     case 6:
@@ -339,6 +606,7 @@ de265_error NAL_Parser::push_data(const unsigned char* data, int len,
 
         pending_input_NAL = alloc_NAL_unit(len+3);
         if (pending_input_NAL == NULL) {
+          update_pending_input_NAL_size();
           return DE265_ERROR_OUT_OF_MEMORY;
         }
         pending_input_NAL->pts = pts;
@@ -363,6 +631,7 @@ de265_error NAL_Parser::push_data(const unsigned char* data, int len,
   }
 
   nal->set_size(out - nal->data());
+  update_pending_input_NAL_size();
   return DE265_OK;
 }
 
@@ -370,11 +639,30 @@ de265_error NAL_Parser::push_data(const unsigned char* data, int len,
 de265_error NAL_Parser::push_NAL(const unsigned char* data, int len,
                                  de265_PTS pts, void* user_data)
 {
+  if (async_parsing) {
+    input_chunk* chunk = new input_chunk;
+    chunk->type = input_chunk::NAL;
+    chunk->data.assign(data, data+len);
+    chunk->pts = pts;
+    chunk->user_data = user_data;
+
+    return queue_input(chunk);
+  }
+
+  return push_NAL_internal(data,len,pts,user_data);
+}
+
+
+de265_error NAL_Parser::push_NAL_internal(const unsigned char* data, int len,
+                                          de265_PTS pts, void* user_data)
+{
 
   // Cannot use byte-stream input and NAL input at the same time.
   assert(pending_input_NAL == NULL);
 
+  de265_mutex_lock(&mutex);
   end_of_frame = false;
+  de265_mutex_unlock(&mutex);
 
   NAL_unit* nal = alloc_NAL_unit(len);
   if (nal == NULL || !nal->set_data(data, len)) {
@@ -392,7 +680,97 @@ de265_error NAL_Parser::push_NAL(const unsigned char* data, int len,
 }
 
 
+de265_error NAL_Parser::push_NAL_borrowed(const unsigned char* data, int len,
+                                          de265_PTS pts, void* user_data,
+                                          de265_release_NAL_func release_func)
+{
+  if (async_parsing) {
+    input_chunk* chunk = new input_chunk;
+    chunk->type = input_chunk::BorrowedNAL;
+    chunk->borrowed_data = data;
+    chunk->borrowed_size = len;
+    chunk->release_func = release_func;
+    chunk->pts = pts;
+    chunk->user_data = user_data;
+
+    return queue_input(chunk);
+  }
+
+  return push_NAL_borrowed_internal(data,len,pts,user_data,release_func);
+}
+
+
+de265_error NAL_Parser::push_NAL_borrowed_internal(const unsigned char* data, int len,
+                                                   de265_PTS pts, void* user_data,
+                                                   de265_release_NAL_func release_func)
+{
+  // Cannot use byte-stream input and NAL input at the same time.
+  assert(pending_input_NAL == NULL);
+
+  de265_mutex_lock(&mutex);
+  end_of_frame = false;
+  de265_mutex_unlock(&mutex);
+
+  NAL_unit* nal = alloc_NAL_unit(0);
+  if (nal == NULL) {
+    if (release_func) { release_func(data, user_data); }
+    return DE265_ERROR_OUT_OF_MEMORY;
+  }
+  nal->pts = pts;
+  nal->user_data = user_data;
+
+  nal->set_borrowed_data(data, len, release_func);
+  nal->mark_stuffing_bytes();
+
+  push_to_NAL_queue(nal);
+
+  return DE265_OK;
+}
+
+
 de265_error NAL_Parser::flush_data()
+{
+  if (async_parsing) {
+    input_chunk* chunk = new input_chunk;
+    chunk->type = input_chunk::EndOfNAL;
+    return queue_input(chunk);
+  }
+
+  return flush_data_internal();
+}
+
+
+void NAL_Parser::mark_end_of_stream()
+{
+  if (async_parsing) {
+    input_chunk* chunk = new input_chunk;
+    chunk->type = input_chunk::EndOfStream;
+    queue_input(chunk);
+    return;
+  }
+
+  de265_mutex_lock(&mutex);
+  end_of_stream = true;
+  de265_mutex_unlock(&mutex);
+}
+
+
+void NAL_Parser::mark_end_of_frame()
+{
+  if (async_parsing) {
+    input_chunk* chunk = new input_chunk;
+    chunk->type = input_chunk::EndOfFrame;
+    queue_input(chunk);
+    return;
+  }
+
+  de265_mutex_lock(&mutex);
+  end_of_frame = true;
+  de265_mutex_unlock(&mutex);
+}
+
+
+de265_error NAL_Parser::flush_data_internal()
 {
   if (pending_input_NAL) {
     NAL_unit* nal = pending_input_NAL;
@@ -417,6 +795,7 @@ de265_error NAL_Parser::flush_data()
     if (input_push_state>=5) {
       push_to_NAL_queue(nal);
       pending_input_NAL = NULL;
+      update_pending_input_NAL_size();
     }
 
     input_push_state = 0;
@@ -428,6 +807,27 @@ de265_error NAL_Parser::flush_data()
 
 void NAL_Parser::remove_pending_input_data()
 {
+  // --- remove queued input, and wait until the ingestion thread is idle ---
+
+  if (async_parsing) {
+    de265_mutex_lock(&mutex);
+
+    while (!input_queue.empty()) {
+      delete input_queue.front();
+      input_queue.pop_front();
+    }
+    nBytes_in_input_queue = 0;
+    de265_cond_broadcast(&cond, &mutex);
+
+    while (ingestion_busy) {
+      de265_cond_wait(&cond, &mutex);
+    }
+
+    ingestion_error = DE265_OK;
+
+    de265_mutex_unlock(&mutex);
+  }
+
   // --- remove pending input data ---
 
   if (pending_input_NAL) {
@@ -442,5 +842,200 @@ void NAL_Parser::remove_pending_input_data()
   }
 
   input_push_state = 0;
+
+  de265_mutex_lock(&mutex);
   nBytes_in_NAL_queue = 0;
+  pending_input_NAL_size = -1;
+  de265_mutex_unlock(&mutex);
+}
+
+
+// --- asynchronous input parsing ---
+
+de265_error NAL_Parser::queue_input(input_chunk* chunk)
+{
+  int size = chunk->data.size();
+
+  de265_mutex_lock(&mutex);
+
+  // Wait until the chunk fits into the queue. A chunk that is larger than the whole
+  // queue is accepted when the queue is empty.
+
+  while (!input_queue.empty() &&
+         nBytes_in_input_queue + size > max_input_queue_bytes) {
+    de265_cond_wait(&cond, &mutex);
+  }
+
+  input_queue.push_back(chunk);
+  nBytes_in_input_queue += size;
+
+  de265_error err = ingestion_error;
+  ingestion_error = DE265_OK;
+
+  de265_cond_broadcast(&cond, &mutex);
+  de265_mutex_unlock(&mutex);
+
+  return err;
+}
+
+
+de265_error NAL_Parser::process_input_chunk(input_chunk* chunk)
+{
+  switch (chunk->type) {
+  case input_chunk::Data:
+    return push_data_internal(chunk->data.data(), chunk->data.size(),
+                              chunk->pts, chunk->user_data);
+
+  case input_chunk::NAL:
+    return push_NAL_internal(chunk->data.data(), chunk->data.size(),
+                             chunk->pts, chunk->user_data);
+
+  case input_chunk::BorrowedNAL:
+    {
+      // the NAL unit takes over the release of the data
+      de265_release_NAL_func release_func = chunk->release_func;
+      chunk->release_func = NULL;
+
+      return push_NAL_borrowed_internal(chunk->borrowed_data, chunk->borrowed_size,
+                                        chunk->pts, chunk->user_data, release_func);
+    }
+
+  case input_chunk::EndOfNAL:
+    return flush_data_internal();
+
+  case input_chunk::EndOfFrame:
+    de265_mutex_lock(&mutex);
+    end_of_frame = true;
+    de265_mutex_unlock(&mutex);
+    return DE265_OK;
+
+  case input_chunk::EndOfStream:
+    de265_mutex_lock(&mutex);
+    end_of_stream = true;
+    de265_mutex_unlock(&mutex);
+    return DE265_OK;
+  }
+
+  return DE265_OK;
+}
+
+
+THREAD_RESULT NAL_Parser::ingestion_main(THREAD_PARAM parser_ptr)
+{
+  NAL_Parser* parser = (NAL_Parser*)parser_ptr;
+
+  de265_mutex_lock(&parser->mutex);
+
+  for (;;) {
+    while (!parser->stop_ingestion && parser->input_queue.empty()) {
+      de265_cond_wait(&parser->cond, &parser->mutex);
+    }
+
+    if (parser->stop_ingestion) {
+      break;
+    }
+
+    input_chunk* chunk = parser->input_queue.front();
+    parser->input_queue.pop_front();
+    parser->nBytes_in_input_queue -= chunk->data.size();
+    parser->ingestion_busy = true;
+
+    // there is space in the queue again
+    de265_cond_broadcast(&parser->cond, &parser->mutex);
+
+    de265_mutex_unlock(&parser->mutex);
+
+    de265_error err = parser->process_input_chunk(chunk);
+    delete chunk;
+
+    de265_mutex_lock(&parser->mutex);
+
+    if (err != DE265_OK && parser->ingestion_error == DE265_OK) {
+      parser->ingestion_error = err;
+    }
+
+    parser->ingestion_busy = false;
+    de265_cond_broadcast(&parser->cond, &parser->mutex);
+  }
+
+  de265_mutex_unlock(&parser->mutex);
+
+  return 0;
+}
+
+
+de265_error NAL_Parser::set_asynchronous_parsing(int max_queued_bytes)
+{
+  if (max_queued_bytes > 0) {
+    if (async_parsing) {
+      de265_mutex_lock(&mutex);
+      max_input_queue_bytes = max_queued_bytes;
+      de265_cond_broadcast(&cond, &mutex);
+      de265_mutex_unlock(&mutex);
+    }
+    else {
+      max_input_queue_bytes = max_queued_bytes;
+      stop_ingestion = false;
+
+      if (de265_thread_create(&ingestion_thread, ingestion_main, this) != 0) {
+        return DE265_ERROR_CANNOT_START_THREADPOOL;
+      }
+
+      async_parsing = true;
+    }
+  }
+  else if (async_parsing) {
+    return stop_ingestion_thread();
+  }
+
+  return DE265_OK;
+}
+
+
+de265_error NAL_Parser::stop_ingestion_thread()
+{
+  de265_mutex_lock(&mutex);
+  stop_ingestion = true;
+  de265_cond_broadcast(&cond, &mutex);
+  de265_mutex_unlock(&mutex);
+
+  de265_thread_join(ingestion_thread);
+  de265_thread_destroy(&ingestion_thread);
+
+  async_parsing = false;
+
+  // parse the input that is still queued
+
+  de265_error err = ingestion_error;
+
+  while (!input_queue.empty()) {
+    input_chunk* chunk = input_queue.front();
+    input_queue.pop_front();
+
+    de265_error chunkErr = process_input_chunk(chunk);
+    if (err == DE265_OK) { err = chunkErr; }
+
+    delete chunk;
+  }
+
+  nBytes_in_input_queue = 0;
+  ingestion_error = DE265_OK;
+
+  return err;
+}
+
+
+void NAL_Parser::wait_for_parsed_input()
+{
+  if (!async_parsing) {
+    return;
+  }
+
+  de265_mutex_lock(&mutex);
+
+  while (NAL_queue.empty() && !input_parsed_locked()) {
+    de265_cond_wait(&cond, &mutex);
+  }
+
+  de265_mutex_unlock(&mutex);
 }
@@ -25,9 +25,11 @@
 #include "libde265/pps.h"
 #include "libde265/nal.h"
 #include "libde265/util.h"
+#include "libde265/threads.h"
 
 #include <vector>
 #include <queue>
+#include <deque>
 
 #define DE265_NAL_FREE_LIST_SIZE 16
 #define DE265_SKIPPED_BYTES_INITIAL_SIZE 16
@@ -54,8 +56,22 @@ class NAL_unit {
 
   int size() const { return data_size; }
   void set_size(int s) { data_size=s; }
-  unsigned char* data() { return nal_data; }
-  const unsigned char* data() const { return nal_data; }
+  unsigned char* data() { return borrowed_data ? borrowed_data : nal_data; }
+  const unsigned char* data() const { return borrowed_data ? borrowed_data : nal_data; }
+
+
+  // --- borrowed data ---
+
+  /* Use the caller's buffer as NAL data. It still contains the stuffing bytes, which are
+     only marked as skipped bytes. 'release_func' is called when the data is not needed
+     anymore. The data is never modified.
+   */
+  void set_borrowed_data(const unsigned char* data, int n, de265_release_NAL_func release_func);
+  void release_borrowed_data();
+
+  // The skipped bytes are still contained in the data and have to be skipped while reading.
+  bool skipped_bytes_in_data() const { return borrowed_data != NULL; }
+  const int* skipped_byte_positions() const { return skipped_bytes.data(); }
 
 
   // --- skipped stuffing bytes ---
@@ -75,11 +91,18 @@ class NAL_unit {
    */
   void remove_stuffing_bytes();
 
+  /* Mark all stuffing bytes in the NAL data as skipped bytes without removing them.
+   */
+  void mark_stuffing_bytes();
+
  private:
   unsigned char* nal_data;
   int data_size;
   int capacity;
 
+  unsigned char* borrowed_data;
+  de265_release_NAL_func release_func;
+
   std::vector<int> skipped_bytes; // up to position[x], there were 'x' skipped bytes
 };
 
@@ -96,34 +119,44 @@ class NAL_Parser
   de265_error push_NAL(const unsigned char* data, int len,
                        de265_PTS pts, void* user_data = NULL);
 
+  de265_error push_NAL_borrowed(const unsigned char* data, int len,
+                                de265_PTS pts, void* user_data,
+                                de265_release_NAL_func release_func);
+
   NAL_unit*   pop_from_NAL_queue();
   de265_error flush_data();
-  void        mark_end_of_stream() { end_of_stream=true; }
-  void        mark_end_of_frame() { end_of_frame=true; }
+  void        mark_end_of_stream();
+  void        mark_end_of_frame();
   void  remove_pending_input_data();
 
-  int bytes_in_input_queue() const {
-    int size = nBytes_in_NAL_queue;
-    if (pending_input_NAL) { size += pending_input_NAL->size(); }
-    return size;
-  }
+  int bytes_in_input_queue() const;
+  int number_of_NAL_units_pending() const;
+  int number_of_complete_NAL_units_pending() const { return get_NAL_queue_length(); }
 
-  int number_of_NAL_units_pending() const {
-    int size = NAL_queue.size();
-    if (pending_input_NAL) { size++; }
-    return size;
-  }
+  void free_NAL_unit(NAL_unit*);
 
-  int number_of_complete_NAL_units_pending() const {
-    return NAL_queue.size();
-  }
 
-  void free_NAL_unit(NAL_unit*);
+  int get_NAL_queue_length() const;
+  bool is_end_of_stream() const;
+  bool is_end_of_frame() const;
+
+  /* The end of the stream or frame has been reached and all NAL units have been taken
+     from the queue. With 'includeIncompleteNAL', there must also be no pending input NAL. */
+  bool is_end_of_input(bool includeIncompleteNAL) const;
+
+
+  // --- asynchronous input parsing ---
 
+  /* Parse the byte-stream on a separate thread. The push functions only queue the input
+     data, up to 'max_queued_bytes'. When the queue is full, they block until the
+     ingestion thread has taken enough data from it.
+     With 'max_queued_bytes'==0, the ingestion thread is stopped and the input is parsed
+     by the push functions again. Input that is still queued is parsed before. */
+  de265_error set_asynchronous_parsing(int max_queued_bytes);
 
-  int get_NAL_queue_length() const { return NAL_queue.size(); }
-  bool is_end_of_stream() const { return end_of_stream; }
-  bool is_end_of_frame() const { return end_of_frame; }
+  /* If there is no NAL unit in the queue, but input is still being parsed,
+     wait until the next NAL unit is available or all input has been parsed. */
+  void wait_for_parsed_input();
 
  private:
   // byte-stream level
@@ -133,6 +166,17 @@ class NAL_Parser
   int  input_push_state;
 
   NAL_unit* pending_input_NAL;
+  int  pending_input_NAL_size; // size of pending_input_NAL after the last push, -1 if none
+
+  de265_error push_data_internal(const unsigned char* data, int len,
+                                 de265_PTS pts, void* user_data);
+  de265_error push_NAL_internal(const unsigned char* data, int len,
+                                de265_PTS pts, void* user_data);
+  de265_error push_NAL_borrowed_internal(const unsigned char* data, int len,
+                                         de265_PTS pts, void* user_data,
+                                         de265_release_NAL_func release_func);
+  de265_error flush_data_internal();
+  void update_pending_input_NAL_size();
 
 
   // NAL level
@@ -148,6 +192,49 @@ class NAL_Parser
   std::vector<NAL_unit*> NAL_free_list;  // maximum size: DE265_NAL_FREE_LIST_SIZE
 
   LIBDE265_CHECK_RESULT NAL_unit* alloc_NAL_unit(int size);
+
+
+  // Input data queued for the ingestion thread. Control entries are queued as well, so
+  // that they are processed in order with the data.
+
+  struct input_chunk {
+    input_chunk() : borrowed_data(NULL), borrowed_size(0), release_func(NULL) { }
+    ~input_chunk() { if (release_func) { release_func(borrowed_data, user_data); } }
+
+    enum { Data, NAL, BorrowedNAL, EndOfNAL, EndOfFrame, EndOfStream } type;
+    std::vector<unsigned char> data;
+    de265_PTS pts;
+    void*     user_data;
+
+    // BorrowedNAL: the data is not copied, the release function is called when the chunk is deleted
+    const unsigned char* borrowed_data;
+    int borrowed_size;
+    de265_release_NAL_func release_func;
+  };
+
+  bool async_parsing;
+  bool ingestion_busy;  // the ingestion thread is processing a chunk
+  bool stop_ingestion;
+  de265_error ingestion_error; // first error of the ingestion thread, returned by the next push
+
+  std::deque<input_chunk*> input_queue;
+  int nBytes_in_input_queue;
+  int max_input_queue_bytes;
+
+  de265_thread ingestion_thread;
+
+  // Protects all state that is shared between the ingestion thread and the decoder:
+  // the NAL queue, the free list, the end flags, and the input queue.
+  mutable de265_mutex mutex;
+  de265_cond  cond; // input queued or taken, NAL unit queued, or ingestion idle
+
+  bool input_parsed_locked() const { return input_queue.empty() && !ingestion_busy; }
+
+  de265_error queue_input(input_chunk* chunk);
+  de265_error process_input_chunk(input_chunk* chunk);
+  de265_error stop_ingestion_thread(); // parses the remaining queued input
+
+  static THREAD_RESULT ingestion_main(THREAD_PARAM parser);
 };
 
 
@@ -540,6 +540,14 @@ void pic_parameter_set::set_derived_values(const seq_parameter_set* sps)
   Log2MinCuChromaQpOffsetSize = sps->Log2CtbSizeY - range_extension.diff_cu_chroma_qp_offset_depth;
   Log2MaxTransformSkipSize = range_extension.log2_max_transform_skip_block_size;
 
+  if (sps->scaling_list_enable_flag) {
+    DequantScale.resize(DEQUANT_SCALE_TABLE_SIZE);
+    fill_dequant_scale_table(DequantScale.data(), &scaling_list);
+  }
+  else {
+    DequantScale.clear();
+  }
+
   if (uniform_spacing_flag) {
 
     // set columns widths
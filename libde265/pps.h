@@ -157,6 +157,13 @@ public:
   std::vector<int> TileIdRS;      // #CTBs  // index in raster-scan order
   std::vector<int> MinTbAddrZS;   // #TBs   [x + y*PicWidthInTbsY]
 
+  // ScalingFactor * levelScale[qP%6], only set when scaling lists are enabled
+  std::vector<int16_t> DequantScale; // DEQUANT_SCALE_TABLE_SIZE
+
+  const int16_t* get_dequant_scale(int qP, int log2nT, int matrixId) const {
+    return &DequantScale[ dequant_scale_table_offset(qP,log2nT,matrixId) ];
+  }
+
   void set_derived_values(const seq_parameter_set* sps);
 };
 
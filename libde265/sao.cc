@@ -25,11 +25,60 @@
 #include <string.h>
 
 
+/* Whether SAO may use the samples of the CTB at (xCtb+dx, yCtb+dy) when filtering
+   the CTB at (xCtb,yCtb). Slices and tiles consist of whole CTBs, hence this
+   can be decided once per neighboring CTB instead of for each sample.
+ */
+static bool sao_neighbor_available(const de265_image* img, const slice_segment_header* shdr,
+                                   int xCtb,int yCtb, int dx,int dy)
+{
+  const seq_parameter_set& sps = img->get_sps();
+  const pic_parameter_set& pps = img->get_pps();
+
+  const int xN = xCtb+dx;
+  const int yN = yCtb+dy;
+
+  if (xN<0 || yN<0 || xN>=sps.PicWidthInCtbsY || yN>=sps.PicHeightInCtbsY) {
+    return false;
+  }
+
+  const slice_segment_header* nhdr = img->get_SliceHeaderCtb(xN,yN);
+  if (nhdr==NULL) {
+    return false;
+  }
+
+  if (nhdr->SliceAddrRS < shdr->SliceAddrRS &&
+      shdr->slice_loop_filter_across_slices_enabled_flag==0) {
+    return false;
+  }
+
+  if (nhdr->SliceAddrRS > shdr->SliceAddrRS &&
+      nhdr->slice_loop_filter_across_slices_enabled_flag==0) {
+    return false;
+  }
+
+  if (pps.loop_filter_across_tiles_enabled_flag==0 &&
+      pps.TileIdRS[xN + yN*sps.PicWidthInCtbsY] !=
+      pps.TileIdRS[xCtb + yCtb*sps.PicWidthInCtbsY]) {
+    return false;
+  }
+
+  return true;
+}
+
+
+/* 'in_ctb' and 'out_ctb' point to the top left sample of the CTB. The input also has to
+   contain the neighboring samples around the CTB.
+
+   The whole CTB is filtered with the acceleration functions. Afterwards, samples that
+   must not be modified (at unavailable neighbors, in PCM or transquant-bypass CUs) are
+   copied back from the input.
+ */
 template <class pixel_t>
 void apply_sao_internal(de265_image* img, int xCtb,int yCtb,
                         const slice_segment_header* shdr, int cIdx, int nSW,int nSH,
-                        const pixel_t* in_img,  int in_stride,
-                        /* */ pixel_t* out_img, int out_stride)
+                        const pixel_t* in_ctb,  int in_stride,
+                        /* */ pixel_t* out_ctb, int out_stride)
 {
   const sao_info* saoinfo = img->get_sao_info(xCtb,yCtb);
 
@@ -41,10 +90,10 @@ void apply_sao_internal(de265_image* img, int xCtb,int yCtb,
     return;
   }
 
+  const acceleration_functions& acceleration = img->decctx->acceleration;
+
   const seq_parameter_set* sps = &img->get_sps();
-  const pic_parameter_set* pps = &img->get_pps();
   const int bitDepth = (cIdx==0 ? sps->BitDepth_Y : sps->BitDepth_C);
-  const int maxPixelValue = (1<<bitDepth)-1;
 
   // top left position of CTB in pixels
   const int xC = xCtb*nSW;
@@ -53,13 +102,8 @@ void apply_sao_internal(de265_image* img, int xCtb,int yCtb,
   const int width  = img->get_width(cIdx);
   const int height = img->get_height(cIdx);
 
-  const int ctbSliceAddrRS = img->get_SliceHeader(xC,yC)->SliceAddrRS;
-
-  const int picWidthInCtbs = sps->PicWidthInCtbsY;
   const int chromashiftW = sps->get_chroma_shift_W(cIdx);
   const int chromashiftH = sps->get_chroma_shift_H(cIdx);
-  const int ctbshiftW = sps->Log2CtbSizeY - chromashiftW;
-  const int ctbshiftH = sps->Log2CtbSizeY - chromashiftH;
 
 
   for (int i=0;i<5;i++)
@@ -73,108 +117,54 @@ void apply_sao_internal(de265_image* img, int xCtb,int yCtb,
   const int ctbH = (yC+nSH>height) ? height-yC : nSH;
 
 
-  const bool extendedTests = img->get_CTB_has_pcm_or_cu_transquant_bypass(xCtb,yCtb);
-
   if (SaoTypeIdx==2) {
-    int hPos[2], vPos[2];
-    int vPosStride[2]; // vPos[] multiplied by image stride
     int SaoEoClass = (saoinfo->SaoEoClass >> (2*cIdx)) & 0x3;
 
-    switch (SaoEoClass) {
-    case 0: hPos[0]=-1; hPos[1]= 1; vPos[0]= 0; vPos[1]=0; break;
-    case 1: hPos[0]= 0; hPos[1]= 0; vPos[0]=-1; vPos[1]=1; break;
-    case 2: hPos[0]=-1; hPos[1]= 1; vPos[0]=-1; vPos[1]=1; break;
-    case 3: hPos[0]= 1; hPos[1]=-1; vPos[0]=-1; vPos[1]=1; break;
-    }
-
-    vPosStride[0] = vPos[0] * in_stride;
-    vPosStride[1] = vPos[1] * in_stride;
-
     /* Reorder sao_info.saoOffsetVal[] array, so that we can index it
        directly with the sum of the two pixel-difference signs. */
-    int8_t  saoOffsetVal[5]; // [2] unused
+    int8_t  saoOffsetVal[5];
     saoOffsetVal[0] = saoinfo->saoOffsetVal[cIdx][1-1];
     saoOffsetVal[1] = saoinfo->saoOffsetVal[cIdx][2-1];
     saoOffsetVal[2] = 0;
     saoOffsetVal[3] = saoinfo->saoOffsetVal[cIdx][3-1];
     saoOffsetVal[4] = saoinfo->saoOffsetVal[cIdx][4-1];
 
+    const bool horizontal = (SaoEoClass != 1);
+    const bool vertical   = (SaoEoClass != 0);
 
-    for (int j=0;j<ctbH;j++) {
-      const pixel_t* in_ptr  = &in_img [xC+(yC+j)*in_stride];
-      /* */ pixel_t* out_ptr = &out_img[xC+(yC+j)*out_stride];
+    // The first/last column and row are only filtered when the neighboring CTB is available.
 
-      for (int i=0;i<ctbW;i++) {
-        int edgeIdx = -1;
+    const int x0 = (horizontal && !sao_neighbor_available(img,shdr,xCtb,yCtb,-1, 0)) ? 1 : 0;
+    const int x1 = (horizontal && !sao_neighbor_available(img,shdr,xCtb,yCtb, 1, 0)) ? ctbW-1 : ctbW;
+    const int y0 = (vertical   && !sao_neighbor_available(img,shdr,xCtb,yCtb, 0,-1)) ? 1 : 0;
+    const int y1 = (vertical   && !sao_neighbor_available(img,shdr,xCtb,yCtb, 0, 1)) ? ctbH-1 : ctbH;
 
-        logtrace(LogSAO, "pos %d,%d\n",xC+i,yC+j);
-
-        if ((extendedTests &&
-             (sps->pcm_loop_filter_disable_flag &&
-              img->get_pcm_flag((xC+i)<<chromashiftW,(yC+j)<<chromashiftH))) ||
-            img->get_cu_transquant_bypass((xC+i)<<chromashiftW,(yC+j)<<chromashiftH)) {
-          continue;
-        }
+    if (x0>=x1 || y0>=y1) {
+      return;
+    }
 
-        // do the expensive test for boundaries only at the boundaries
-        bool testBoundary = (i==0 || j==0 || i==ctbW-1 || j==ctbH-1);
-
-        if (testBoundary)
-          for (int k=0;k<2;k++) {
-            int xS = xC+i+hPos[k];
-            int yS = yC+j+vPos[k];
-
-            if (xS<0 || yS<0 || xS>=width || yS>=height) {
-              edgeIdx=0;
-              break;
-            }
-
-
-            // This part seems inefficient with all the get_SliceHeaderIndex() calls,
-            // but removing this part (because the input was known to have only a single
-            // slice anyway) reduced computation time only by 1.3%.
-            // TODO: however, this may still be a big part of SAO itself.
-
-            slice_segment_header* sliceHeader = img->get_SliceHeader(xS<<chromashiftW,
-                                                                     yS<<chromashiftH);
-            if (sliceHeader==NULL) { return; }
-
-            int sliceAddrRS = sliceHeader->SliceAddrRS;
-            if (sliceAddrRS <  ctbSliceAddrRS &&
-                img->get_SliceHeader((xC+i)<<chromashiftW,
-                                     (yC+j)<<chromashiftH)->slice_loop_filter_across_slices_enabled_flag==0) {
-              edgeIdx=0;
-              break;
-            }
-
-            if (sliceAddrRS >  ctbSliceAddrRS &&
-                img->get_SliceHeader(xS<<chromashiftW,
-                                     yS<<chromashiftH)->slice_loop_filter_across_slices_enabled_flag==0) {
-              edgeIdx=0;
-              break;
-            }
-
-
-            if (pps->loop_filter_across_tiles_enabled_flag==0 &&
-                pps->TileIdRS[(xS>>ctbshiftW) + (yS>>ctbshiftH)*picWidthInCtbs] !=
-                pps->TileIdRS[(xC>>ctbshiftW) + (yC>>ctbshiftH)*picWidthInCtbs]) {
-              edgeIdx=0;
-              break;
-            }
-          }
+    acceleration.sao_edge(SaoEoClass,
+                          out_ctb + x0 + y0*out_stride, out_stride,
+                          in_ctb  + x0 + y0*in_stride,  in_stride,
+                          x1-x0, y1-y0, saoOffsetVal, bitDepth);
 
-        if (edgeIdx != 0) {
+    // The diagonal classes also depend on the CTBs at the corners.
 
-          edgeIdx = ( Sign(in_ptr[i] - in_ptr[i+hPos[0]+vPosStride[0]]) +
-                      Sign(in_ptr[i] - in_ptr[i+hPos[1]+vPosStride[1]])   );
+    if (SaoEoClass >= 2) {
+      const int dx = (SaoEoClass==2 ? -1 : 1);
 
-          if (1) { // edgeIdx != 0) {   // seems to be faster without this check (zero in offset table)
-            int offset = saoOffsetVal[edgeIdx+2];
+      // corner sample in the top row
+      int xT = (dx<0 ? 0 : ctbW-1);
+      if (y0==0 && (dx<0 ? x0==0 : x1==ctbW) &&
+          !sao_neighbor_available(img,shdr,xCtb,yCtb, dx,-1)) {
+        out_ctb[xT] = in_ctb[xT];
+      }
 
-            out_ptr[i] = Clip3(0,maxPixelValue,
-                               in_ptr[i] + offset);
-          }
-        }
+      // corner sample in the bottom row
+      int xB = (dx<0 ? ctbW-1 : 0);
+      if (y1==ctbH && (dx<0 ? x1==ctbW : x0==0) &&
+          !sao_neighbor_available(img,shdr,xCtb,yCtb, -dx,1)) {
+        out_ctb[xB + (ctbH-1)*out_stride] = in_ctb[xB + (ctbH-1)*in_stride];
       }
     }
   }
@@ -183,342 +173,146 @@ void apply_sao_internal(de265_image* img, int xCtb,int yCtb,
     int saoLeftClass = saoinfo->sao_band_position[cIdx];
     logtrace(LogSAO,"saoLeftClass: %d\n",saoLeftClass);
 
-    int bandTable[32];
-    memset(bandTable, 0, sizeof(int)*32);
-
-    for (int k=0;k<4;k++) {
-      bandTable[ (k+saoLeftClass)&31 ] = k+1;
+    // Shifts are a strange thing. On x86, >>x actually computes >>(x%64).
+    // So we have to take care of large bandShifts.
+    if (bandShift >= 8) {
+      return;
     }
 
+    acceleration.sao_band(out_ctb, out_stride, in_ctb, in_stride, ctbW, ctbH,
+                          saoLeftClass, saoinfo->saoOffsetVal[cIdx], bitDepth);
+  }
 
-    /* If PCM or transquant_bypass is used in this CTB, we have to
-       run all checks (A).
-       Otherwise, we run a simplified version of the code (B).
-
-       NOTE: this whole part of SAO does not seem to be a significant part of the time spent
-    */
-
-    if (extendedTests) {
-
-      // (A) full version with all checks
 
-      for (int j=0;j<ctbH;j++)
-        for (int i=0;i<ctbW;i++) {
+  /* If PCM (with pcm_loop_filter_disabled) or transquant_bypass is used in this CTB,
+     restore the unfiltered samples of these CUs.
+   */
 
-          if ((sps->pcm_loop_filter_disable_flag &&
-               img->get_pcm_flag((xC+i)<<chromashiftW,(yC+j)<<chromashiftH)) ||
-              img->get_cu_transquant_bypass((xC+i)<<chromashiftW,(yC+j)<<chromashiftH)) {
-            continue;
-          }
+  if (img->get_CTB_has_pcm_or_cu_transquant_bypass(xCtb,yCtb)) {
+    const int cbW = sps->MinCbSizeY >> chromashiftW;
+    const int cbH = sps->MinCbSizeY >> chromashiftH;
 
-          // Shifts are a strange thing. On x86, >>x actually computes >>(x%64).
-          // So we have to take care of large bandShifts.
-          int bandIdx;
-          if (bandShift >= 8) {
-            bandIdx = 0;
-          } else {
-            bandIdx = bandTable[ in_img[xC+i+(yC+j)*in_stride]>>bandShift ];
-          }
+    for (int y=0;y<ctbH;y+=cbH)
+      for (int x=0;x<ctbW;x+=cbW) {
+        const int xL = (xC+x)<<chromashiftW;
+        const int yL = (yC+y)<<chromashiftH;
 
-          if (bandIdx>0) {
-            int offset = saoinfo->saoOffsetVal[cIdx][bandIdx-1];
+        if ((sps->pcm_loop_filter_disable_flag && img->get_pcm_flag(xL,yL)) ||
+            img->get_cu_transquant_bypass(xL,yL)) {
+          const int w = (x+cbW>ctbW) ? ctbW-x : cbW;
+          const int h = (y+cbH>ctbH) ? ctbH-y : cbH;
 
-            logtrace(LogSAO,"%d %d (%d) offset %d  %x -> %x\n",xC+i,yC+j,bandIdx,
-                     offset,
-                     in_img[xC+i+(yC+j)*in_stride],
-                     in_img[xC+i+(yC+j)*in_stride]+offset);
-
-            out_img[xC+i+(yC+j)*out_stride] = Clip3(0,maxPixelValue,
-                                                    in_img[xC+i+(yC+j)*in_stride] + offset);
+          for (int j=0;j<h;j++) {
+            memcpy(&out_ctb[x+(y+j)*out_stride], &in_ctb[x+(y+j)*in_stride], w*sizeof(pixel_t));
           }
         }
-    }
-    else
-      {
-        // (B) simplified version (only works if no PCM and transquant_bypass is active)
-
-        for (int j=0;j<ctbH;j++)
-          for (int i=0;i<ctbW;i++) {
-
-            // see above
-            int bandIdx;
-            if (bandShift >= 8) {
-              bandIdx = 0;
-            } else {
-              bandIdx = bandTable[ in_img[xC+i+(yC+j)*in_stride]>>bandShift ];
-            }
-
-            if (bandIdx>0) {
-              int offset = saoinfo->saoOffsetVal[cIdx][bandIdx-1];
-
-              out_img[xC+i+(yC+j)*out_stride] = Clip3(0,maxPixelValue,
-                                                      in_img[xC+i+(yC+j)*in_stride] + offset);
-            }
-          }
       }
   }
 }
 
 
+/* Applies SAO to one component of a CTB in-place. The CTB is first copied into a local
+   buffer together with its neighboring samples. Those of the CTB row above and of the
+   CTB to the left have already been modified by SAO, so they are taken from the line
+   and column buffers. Then, the deblocked samples of this CTB that will be needed by
+   its right and lower neighbors are saved in these buffers.
+ */
 template <class pixel_t>
-void apply_sao(de265_image* img, int xCtb,int yCtb,
-               const slice_segment_header* shdr, int cIdx, int nSW,int nSH,
-               const pixel_t* in_img,  int in_stride,
-               /* */ pixel_t* out_img, int out_stride)
+void apply_sao_CTB_in_place_internal(de265_image* img, int xCtb,int yCtb,
+                                     const slice_segment_header* shdr, int cIdx,
+                                     bool enabled, int nSW,int nSH,
+                                     pixel_t* column)
 {
-  if (img->high_bit_depth(cIdx)) {
-    apply_sao_internal<uint16_t>(img,xCtb,yCtb, shdr,cIdx,nSW,nSH,
-                                 (uint16_t*)in_img, in_stride,
-                                 (uint16_t*)out_img,out_stride);
-  }
-  else {
-    apply_sao_internal<uint8_t>(img,xCtb,yCtb, shdr,cIdx,nSW,nSH,
-                                in_img, in_stride,
-                                out_img,out_stride);
-  }
-}
+  const int width  = img->get_width(cIdx);
+  const int height = img->get_height(cIdx);
 
+  const int xC = xCtb*nSW;
+  const int yC = yCtb*nSH;
 
-void apply_sample_adaptive_offset(de265_image* img)
-{
-  const seq_parameter_set& sps = img->get_sps();
+  const int ctbW = (xC+nSW>width)  ? width -xC : nSW;
+  const int ctbH = (yC+nSH>height) ? height-yC : nSH;
 
-  if (sps.sample_adaptive_offset_enabled_flag==0) {
-    return;
-  }
+  const int stride = img->get_image_stride(cIdx);
+  pixel_t* ctb = img->get_image_plane_at_pos_NEW<pixel_t>(cIdx, xC,yC);
 
-  de265_image inputCopy;
-  de265_error err = inputCopy.copy_image(img);
-  if (err != DE265_OK) {
-    img->decctx->add_warning(DE265_WARNING_CANNOT_APPLY_SAO_OUT_OF_MEMORY,false);
-    return;
-  }
+  pixel_t* line = (pixel_t*)img->get_sao_line_buffer(cIdx, yCtb);
 
-  for (int yCtb=0; yCtb<sps.PicHeightInCtbsY; yCtb++)
-    for (int xCtb=0; xCtb<sps.PicWidthInCtbsY; xCtb++)
-      {
-        const slice_segment_header* shdr = img->get_SliceHeaderCtb(xCtb,yCtb);
+  const bool left  = (xC>0);
+  const bool right = (xC+ctbW<width);
+  const bool below = (yC+ctbH<height);
 
-        if (shdr->slice_sao_luma_flag) {
-          apply_sao(img, xCtb,yCtb, shdr, 0, 1<<sps.Log2CtbSizeY, 1<<sps.Log2CtbSizeY,
-                    inputCopy.get_image_plane(0), inputCopy.get_image_stride(0),
-                    img->get_image_plane(0), img->get_image_stride(0));
-        }
+  enabled &= ((img->get_sao_info(xCtb,yCtb)->SaoTypeIdx >> (2*cIdx)) & 0x3) != 0;
 
-        if (shdr->slice_sao_chroma_flag) {
-          int nSW = (1<<sps.Log2CtbSizeY) / sps.SubWidthC;
-          int nSH = (1<<sps.Log2CtbSizeY) / sps.SubHeightC;
+  if (enabled) {
+    const int in_stride = MAX_SAO_CTB_SIZE+2;
+    pixel_t in[(MAX_SAO_CTB_SIZE+2) * (MAX_SAO_CTB_SIZE+2)];
+    pixel_t* in_ctb = &in[1+in_stride];
 
-          apply_sao(img, xCtb,yCtb, shdr, 1, nSW,nSH,
-                    inputCopy.get_image_plane(1), inputCopy.get_image_stride(1),
-                    img->get_image_plane(1), img->get_image_stride(1));
+    // Samples outside of the image are not read by SAO, we leave them uninitialized.
 
-          apply_sao(img, xCtb,yCtb, shdr, 2, nSW,nSH,
-                    inputCopy.get_image_plane(2), inputCopy.get_image_stride(2),
-                    img->get_image_plane(2), img->get_image_stride(2));
-        }
-      }
-}
+    if (yC>0) {
+      const pixel_t* above = (const pixel_t*)img->get_sao_line_buffer(cIdx, yCtb-1);
+      int i0 = left ? -1 : 0;
+      int i1 = right ? ctbW : ctbW-1;
+      memcpy(&in_ctb[i0-in_stride], &above[xC+i0], (i1-i0+1)*sizeof(pixel_t));
+    }
 
+    for (int j=0;j<ctbH;j++) {
+      if (left)  { in_ctb[j*in_stride-1] = column[j]; }
+      memcpy(&in_ctb[j*in_stride], &ctb[j*stride], ctbW*sizeof(pixel_t));
+      if (right) { in_ctb[j*in_stride+ctbW] = ctb[j*stride+ctbW]; }
+    }
 
-void apply_sample_adaptive_offset_sequential(de265_image* img)
-{
-  const seq_parameter_set& sps = img->get_sps();
+    if (below) {
+      int i0 = left ? -1 : 0;
+      int i1 = right ? ctbW : ctbW-1;
+      memcpy(&in_ctb[i0+ctbH*in_stride], &ctb[i0+ctbH*stride], (i1-i0+1)*sizeof(pixel_t));
+    }
 
-  if (sps.sample_adaptive_offset_enabled_flag==0) {
-    return;
-  }
+    // save the deblocked samples before we overwrite them
 
-  int lumaImageSize   = img->get_image_stride(0) * img->get_height(0) * img->get_bytes_per_pixel(0);
-  int chromaImageSize = img->get_image_stride(1) * img->get_height(1) * img->get_bytes_per_pixel(1);
+    if (below) { memcpy(&line[xC], &ctb[(ctbH-1)*stride], ctbW*sizeof(pixel_t)); }
+    for (int j=0;j<ctbH;j++) { column[j] = ctb[j*stride+ctbW-1]; }
 
-  uint8_t* inputCopy = new uint8_t[ libde265_max(lumaImageSize, chromaImageSize) ];
-  if (inputCopy == NULL) {
-    img->decctx->add_warning(DE265_WARNING_CANNOT_APPLY_SAO_OUT_OF_MEMORY,false);
-    return;
+    apply_sao_internal<pixel_t>(img, xCtb,yCtb, shdr, cIdx, nSW,nSH,
+                                in_ctb, in_stride, ctb, stride);
   }
-
-
-  int nChannels = 3;
-  if (sps.ChromaArrayType == CHROMA_MONO) { nChannels=1; }
-
-  for (int cIdx=0;cIdx<nChannels;cIdx++) {
-
-    int stride = img->get_image_stride(cIdx);
-    int height = img->get_height(cIdx);
-
-    memcpy(inputCopy, img->get_image_plane(cIdx), stride * height * img->get_bytes_per_pixel(cIdx));
-
-    for (int yCtb=0; yCtb<sps.PicHeightInCtbsY; yCtb++)
-      for (int xCtb=0; xCtb<sps.PicWidthInCtbsY; xCtb++)
-        {
-          const slice_segment_header* shdr = img->get_SliceHeaderCtb(xCtb,yCtb);
-          if (shdr==NULL) { return; }
-
-          if (cIdx==0 && shdr->slice_sao_luma_flag) {
-            apply_sao(img, xCtb,yCtb, shdr, 0, 1<<sps.Log2CtbSizeY, 1<<sps.Log2CtbSizeY,
-                      inputCopy, stride,
-                      img->get_image_plane(0), img->get_image_stride(0));
-          }
-
-          if (cIdx!=0 && shdr->slice_sao_chroma_flag) {
-            int nSW = (1<<sps.Log2CtbSizeY) / sps.SubWidthC;
-            int nSH = (1<<sps.Log2CtbSizeY) / sps.SubHeightC;
-
-            apply_sao(img, xCtb,yCtb, shdr, cIdx, nSW,nSH,
-                      inputCopy, stride,
-                      img->get_image_plane(cIdx), img->get_image_stride(cIdx));
-          }
-        }
+  else {
+    if (below) { memcpy(&line[xC], &ctb[(ctbH-1)*stride], ctbW*sizeof(pixel_t)); }
+    for (int j=0;j<ctbH;j++) { column[j] = ctb[j*stride+ctbW-1]; }
   }
-
-  delete[] inputCopy;
 }
 
 
-
-
-class thread_task_sao : public thread_task
-{
-public:
-  int  ctb_y;
-  de265_image* img; /* this is where we get the SPS from
-                       (either inputImg or outputImg can be a dummy image)
-                    */
-
-  de265_image* inputImg;
-  de265_image* outputImg;
-  int inputProgress;
-
-  virtual void work();
-  virtual std::string name() const {
-    char buf[100];
-    sprintf(buf,"sao-%d",ctb_y);
-    return buf;
-  }
-};
-
-
-void thread_task_sao::work()
+void apply_sao_CTB_in_place(de265_image* img, int xCtb,int yCtb, sao_column_buffer* column)
 {
-  state = Running;
-  img->thread_run(this);
-
   const seq_parameter_set& sps = img->get_sps();
 
-  const int rightCtb = sps.PicWidthInCtbsY-1;
-  const int ctbSize  = (1<<sps.Log2CtbSizeY);
-
-
-  // wait until also the CTB-rows below and above are ready
-
-  img->wait_for_progress(this, rightCtb,ctb_y,  inputProgress);
-
-  if (ctb_y>0) {
-    img->wait_for_progress(this, rightCtb,ctb_y-1, inputProgress);
-  }
-
-  if (ctb_y+1<sps.PicHeightInCtbsY) {
-    img->wait_for_progress(this, rightCtb,ctb_y+1, inputProgress);
+  const slice_segment_header* shdr = img->get_SliceHeaderCtb(xCtb,yCtb);
+  if (shdr==NULL) {
+    return;
   }
 
+  int nChannels = 3;
+  if (sps.ChromaArrayType == CHROMA_MONO) { nChannels=1; }
 
-  // copy input image to output for this CTB-row
-
-  outputImg->copy_lines_from(inputImg, ctb_y * ctbSize, (ctb_y+1) * ctbSize);
-
-
-  // process SAO in the CTB-row
-
-  for (int xCtb=0; xCtb<sps.PicWidthInCtbsY; xCtb++)
-    {
-      const slice_segment_header* shdr = img->get_SliceHeaderCtb(xCtb,ctb_y);
-      if (shdr==NULL) {
-        break;
-      }
-
-      if (shdr->slice_sao_luma_flag) {
-        apply_sao(img, xCtb,ctb_y, shdr, 0, ctbSize, ctbSize,
-                  inputImg ->get_image_plane(0), inputImg ->get_image_stride(0),
-                  outputImg->get_image_plane(0), outputImg->get_image_stride(0));
-      }
-
-      if (shdr->slice_sao_chroma_flag) {
-        int nSW = ctbSize / sps.SubWidthC;
-        int nSH = ctbSize / sps.SubHeightC;
-
-        apply_sao(img, xCtb,ctb_y, shdr, 1, nSW,nSH,
-                  inputImg ->get_image_plane(1), inputImg ->get_image_stride(1),
-                  outputImg->get_image_plane(1), outputImg->get_image_stride(1));
+  for (int cIdx=0;cIdx<nChannels;cIdx++) {
+    bool enabled = (cIdx==0 ? shdr->slice_sao_luma_flag : shdr->slice_sao_chroma_flag);
 
-        apply_sao(img, xCtb,ctb_y, shdr, 2, nSW,nSH,
-                  inputImg ->get_image_plane(2), inputImg ->get_image_stride(2),
-                  outputImg->get_image_plane(2), outputImg->get_image_stride(2));
-      }
+    int nSW = (1<<sps.Log2CtbSizeY);
+    int nSH = (1<<sps.Log2CtbSizeY);
+    if (cIdx>0) {
+      nSW /= sps.SubWidthC;
+      nSH /= sps.SubHeightC;
     }
 
-
-  // mark SAO progress
-
-  for (int x=0;x<=rightCtb;x++) {
-    const int CtbWidth = sps.PicWidthInCtbsY;
-    img->ctb_progress[x+ctb_y*CtbWidth].set_progress(CTB_PROGRESS_SAO);
-  }
-
-
-  state = Finished;
-  img->thread_finishes(this);
-}
-
-
-bool add_sao_tasks(image_unit* imgunit, int saoInputProgress)
-{
-  de265_image* img = imgunit->img;
-  const seq_parameter_set& sps = img->get_sps();
-
-  if (sps.sample_adaptive_offset_enabled_flag==0) {
-    return false;
-  }
-
-
-  decoder_context* ctx = img->decctx;
-
-  de265_error err = imgunit->sao_output.alloc_image(img->get_width(), img->get_height(),
-                                                    img->get_chroma_format(),
-                                                    img->get_shared_sps(),
-                                                    false,
-                                                    img->decctx, //img->encctx,
-                                                    img->pts, img->user_data, true);
-  if (err != DE265_OK) {
-    img->decctx->add_warning(DE265_WARNING_CANNOT_APPLY_SAO_OUT_OF_MEMORY,false);
-    return false;
-  }
-
-  int nRows = sps.PicHeightInCtbsY;
-
-  int n=0;
-  img->thread_start(nRows);
-
-  for (int y=0;y<nRows;y++)
-    {
-      thread_task_sao* task = new thread_task_sao;
-
-      task->inputImg  = img;
-      task->outputImg = &imgunit->sao_output;
-      task->img = img;
-      task->ctb_y = y;
-      task->inputProgress = saoInputProgress;
-
-      imgunit->tasks.push_back(task);
-      add_task(&ctx->thread_pool_, task);
-      n++;
+    if (img->high_bit_depth(cIdx)) {
+      apply_sao_CTB_in_place_internal<uint16_t>(img, xCtb,yCtb, shdr, cIdx, enabled, nSW,nSH,
+                                                (uint16_t*)column->samples[cIdx]);
     }
-
-  /* Currently need barrier here because when are finished, we have to swap the pixel
-     data back into the main image. */
-  img->wait_for_completion();
-
-  img->exchange_pixel_data_with(imgunit->sao_output);
-
-  return true;
+    else {
+      apply_sao_CTB_in_place_internal<uint8_t>(img, xCtb,yCtb, shdr, cIdx, enabled, nSW,nSH,
+                                               column->samples[cIdx]);
+    }
+  }
 }
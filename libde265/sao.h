@@ -23,14 +23,23 @@
 
 #include "libde265/decctx.h"
 
-void apply_sample_adaptive_offset(de265_image* img);
+#define MAX_SAO_CTB_SIZE 64
 
-/* requires less memory than the function above */
-void apply_sample_adaptive_offset_sequential(de265_image* img);
+/* The right column of deblocked samples of the previous CTB in the same CTB row,
+   for each color component. High bit-depth samples are stored as uint16_t.
+ */
+struct sao_column_buffer
+{
+  uint8_t samples[3][MAX_SAO_CTB_SIZE*2];
+};
 
-/* saoInputProgress - the CTB progress that SAO will wait for before beginning processing.
-   Returns 'true' if any tasks have been added.
+/* Applies SAO to a deblocked CTB, writing the result back into the image.
+   The CTBs of a picture have to be processed in raster-scan order within a CTB row, and
+   the CTB row above has to be processed up to the CTB to the upper right. The CTBs to the
+   right and below (including the diagonal ones) must be deblocked, but not have SAO applied.
+   The deblocked samples on the CTB boundaries are kept in the picture's SAO line buffers and
+   in the 'column' buffer, which has to be passed to all CTBs of a row in sequence.
  */
-bool add_sao_tasks(image_unit* imgunit, int saoInputProgress);
+void apply_sao_CTB_in_place(de265_image* img, int xCtb,int yCtb, sao_column_buffer* column);
 
 #endif
@@ -2847,7 +2847,12 @@ void read_coding_tree_unit(thread_context* tctx)
            xCtbPixels,yCtbPixels, xCtb,yCtb,
            tctx->img->PicOrderCntVal, tctx->shdr->SliceAddrRS);
 
-  img->set_SliceAddrRS(xCtb, yCtb, tctx->shdr->SliceAddrRS);
+  // In task-based decoding, the slice addresses have already been set for the whole picture.
+  // Do not write them again, other slices may read them concurrently.
+
+  if (img->get_SliceAddrRS(xCtb, yCtb) != tctx->shdr->SliceAddrRS) {
+    img->set_SliceAddrRS(xCtb, yCtb, tctx->shdr->SliceAddrRS);
+  }
 
   img->set_SliceHeaderIndex(xCtbPixels,yCtbPixels, shdr->slice_index);
 
@@ -3421,11 +3426,55 @@ int residual_coding(thread_context* tctx,
 }
 
 
+static void record_TU(thread_context* tctx,
+                      int x0,int y0,
+                      int xCUBase,int yCUBase,
+                      int nT, int cIdx, enum PredMode cuPredMode, bool cbf)
+{
+  ctb_reconstruction_data* recon = tctx->ctb_recon;
+
+  ctb_reconstruction_data::op op;
+  op.type = ctb_reconstruction_data::TransformBlock;
+
+  ctb_reconstruction_data::transform_block& tb = op.tb;
+  tb.x0 = x0;
+  tb.y0 = y0;
+  tb.xCUBase = xCUBase;
+  tb.yCUBase = yCUBase;
+  tb.nT = nT;
+  tb.cIdx = cIdx;
+  tb.cuPredMode = cuPredMode;
+  tb.cbf = cbf;
+  tb.transform_skip_flag = tctx->transform_skip_flag[cIdx];
+  tb.cu_transquant_bypass_flag = tctx->cu_transquant_bypass_flag;
+  tb.explicit_rdpcm_flag = tctx->explicit_rdpcm_flag;
+  tb.explicit_rdpcm_dir  = tctx->explicit_rdpcm_dir;
+  tb.ResScaleVal = tctx->ResScaleVal;
+  tb.qPYPrime  = tctx->qPYPrime;
+  tb.qPCbPrime = tctx->qPCbPrime;
+  tb.qPCrPrime = tctx->qPCrPrime;
+
+  int nCoeff = (cbf ? tctx->nCoeff[cIdx] : 0);
+  tb.nCoeff = nCoeff;
+  tb.firstCoeff = recon->coeffs.size();
+
+  recon->coeffs.insert(recon->coeffs.end(), tctx->coeffList[cIdx], tctx->coeffList[cIdx]+nCoeff);
+  recon->coeffs.insert(recon->coeffs.end(), tctx->coeffPos[cIdx],  tctx->coeffPos[cIdx] +nCoeff);
+
+  recon->ops.push_back(op);
+}
+
+
 static void decode_TU(thread_context* tctx,
                       int x0,int y0,
                       int xCUBase,int yCUBase,
                       int nT, int cIdx, enum PredMode cuPredMode, bool cbf)
 {
+  if (tctx->ctb_recon) {
+    record_TU(tctx, x0,y0, xCUBase,yCUBase, nT, cIdx, cuPredMode, cbf);
+    return;
+  }
+
   de265_image* img = tctx->img;
   const seq_parameter_set& sps = img->get_sps();
 
@@ -4054,6 +4103,41 @@ void read_prediction_unit_SKIP(thread_context* tctx,
 }
 
 
+/* Derives the motion vectors and predicts the PB. When parsing and reconstruction are split,
+   the prediction is recorded instead.
+ */
+static void decode_prediction_block(thread_context* tctx,
+                                    int xC,int yC, int xB,int yB,
+                                    int nCS, int nPbW,int nPbH, int partIdx)
+{
+  if (tctx->ctb_recon == NULL) {
+    decode_prediction_unit(tctx->decctx, tctx->shdr, tctx->img, tctx->motion,
+                           xC,yC,xB,yB, nCS, nPbW,nPbH, partIdx);
+    return;
+  }
+
+  ctb_reconstruction_data::op op;
+  op.type = ctb_reconstruction_data::PredictionBlock;
+
+  ctb_reconstruction_data::prediction_block& pb = op.pb;
+  pb.shdr = tctx->shdr;
+  pb.xC = xC;
+  pb.yC = yC;
+  pb.xB = xB;
+  pb.yB = yB;
+  pb.nCS = nCS;
+  pb.nPbW = nPbW;
+  pb.nPbH = nPbH;
+
+  motion_vectors_and_ref_indices(tctx->decctx, tctx->shdr, tctx->img, tctx->motion,
+                                 xC,yC, xB,yB, nCS, nPbW,nPbH, partIdx, &pb.vi);
+
+  tctx->img->set_mv_info(xC+xB,yC+yB,nPbW,nPbH, pb.vi);
+
+  tctx->ctb_recon->ops.push_back(op);
+}
+
+
 /* xC/yC : CB position
    xB/yB : position offset of the PB
    nPbW/nPbH : size of PB
@@ -4133,18 +4217,17 @@ void read_prediction_unit(thread_context* tctx,
 
 
 
-  decode_prediction_unit(tctx->decctx, tctx->shdr, tctx->img, tctx->motion,
-                         xC,yC,xB,yB, nCS, nPbW,nPbH, partIdx);
+  decode_prediction_block(tctx, xC,yC,xB,yB, nCS, nPbW,nPbH, partIdx);
 }
 
 
 
 
 template <class pixel_t>
-void read_pcm_samples_internal(thread_context* tctx, int x0, int y0, int log2CbSize,
+void read_pcm_samples_internal(de265_image* img, int x0, int y0, int log2CbSize,
                                int cIdx, bitreader& br)
 {
-  const seq_parameter_set& sps = tctx->img->get_sps();
+  const seq_parameter_set& sps = img->get_sps();
 
   int nPcmBits;
   int bitDepth;
@@ -4169,8 +4252,8 @@ void read_pcm_samples_internal(thread_context* tctx, int x0, int y0, int log2CbS
 
   pixel_t* ptr;
   int stride;
-  ptr    = tctx->img->get_image_plane_at_pos_NEW<pixel_t>(cIdx,x0,y0);
-  stride = tctx->img->get_image_stride(cIdx);
+  ptr    = img->get_image_plane_at_pos_NEW<pixel_t>(cIdx,x0,y0);
+  stride = img->get_image_stride(cIdx);
 
   int shift = bitDepth - nPcmBits;
 
@@ -4182,6 +4265,25 @@ void read_pcm_samples_internal(thread_context* tctx, int x0, int y0, int log2CbS
       }
 }
 
+static void read_pcm_samples(de265_image* img, int x0, int y0, int log2CbSize, bitreader& br)
+{
+  if (img->high_bit_depth(0)) {
+    read_pcm_samples_internal<uint16_t>(img,x0,y0,log2CbSize,0,br);
+  } else {
+    read_pcm_samples_internal<uint8_t>(img,x0,y0,log2CbSize,0,br);
+  }
+
+  if (img->get_sps().ChromaArrayType != CHROMA_MONO) {
+    if (img->high_bit_depth(1)) {
+      read_pcm_samples_internal<uint16_t>(img,x0,y0,log2CbSize,1,br);
+      read_pcm_samples_internal<uint16_t>(img,x0,y0,log2CbSize,2,br);
+    } else {
+      read_pcm_samples_internal<uint8_t>(img,x0,y0,log2CbSize,1,br);
+      read_pcm_samples_internal<uint8_t>(img,x0,y0,log2CbSize,2,br);
+    }
+  }
+}
+
 static void read_pcm_samples(thread_context* tctx, int x0, int y0, int log2CbSize)
 {
   bitreader br;
@@ -4189,21 +4291,34 @@ static void read_pcm_samples(thread_context* tctx, int x0, int y0, int log2CbSiz
   br.bytes_remaining = tctx->cabac_decoder.bitstream_end - tctx->cabac_decoder.bitstream_curr;
   br.nextbits = 0;
   br.nextbits_cnt = 0;
+  br.skipped = tctx->cabac_decoder.skipped;
 
-
-  if (tctx->img->high_bit_depth(0)) {
-    read_pcm_samples_internal<uint16_t>(tctx,x0,y0,log2CbSize,0,br);
-  } else {
-    read_pcm_samples_internal<uint8_t>(tctx,x0,y0,log2CbSize,0,br);
+  if (tctx->ctb_recon == NULL) {
+    read_pcm_samples(tctx->img, x0,y0, log2CbSize, br);
   }
+  else {
+    // The samples are read during reconstruction. Only skip over them here.
 
-  if (tctx->img->get_sps().ChromaArrayType != CHROMA_MONO) {
-    if (tctx->img->high_bit_depth(1)) {
-      read_pcm_samples_internal<uint16_t>(tctx,x0,y0,log2CbSize,1,br);
-      read_pcm_samples_internal<uint16_t>(tctx,x0,y0,log2CbSize,2,br);
-    } else {
-      read_pcm_samples_internal<uint8_t>(tctx,x0,y0,log2CbSize,1,br);
-      read_pcm_samples_internal<uint8_t>(tctx,x0,y0,log2CbSize,2,br);
+    ctb_reconstruction_data::op op;
+    op.type = ctb_reconstruction_data::PCMSamples;
+    op.pcm.x0 = x0;
+    op.pcm.y0 = y0;
+    op.pcm.log2CbSize = log2CbSize;
+    op.pcm.data = br.data;
+    op.pcm.bytes_remaining = br.bytes_remaining;
+    op.pcm.skipped = br.skipped;
+    tctx->ctb_recon->ops.push_back(op);
+
+    const seq_parameter_set& sps = tctx->img->get_sps();
+
+    int nBits = (1<<(2*log2CbSize)) * sps.pcm_sample_bit_depth_luma;
+    if (sps.ChromaArrayType != CHROMA_MONO) {
+      nBits += 2 * ((1<<(2*log2CbSize)) / (sps.SubWidthC*sps.SubHeightC))
+        * sps.pcm_sample_bit_depth_chroma;
+    }
+
+    for ( ; nBits>0 ; nBits-=32) {
+      skip_bits(&br, libde265_min(nBits,32));
     }
   }
 
@@ -4306,8 +4421,7 @@ void read_coding_unit(thread_context* tctx,
     // DECODE
 
     int nCS_L = 1<<log2CbSize;
-    decode_prediction_unit(tctx->decctx,tctx->shdr,tctx->img,tctx->motion,
-                           x0,y0, 0,0, nCS_L, nCS_L,nCS_L, 0);
+    decode_prediction_block(tctx, x0,y0, 0,0, nCS_L, nCS_L,nCS_L, 0);
   }
   else /* not skipped */ {
     if (shdr->slice_type != SLICE_TYPE_I) {
@@ -4656,10 +4770,13 @@ void read_coding_quadtree(thread_context* tctx,
 enum DecodeResult {
   Decode_EndOfSliceSegment,
   Decode_EndOfSubstream,
-  Decode_Error
+  Decode_Error,
+  Decode_Deferred  // continuation task is waiting for a CTB and will be run again
 };
 
 /* Decode CTBs until the end of sub-stream, the end-of-slice, or some error occurs.
+   With 'block_wpp', decoding may also stop with Decode_Deferred before a CTB that has
+   to wait for the row above. Calling the function again continues at this CTB.
  */
 enum DecodeResult decode_substream(thread_context* tctx,
                                    bool block_wpp, // block on WPP dependencies
@@ -4689,14 +4806,27 @@ enum DecodeResult decode_substream(thread_context* tctx,
         //printf("CTX wait on %d/%d\n",1,tctx->CtbY-1);
 
         // we have to wait until the context model data is there
-        tctx->img->wait_for_progress(tctx->task, 1,tctx->CtbY-1,CTB_PROGRESS_PREFILTER);
+        if (!block_wpp) {
+          tctx->img->wait_for_progress(tctx->task, 1,tctx->CtbY-1,CTB_PROGRESS_PREFILTER);
+        }
+        else if (!tctx->img->wait_for_progress_or_defer(tctx->task, 1,tctx->CtbY-1,
+                                                        CTB_PROGRESS_PREFILTER)) {
+          return Decode_Deferred;
+        }
 
         // copy CABAC model from previous CTB row
         tctx->ctx_model = tctx->imgunit->ctx_models[(tctx->CtbY-1)];
         tctx->imgunit->ctx_models[(tctx->CtbY-1)].release(); // not used anymore
       }
       else {
-        tctx->img->wait_for_progress(tctx->task, 0,tctx->CtbY-1,CTB_PROGRESS_PREFILTER);
+        if (!block_wpp) {
+          tctx->img->wait_for_progress(tctx->task, 0,tctx->CtbY-1,CTB_PROGRESS_PREFILTER);
+        }
+        else if (!tctx->img->wait_for_progress_or_defer(tctx->task, 0,tctx->CtbY-1,
+                                                        CTB_PROGRESS_PREFILTER)) {
+          return Decode_Deferred;
+        }
+
         initialize_CABAC_models(tctx);
       }
     }
@@ -4721,7 +4851,9 @@ enum DecodeResult decode_substream(thread_context* tctx,
 
       //printf("wait on %d/%d (%d)\n",ctbx+1,ctby-1, ctbx+1+(ctby-1)*sps->PicWidthInCtbsY);
 
-      tctx->img->wait_for_progress(tctx->task, ctbx+1,ctby-1, CTB_PROGRESS_PREFILTER);
+      if (!tctx->img->wait_for_progress_or_defer(tctx->task, ctbx+1,ctby-1, CTB_PROGRESS_PREFILTER)) {
+        return Decode_Deferred;
+      }
     }
 
     //printf("%p: decode %d;%d\n", tctx, tctx->CtbX,tctx->CtbY);
@@ -4733,6 +4865,10 @@ enum DecodeResult decode_substream(thread_context* tctx,
       return Decode_Error;
     }
 
+    if (tctx->imgunit->split_reconstruction()) {
+      tctx->ctb_recon = &tctx->imgunit->ctb_reconstruction[ctbx+ctby*ctbW];
+    }
+
     read_coding_tree_unit(tctx);
 
 
@@ -4769,7 +4905,8 @@ enum DecodeResult decode_substream(thread_context* tctx,
       }
     }
 
-    tctx->img->ctb_progress[ctbx+ctby*ctbW].set_progress(CTB_PROGRESS_PREFILTER);
+    tctx->img->compress_CTB_motion(ctbx,ctby);
+    tctx->img->ctb_progress[ctbx+ctby*ctbW].set_progress(tctx->imgunit->decoded_CTB_progress());
 
     //printf("%p: decoded %d|%d\n",tctx, ctby,ctbx);
 
@@ -4838,6 +4975,25 @@ bool initialize_CABAC_at_slice_segment_start(thread_context* tctx)
   const seq_parameter_set& sps = img->get_sps();
   slice_segment_header* shdr = tctx->shdr;
 
+  // In task-based decoding, all slice segments of a picture are queued at once.
+  // Decode them in order and mark the CTBs up to this slice segment as processed,
+  // because the previous slice segment may not have decoded all of them (stream errors).
+  // Without WPP and tiles, independent slices do not depend on each other and are
+  // decoded in parallel. Their reconstruction is synchronized by the CTB progress.
+
+  bool parallelSlices = (!pps.entropy_coding_sync_enabled_flag && !pps.tiles_enabled_flag &&
+                         !shdr->dependent_slice_segment_flag);
+
+  if (tctx->decctx->task_based_decoding() && !parallelSlices) {
+    slice_unit* prevSliceSegment = tctx->imgunit->get_prev_slice_segment(tctx->sliceunit);
+    if (prevSliceSegment) {
+      prevSliceSegment->finished_threads.wait_for_progress(prevSliceSegment->nThreads);
+
+      tctx->decctx->mark_whole_slice_as_processed(tctx->imgunit, prevSliceSegment,
+                                                  tctx->imgunit->decoded_CTB_progress());
+    }
+  }
+
   if (shdr->dependent_slice_segment_flag) {
     int prevCtb = pps.CtbAddrTStoRS[ pps.CtbAddrRStoTS[shdr->slice_segment_address] -1 ];
 
@@ -4942,6 +5098,28 @@ void thread_task_slice_segment::work()
 }
 
 
+std::string thread_task_slice_segment_data::name() const {
+  char buf[100];
+  sprintf(buf,"slice-segment-data-%d",tctx->shdr->slice_segment_address);
+  return buf;
+}
+
+
+void thread_task_slice_segment_data::work()
+{
+  de265_image* img = tctx->img;
+
+  state = Running;
+  img->thread_run(this);
+
+  /*de265_error err =*/ read_slice_segment_data(tctx);
+
+  state = Finished;
+  tctx->sliceunit->finished_threads.increase_progress(1);
+  img->thread_finishes(this);
+}
+
+
 void thread_task_ctb_row::work()
 {
   thread_task_ctb_row* data = this;
@@ -4951,39 +5129,46 @@ void thread_task_ctb_row::work()
   const seq_parameter_set& sps = img->get_sps();
   int ctbW = sps.PicWidthInCtbsY;
 
-  state = Running;
-  img->thread_run(this);
+  bool resumed = img->thread_run_or_resume(this);
 
-  setCtbAddrFromTS(tctx);
+  if (!resumed) {
+    setCtbAddrFromTS(tctx);
+  }
+
+  // a deferred task always continues in the same row
 
   int ctby = tctx->CtbAddrInRS / ctbW;
   int myCtbRow = ctby;
 
   //printf("start CTB-row decoding at row %d\n", ctby);
 
-  if (data->firstSliceSubstream) {
-    bool success = initialize_CABAC_at_slice_segment_start(tctx);
-    if (!success) {
-      // could not decode this row, mark whole row as finished
-      for (int x=0;x<ctbW;x++) {
-        img->ctb_progress[myCtbRow*ctbW + x].set_progress(CTB_PROGRESS_PREFILTER);
-      }
+  if (!resumed) {
+    if (data->firstSliceSubstream) {
+      bool success = initialize_CABAC_at_slice_segment_start(tctx);
+      if (!success) {
+        // could not decode this row, mark whole row as finished
+        for (int x=0;x<ctbW;x++) {
+          img->ctb_progress[myCtbRow*ctbW + x].set_progress(CTB_PROGRESS_PREFILTER);
+        }
 
-      state = Finished;
-      tctx->sliceunit->finished_threads.increase_progress(1);
-      img->thread_finishes(this);
-      return;
+        state = Finished;
+        tctx->sliceunit->finished_threads.increase_progress(1);
+        img->thread_finishes(this);
+        return;
+      }
+      //initialize_CABAC(tctx);
     }
-    //initialize_CABAC(tctx);
-  }
 
-  init_CABAC_decoder_2(&tctx->cabac_decoder);
+    init_CABAC_decoder_2(&tctx->cabac_decoder);
+  }
 
   bool firstIndependentSubstream =
     data->firstSliceSubstream && !tctx->shdr->dependent_slice_segment_flag;
 
-  /*enum DecodeResult result =*/
-  decode_substream(tctx, true, firstIndependentSubstream);
+  enum DecodeResult result = decode_substream(tctx, true, firstIndependentSubstream);
+  if (result == Decode_Deferred) {
+    return; // we will be run again, do not touch any task data
+  }
 
   // mark progress on remaining CTBs in row (in case of decoder error and early termination)
 
@@ -5006,6 +5191,118 @@ void thread_task_ctb_row::work()
 }
 
 
+/* Replays the recorded reconstruction of a CTB. */
+static void reconstruct_CTB(thread_context* tctx, const ctb_reconstruction_data& recon)
+{
+  for (size_t i=0;i<recon.ops.size();i++) {
+    const ctb_reconstruction_data::op& op = recon.ops[i];
+
+    switch (op.type) {
+    case ctb_reconstruction_data::TransformBlock:
+      {
+        const ctb_reconstruction_data::transform_block& tb = op.tb;
+        const int cIdx = tb.cIdx;
+
+        tctx->transform_skip_flag[cIdx] = tb.transform_skip_flag;
+        tctx->cu_transquant_bypass_flag = tb.cu_transquant_bypass_flag;
+        tctx->explicit_rdpcm_flag = tb.explicit_rdpcm_flag;
+        tctx->explicit_rdpcm_dir  = tb.explicit_rdpcm_dir;
+        tctx->ResScaleVal = tb.ResScaleVal;
+        tctx->qPYPrime  = tb.qPYPrime;
+        tctx->qPCbPrime = tb.qPCbPrime;
+        tctx->qPCrPrime = tb.qPCrPrime;
+
+        tctx->nCoeff[cIdx] = tb.nCoeff;
+        if (tb.nCoeff) {
+          memcpy(tctx->coeffList[cIdx], &recon.coeffs[tb.firstCoeff], tb.nCoeff*sizeof(int16_t));
+          memcpy(tctx->coeffPos[cIdx],  &recon.coeffs[tb.firstCoeff+tb.nCoeff],
+                 tb.nCoeff*sizeof(int16_t));
+        }
+
+        decode_TU(tctx, tb.x0,tb.y0, tb.xCUBase,tb.yCUBase, tb.nT, cIdx,
+                  (enum PredMode)tb.cuPredMode, tb.cbf);
+      }
+      break;
+
+    case ctb_reconstruction_data::PredictionBlock:
+      {
+        const ctb_reconstruction_data::prediction_block& pb = op.pb;
+
+        generate_inter_prediction_samples(tctx->decctx, pb.shdr, tctx->img,
+                                          pb.xC,pb.yC, pb.xB,pb.yB, pb.nCS, pb.nPbW,pb.nPbH,
+                                          &pb.vi);
+      }
+      break;
+
+    case ctb_reconstruction_data::PCMSamples:
+      {
+        bitreader br;
+        br.data            = op.pcm.data;
+        br.bytes_remaining = op.pcm.bytes_remaining;
+        br.nextbits = 0;
+        br.nextbits_cnt = 0;
+        br.skipped = op.pcm.skipped;
+
+        read_pcm_samples(tctx->img, op.pcm.x0,op.pcm.y0, op.pcm.log2CbSize, br);
+      }
+      break;
+    }
+  }
+}
+
+
+thread_task_reconstruct_ctb_row::~thread_task_reconstruct_ctb_row()
+{
+  delete tctx;
+}
+
+
+std::string thread_task_reconstruct_ctb_row::name() const {
+  char buf[100];
+  sprintf(buf,"reconstruct-%d",ctb_y);
+  return buf;
+}
+
+
+void thread_task_reconstruct_ctb_row::work()
+{
+  de265_image* img = tctx->img;
+
+  img->thread_run_or_resume(this);
+
+  const seq_parameter_set& sps = img->get_sps();
+  const int ctbW = sps.PicWidthInCtbsY;
+
+  for ( ; ctb_x<ctbW; ctb_x++) {
+
+    // Intra prediction uses the samples up to the CTB to the upper right.
+
+    if (!img->wait_for_progress_or_defer(this, ctb_x,ctb_y, CTB_PROGRESS_PARSED)) {
+      return; // we will be run again
+    }
+
+    if (ctb_y>0 &&
+        !img->wait_for_progress_or_defer(this, libde265_min(ctb_x+1,ctbW-1),ctb_y-1,
+                                         CTB_PROGRESS_PREFILTER)) {
+      return;
+    }
+
+    reconstruct_CTB(tctx, tctx->imgunit->ctb_reconstruction[ctb_x+ctb_y*ctbW]);
+
+    // Without loop filters, the row is final now. Fill its border before marking it complete.
+
+    if (finalProgress == CTB_PROGRESS_COMPLETE && ctb_x==ctbW-1) {
+      img->extend_borders_CTB_row(ctb_y);
+    }
+
+    img->ctb_progress[ctb_x+ctb_y*ctbW].set_progress(finalProgress);
+  }
+
+  state = Finished;
+  img->thread_finishes(this);
+}
+
+
 de265_error read_slice_segment_data(thread_context* tctx)
 {
   setCtbAddrFromTS(tctx);
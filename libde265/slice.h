@@ -306,6 +306,32 @@ public:
   virtual std::string name() const;
 };
 
+// decodes all substreams of a slice segment one after another (used for frame-parallel decoding)
+class thread_task_slice_segment_data : public thread_task
+{
+public:
+  thread_context* tctx;
+
+  virtual void work();
+  virtual std::string name() const;
+};
+
+/* Reconstructs the samples of a CTB row from the data recorded by the parser
+   (split parsing and reconstruction). */
+class thread_task_reconstruct_ctb_row : public thread_task
+{
+public:
+  ~thread_task_reconstruct_ctb_row();
+
+  int    ctb_y;
+  int    ctb_x; // next CTB, we continue there when the task was deferred
+  int    finalProgress; // CTB progress after reconstruction
+  thread_context* tctx; // we are the owner
+
+  virtual void work();
+  virtual std::string name() const;
+};
+
 
 int check_CTB_available(const de265_image* img,
                         int xC,int yC, int xN,int yN);
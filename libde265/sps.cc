@@ -996,6 +996,42 @@ de265_error write_scaling_list(CABAC_encoder& out, const seq_parameter_set* sps,
 }
 
 
+const int levelScale[6] = { 40,45,51,57,64,72 };
+
+
+void fill_dequant_scale_table(int16_t* table, const scaling_list_data* sclist)
+{
+  for (int qPmod6=0;qPmod6<6;qPmod6++)
+    for (int log2nT=2;log2nT<=5;log2nT++)
+      for (int matrixId=0;matrixId<6;matrixId++) {
+        const int nT = 1<<log2nT;
+        int16_t* out = table + dequant_scale_table_offset(qPmod6, log2nT, matrixId);
+
+        for (int y=0;y<nT;y++)
+          for (int x=0;x<nT;x++) {
+            int m;
+            switch (log2nT) {
+            case 2: m = sclist->ScalingFactor_Size0[matrixId][y][x]; break;
+            case 3: m = sclist->ScalingFactor_Size1[matrixId][y][x]; break;
+            case 4: m = sclist->ScalingFactor_Size2[matrixId][y][x]; break;
+            default:
+              if (matrixId==0 || matrixId==3) {
+                m = sclist->ScalingFactor_Size3[matrixId/3][y][x];
+              }
+              else {
+                // 32x32 chroma (4:4:4 only): the 16x16 scaling list upsampled by 4 (7.4.5)
+                if ((x|y)<2 && (x|y)!=0) { m = sclist->ScalingFactor_Size2[matrixId][0][1]; }
+                else                     { m = sclist->ScalingFactor_Size2[matrixId][y/2][x/2]; }
+              }
+              break;
+            }
+
+            out[x+y*nT] = m * levelScale[qPmod6];
+          }
+      }
+}
+
+
 void set_default_scaling_lists(scaling_list_data* sclist)
 {
   // 4x4
@@ -254,4 +254,22 @@ de265_error write_scaling_list(CABAC_encoder& out, const seq_parameter_set* sps,
                                scaling_list_data* sclist, bool inPPS);
 void set_default_scaling_lists(scaling_list_data*);
 
+
+// (8.6.4.2) levelScale[qP%6]
+extern const int levelScale[6];
+
+/* Combined dequantization factors ScalingFactor * levelScale[qP%6]. For each
+   of the six values of qP%6, the table holds the 4x4, 8x8, 16x16 and 32x32
+   factors of the six matrices (matrixId = cIdx for intra, 3+cIdx for inter).
+ */
+#define DEQUANT_SCALE_TABLE_SIZE (6*6*(16+64+256+1024))
+
+void fill_dequant_scale_table(int16_t* table, const scaling_list_data*);
+
+inline int dequant_scale_table_offset(int qP, int log2nT, int matrixId)
+{
+  static const int sizeOffset[4] = { 0, 6*16, 6*(16+64), 6*(16+64+256) };
+  return (qP%6)*(DEQUANT_SCALE_TABLE_SIZE/6) + sizeOffset[log2nT-2] + (matrixId << (2*log2nT));
+}
+
 #endif
@@ -21,6 +21,16 @@
 #include "threads.h"
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
+
+#include <thread>
+#include <chrono>
+
+#ifdef DE265_USE_FUTEX
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 
 #if defined(_MSC_VER) || defined(__MINGW32__)
 # include <malloc.h>
@@ -32,9 +42,6 @@
 #ifndef _WIN32
 // #include <intrin.h>
 
-#define THREAD_RESULT       void*
-#define THREAD_PARAM        void*
-
 #include <stdio.h>
 
 int  de265_thread_create(de265_thread* t, void *(*start_routine) (void *), void *arg) { return pthread_create(t,NULL,start_routine,arg); }
@@ -51,9 +58,6 @@ void de265_cond_wait(de265_cond* c,de265_mutex* m) { pthread_cond_wait(c,m); }
 void de265_cond_signal(de265_cond* c) { pthread_cond_signal(c); }
 #else  // _WIN32
 
-#define THREAD_RESULT       DWORD WINAPI
-#define THREAD_PARAM        LPVOID
-
 int  de265_thread_create(de265_thread* t, LPTHREAD_START_ROUTINE start_routine, void *arg) {
     HANDLE handle = CreateThread(NULL, 0, start_routine, arg, 0, NULL);
     if (handle == NULL) {
@@ -81,61 +85,231 @@ void de265_cond_signal(de265_cond* c) { win32_cond_signal(c); }
 #endif // _WIN32
 
 
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define DE265_THREAD_LOCAL __declspec(thread)
+#else
+#define DE265_THREAD_LOCAL thread_local
+#endif
+
+
+
+
+// statistics over all progress locks
+static std::atomic<int64_t> progress_num_sleeps(0);
+static std::atomic<int64_t> progress_sleep_time_us(0);
+
+#define PROGRESS_SPIN_COUNT 100
+
+
+static inline void cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(_MSC_VER)
+  YieldProcessor();
+#endif
+}
+
+
+#ifdef DE265_USE_FUTEX
+static void futex_wait(std::atomic<int>* addr, int value)
+{
+  // returns immediately if '*addr' is not 'value' anymore
+  syscall(SYS_futex, (int*)addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void futex_wake_all(std::atomic<int>* addr)
+{
+  syscall(SYS_futex, (int*)addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+#endif
 
 
 de265_progress_lock::de265_progress_lock()
 {
   mProgress = 0;
+  mNumSleeping = 0;
 
+  mDeferredLock = false;
+  mNumDeferred = 0;
+
+#ifndef DE265_USE_FUTEX
   de265_mutex_init(&mutex);
   de265_cond_init(&cond);
+#endif
 }
 
 de265_progress_lock::~de265_progress_lock()
 {
+#ifndef DE265_USE_FUTEX
   de265_mutex_destroy(&mutex);
   de265_cond_destroy(&cond);
+#endif
 }
 
 void de265_progress_lock::wait_for_progress(int progress)
 {
-  if (mProgress >= progress) {
+  if (get_progress() >= progress) {
     return;
   }
 
+  for (int i=0;i<PROGRESS_SPIN_COUNT;i++) {
+    cpu_relax();
+
+    if (get_progress() >= progress) {
+      return;
+    }
+  }
+
+
+  // Go to sleep. We announce this before checking the progress again, and the
+  // progress is set before looking for sleeping threads, so no wake-up gets lost.
+
+  std::chrono::steady_clock::time_point sleepStart = std::chrono::steady_clock::now();
+
+#ifdef DE265_USE_FUTEX
+  mNumSleeping.fetch_add(1, std::memory_order_seq_cst);
+
+  for (;;) {
+    int current = mProgress.load(std::memory_order_seq_cst);
+    if (current >= progress) {
+      break;
+    }
+
+    futex_wait(&mProgress, current);
+  }
+
+  mNumSleeping.fetch_sub(1, std::memory_order_relaxed);
+#else
   de265_mutex_lock(&mutex);
-  while (mProgress < progress) {
+  mNumSleeping.fetch_add(1, std::memory_order_seq_cst);
+
+  while (mProgress.load(std::memory_order_seq_cst) < progress) {
     de265_cond_wait(&cond, &mutex);
   }
+
+  mNumSleeping.fetch_sub(1, std::memory_order_relaxed);
   de265_mutex_unlock(&mutex);
+#endif
+
+  std::chrono::steady_clock::duration sleepTime = std::chrono::steady_clock::now() - sleepStart;
+
+  progress_num_sleeps++;
+  progress_sleep_time_us += std::chrono::duration_cast<std::chrono::microseconds>(sleepTime).count();
 }
 
 void de265_progress_lock::set_progress(int progress)
 {
-  de265_mutex_lock(&mutex);
+  int current = mProgress.load(std::memory_order_relaxed);
+
+  do {
+    if (progress <= current) {
+      return;
+    }
+  } while (!mProgress.compare_exchange_weak(current, progress, std::memory_order_seq_cst));
+
+  progress_changed();
+}
+
+void de265_progress_lock::increase_progress(int progress)
+{
+  mProgress.fetch_add(progress, std::memory_order_seq_cst);
+
+  progress_changed();
+}
 
-  if (progress>mProgress) {
-    mProgress = progress;
+void de265_progress_lock::progress_changed()
+{
+  // wake up sleeping threads
 
+  if (mNumSleeping.load(std::memory_order_seq_cst) > 0) {
+#ifdef DE265_USE_FUTEX
+    futex_wake_all(&mProgress);
+#else
+    de265_mutex_lock(&mutex);
     de265_cond_broadcast(&cond, &mutex);
+    de265_mutex_unlock(&mutex);
+#endif
   }
 
-  de265_mutex_unlock(&mutex);
+
+  // queue the deferred tasks that can continue now
+
+  if (mNumDeferred.load(std::memory_order_seq_cst) > 0) {
+    std::vector<deferred_task> ready;
+
+    lock_deferred_tasks();
+
+    int progress = mProgress.load(std::memory_order_relaxed);
+
+    for (size_t i=0;i<deferred_tasks.size(); ) {
+      if (deferred_tasks[i].progress <= progress) {
+        ready.push_back(deferred_tasks[i]);
+
+        deferred_tasks[i] = deferred_tasks.back();
+        deferred_tasks.pop_back();
+        mNumDeferred--;
+      }
+      else {
+        i++;
+      }
+    }
+
+    unlock_deferred_tasks();
+
+    // The tasks may run immediately. Add them after releasing the lock.
+
+    for (size_t i=0;i<ready.size();i++) {
+      add_task(ready[i].pool, ready[i].task);
+    }
+  }
 }
 
-void de265_progress_lock::increase_progress(int progress)
+bool de265_progress_lock::defer_until_progress(int progress, thread_pool* pool, thread_task* task)
 {
-  de265_mutex_lock(&mutex);
+  deferred_task d;
+  d.progress = progress;
+  d.pool = pool;
+  d.task = task;
 
-  mProgress += progress;
-  de265_cond_broadcast(&cond, &mutex);
+  lock_deferred_tasks();
 
-  de265_mutex_unlock(&mutex);
+  deferred_tasks.push_back(d);
+  mNumDeferred.fetch_add(1, std::memory_order_seq_cst);
+
+  // If the progress was set before the task was announced, nobody will add the task.
+  // We still have the lock, so it is the last entry in the list.
+
+  if (mProgress.load(std::memory_order_seq_cst) >= progress) {
+    deferred_tasks.pop_back();
+    mNumDeferred--;
+
+    unlock_deferred_tasks();
+    return false;
+  }
+
+  unlock_deferred_tasks();
+  return true;
+}
+
+void de265_progress_lock::lock_deferred_tasks()
+{
+  while (mDeferredLock.exchange(true, std::memory_order_acquire)) {
+    cpu_relax();
+  }
+}
+
+
+void de265_get_progress_sleep_statistics(int64_t* nSleeps, int64_t* sleepTime_us)
+{
+  if (nSleeps)      { *nSleeps = progress_num_sleeps; }
+  if (sleepTime_us) { *sleepTime_us = progress_sleep_time_us; }
 }
 
-int  de265_progress_lock::get_progress() const
+void de265_reset_progress_sleep_statistics()
 {
-  return mProgress;
+  progress_num_sleeps = 0;
+  progress_sleep_time_us = 0;
 }
 
 
@@ -184,59 +358,299 @@ void printblks(const thread_pool* pool)
 #endif
 
 
-static THREAD_RESULT worker_thread(THREAD_PARAM pool_ptr)
+task_submission_queue::task_submission_queue()
 {
-  thread_pool* pool = (thread_pool*)pool_ptr;
+  slots = NULL;
+  mask = 0;
+}
 
 
-  de265_mutex_lock(&pool->mutex);
+task_submission_queue::~task_submission_queue()
+{
+  free();
+}
+
+
+void task_submission_queue::alloc(int log2size)
+{
+  free();
+
+  int size = 1<<log2size;
+
+  slots = new slot[size];
+  mask = size-1;
+
+  for (int i=0;i<size;i++) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+    slots[i].task = NULL;
+  }
+
+  push_pos.store(0, std::memory_order_relaxed);
+  pop_pos.store(0, std::memory_order_relaxed);
+}
+
 
-  while(true) {
+void task_submission_queue::free()
+{
+  delete[] slots;
+  slots = NULL;
+}
 
-    // wait until we can pick a task or until the pool has been stopped
 
-    for (;;) {
-      // end waiting if thread-pool has been stopped or we have a task to execute
+bool task_submission_queue::push(thread_task* task)
+{
+  slot* s;
+  uint32_t pos = push_pos.load(std::memory_order_relaxed);
+
+  for (;;) {
+    s = &slots[pos & mask];
+    uint32_t seq = s->sequence.load(std::memory_order_acquire);
+    int32_t  diff = (int32_t)(seq - pos);
 
-      if (pool->stopped || pool->tasks.size()>0) {
+    if (diff == 0) {
+      // slot is free in this round, try to claim it
+      if (push_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
         break;
       }
+    }
+    else if (diff < 0) {
+      return false; // slot still holds a task of the previous round -> queue is full
+    }
+    else {
+      pos = push_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  s->task = task;
+  s->sequence.store(pos+1, std::memory_order_release);
+
+  return true;
+}
+
+
+thread_task* task_submission_queue::pop()
+{
+  slot* s;
+  uint32_t pos = pop_pos.load(std::memory_order_relaxed);
 
-      //printf("going idle\n");
-      de265_cond_wait(&pool->cond_var, &pool->mutex);
+  for (;;) {
+    s = &slots[pos & mask];
+    uint32_t seq = s->sequence.load(std::memory_order_acquire);
+    int32_t  diff = (int32_t)(seq - (pos+1));
+
+    if (diff == 0) {
+      // slot has been written in this round, try to claim it
+      if (pop_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (diff < 0) {
+      return NULL; // empty
     }
+    else {
+      pos = pop_pos.load(std::memory_order_relaxed);
+    }
+  }
 
-    // if the pool was shut down, end the execution
+  thread_task* task = s->task;
+  s->sequence.store(pos+mask+1, std::memory_order_release);
 
-    if (pool->stopped) {
-      de265_mutex_unlock(&pool->mutex);
-      return NULL;
+  return task;
+}
+
+
+
+work_stealing_deque::work_stealing_deque()
+{
+  top.store(0, std::memory_order_relaxed);
+  bottom.store(0, std::memory_order_relaxed);
+}
+
+
+bool work_stealing_deque::push(thread_task* task)
+{
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_acquire);
+
+  if (b-t >= SIZE) {
+    return false;
+  }
+
+  tasks[b & (SIZE-1)].store(task, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom.store(b+1, std::memory_order_relaxed);
+
+  return true;
+}
+
+
+thread_task* work_stealing_deque::pop()
+{
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_relaxed);
+
+  if (t > b) {
+    // empty
+    bottom.store(b+1, std::memory_order_relaxed);
+    return NULL;
+  }
+
+  thread_task* task = tasks[b & (SIZE-1)].load(std::memory_order_relaxed);
+
+  if (t == b) {
+    // last task, race against thieves
+
+    if (!top.compare_exchange_strong(t, t+1,
+                                     std::memory_order_seq_cst,
+                                     std::memory_order_relaxed)) {
+      task = NULL;
     }
 
+    bottom.store(b+1, std::memory_order_relaxed);
+  }
 
-    // get a task
+  return task;
+}
 
-    thread_task* task = pool->tasks.front();
-    pool->tasks.pop_front();
 
-    pool->num_threads_working++;
+thread_task* work_stealing_deque::steal()
+{
+  int64_t t = top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t b = bottom.load(std::memory_order_acquire);
 
-    //printblks(pool);
+  if (t >= b) {
+    return NULL;
+  }
 
-    de265_mutex_unlock(&pool->mutex);
+  thread_task* task = tasks[t & (SIZE-1)].load(std::memory_order_relaxed);
+
+  if (!top.compare_exchange_strong(t, t+1,
+                                   std::memory_order_seq_cst,
+                                   std::memory_order_relaxed)) {
+    return NULL; // lost against another thief or the owner
+  }
+
+  return task;
+}
+
+
+
+// the worker that is running on this thread (NULL for threads outside of any pool)
+static DE265_THREAD_LOCAL thread_pool::worker_info* current_worker = NULL;
+
+
+#define WORKER_SPIN_COUNT 16
+
+static thread_task* get_next_task(thread_pool* pool, int me)
+{
+  // own tasks first, then tasks from the outside, then steal from the other workers
+
+  thread_task* task = pool->worker_deques[me].pop();
+  if (task) { return task; }
+
+  task = pool->queue.pop();
+  if (task) { return task; }
+
+  if (pool->num_overflow_tasks > 0) {
+    de265_mutex_lock(&pool->overflow_mutex);
+    if (!pool->overflow_tasks.empty()) {
+      task = pool->overflow_tasks.front();
+      pool->overflow_tasks.pop_front();
+      pool->num_overflow_tasks--;
+    }
+    de265_mutex_unlock(&pool->overflow_mutex);
+
+    if (task) { return task; }
+  }
+
+  for (int i=1;i<pool->num_worker_deques;i++) {
+    int victim = (me+i) % pool->num_worker_deques;
+
+    task = pool->worker_deques[victim].steal();
+    if (task) { return task; }
+  }
+
+  return NULL;
+}
+
+
+static THREAD_RESULT worker_thread(THREAD_PARAM worker_ptr)
+{
+  thread_pool::worker_info* worker = (thread_pool::worker_info*)worker_ptr;
+  thread_pool* pool = worker->pool;
+
+  current_worker = worker;
+
+  while (!pool->stopped) {
+
+    thread_task* task = get_next_task(pool, worker->index);
+
+    // Tasks often come in bursts. Look for new work a few more times before paying
+    // for sleeping and being woken up again.
+
+    for (int i=0; task==NULL && i<WORKER_SPIN_COUNT; i++) {
+      std::this_thread::yield();
+      task = get_next_task(pool, worker->index);
+    }
+
+    if (task==NULL) {
+      // Go to sleep until a new task is added or the pool is stopped.
+      // We check for tasks again after announcing that we are sleeping, so that
+      // add_task() cannot miss us.
+
+      de265_mutex_lock(&pool->mutex);
+
+      pool->num_threads_sleeping++;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      for (;;) {
+        task = get_next_task(pool, worker->index);
+        if (task || pool->stopped) {
+          pool->num_threads_sleeping--;
+          break;
+        }
+
+        //printf("going idle\n");
+        de265_cond_wait(&pool->cond_var, &pool->mutex);
+
+        if (pool->num_wakeups > 0) {
+          // add_task() has already removed us from the sleeping threads
+
+          pool->num_wakeups--;
+
+          task = get_next_task(pool, worker->index);
+          if (task) {
+            break;
+          }
+
+          pool->num_threads_sleeping++;
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+      }
+
+      de265_mutex_unlock(&pool->mutex);
+
+      if (task==NULL) {
+        break; // pool was stopped
+      }
+    }
 
 
     // execute the task
 
-    task->work();
+    pool->num_threads_working++;
 
-    // end processing and check if this was the last task to be processed
+    //printblks(pool);
 
-    de265_mutex_lock(&pool->mutex);
+    task->work();
 
     pool->num_threads_working--;
   }
-  de265_mutex_unlock(&pool->mutex);
+
+  current_worker = NULL;
 
   return NULL;
 }
@@ -258,15 +672,25 @@ de265_error start_thread_pool(thread_pool* pool, int num_threads)
   de265_mutex_init(&pool->mutex);
   de265_cond_init(&pool->cond_var);
 
-  de265_mutex_lock(&pool->mutex);
+  de265_mutex_init(&pool->overflow_mutex);
+
+  pool->queue.alloc(14);
+  pool->worker_deques = new work_stealing_deque[num_threads];
+  pool->num_worker_deques = num_threads;
+  pool->num_overflow_tasks = 0;
+
   pool->num_threads_working = 0;
+  pool->num_threads_sleeping = 0;
+  pool->num_wakeups = 0;
   pool->stopped = false;
-  de265_mutex_unlock(&pool->mutex);
 
   // start worker threads
 
   for (int i=0; i<num_threads; i++) {
-    int ret = de265_thread_create(&pool->thread[i], worker_thread, pool);
+    pool->workers[i].pool  = pool;
+    pool->workers[i].index = i;
+
+    int ret = de265_thread_create(&pool->thread[i], worker_thread, &pool->workers[i]);
     if (ret != 0) {
       // cerr << "pthread_create() failed: " << ret << endl;
       return DE265_ERROR_CANNOT_START_THREADPOOL;
@@ -292,6 +716,13 @@ void stop_thread_pool(thread_pool* pool)
     de265_thread_destroy(&pool->thread[i]);
   }
 
+  delete[] pool->worker_deques;
+  pool->worker_deques = NULL;
+  pool->queue.free();
+  pool->overflow_tasks.clear();
+
+  de265_mutex_destroy(&pool->overflow_mutex);
+
   de265_mutex_destroy(&pool->mutex);
   de265_cond_destroy(&pool->cond_var);
 }
@@ -299,14 +730,42 @@ void stop_thread_pool(thread_pool* pool)
 
 void   add_task(thread_pool* pool, thread_task* task)
 {
-  de265_mutex_lock(&pool->mutex);
-  if (!pool->stopped) {
+  if (pool->stopped) {
+    return;
+  }
 
-    pool->tasks.push_back(task);
+  // tasks added by our own workers go into their deque
 
-    // wake up one thread
+  bool added = false;
 
-    de265_cond_signal(&pool->cond_var);
+  if (current_worker && current_worker->pool == pool) {
+    added = pool->worker_deques[current_worker->index].push(task);
+  }
+
+  if (!added && pool->num_overflow_tasks == 0) {
+    added = pool->queue.push(task);
+  }
+
+  if (!added) {
+    de265_mutex_lock(&pool->overflow_mutex);
+    pool->overflow_tasks.push_back(task);
+    pool->num_overflow_tasks++;
+    de265_mutex_unlock(&pool->overflow_mutex);
+  }
+
+
+  // Wake up one sleeping thread. Threads that have already been woken up but are not
+  // running yet are not counted, so that we do not signal them again for each task.
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (pool->num_threads_sleeping > 0) {
+    de265_mutex_lock(&pool->mutex);
+    if (pool->num_threads_sleeping > 0) {
+      pool->num_threads_sleeping--;
+      pool->num_wakeups++;
+      de265_cond_signal(&pool->cond_var);
+    }
+    de265_mutex_unlock(&pool->mutex);
   }
-  de265_mutex_unlock(&pool->mutex);
 }
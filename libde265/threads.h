@@ -32,8 +32,10 @@
 #endif
 
 #include <deque>
+#include <vector>
 #include <string>
 #include <atomic>
+#include <stdint.h>
 
 #ifndef _WIN32
 #include <pthread.h>
@@ -42,6 +44,9 @@ typedef pthread_t        de265_thread;
 typedef pthread_mutex_t  de265_mutex;
 typedef pthread_cond_t   de265_cond;
 
+#define THREAD_RESULT       void*
+#define THREAD_PARAM        void*
+
 #else // _WIN32
 #if !defined(NOMINMAX)
 #define NOMINMAX 1
@@ -55,8 +60,16 @@ typedef pthread_cond_t   de265_cond;
 typedef HANDLE              de265_thread;
 typedef HANDLE              de265_mutex;
 typedef win32_cond_t        de265_cond;
+
+#define THREAD_RESULT       DWORD WINAPI
+#define THREAD_PARAM        LPVOID
 #endif  // _WIN32
 
+// Threads waiting for progress sleep on a futex. Elsewhere, we use a mutex and condvar.
+#if defined(__linux__)
+#define DE265_USE_FUTEX 1
+#endif
+
 #ifndef _WIN32
 int  de265_thread_create(de265_thread* t, void *(*start_routine) (void *), void *arg);
 #else
@@ -75,6 +88,14 @@ void de265_cond_wait(de265_cond* c,de265_mutex* m);
 void de265_cond_signal(de265_cond* c);
 
 
+class thread_task;
+class thread_pool;
+
+
+/* The progress is an atomic counter. Checking it does not lock anything, and setting it
+   only does more work when there are threads sleeping or tasks deferred on it.
+   Waiting threads spin for a short time before they go to sleep.
+ */
 class de265_progress_lock
 {
 public:
@@ -84,19 +105,46 @@ public:
   void wait_for_progress(int progress);
   void set_progress(int progress);
   void increase_progress(int progress);
-  int  get_progress() const;
-  void reset(int value=0) { mProgress=value; }
+  int  get_progress() const { return mProgress.load(std::memory_order_acquire); }
+  void reset(int value=0) { mProgress.store(value, std::memory_order_relaxed); }
 
-private:
-  int mProgress;
+  /* Instead of waiting, add 'task' to 'pool' as soon as 'progress' is reached.
+     Returns false (and does not add the task) if the progress has already been reached.
+   */
+  bool defer_until_progress(int progress, thread_pool* pool, thread_task* task);
 
-  // private data
+private:
+  std::atomic<int> mProgress;
+  std::atomic<int> mNumSleeping; // threads that are going to sleep in wait_for_progress()
 
+#ifndef DE265_USE_FUTEX
   de265_mutex mutex;
   de265_cond  cond;
+#endif
+
+  struct deferred_task {
+    int progress;
+    thread_pool* pool;
+    thread_task* task;
+  };
+
+  // protected by a spin-lock, tasks are rarely deferred on the same CTB at the same time
+  std::atomic<bool> mDeferredLock;
+  std::atomic<int>  mNumDeferred;
+  std::vector<deferred_task> deferred_tasks;
+
+  void progress_changed();
+  void lock_deferred_tasks();
+  void unlock_deferred_tasks() { mDeferredLock.store(false, std::memory_order_release); }
 };
 
 
+/* How often threads had to sleep in de265_progress_lock::wait_for_progress() because
+   spinning was not enough, and for how long in total. Counted over all progress locks. */
+LIBDE265_API void de265_get_progress_sleep_statistics(int64_t* nSleeps, int64_t* sleepTime_us);
+LIBDE265_API void de265_reset_progress_sleep_statistics();
+
+
 
 class thread_task
 {
@@ -114,28 +162,102 @@ public:
 
 #define MAX_THREADS 32
 
-/* TODO NOTE: When unblocking a task, we have to check first
-   if there are threads waiting because of the run-count limit.
-   If there are higher-priority tasks, those should be run instead
-   of the just unblocked task.
+
+/* Bounded FIFO for tasks that are added from outside of the thread pool.
+   Any thread may push and pop without locking. Each slot carries a sequence number
+   that tells whether it is ready to be written or read in the current round.
  */
+class task_submission_queue
+{
+ public:
+  task_submission_queue();
+  ~task_submission_queue();
+
+  void alloc(int log2size);
+  void free();
+
+  bool push(thread_task* task);  // returns false if the queue is full
+  thread_task* pop();            // returns NULL if the queue is empty
 
+ private:
+  struct slot {
+    std::atomic<uint32_t> sequence;
+    thread_task* task;
+  };
+
+  slot*    slots;
+  uint32_t mask;
+
+  std::atomic<uint32_t> push_pos;
+  std::atomic<uint32_t> pop_pos;
+};
+
+
+/* Work-stealing deque (Chase-Lev) of a single worker thread.
+   Only the owning thread pushes and pops at the bottom end, other workers steal
+   from the top end.
+ */
+class work_stealing_deque
+{
+ public:
+  work_stealing_deque();
+
+  bool push(thread_task* task);  // owner only, returns false if the deque is full
+  thread_task* pop();            // owner only
+  thread_task* steal();          // any thread
+
+ private:
+  enum { LOG2_SIZE = 8, SIZE = 1<<LOG2_SIZE };
+
+  std::atomic<int64_t> top;
+  std::atomic<int64_t> bottom;
+  std::atomic<thread_task*> tasks[SIZE];
+};
+
+
+/* Tasks added from outside of the pool go into a shared FIFO and are started in the
+   order in which they were added. A task may therefore block until a task that was
+   added before it has made progress.
+
+   Tasks added by a worker thread go into the worker's own deque. They are run before
+   older tasks and can be stolen by idle workers, so they must not block on tasks that
+   were added before them.
+
+   Tasks that are deferred with de265_progress_lock::defer_until_progress() are added
+   again by the thread that reaches the progress. They give up their thread instead of
+   blocking, so that the workers only run tasks that can make progress.
+ */
 class thread_pool
 {
  public:
-  bool stopped;
+  std::atomic<bool> stopped;
 
-  std::deque<thread_task*> tasks;  // we are not the owner
+  task_submission_queue queue;  // we are not the owner of the tasks
+  work_stealing_deque*  worker_deques;
+  int                   num_worker_deques; // fixed before the threads are started
+
+  // Tasks that did not fit into 'queue'. Once this is used, all new tasks are appended
+  // here until it is empty again, to keep the order.
+  std::deque<thread_task*> overflow_tasks;
+  std::atomic<int> num_overflow_tasks;
+  de265_mutex      overflow_mutex;
 
   de265_thread thread[MAX_THREADS];
   int num_threads;
 
-  int num_threads_working;
+  struct worker_info {
+    thread_pool* pool;
+    int index;  // into thread[] and worker_deques[]
+  } workers[MAX_THREADS];
+
+  std::atomic<int> num_threads_working;
+  std::atomic<int> num_threads_sleeping; // sleeping threads that have not been woken up yet
+  int              num_wakeups;          // wake-up calls that have not been taken yet
 
   int ctbx[MAX_THREADS]; // the CTB the thread is working on
   int ctby[MAX_THREADS];
 
-  de265_mutex  mutex;
+  de265_mutex  mutex;      // only used for sending idle threads to sleep and waking them up
   de265_cond   cond_var;
 };
 
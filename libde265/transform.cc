@@ -211,10 +211,11 @@ void decode_quantization_parameters(thread_context* tctx, int xC,int yC,
 
 
 
+// 'extent': all non-zero coefficients are in the top-left extent x extent corner
 template <class pixel_t>
 void transform_coefficients(acceleration_functions* acceleration,
                             int16_t* coeff, int coeffStride, int nT, int trType,
-                            pixel_t* dst, int dstStride, int bit_depth)
+                            pixel_t* dst, int dstStride, int bit_depth, int extent)
 {
   logtrace(LogTransform,"transform --- trType: %d nT: %d\n",trType,nT);
 
@@ -223,6 +224,10 @@ void transform_coefficients(acceleration_functions* acceleration,
 
     acceleration->transform_4x4_dst_add<pixel_t>(dst, coeff, dstStride, bit_depth);
 
+  } else if (extent < nT) {
+
+    acceleration->transform_add_sparse<pixel_t>(Log2(nT)-2, dst,coeff,dstStride, extent, bit_depth);
+
   } else {
 
     /**/ if (nT==4)  { acceleration->transform_add<pixel_t>(0,dst,coeff,dstStride, bit_depth); }
@@ -356,7 +361,6 @@ void fwd_transform(acceleration_functions* acceleration,
 
 
 
-static const int levelScale[] = { 40,45,51,57,64,72 };
 
 // (8.6.2) and (8.6.3)
 template <class pixel_t>
@@ -459,64 +463,21 @@ void scale_coefficients_internal(thread_context* tctx,
 
     // --- inverse quantization ---
 
-    if (sps.scaling_list_enable_flag==0) {
-
-      //const int m_x_y = 16;
-      const int m_x_y = 1;
-      bdShift -= 4;  // this is equivalent to having a m_x_y of 16 and we can use 32bit integers
-
-      const int offset = (1<<(bdShift-1));
-      const int fact = m_x_y * levelScale[qP%6] << (qP/6);
-
-      for (int i=0;i<tctx->nCoeff[cIdx];i++) {
-
-        // usually, this needs to be 64bit, but because we modify the shift above, we can use 16 bit
-        int32_t currCoeff  = tctx->coeffList[cIdx][i];
-
-        //logtrace(LogTransform,"coefficient[%d] = %d\n",tctx->coeffPos[cIdx][i],
-        //tctx->coeffList[cIdx][i]);
-
-        currCoeff = Clip3(-32768,32767,
-                          ( (currCoeff * fact + offset ) >> bdShift));
-
-        //logtrace(LogTransform," -> %d\n",currCoeff);
-
-        tctx->coeffBuf[ tctx->coeffPos[cIdx][i] ] = currCoeff;
-      }
+    // (the PPS has no scaling factors if it was parsed with an SPS without scaling lists)
+    if (sps.scaling_list_enable_flag==0 || pps.DequantScale.empty()) {
+      tctx->decctx->acceleration.dequant_flat(tctx->coeffBuf, tctx->coeffList[cIdx], tctx->coeffPos[cIdx],
+                                              tctx->nCoeff[cIdx], 16*levelScale[qP%6], qP/6, bdShift);
     }
     else {
-      const int offset = (1<<(bdShift-1));
-
-      const uint8_t* sclist;
       int matrixID = cIdx;
       if (!intra) {
-        if (nT<32) { matrixID += 3; }
-        else { matrixID++; }
+        matrixID += 3;
       }
 
-      switch (nT) {
-      case  4: sclist = &pps.scaling_list.ScalingFactor_Size0[matrixID][0][0]; break;
-      case  8: sclist = &pps.scaling_list.ScalingFactor_Size1[matrixID][0][0]; break;
-      case 16: sclist = &pps.scaling_list.ScalingFactor_Size2[matrixID][0][0]; break;
-      case 32: sclist = &pps.scaling_list.ScalingFactor_Size3[matrixID][0][0]; break;
-      default: assert(0);
-      }
-
-      for (int i=0;i<tctx->nCoeff[cIdx];i++) {
-        int pos = tctx->coeffPos[cIdx][i];
-        int x = pos%nT;
-        int y = pos/nT;
-
-        const int m_x_y = sclist[x+y*nT];
-        const int fact = m_x_y * levelScale[qP%6] << (qP/6);
+      const int16_t* m = pps.get_dequant_scale(qP, Log2(nT), matrixID);
 
-        int64_t currCoeff  = tctx->coeffList[cIdx][i];
-
-        currCoeff = Clip3(-32768,32767,
-                          ( (currCoeff * fact + offset ) >> bdShift));
-
-        tctx->coeffBuf[ tctx->coeffPos[cIdx][i] ] = currCoeff;
-      }
+      tctx->decctx->acceleration.dequant_scaled(tctx->coeffBuf, tctx->coeffList[cIdx], tctx->coeffPos[cIdx],
+                                                tctx->nCoeff[cIdx], m, qP/6, bdShift);
     }
 
 
@@ -608,8 +569,25 @@ void scale_coefficients_internal(thread_context* tctx,
                                         pred, stride, bit_depth, cIdx);
       }
       else {
+        // size of the top-left block containing all non-zero coefficients
+
+        int extent = nT;
+        if (trType==0) {
+          const int log2nT = Log2(nT);
+
+          int maxXY = 0;
+          for (int i=0;i<tctx->nCoeff[cIdx];i++) {
+            int pos = tctx->coeffPos[cIdx][i];
+            maxXY |= (pos & (nT-1)) | (pos >> log2nT);
+          }
+
+          if      (maxXY==0) { extent=1; }
+          else if (maxXY<4)  { extent=4; }
+          else if (maxXY<8)  { extent=8; }
+        }
+
         transform_coefficients(&tctx->decctx->acceleration, coeff, coeffStride, nT, trType,
-                               pred, stride, bit_depth);
+                               pred, stride, bit_depth, libde265_min(extent,nT));
       }
     }
   }
@@ -292,7 +292,10 @@ void draw_PB_block(const de265_image* srcimg,uint8_t* img,int stride,
     tint_rect(img,stride, x0,y0,w,h, cols[predMode], pixelSize);
   }
   else if (what == PBMotionVectors) {
-    const PBMotion& mvi = srcimg->get_mv_info(x0,y0);
+    // finished pictures only keep the compressed motion field
+    const PBMotion& mvi = (srcimg->has_mv_info() ?
+                           srcimg->get_mv_info(x0,y0) :
+                           srcimg->get_col_motion(x0,y0).motion);
     int x = x0+w/2;
     int y = y0+h/2;
     if (mvi.predFlag[0]) {
@@ -0,0 +1,206 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <immintrin.h>
+
+#include "x86/avx2-dct.h"
+#include "x86/sse-dct.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/* The same operations as in sse-dct.cc with eight 32 bit residuals per
+   register. The horizontal RDPCM prefix sum is computed within each 128 bit
+   lane first, then the sum of the lower lane is carried into the upper lane.
+ */
+
+
+static inline __m256i load_coeffs8(const int16_t* c)
+{
+  return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)c));
+}
+
+// transform skip scaling: ((c << tsShift) + rnd) >> bdShift
+static inline __m256i scale_ts_avx2(__m256i c, __m128i tsShift, __m256i rnd, __m128i bdShift)
+{
+  return _mm256_sra_epi32(_mm256_add_epi32(_mm256_sll_epi32(c, tsShift), rnd), bdShift);
+}
+
+// prefix sum over the eight 32 bit elements
+static inline __m256i prefix_sum8(__m256i v)
+{
+  v = _mm256_add_epi32(v, _mm256_slli_si256(v,4));
+  v = _mm256_add_epi32(v, _mm256_slli_si256(v,8));
+
+  __m256i carry = _mm256_shuffle_epi32(v, 0xFF);
+  return _mm256_add_epi32(v, _mm256_permute2x128_si256(carry,carry, 0x08));
+}
+
+static inline __m256i broadcast_last(__m256i v)
+{
+  return _mm256_permutevar8x32_epi32(v, _mm256_set1_epi32(7));
+}
+
+
+void ff_hevc_transform_skip_residual_avx2(int32_t *residual, const int16_t *coeffs, int nT,
+                                          int tsShift, int bdShift)
+{
+  const __m128i ts  = _mm_cvtsi32_si128(tsShift);
+  const __m128i bd  = _mm_cvtsi32_si128(bdShift);
+  const __m256i rnd = _mm256_set1_epi32(1<<(bdShift-1));
+
+  for (int i=0;i<nT*nT;i+=8) {
+    _mm256_storeu_si256((__m256i*)(residual+i), scale_ts_avx2(load_coeffs8(coeffs+i), ts,rnd,bd));
+  }
+}
+
+
+void ff_hevc_transform_bypass_avx2(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  for (int i=0;i<nT*nT;i+=8) {
+    _mm256_storeu_si256((__m256i*)(residual+i), load_coeffs8(coeffs+i));
+  }
+}
+
+
+void ff_hevc_transform_bypass_rdpcm_v_avx2(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  if (nT==4) {
+    ff_hevc_transform_bypass_rdpcm_v_sse4(residual,coeffs,nT);
+    return;
+  }
+
+  for (int x=0;x<nT;x+=8) {
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int y=0;y<nT;y++) {
+      sum = _mm256_add_epi32(sum, load_coeffs8(coeffs+x+y*nT));
+      _mm256_storeu_si256((__m256i*)(residual+x+y*nT), sum);
+    }
+  }
+}
+
+
+void ff_hevc_transform_bypass_rdpcm_h_avx2(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  if (nT==4) {
+    ff_hevc_transform_bypass_rdpcm_h_sse4(residual,coeffs,nT);
+    return;
+  }
+
+  for (int y=0;y<nT;y++) {
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int x=0;x<nT;x+=8) {
+      sum = _mm256_add_epi32(broadcast_last(sum), prefix_sum8(load_coeffs8(coeffs+x+y*nT)));
+      _mm256_storeu_si256((__m256i*)(residual+x+y*nT), sum);
+    }
+  }
+}
+
+
+void ff_hevc_rdpcm_v_avx2(int32_t* residual, const int16_t* coeffs, int nT, int tsShift, int bdShift)
+{
+  if (nT==4) {
+    ff_hevc_rdpcm_v_sse4(residual,coeffs,nT,tsShift,bdShift);
+    return;
+  }
+
+  const __m128i ts  = _mm_cvtsi32_si128(tsShift);
+  const __m128i bd  = _mm_cvtsi32_si128(bdShift);
+  const __m256i rnd = _mm256_set1_epi32(1<<(bdShift-1));
+
+  for (int x=0;x<nT;x+=8) {
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int y=0;y<nT;y++) {
+      sum = _mm256_add_epi32(sum, scale_ts_avx2(load_coeffs8(coeffs+x+y*nT), ts,rnd,bd));
+      _mm256_storeu_si256((__m256i*)(residual+x+y*nT), sum);
+    }
+  }
+}
+
+
+void ff_hevc_rdpcm_h_avx2(int32_t* residual, const int16_t* coeffs, int nT, int tsShift, int bdShift)
+{
+  if (nT==4) {
+    ff_hevc_rdpcm_h_sse4(residual,coeffs,nT,tsShift,bdShift);
+    return;
+  }
+
+  const __m128i ts  = _mm_cvtsi32_si128(tsShift);
+  const __m128i bd  = _mm_cvtsi32_si128(bdShift);
+  const __m256i rnd = _mm256_set1_epi32(1<<(bdShift-1));
+
+  for (int y=0;y<nT;y++) {
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int x=0;x<nT;x+=8) {
+      __m256i v = scale_ts_avx2(load_coeffs8(coeffs+x+y*nT), ts,rnd,bd);
+      sum = _mm256_add_epi32(broadcast_last(sum), prefix_sum8(v));
+      _mm256_storeu_si256((__m256i*)(residual+x+y*nT), sum);
+    }
+  }
+}
+
+
+void ff_hevc_add_residual_8_avx2(uint8_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth)
+{
+  if (nT<16) {
+    ff_hevc_add_residual_8_sse4(dst,stride,r,nT,bit_depth);
+    return;
+  }
+
+  for (int y=0;y<nT;y++)
+    for (int x=0;x<nT;x+=16) {
+      uint8_t* p = dst+y*stride+x;
+
+      // saturated to 16 bit, which does not change the clipped result
+      __m256i v = _mm256_packs_epi32(_mm256_loadu_si256((const __m256i*)(r+y*nT+x)),
+                                     _mm256_loadu_si256((const __m256i*)(r+y*nT+x+8)));
+      v = _mm256_permute4x64_epi64(v, 0xD8);
+      v = _mm256_adds_epi16(v, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p)));
+      v = _mm256_permute4x64_epi64(_mm256_packus_epi16(v,v), 0x08);
+      _mm_storeu_si128((__m128i*)p, _mm256_castsi256_si128(v));
+    }
+}
+
+
+void ff_hevc_add_residual_16_avx2(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth)
+{
+  if (nT<8) {
+    ff_hevc_add_residual_16_sse4(dst,stride,r,nT,bit_depth);
+    return;
+  }
+
+  const __m128i maxval = _mm_set1_epi16((short)((1<<bit_depth)-1));
+
+  for (int y=0;y<nT;y++)
+    for (int x=0;x<nT;x+=8) {
+      uint16_t* p = dst+y*stride+x;
+
+      __m256i v = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(r+y*nT+x)),
+                                   _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)));
+      v = _mm256_permute4x64_epi64(_mm256_packus_epi32(v,v), 0x08);
+      _mm_storeu_si128((__m128i*)p, _mm_min_epu16(_mm256_castsi256_si128(v), maxval));
+    }
+}
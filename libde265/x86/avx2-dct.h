@@ -0,0 +1,43 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AVX2_DCT_H
+#define AVX2_DCT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* Residuals without transform (transform skip, transquant bypass, RDPCM)
+   and adding the residual to the prediction, see fallback-dct.h for the
+   parameters. Blocks too small for 256 bit registers use the SSE4.1 code.
+ */
+
+void ff_hevc_transform_skip_residual_avx2(int32_t *residual, const int16_t *coeffs, int nT, int tsShift, int bdShift);
+void ff_hevc_transform_bypass_avx2(int32_t *residual, const int16_t *coeffs, int nT);
+void ff_hevc_transform_bypass_rdpcm_v_avx2(int32_t *residual, const int16_t *coeffs, int nT);
+void ff_hevc_transform_bypass_rdpcm_h_avx2(int32_t *residual, const int16_t *coeffs, int nT);
+void ff_hevc_rdpcm_v_avx2(int32_t* residual, const int16_t* coeffs, int nT, int tsShift, int bdShift);
+void ff_hevc_rdpcm_h_avx2(int32_t* residual, const int16_t* coeffs, int nT, int tsShift, int bdShift);
+
+void ff_hevc_add_residual_8_avx2(uint8_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth);
+void ff_hevc_add_residual_16_avx2(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth);
+
+#endif
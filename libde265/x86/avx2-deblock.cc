@@ -0,0 +1,502 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <immintrin.h>
+
+#include "x86/avx2-deblock.h"
+#include "fallback-deblock.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/* Same register layout as in sse-deblock.cc, but with two 4-line segments
+   processed at once, one in each 128 bit lane:
+
+     A[i] = [ p_i | q_i of segment 0 ][ p_i | q_i of segment 1 ]
+
+   For chroma, the lanes hold the Cb and the Cr segment. As the segments
+   may take different filter decisions, both the strong and the weak filter
+   are computed and the results are selected per lane.
+ */
+
+#define MAX_BIT_DEPTH 12
+
+
+static inline __m256i lanes(__m128i a, __m128i b)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1);
+}
+
+static inline __m256i lanes_epi16(int a, int b)
+{
+  return lanes(_mm_set1_epi16(a), _mm_set1_epi16(b));
+}
+
+// 4 samples each from p0 and p1, as [p0 | p1]
+static inline __m128i load4x2(const uint8_t* p0, const uint8_t* p1)
+{
+  int32_t v0,v1;
+  memcpy(&v0, p0, 4);
+  memcpy(&v1, p1, 4);
+  return _mm_cvtepu8_epi16(_mm_unpacklo_epi32(_mm_cvtsi32_si128(v0), _mm_cvtsi32_si128(v1)));
+}
+
+static inline __m128i load4x2(const uint16_t* p0, const uint16_t* p1)
+{
+  return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p0),
+                            _mm_loadl_epi64((const __m128i*)p1));
+}
+
+// 8 samples each from p0 and p1, as [p0][p1]
+static inline __m256i load8x2(const uint8_t* p0, const uint8_t* p1)
+{
+  return _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p0),
+                                                 _mm_loadl_epi64((const __m128i*)p1)));
+}
+
+static inline __m256i load8x2(const uint16_t* p0, const uint16_t* p1)
+{
+  return lanes(_mm_loadu_si128((const __m128i*)p0),
+               _mm_loadu_si128((const __m128i*)p1));
+}
+
+// store the low 4 samples of each lane
+static inline void store4x2(uint8_t* p0, uint8_t* p1, __m256i v)
+{
+  __m256i b = _mm256_packus_epi16(v,v);
+  int32_t d0 = _mm_cvtsi128_si32(_mm256_castsi256_si128(b));
+  int32_t d1 = _mm_cvtsi128_si32(_mm256_extracti128_si256(b,1));
+  memcpy(p0, &d0, 4);
+  memcpy(p1, &d1, 4);
+}
+
+static inline void store4x2(uint16_t* p0, uint16_t* p1, __m256i v)
+{
+  _mm_storel_epi64((__m128i*)p0, _mm256_castsi256_si128(v));
+  _mm_storel_epi64((__m128i*)p1, _mm256_extracti128_si256(v,1));
+}
+
+// store the 8 samples of each lane
+static inline void store8x2(uint8_t* p0, uint8_t* p1, __m256i v)
+{
+  __m256i b = _mm256_packus_epi16(v,v);
+  _mm_storel_epi64((__m128i*)p0, _mm256_castsi256_si128(b));
+  _mm_storel_epi64((__m128i*)p1, _mm256_extracti128_si256(b,1));
+}
+
+static inline void store8x2(uint16_t* p0, uint16_t* p1, __m256i v)
+{
+  _mm_storeu_si128((__m128i*)p0, _mm256_castsi256_si128(v));
+  _mm_storeu_si128((__m128i*)p1, _mm256_extracti128_si256(v,1));
+}
+
+static inline __m256i swap_halves(__m256i v)
+{
+  return _mm256_shuffle_epi32(v, 0x4E);
+}
+
+static inline __m256i clamp(__m256i v, __m256i lo, __m256i hi)
+{
+  return _mm256_min_epi16(_mm256_max_epi16(v, lo), hi);
+}
+
+// mask for the p half and the q half of each lane
+static inline __m256i side_mask(bool p0, bool q0, bool p1, bool q1)
+{
+  return lanes(_mm_unpacklo_epi64(_mm_set1_epi16(p0 ? -1 : 0), _mm_set1_epi16(q0 ? -1 : 0)),
+               _mm_unpacklo_epi64(_mm_set1_epi16(p1 ? -1 : 0), _mm_set1_epi16(q1 ? -1 : 0)));
+}
+
+
+// --- luma ---
+
+// Loads 4 rows of each segment across a vertical edge and transposes them.
+template <class pixel_t>
+static inline void load_luma_v(const pixel_t* ptr, ptrdiff_t stride, __m256i* A)
+{
+  __m256i r[4];
+  for (int k=0;k<4;k++) {
+    r[k] = load8x2(ptr-4+k*stride, ptr-4+(k+4)*stride);
+  }
+
+  __m256i t0 = _mm256_unpacklo_epi16(r[0],r[1]);
+  __m256i t1 = _mm256_unpackhi_epi16(r[0],r[1]);
+  __m256i t2 = _mm256_unpacklo_epi16(r[2],r[3]);
+  __m256i t3 = _mm256_unpackhi_epi16(r[2],r[3]);
+
+  __m256i c01 = _mm256_unpacklo_epi32(t0,t2);  // columns p3 | p2
+  __m256i c23 = _mm256_unpackhi_epi32(t0,t2);  // columns p1 | p0
+  __m256i c45 = _mm256_unpacklo_epi32(t1,t3);  // columns q0 | q1
+  __m256i c67 = _mm256_unpackhi_epi32(t1,t3);  // columns q2 | q3
+
+  A[0] = _mm256_alignr_epi8(c45,c23,8);
+  A[1] = _mm256_blend_epi16(c23,c45,0xF0);
+  A[2] = _mm256_alignr_epi8(c67,c01,8);
+  A[3] = _mm256_blend_epi16(c01,c67,0xF0);
+}
+
+template <class pixel_t>
+static inline void store_luma_v(pixel_t* ptr, ptrdiff_t stride, const __m256i* A)
+{
+  __m256i c01 = _mm256_unpacklo_epi64(A[3],A[2]);
+  __m256i c23 = _mm256_unpacklo_epi64(A[1],A[0]);
+  __m256i c45 = _mm256_unpackhi_epi64(A[0],A[1]);
+  __m256i c67 = _mm256_unpackhi_epi64(A[2],A[3]);
+
+  __m256i v0 = _mm256_unpacklo_epi16(c01,c23);
+  __m256i v1 = _mm256_unpackhi_epi16(c01,c23);
+  __m256i v2 = _mm256_unpacklo_epi16(c45,c67);
+  __m256i v3 = _mm256_unpackhi_epi16(c45,c67);
+
+  __m256i l01 = _mm256_unpacklo_epi16(v0,v1);
+  __m256i l23 = _mm256_unpackhi_epi16(v0,v1);
+  __m256i r01 = _mm256_unpacklo_epi16(v2,v3);
+  __m256i r23 = _mm256_unpackhi_epi16(v2,v3);
+
+  store8x2(ptr-4,          ptr-4+4*stride, _mm256_unpacklo_epi64(l01,r01));
+  store8x2(ptr-4+stride,   ptr-4+5*stride, _mm256_unpackhi_epi64(l01,r01));
+  store8x2(ptr-4+2*stride, ptr-4+6*stride, _mm256_unpacklo_epi64(l23,r23));
+  store8x2(ptr-4+3*stride, ptr-4+7*stride, _mm256_unpackhi_epi64(l23,r23));
+}
+
+// Along a horizontal edge, the two segments are adjacent in each row.
+template <class pixel_t>
+static inline void load_luma_h(const pixel_t* ptr, ptrdiff_t stride, __m256i* A)
+{
+  for (int i=0;i<4;i++) {
+    __m256i pq = load8x2(ptr-(i+1)*stride, ptr+i*stride);
+    A[i] = _mm256_permute4x64_epi64(pq, 0xD8);
+  }
+}
+
+template <class pixel_t>
+static inline void store_luma_h(pixel_t* ptr, ptrdiff_t stride, const __m256i* A)
+{
+  for (int i=0;i<3;i++) {
+    __m256i pq = _mm256_permute4x64_epi64(A[i], 0xD8);
+    store8x2(ptr-(i+1)*stride, ptr+i*stride, pq);
+  }
+}
+
+
+struct luma_decision
+{
+  bool on;
+  bool strong;
+  bool dEp, dEq;
+};
+
+// 8.7.2.5.3, for the segment in lane 's'
+
+static inline luma_decision luma_decisions(const int16_t* E, const int16_t* F, const int16_t* G,
+                                           int s, int beta, int tc)
+{
+  luma_decision dec = { false,false,false,false };
+
+  if (tc==0) {
+    return dec;
+  }
+
+  E += 8*s;
+  F += 8*s;
+  G += 8*s;
+
+  int dpq0 = E[0] + E[4];
+  int dpq3 = E[3] + E[7];
+
+  if (dpq0 + dpq3 >= beta) {
+    return dec;
+  }
+
+  bool dSam0 = (2*dpq0 < (beta>>2) &&
+                F[0] + F[4] < (beta>>3) &&
+                G[0] < ((5*tc+1)>>1));
+
+  bool dSam3 = (2*dpq3 < (beta>>2) &&
+                F[3] + F[7] < (beta>>3) &&
+                G[3] < ((5*tc+1)>>1));
+
+  dec.on     = true;
+  dec.strong = dSam0 && dSam3;
+  dec.dEp    = (E[0] + E[3] < ((beta + (beta>>1))>>3));
+  dec.dEq    = (E[4] + E[7] < ((beta + (beta>>1))>>3));
+
+  return dec;
+}
+
+
+template <class pixel_t>
+static inline void luma_edge(pixel_t* ptr, ptrdiff_t stride, bool vertical,
+                             const int* beta, const int* tc,
+                             const bool* filterP, const bool* filterQ, int bit_depth)
+{
+  if (tc[0]==0 && tc[1]==0) {
+    return;
+  }
+
+  __m256i A[4];
+  if (vertical) load_luma_v(ptr,stride,A);
+  else          load_luma_h(ptr,stride,A);
+
+  __m256i B0 = swap_halves(A[0]);
+  __m256i B1 = swap_halves(A[1]);
+
+
+  // --- decisions ---
+
+  int16_t E[16],F[16],G[16];
+  _mm256_storeu_si256((__m256i*)E, _mm256_abs_epi16(_mm256_sub_epi16(_mm256_add_epi16(A[2],A[0]),
+                                                                     _mm256_add_epi16(A[1],A[1]))));
+  _mm256_storeu_si256((__m256i*)F, _mm256_abs_epi16(_mm256_sub_epi16(A[3],A[0])));
+  _mm256_storeu_si256((__m256i*)G, _mm256_abs_epi16(_mm256_sub_epi16(A[0],B0)));
+
+  luma_decision d0 = luma_decisions(E,F,G, 0, beta[0],tc[0]);
+  luma_decision d1 = luma_decisions(E,F,G, 1, beta[1],tc[1]);
+
+  if (!d0.on && !d1.on) {
+    return;
+  }
+
+  const __m256i side = side_mask(d0.on && filterP[0], d0.on && filterQ[0],
+                                 d1.on && filterP[1], d1.on && filterQ[1]);
+  const __m256i strong = lanes_epi16(d0.strong ? -1 : 0, d1.strong ? -1 : 0);
+  const __m256i sideS  = _mm256_and_si256(side, strong);
+  const __m256i sideW  = _mm256_andnot_si256(strong, side);
+  const __m256i sideE  = _mm256_and_si256(sideW, side_mask(d0.dEp,d0.dEq, d1.dEp,d1.dEq));
+
+  const __m256i zero   = _mm256_setzero_si256();
+  const __m256i maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+  const __m256i tcv    = lanes_epi16(tc[0], tc[1]);
+
+
+  // --- strong filter ---
+
+  const __m256i tc2 = _mm256_add_epi16(tcv,tcv);
+  __m256i s = _mm256_add_epi16(A[0],B0);  // p0+q0
+
+  // (p2 + 2*p1 + 2*p0 + 2*q0 + q1 + 4) >> 3
+  __m256i n0 = _mm256_add_epi16(_mm256_add_epi16(A[2],B1),
+                                _mm256_slli_epi16(_mm256_add_epi16(A[1],s),1));
+  n0 = _mm256_srli_epi16(_mm256_add_epi16(n0, _mm256_set1_epi16(4)), 3);
+
+  // (p2 + p1 + p0 + q0 + 2) >> 2
+  __m256i n1 = _mm256_add_epi16(_mm256_add_epi16(A[2],A[1]), s);
+  n1 = _mm256_srli_epi16(_mm256_add_epi16(n1, _mm256_set1_epi16(2)), 2);
+
+  // (2*p3 + 3*p2 + p1 + p0 + q0 + 4) >> 3
+  __m256i n2 = _mm256_add_epi16(_mm256_slli_epi16(_mm256_add_epi16(A[3],A[2]),1),
+                                _mm256_add_epi16(_mm256_add_epi16(A[2],A[1]), s));
+  n2 = _mm256_srli_epi16(_mm256_add_epi16(n2, _mm256_set1_epi16(4)), 3);
+
+  n0 = clamp(n0, _mm256_sub_epi16(A[0],tc2), _mm256_add_epi16(A[0],tc2));
+  n1 = clamp(n1, _mm256_sub_epi16(A[1],tc2), _mm256_add_epi16(A[1],tc2));
+  n2 = clamp(n2, _mm256_sub_epi16(A[2],tc2), _mm256_add_epi16(A[2],tc2));
+
+
+  // --- weak filter ---
+
+  const __m256i tch = _mm256_srai_epi16(tcv,1);
+
+  // delta = (9*(q0-p0) - 3*(q1-p1) + 8) >> 4, computed in 32 bit in the p half
+  __m256i d = _mm256_madd_epi16(_mm256_unpacklo_epi16(_mm256_sub_epi16(B0,A[0]),
+                                                      _mm256_sub_epi16(B1,A[1])),
+                                _mm256_set1_epi32(9 | (-3 * 65536)));
+  d = _mm256_srai_epi32(_mm256_add_epi32(d, _mm256_set1_epi32(8)), 4);
+  d = _mm256_packs_epi32(d,d);
+
+  __m256i on = _mm256_cmpgt_epi16(_mm256_mullo_epi16(tcv, _mm256_set1_epi16(10)),
+                                  _mm256_abs_epi16(d));
+
+  // [ delta | -delta ]
+  d = clamp(d, _mm256_sub_epi16(zero,tcv), tcv);
+  d = _mm256_sign_epi16(d, _mm256_setr_epi16(1,1,1,1,-1,-1,-1,-1, 1,1,1,1,-1,-1,-1,-1));
+
+  __m256i w0 = clamp(_mm256_add_epi16(A[0],d), zero, maxval);
+
+  // (((p2+p0+1)>>1) - p1 + delta) >> 1
+  __m256i d1v = _mm256_sub_epi16(_mm256_avg_epu16(A[2],A[0]), A[1]);
+  d1v = _mm256_srai_epi16(_mm256_add_epi16(d1v,d), 1);
+  d1v = clamp(d1v, _mm256_sub_epi16(zero,tch), tch);
+
+  __m256i w1 = clamp(_mm256_add_epi16(A[1],d1v), zero, maxval);
+
+
+  // --- select results ---
+
+  A[0] = _mm256_blendv_epi8(A[0], n0, sideS);
+  A[1] = _mm256_blendv_epi8(A[1], n1, sideS);
+  A[2] = _mm256_blendv_epi8(A[2], n2, sideS);
+
+  A[0] = _mm256_blendv_epi8(A[0], w0, _mm256_and_si256(sideW, on));
+  A[1] = _mm256_blendv_epi8(A[1], w1, _mm256_and_si256(sideE, on));
+
+  if (vertical) store_luma_v(ptr,stride,A);
+  else          store_luma_h(ptr,stride,A);
+}
+
+
+// --- chroma ---
+
+template <class pixel_t>
+static inline void chroma_edge(pixel_t* cb, pixel_t* cr, ptrdiff_t stride, bool vertical,
+                               const int* tc, bool filterP, bool filterQ, int bit_depth)
+{
+  if (tc[0]==0 && tc[1]==0) {
+    return;
+  }
+
+  __m256i A0,A1;
+
+  if (vertical) {
+    __m256i r01 = lanes(load4x2(cb-2,          cb-2+stride),
+                        load4x2(cr-2,          cr-2+stride));
+    __m256i r23 = lanes(load4x2(cb-2+2*stride, cb-2+3*stride),
+                        load4x2(cr-2+2*stride, cr-2+3*stride));
+
+    __m256i t0 = _mm256_unpacklo_epi16(r01,r23);
+    __m256i t1 = _mm256_unpackhi_epi16(r01,r23);
+
+    __m256i c01 = _mm256_unpacklo_epi16(t0,t1);  // columns p1 | p0
+    __m256i c23 = _mm256_unpackhi_epi16(t0,t1);  // columns q0 | q1
+
+    A0 = _mm256_alignr_epi8(c23,c01,8);
+    A1 = _mm256_blend_epi16(c01,c23,0xF0);
+  }
+  else {
+    A0 = lanes(load4x2(cb-stride,   cb),        load4x2(cr-stride,   cr));
+    A1 = lanes(load4x2(cb-2*stride, cb+stride), load4x2(cr-2*stride, cr+stride));
+  }
+
+  // 8.7.2.5.5
+
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i tcv  = lanes_epi16(tc[0], tc[1]);
+
+  // delta = (((q0-p0)<<2) + p1 - q1 + 4) >> 3, in the p half
+  __m256i d = _mm256_add_epi16(_mm256_slli_epi16(_mm256_sub_epi16(swap_halves(A0),A0),2),
+                               _mm256_sub_epi16(A1,swap_halves(A1)));
+  d = _mm256_srai_epi16(_mm256_add_epi16(d, _mm256_set1_epi16(4)), 3);
+  d = _mm256_unpacklo_epi64(d,d);
+
+  d = clamp(d, _mm256_sub_epi16(zero,tcv), tcv);
+  d = _mm256_sign_epi16(d, _mm256_setr_epi16(1,1,1,1,-1,-1,-1,-1, 1,1,1,1,-1,-1,-1,-1));
+
+  __m256i n0 = clamp(_mm256_add_epi16(A0,d), zero, _mm256_set1_epi16((1<<bit_depth)-1));
+  A0 = _mm256_blendv_epi8(A0, n0, side_mask(filterP,filterQ, filterP,filterQ));
+
+  if (vertical) {
+    __m256i c01 = _mm256_unpacklo_epi64(A1,A0);
+    __m256i c23 = _mm256_unpackhi_epi64(A0,A1);
+
+    __m256i t0 = _mm256_unpacklo_epi16(c01,c23);
+    __m256i t1 = _mm256_unpackhi_epi16(c01,c23);
+
+    __m256i r01 = _mm256_unpacklo_epi16(t0,t1);
+    __m256i r23 = _mm256_unpackhi_epi16(t0,t1);
+
+    store4x2(cb-2,          cr-2,          r01);
+    store4x2(cb-2+stride,   cr-2+stride,   _mm256_unpackhi_epi64(r01,r01));
+    store4x2(cb-2+2*stride, cr-2+2*stride, r23);
+    store4x2(cb-2+3*stride, cr-2+3*stride, _mm256_unpackhi_epi64(r23,r23));
+  }
+  else {
+    store4x2(cb-stride, cr-stride, A0);
+    store4x2(cb,        cr,        _mm256_unpackhi_epi64(A0,A0));
+  }
+}
+
+
+// --- exported functions ---
+
+void ff_hevc_deblock_luma_v_8_avx2(uint8_t *ptr, ptrdiff_t stride,
+                                   const int* beta, const int* tc,
+                                   const bool* filterP, const bool* filterQ)
+{
+  luma_edge(ptr, stride, true, beta,tc, filterP,filterQ, 8);
+}
+
+void ff_hevc_deblock_luma_h_8_avx2(uint8_t *ptr, ptrdiff_t stride,
+                                   const int* beta, const int* tc,
+                                   const bool* filterP, const bool* filterQ)
+{
+  luma_edge(ptr, stride, false, beta,tc, filterP,filterQ, 8);
+}
+
+void ff_hevc_deblock_chroma_v_8_avx2(uint8_t *cb, uint8_t *cr, ptrdiff_t stride,
+                                     const int* tc, bool filterP, bool filterQ)
+{
+  chroma_edge(cb,cr, stride, true, tc, filterP,filterQ, 8);
+}
+
+void ff_hevc_deblock_chroma_h_8_avx2(uint8_t *cb, uint8_t *cr, ptrdiff_t stride,
+                                     const int* tc, bool filterP, bool filterQ)
+{
+  chroma_edge(cb,cr, stride, false, tc, filterP,filterQ, 8);
+}
+
+
+void ff_hevc_deblock_luma_v_16_avx2(uint16_t *ptr, ptrdiff_t stride,
+                                    const int* beta, const int* tc,
+                                    const bool* filterP, const bool* filterQ, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    deblock_luma_v_16_fallback(ptr,stride, beta,tc, filterP,filterQ, bit_depth);
+    return;
+  }
+
+  luma_edge(ptr, stride, true, beta,tc, filterP,filterQ, bit_depth);
+}
+
+void ff_hevc_deblock_luma_h_16_avx2(uint16_t *ptr, ptrdiff_t stride,
+                                    const int* beta, const int* tc,
+                                    const bool* filterP, const bool* filterQ, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    deblock_luma_h_16_fallback(ptr,stride, beta,tc, filterP,filterQ, bit_depth);
+    return;
+  }
+
+  luma_edge(ptr, stride, false, beta,tc, filterP,filterQ, bit_depth);
+}
+
+void ff_hevc_deblock_chroma_v_16_avx2(uint16_t *cb, uint16_t *cr, ptrdiff_t stride,
+                                      const int* tc, bool filterP, bool filterQ, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    deblock_chroma_v_16_fallback(cb,cr,stride, tc, filterP,filterQ, bit_depth);
+    return;
+  }
+
+  chroma_edge(cb,cr, stride, true, tc, filterP,filterQ, bit_depth);
+}
+
+void ff_hevc_deblock_chroma_h_16_avx2(uint16_t *cb, uint16_t *cr, ptrdiff_t stride,
+                                      const int* tc, bool filterP, bool filterQ, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    deblock_chroma_h_16_fallback(cb,cr,stride, tc, filterP,filterQ, bit_depth);
+    return;
+  }
+
+  chroma_edge(cb,cr, stride, false, tc, filterP,filterQ, bit_depth);
+}
@@ -0,0 +1,1138 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <immintrin.h>
+
+#include "x86/avx2-motion.h"
+#include "fallback-motion.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/* The AVX2 kernels compute exactly the same values as the scalar
+   fallback (fallback-motion.cc). Each row is processed in groups of 16
+   samples in 256-bit registers, the remaining columns with 128-bit
+   registers. Only 'width' samples are written per row.
+
+   High bit depths are supported up to 12 bits, where the pixels and all
+   intermediate values of the separable filters fit into 16 bits.
+ */
+
+#define MAX_PB_SIZE 64  // row stride of the intermediate buffer (mcbuffer)
+#define MAX_BIT_DEPTH 12
+
+
+// Luma filters, applied to 8 samples starting 'qpel_offset' samples before
+// the current position. The 1/4 and 3/4 filters only have 7 taps.
+
+static const int8_t qpel_filters[3][8] = {
+  { -1, 4,-10, 58, 17, -5, 1, 0 },
+  { -1, 4,-11, 40, 40,-11, 4,-1 },
+  {  1,-5, 17, 58,-10,  4,-1, 0 }
+};
+
+static const int qpel_offset[3] = { 3,3,2 };
+static const int qpel_taps[3]   = { 7,8,7 };
+
+static const int8_t epel_filters[7][4] = {
+  { -2, 58, 10, -2 },
+  { -4, 54, 16, -2 },
+  { -6, 46, 28, -4 },
+  { -4, 36, 36, -4 },
+  { -4, 28, 46, -6 },
+  { -2, 16, 54, -4 },
+  { -2, 10, 58, -2 }
+};
+
+
+// two signed 8-bit coefficients in each 16-bit lane (for maddubs)
+static inline __m256i coeff_pair_8(int8_t c0, int8_t c1)
+{
+  return _mm256_set1_epi16((int16_t)((uint8_t)c0 | ((uint8_t)c1 << 8)));
+}
+
+// two 16-bit coefficients in each 32-bit lane (for madd)
+static inline __m256i coeff_pair_16(int8_t c0, int8_t c1)
+{
+  return _mm256_set1_epi32((int32_t)((uint16_t)c0 | ((uint32_t)(uint16_t)c1 << 16)));
+}
+
+
+// store the lowest n (<8) 16-bit values
+static inline void store_partial_epi16(int16_t* dst, __m128i v, int n)
+{
+  if (n & 4) {
+    _mm_storel_epi64((__m128i*)dst, v);
+    v = _mm_srli_si128(v, 8);
+    dst += 4;
+  }
+  if (n & 2) {
+    int32_t d = _mm_cvtsi128_si32(v);
+    memcpy(dst, &d, 4);
+    v = _mm_srli_si128(v, 4);
+    dst += 2;
+  }
+  if (n & 1) {
+    *dst = (int16_t)_mm_cvtsi128_si32(v);
+  }
+}
+
+
+/* Runs 'kernel' over all samples of the block. A kernel provides
+   filter16() / filter8(), which compute 16 / 8 output samples starting at (x,y).
+ */
+template <class kernel>
+static inline void filter_block(int16_t* dst, ptrdiff_t dststride,
+                                int width, int height, const kernel& k)
+{
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+16<=width;x+=16) {
+      _mm256_storeu_si256((__m256i*)(dst+x), k.filter16(y,x));
+    }
+
+    if (x+8<=width) {
+      _mm_storeu_si128((__m128i*)(dst+x), k.filter8(y,x));
+      x+=8;
+    }
+
+    if (x<width) {
+      store_partial_epi16(dst+x, k.filter8(y,x), width-x);
+    }
+
+    dst += dststride;
+  }
+}
+
+
+// full-sample position: scale pixels to 14 bit
+
+struct pixels_kernel_8
+{
+  pixels_kernel_8(const uint8_t* s, ptrdiff_t st) : src(s), stride(st) { }
+
+  __m256i filter16(int y,int x) const {
+    __m128i p = _mm_loadu_si128((const __m128i*)(src + y*stride + x));
+    return _mm256_slli_epi16(_mm256_cvtepu8_epi16(p), 6);
+  }
+
+  __m128i filter8(int y,int x) const {
+    __m128i p = _mm_loadl_epi64((const __m128i*)(src + y*stride + x));
+    return _mm_slli_epi16(_mm_cvtepu8_epi16(p), 6);
+  }
+
+  const uint8_t* src;
+  ptrdiff_t stride;
+};
+
+
+/* Horizontal filter on 8-bit pixels. The input bytes are shuffled into
+   neighboring pairs and multiplied with a pair of coefficients (maddubs).
+   Partial sums cannot saturate and the final sum fits into 16 bits.
+ */
+template <int nPairs>
+struct h_kernel_8
+{
+  // 's' points to the sample below the first filter tap
+  h_kernel_8(const uint8_t* s, ptrdiff_t st, const int8_t* c) : src(s), stride(st) {
+    for (int j=0;j<nPairs;j++) {
+      uint8_t m[32];
+      for (int i=0;i<8;i++) {
+        m[2*i  ] = m[2*i   + 16] = 2*j+i;
+        m[2*i+1] = m[2*i+1 + 16] = 2*j+i+1;
+      }
+
+      shuffle[j] = _mm256_loadu_si256((const __m256i*)m);
+      coeff[j]   = coeff_pair_8(c[2*j], c[2*j+1]);
+    }
+  }
+
+  __m256i filter16(int y,int x) const {
+    const uint8_t* p = src + y*stride + x;
+    __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+                                         _mm_loadu_si128((const __m128i*)(p+8)), 1);
+
+    __m256i sum = _mm256_maddubs_epi16(_mm256_shuffle_epi8(in, shuffle[0]), coeff[0]);
+    for (int j=1;j<nPairs;j++) {
+      sum = _mm256_add_epi16(sum, _mm256_maddubs_epi16(_mm256_shuffle_epi8(in, shuffle[j]), coeff[j]));
+    }
+
+    return sum;
+  }
+
+  __m128i filter8(int y,int x) const {
+    __m128i in = _mm_loadu_si128((const __m128i*)(src + y*stride + x));
+
+    __m128i sum = _mm_maddubs_epi16(_mm_shuffle_epi8(in, _mm256_castsi256_si128(shuffle[0])),
+                                    _mm256_castsi256_si128(coeff[0]));
+    for (int j=1;j<nPairs;j++) {
+      sum = _mm_add_epi16(sum, _mm_maddubs_epi16(_mm_shuffle_epi8(in, _mm256_castsi256_si128(shuffle[j])),
+                                                 _mm256_castsi256_si128(coeff[j])));
+    }
+
+    return sum;
+  }
+
+  const uint8_t* src;
+  ptrdiff_t stride;
+  __m256i shuffle[nPairs];
+  __m256i coeff[nPairs];
+};
+
+
+/* Vertical filter on 8-bit pixels. Two input rows are interleaved and
+   multiplied with a pair of coefficients. For an odd number of taps,
+   the last row is paired with itself and a zero coefficient, such that
+   no row outside of the filter support is read.
+ */
+template <int nTaps>
+struct v_kernel_8
+{
+  enum { nPairs = (nTaps+1)/2 };
+
+  // 's' points to the row of the first filter tap
+  v_kernel_8(const uint8_t* s, ptrdiff_t st, const int8_t* c) : src(s), stride(st) {
+    for (int j=0;j<nPairs;j++) {
+      coeff[j] = coeff_pair_8(c[2*j], 2*j+1<nTaps ? c[2*j+1] : 0);
+    }
+  }
+
+  static int second_row(int j) { return 2*j+1<nTaps ? 2*j+1 : 2*j; }
+
+  __m256i filter16(int y,int x) const {
+    const uint8_t* p = src + y*stride + x;
+
+    __m256i sum = _mm256_setzero_si256();
+    for (int j=0;j<nPairs;j++) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(p + 2*j          *stride));
+      __m128i b = _mm_loadu_si128((const __m128i*)(p + second_row(j)*stride));
+
+      __m256i ab = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(a,b)),
+                                           _mm_unpackhi_epi8(a,b), 1);
+      sum = _mm256_add_epi16(sum, _mm256_maddubs_epi16(ab, coeff[j]));
+    }
+
+    return sum;
+  }
+
+  __m128i filter8(int y,int x) const {
+    const uint8_t* p = src + y*stride + x;
+
+    __m128i sum = _mm_setzero_si128();
+    for (int j=0;j<nPairs;j++) {
+      __m128i a = _mm_loadl_epi64((const __m128i*)(p + 2*j          *stride));
+      __m128i b = _mm_loadl_epi64((const __m128i*)(p + second_row(j)*stride));
+
+      sum = _mm_add_epi16(sum, _mm_maddubs_epi16(_mm_unpacklo_epi8(a,b),
+                                                 _mm256_castsi256_si128(coeff[j])));
+    }
+
+    return sum;
+  }
+
+  const uint8_t* src;
+  ptrdiff_t stride;
+  __m256i coeff[nPairs];
+};
+
+
+/* Vertical filter on 16-bit values (high bit depth pixels or the output
+   of the horizontal pass), with 32-bit accumulation. Like the scalar code,
+   the result is truncated (not saturated) to 16 bits.
+ */
+template <int nTaps>
+struct v_kernel_16
+{
+  enum { nPairs = (nTaps+1)/2 };
+
+  v_kernel_16(const int16_t* s, ptrdiff_t st, const int8_t* c, int shift)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shift)) {
+    for (int j=0;j<nPairs;j++) {
+      coeff[j] = coeff_pair_16(c[2*j], 2*j+1<nTaps ? c[2*j+1] : 0);
+    }
+  }
+
+  static int second_row(int j) { return 2*j+1<nTaps ? 2*j+1 : 2*j; }
+
+  __m256i filter16(int y,int x) const {
+    const int16_t* p = src + y*stride + x;
+
+    __m256i lo = _mm256_setzero_si256();
+    __m256i hi = _mm256_setzero_si256();
+    for (int j=0;j<nPairs;j++) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(p + 2*j          *stride));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(p + second_row(j)*stride));
+
+      lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a,b), coeff[j]));
+      hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a,b), coeff[j]));
+    }
+
+    const __m256i mask = _mm256_set1_epi32(0xFFFF);
+    lo = _mm256_and_si256(_mm256_sra_epi32(lo, shift), mask);
+    hi = _mm256_and_si256(_mm256_sra_epi32(hi, shift), mask);
+
+    return _mm256_packus_epi32(lo,hi);
+  }
+
+  __m128i filter8(int y,int x) const {
+    const int16_t* p = src + y*stride + x;
+
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    for (int j=0;j<nPairs;j++) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(p + 2*j          *stride));
+      __m128i b = _mm_loadu_si128((const __m128i*)(p + second_row(j)*stride));
+      __m128i c = _mm256_castsi256_si128(coeff[j]);
+
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a,b), c));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a,b), c));
+    }
+
+    const __m128i mask = _mm_set1_epi32(0xFFFF);
+    lo = _mm_and_si128(_mm_sra_epi32(lo, shift), mask);
+    hi = _mm_and_si128(_mm_sra_epi32(hi, shift), mask);
+
+    return _mm_packus_epi32(lo,hi);
+  }
+
+  const int16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m256i coeff[nPairs];
+};
+
+
+// full-sample position for high bit depths
+
+struct pixels_kernel_16
+{
+  pixels_kernel_16(const uint16_t* s, ptrdiff_t st, int shift)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shift)) { }
+
+  __m256i filter16(int y,int x) const {
+    return _mm256_sll_epi16(_mm256_loadu_si256((const __m256i*)(src + y*stride + x)), shift);
+  }
+
+  __m128i filter8(int y,int x) const {
+    return _mm_sll_epi16(_mm_loadu_si128((const __m128i*)(src + y*stride + x)), shift);
+  }
+
+  const uint16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+};
+
+
+/* Horizontal filter for high bit depths. Neighboring pixels are interleaved
+   and multiplied with a pair of coefficients (madd), accumulating in 32 bits.
+   7-tap filters are applied as 8-tap filters with a zero coefficient.
+ */
+template <int nTaps>
+struct h_kernel_16
+{
+  enum { nPairs = nTaps/2 };
+
+  // 's' points to the sample below the first filter tap
+  h_kernel_16(const uint16_t* s, ptrdiff_t st, const int8_t* c, int shift)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shift)) {
+    for (int j=0;j<nPairs;j++) {
+      coeff[j] = coeff_pair_16(c[2*j], c[2*j+1]);
+    }
+  }
+
+  __m256i filter16(int y,int x) const {
+    const int16_t* p = (const int16_t*)(src + y*stride + x);
+
+    __m256i lo = _mm256_setzero_si256();
+    __m256i hi = _mm256_setzero_si256();
+    for (int j=0;j<nPairs;j++) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(p + 2*j));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(p + 2*j+1));
+
+      lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a,b), coeff[j]));
+      hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a,b), coeff[j]));
+    }
+
+    return _mm256_packs_epi32(_mm256_sra_epi32(lo, shift),
+                              _mm256_sra_epi32(hi, shift));
+  }
+
+  __m128i filter8(int y,int x) const {
+    const int16_t* p = (const int16_t*)(src + y*stride + x);
+
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    for (int j=0;j<nPairs;j++) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(p + 2*j));
+      __m128i b = _mm_loadu_si128((const __m128i*)(p + 2*j+1));
+      __m128i c = _mm256_castsi256_si128(coeff[j]);
+
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a,b), c));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a,b), c));
+    }
+
+    return _mm_packs_epi32(_mm_sra_epi32(lo, shift),
+                           _mm_sra_epi32(hi, shift));
+  }
+
+  const uint16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m256i coeff[nPairs];
+};
+
+
+// --- final prediction output ---
+
+void ff_hevc_put_unweighted_pred_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                        const int16_t *src, ptrdiff_t srcstride,
+                                        int width, int height)
+{
+  // (v+32)>>6 == mulhrs(v, 1<<9)
+  const __m256i scale = _mm256_set1_epi16(1<<9);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+32<=width;x+=32) {
+      __m256i a = _mm256_mulhrs_epi16(_mm256_loadu_si256((const __m256i*)(src+x   )), scale);
+      __m256i b = _mm256_mulhrs_epi16(_mm256_loadu_si256((const __m256i*)(src+x+16)), scale);
+      __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(a,b), 0xD8);
+      _mm256_storeu_si256((__m256i*)(dst+x), r);
+    }
+
+    if (x+16<=width) {
+      __m256i a = _mm256_mulhrs_epi16(_mm256_loadu_si256((const __m256i*)(src+x)), scale);
+      __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(a,a), 0xD8);
+      _mm_storeu_si128((__m128i*)(dst+x), _mm256_castsi256_si128(r));
+      x+=16;
+    }
+
+    if (x+8<=width) {
+      __m128i a = _mm_mulhrs_epi16(_mm_loadu_si128((const __m128i*)(src+x)),
+                                   _mm256_castsi256_si128(scale));
+      _mm_storel_epi64((__m128i*)(dst+x), _mm_packus_epi16(a,a));
+      x+=8;
+    }
+
+    if (x+4<=width) {
+      __m128i a = _mm_mulhrs_epi16(_mm_loadl_epi64((const __m128i*)(src+x)),
+                                   _mm256_castsi256_si128(scale));
+      int32_t d = _mm_cvtsi128_si32(_mm_packus_epi16(a,a));
+      memcpy(dst+x, &d, 4);
+      x+=4;
+    }
+
+    for (;x<width;x++) {
+      int v = (src[x]+32)>>6;
+      dst[x] = v<0 ? 0 : v>255 ? 255 : v;
+    }
+
+    dst += dststride;
+    src += srcstride;
+  }
+}
+
+
+void ff_hevc_put_weighted_pred_avg_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                          const int16_t *src1, const int16_t *src2,
+                                          ptrdiff_t srcstride, int width,
+                                          int height)
+{
+  // (v+64)>>7 == mulhrs(v, 1<<8). The saturating add only changes values
+  // that are clipped to 0 or 255 anyway.
+  const __m256i scale = _mm256_set1_epi16(1<<8);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+32<=width;x+=32) {
+      __m256i a = _mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)(src1+x)),
+                                    _mm256_loadu_si256((const __m256i*)(src2+x)));
+      __m256i b = _mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)(src1+x+16)),
+                                    _mm256_loadu_si256((const __m256i*)(src2+x+16)));
+      a = _mm256_mulhrs_epi16(a, scale);
+      b = _mm256_mulhrs_epi16(b, scale);
+      __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(a,b), 0xD8);
+      _mm256_storeu_si256((__m256i*)(dst+x), r);
+    }
+
+    if (x+16<=width) {
+      __m256i a = _mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)(src1+x)),
+                                    _mm256_loadu_si256((const __m256i*)(src2+x)));
+      a = _mm256_mulhrs_epi16(a, scale);
+      __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(a,a), 0xD8);
+      _mm_storeu_si128((__m128i*)(dst+x), _mm256_castsi256_si128(r));
+      x+=16;
+    }
+
+    if (x+8<=width) {
+      __m128i a = _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(src1+x)),
+                                 _mm_loadu_si128((const __m128i*)(src2+x)));
+      a = _mm_mulhrs_epi16(a, _mm256_castsi256_si128(scale));
+      _mm_storel_epi64((__m128i*)(dst+x), _mm_packus_epi16(a,a));
+      x+=8;
+    }
+
+    if (x+4<=width) {
+      __m128i a = _mm_adds_epi16(_mm_loadl_epi64((const __m128i*)(src1+x)),
+                                 _mm_loadl_epi64((const __m128i*)(src2+x)));
+      a = _mm_mulhrs_epi16(a, _mm256_castsi256_si128(scale));
+      int32_t d = _mm_cvtsi128_si32(_mm_packus_epi16(a,a));
+      memcpy(dst+x, &d, 4);
+      x+=4;
+    }
+
+    for (;x<width;x++) {
+      int v = (src1[x]+src2[x]+64)>>7;
+      dst[x] = v<0 ? 0 : v>255 ? 255 : v;
+    }
+
+    dst  += dststride;
+    src1 += srcstride;
+    src2 += srcstride;
+  }
+}
+
+
+// --- chroma ---
+
+void ff_hevc_put_hevc_epel_pixels_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                         const uint8_t *src, ptrdiff_t srcstride,
+                                         int width, int height,
+                                         int mx, int my, int16_t* mcbuffer)
+{
+  filter_block(dst,dststride, width,height, pixels_kernel_8(src,srcstride));
+}
+
+void ff_hevc_put_hevc_epel_h_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                    const uint8_t *src, ptrdiff_t srcstride,
+                                    int width, int height,
+                                    int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  filter_block(dst,dststride, width,height,
+               h_kernel_8<2>(src-1, srcstride, epel_filters[mx-1]));
+}
+
+void ff_hevc_put_hevc_epel_v_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                    const uint8_t *src, ptrdiff_t srcstride,
+                                    int width, int height,
+                                    int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  filter_block(dst,dststride, width,height,
+               v_kernel_8<4>(src-srcstride, srcstride, epel_filters[my-1]));
+}
+
+void ff_hevc_put_hevc_epel_hv_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                     const uint8_t *src, ptrdiff_t srcstride,
+                                     int width, int height,
+                                     int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  // horizontal pass for the rows -1 .. height+1
+
+  filter_block(mcbuffer,MAX_PB_SIZE, width,height+3,
+               h_kernel_8<2>(src-srcstride-1, srcstride, epel_filters[mx-1]));
+
+  filter_block(dst,dststride, width,height,
+               v_kernel_16<4>(mcbuffer, MAX_PB_SIZE, epel_filters[my-1], 6));
+}
+
+
+// --- luma ---
+
+static inline void qpel_h(int16_t *dst, ptrdiff_t dststride,
+                          const uint8_t *src, ptrdiff_t srcstride,
+                          int width, int height, int xFrac)
+{
+  filter_block(dst,dststride, width,height,
+               h_kernel_8<4>(src - qpel_offset[xFrac-1], srcstride, qpel_filters[xFrac-1]));
+}
+
+static inline void qpel_v(int16_t *dst, ptrdiff_t dststride,
+                          const uint8_t *src, ptrdiff_t srcstride,
+                          int width, int height, int yFrac)
+{
+  const uint8_t* s = src - qpel_offset[yFrac-1]*srcstride;
+  const int8_t*  c = qpel_filters[yFrac-1];
+
+  if (qpel_taps[yFrac-1]==8) {
+    filter_block(dst,dststride, width,height, v_kernel_8<8>(s,srcstride,c));
+  }
+  else {
+    filter_block(dst,dststride, width,height, v_kernel_8<7>(s,srcstride,c));
+  }
+}
+
+static inline void qpel_hv(int16_t *dst, ptrdiff_t dststride,
+                           const uint8_t *src, ptrdiff_t srcstride,
+                           int width, int height, int16_t* mcbuffer,
+                           int xFrac, int yFrac)
+{
+  const int8_t* c = qpel_filters[yFrac-1];
+  int nTaps = qpel_taps[yFrac-1];
+
+  // horizontal pass for all rows covered by the vertical filter
+
+  qpel_h(mcbuffer,MAX_PB_SIZE, src - qpel_offset[yFrac-1]*srcstride, srcstride,
+         width, height+nTaps-1, xFrac);
+
+  if (nTaps==8) {
+    filter_block(dst,dststride, width,height, v_kernel_16<8>(mcbuffer,MAX_PB_SIZE,c, 6));
+  }
+  else {
+    filter_block(dst,dststride, width,height, v_kernel_16<7>(mcbuffer,MAX_PB_SIZE,c, 6));
+  }
+}
+
+
+void ff_hevc_put_hevc_qpel_pixels_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                         const uint8_t *src, ptrdiff_t srcstride,
+                                         int width, int height, int16_t* mcbuffer)
+{
+  filter_block(dst,dststride, width,height, pixels_kernel_8(src,srcstride));
+}
+
+
+#define QPEL_FUNC_8(name, call)                                           \
+  void ff_hevc_put_hevc_qpel_ ## name ## _8_avx2(int16_t *dst, ptrdiff_t dststride, \
+                                                 const uint8_t *src, ptrdiff_t srcstride, \
+                                                 int width, int height, int16_t* mcbuffer) \
+  {                                                                     \
+    call;                                                               \
+  }
+
+QPEL_FUNC_8(h_1, qpel_h(dst,dststride, src,srcstride, width,height, 1))
+QPEL_FUNC_8(h_2, qpel_h(dst,dststride, src,srcstride, width,height, 2))
+QPEL_FUNC_8(h_3, qpel_h(dst,dststride, src,srcstride, width,height, 3))
+
+QPEL_FUNC_8(v_1, qpel_v(dst,dststride, src,srcstride, width,height, 1))
+QPEL_FUNC_8(v_2, qpel_v(dst,dststride, src,srcstride, width,height, 2))
+QPEL_FUNC_8(v_3, qpel_v(dst,dststride, src,srcstride, width,height, 3))
+
+QPEL_FUNC_8(h_1_v_1, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 1,1))
+QPEL_FUNC_8(h_1_v_2, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 1,2))
+QPEL_FUNC_8(h_1_v_3, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 1,3))
+QPEL_FUNC_8(h_2_v_1, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 2,1))
+QPEL_FUNC_8(h_2_v_2, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 2,2))
+QPEL_FUNC_8(h_2_v_3, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 2,3))
+QPEL_FUNC_8(h_3_v_1, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 3,1))
+QPEL_FUNC_8(h_3_v_2, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 3,2))
+QPEL_FUNC_8(h_3_v_3, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 3,3))
+
+
+// --- high bit depths ---
+
+static inline __m256i clip_pixels(__m256i v, __m256i maxval)
+{
+  return _mm256_min_epi16(_mm256_max_epi16(v, _mm256_setzero_si256()), maxval);
+}
+
+static inline uint16_t clip_pixel(int v, int bit_depth)
+{
+  int maxval = (1<<bit_depth)-1;
+  return v<0 ? 0 : v>maxval ? maxval : v;
+}
+
+
+void ff_hevc_put_unweighted_pred_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                         const int16_t *src, ptrdiff_t srcstride,
+                                         int width, int height, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_unweighted_pred_16_fallback(dst,dststride, src,srcstride, width,height, bit_depth);
+    return;
+  }
+
+  // (v + (1<<(shift1-1))) >> shift1 == mulhrs(v, 1<<(15-shift1))
+  const int shift1 = 14-bit_depth;
+  const __m256i scale  = _mm256_set1_epi16(1<<(15-shift1));
+  const __m256i maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+16<=width;x+=16) {
+      __m256i v = _mm256_mulhrs_epi16(_mm256_loadu_si256((const __m256i*)(src+x)), scale);
+      _mm256_storeu_si256((__m256i*)(dst+x), clip_pixels(v, maxval));
+    }
+
+    if (x+8<=width) {
+      __m256i v = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src+x)));
+      v = clip_pixels(_mm256_mulhrs_epi16(v, scale), maxval);
+      _mm_storeu_si128((__m128i*)(dst+x), _mm256_castsi256_si128(v));
+      x+=8;
+    }
+
+    if (x+4<=width) {
+      __m256i v = _mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)(src+x)));
+      v = clip_pixels(_mm256_mulhrs_epi16(v, scale), maxval);
+      _mm_storel_epi64((__m128i*)(dst+x), _mm256_castsi256_si128(v));
+      x+=4;
+    }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel((src[x] + (1<<(shift1-1)))>>shift1, bit_depth);
+    }
+
+    dst += dststride;
+    src += srcstride;
+  }
+}
+
+
+void ff_hevc_put_weighted_pred_avg_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                           const int16_t *src1, const int16_t *src2,
+                                           ptrdiff_t srcstride, int width,
+                                           int height, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_weighted_pred_avg_16_fallback(dst,dststride, src1,src2,srcstride, width,height, bit_depth);
+    return;
+  }
+
+  // (v + (1<<(shift2-1))) >> shift2 == mulhrs(v, 1<<(15-shift2)).
+  // The saturating add only changes values that are clipped anyway.
+  const __m256i scale  = _mm256_set1_epi16(1<<bit_depth);
+  const __m256i maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+16<=width;x+=16) {
+      __m256i v = _mm256_adds_epi16(_mm256_loadu_si256((const __m256i*)(src1+x)),
+                                    _mm256_loadu_si256((const __m256i*)(src2+x)));
+      v = clip_pixels(_mm256_mulhrs_epi16(v, scale), maxval);
+      _mm256_storeu_si256((__m256i*)(dst+x), v);
+    }
+
+    if (x+8<=width) {
+      __m128i v = _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(src1+x)),
+                                 _mm_loadu_si128((const __m128i*)(src2+x)));
+      __m256i r = clip_pixels(_mm256_mulhrs_epi16(_mm256_castsi128_si256(v), scale), maxval);
+      _mm_storeu_si128((__m128i*)(dst+x), _mm256_castsi256_si128(r));
+      x+=8;
+    }
+
+    if (x+4<=width) {
+      __m128i v = _mm_adds_epi16(_mm_loadl_epi64((const __m128i*)(src1+x)),
+                                 _mm_loadl_epi64((const __m128i*)(src2+x)));
+      __m256i r = clip_pixels(_mm256_mulhrs_epi16(_mm256_castsi128_si256(v), scale), maxval);
+      _mm_storel_epi64((__m128i*)(dst+x), _mm256_castsi256_si128(r));
+      x+=4;
+    }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel((src1[x] + src2[x] + (1<<(14-bit_depth)))>>(15-bit_depth), bit_depth);
+    }
+
+    dst  += dststride;
+    src1 += srcstride;
+    src2 += srcstride;
+  }
+}
+
+
+void ff_hevc_put_hevc_epel_pixels_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                                          const uint16_t *src, ptrdiff_t srcstride,
+                                          int width, int height,
+                                          int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_epel_16_fallback(dst,dststride, src,srcstride, width,height, mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block(dst,dststride, width,height, pixels_kernel_16(src,srcstride, 14-bit_depth));
+}
+
+void ff_hevc_put_hevc_epel_h_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                                     const uint16_t *src, ptrdiff_t srcstride,
+                                     int width, int height,
+                                     int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_epel_hv_fallback(dst,dststride, src,srcstride, width,height, mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block(dst,dststride, width,height,
+               h_kernel_16<4>(src-1, srcstride, epel_filters[mx-1], bit_depth-8));
+}
+
+void ff_hevc_put_hevc_epel_v_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                                     const uint16_t *src, ptrdiff_t srcstride,
+                                     int width, int height,
+                                     int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_epel_hv_fallback(dst,dststride, src,srcstride, width,height, mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block(dst,dststride, width,height,
+               v_kernel_16<4>((const int16_t*)(src-srcstride), srcstride,
+                              epel_filters[my-1], bit_depth-8));
+}
+
+void ff_hevc_put_hevc_epel_hv_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                                      const uint16_t *src, ptrdiff_t srcstride,
+                                      int width, int height,
+                                      int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_epel_hv_fallback(dst,dststride, src,srcstride, width,height, mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block(mcbuffer,MAX_PB_SIZE, width,height+3,
+               h_kernel_16<4>(src-srcstride-1, srcstride, epel_filters[mx-1], bit_depth-8));
+
+  filter_block(dst,dststride, width,height,
+               v_kernel_16<4>(mcbuffer, MAX_PB_SIZE, epel_filters[my-1], 6));
+}
+
+
+static inline void qpel_h_16(int16_t *dst, ptrdiff_t dststride,
+                             const uint16_t *src, ptrdiff_t srcstride,
+                             int width, int height, int xFrac, int bit_depth)
+{
+  filter_block(dst,dststride, width,height,
+               h_kernel_16<8>(src - qpel_offset[xFrac-1], srcstride,
+                              qpel_filters[xFrac-1], bit_depth-8));
+}
+
+static inline void qpel_v_16(int16_t *dst, ptrdiff_t dststride,
+                             const uint16_t *src, ptrdiff_t srcstride,
+                             int width, int height, int yFrac, int bit_depth)
+{
+  const int16_t* s = (const int16_t*)(src - qpel_offset[yFrac-1]*srcstride);
+  const int8_t*  c = qpel_filters[yFrac-1];
+
+  if (qpel_taps[yFrac-1]==8) {
+    filter_block(dst,dststride, width,height, v_kernel_16<8>(s,srcstride,c, bit_depth-8));
+  }
+  else {
+    filter_block(dst,dststride, width,height, v_kernel_16<7>(s,srcstride,c, bit_depth-8));
+  }
+}
+
+static inline void qpel_hv_16(int16_t *dst, ptrdiff_t dststride,
+                              const uint16_t *src, ptrdiff_t srcstride,
+                              int width, int height, int16_t* mcbuffer,
+                              int xFrac, int yFrac, int bit_depth)
+{
+  const int8_t* c = qpel_filters[yFrac-1];
+  int nTaps = qpel_taps[yFrac-1];
+
+  qpel_h_16(mcbuffer,MAX_PB_SIZE, src - qpel_offset[yFrac-1]*srcstride, srcstride,
+            width, height+nTaps-1, xFrac, bit_depth);
+
+  if (nTaps==8) {
+    filter_block(dst,dststride, width,height, v_kernel_16<8>(mcbuffer,MAX_PB_SIZE,c, 6));
+  }
+  else {
+    filter_block(dst,dststride, width,height, v_kernel_16<7>(mcbuffer,MAX_PB_SIZE,c, 6));
+  }
+}
+
+
+#define QPEL_FUNC_16(name, fallback, call)                              \
+  void ff_hevc_put_hevc_qpel_ ## name ## _16_avx2(int16_t *dst, ptrdiff_t dststride, \
+                                                  const uint16_t *src, ptrdiff_t srcstride, \
+                                                  int width, int height, int16_t* mcbuffer, \
+                                                  int bit_depth)        \
+  {                                                                     \
+    if (bit_depth > MAX_BIT_DEPTH) {                                    \
+      fallback(dst,dststride, src,srcstride, width,height, mcbuffer, bit_depth); \
+      return;                                                           \
+    }                                                                   \
+                                                                        \
+    call;                                                               \
+  }
+
+QPEL_FUNC_16(pixels, put_qpel_0_0_fallback_16,
+             filter_block(dst,dststride, width,height, pixels_kernel_16(src,srcstride, 14-bit_depth)))
+
+QPEL_FUNC_16(h_1, put_qpel_1_0_fallback_16, qpel_h_16(dst,dststride, src,srcstride, width,height, 1, bit_depth))
+QPEL_FUNC_16(h_2, put_qpel_2_0_fallback_16, qpel_h_16(dst,dststride, src,srcstride, width,height, 2, bit_depth))
+QPEL_FUNC_16(h_3, put_qpel_3_0_fallback_16, qpel_h_16(dst,dststride, src,srcstride, width,height, 3, bit_depth))
+
+QPEL_FUNC_16(v_1, put_qpel_0_1_fallback_16, qpel_v_16(dst,dststride, src,srcstride, width,height, 1, bit_depth))
+QPEL_FUNC_16(v_2, put_qpel_0_2_fallback_16, qpel_v_16(dst,dststride, src,srcstride, width,height, 2, bit_depth))
+QPEL_FUNC_16(v_3, put_qpel_0_3_fallback_16, qpel_v_16(dst,dststride, src,srcstride, width,height, 3, bit_depth))
+
+QPEL_FUNC_16(h_1_v_1, put_qpel_1_1_fallback_16, qpel_hv_16(dst,dststride, src,srcstride, width,height, mcbuffer, 1,1, bit_depth))
+QPEL_FUNC_16(h_1_v_2, put_qpel_1_2_fallback_16, qpel_hv_16(dst,dststride, src,srcstride, width,height, mcbuffer, 1,2, bit_depth))
+QPEL_FUNC_16(h_1_v_3, put_qpel_1_3_fallback_16, qpel_hv_16(dst,dststride, src,srcstride, width,height, mcbuffer, 1,3, bit_depth))
+QPEL_FUNC_16(h_2_v_1, put_qpel_2_1_fallback_16, qpel_hv_16(dst,dststride, src,srcstride, width,height, mcbuffer, 2,1, bit_depth))
+QPEL_FUNC_16(h_2_v_2, put_qpel_2_2_fallback_16, qpel_hv_16(dst,dststride, src,srcstride, width,height, mcbuffer, 2,2, bit_depth))
+QPEL_FUNC_16(h_2_v_3, put_qpel_2_3_fallback_16, qpel_hv_16(dst,dststride, src,srcstride, width,height, mcbuffer, 2,3, bit_depth))
+QPEL_FUNC_16(h_3_v_1, put_qpel_3_1_fallback_16, qpel_hv_16(dst,dststride, src,srcstride, width,height, mcbuffer, 3,1, bit_depth))
+QPEL_FUNC_16(h_3_v_2, put_qpel_3_2_fallback_16, qpel_hv_16(dst,dststride, src,srcstride, width,height, mcbuffer, 3,2, bit_depth))
+QPEL_FUNC_16(h_3_v_3, put_qpel_3_3_fallback_16, qpel_hv_16(dst,dststride, src,srcstride, width,height, mcbuffer, 3,3, bit_depth))
+
+
+// --- explicit weighted prediction ---
+
+/* Weighted sums use 16x16->32 bit multiply-adds (see sse-weighted.cc).
+   The in-lane unpacking is undone by the in-lane packing, so the sample
+   order is preserved.
+ */
+
+// ((src*w + rnd) >> log2WD) + o, with 'wr' holding the (w,rnd) pairs
+
+static inline __m256i weighted_uni(__m256i src, __m256i wr, __m128i shift, __m256i o)
+{
+  const __m256i one = _mm256_set1_epi16(1);
+
+  __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(src, one), wr);
+  __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(src, one), wr);
+
+  lo = _mm256_add_epi32(_mm256_sra_epi32(lo, shift), o);
+  hi = _mm256_add_epi32(_mm256_sra_epi32(hi, shift), o);
+
+  return _mm256_packs_epi32(lo, hi);
+}
+
+// (src1*w1 + src2*w2 + rnd) >> shift
+
+static inline __m256i weighted_bi(__m256i src1, __m256i src2, __m256i w,
+                                  __m128i shift, __m256i rnd)
+{
+  __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(src1, src2), w);
+  __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(src1, src2), w);
+
+  lo = _mm256_sra_epi32(_mm256_add_epi32(lo, rnd), shift);
+  hi = _mm256_sra_epi32(_mm256_add_epi32(hi, rnd), shift);
+
+  return _mm256_packs_epi32(lo, hi);
+}
+
+static inline __m256i weight_pair(int a, int b)
+{
+  return _mm256_set1_epi32((a & 0xFFFF) | (b << 16));
+}
+
+static inline __m256i load_partial(const int16_t* p, int n)
+{
+  if (n==8) return _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p));
+  else      return _mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)p));
+}
+
+// store 16, 8 or 4 values as 8 bit pixels
+
+static inline void store_pixels_8(uint8_t* dst, __m256i v, int n)
+{
+  __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi16(v,v), 0xD8);
+
+  if (n==16) {
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(p));
+  }
+  else if (n==8) {
+    _mm_storel_epi64((__m128i*)dst, _mm256_castsi256_si128(p));
+  }
+  else {
+    int32_t d = _mm_cvtsi128_si32(_mm256_castsi256_si128(p));
+    memcpy(dst, &d, 4);
+  }
+}
+
+static inline void store_pixels_16(uint16_t* dst, __m256i v, __m256i maxval, int n)
+{
+  v = clip_pixels(v, maxval);
+
+  if (n==16)     _mm256_storeu_si256((__m256i*)dst, v);
+  else if (n==8) _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(v));
+  else           _mm_storel_epi64((__m128i*)dst, _mm256_castsi256_si128(v));
+}
+
+
+void ff_hevc_put_weighted_pred_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                      const int16_t *src, ptrdiff_t srcstride,
+                                      int width, int height,
+                                      int w,int o,int log2WD)
+{
+  const int rnd = 1<<(log2WD-1);
+
+  const __m256i wr    = weight_pair(w, rnd);
+  const __m128i shift = _mm_cvtsi32_si128(log2WD);
+  const __m256i offs  = _mm256_set1_epi32(o);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+32<=width;x+=32) {
+      __m256i a = weighted_uni(_mm256_loadu_si256((const __m256i*)(src+x   )), wr, shift, offs);
+      __m256i b = weighted_uni(_mm256_loadu_si256((const __m256i*)(src+x+16)), wr, shift, offs);
+      __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(a,b), 0xD8);
+      _mm256_storeu_si256((__m256i*)(dst+x), r);
+    }
+
+    if (x+16<=width) {
+      __m256i a = weighted_uni(_mm256_loadu_si256((const __m256i*)(src+x)), wr, shift, offs);
+      store_pixels_8(dst+x, a, 16);
+      x+=16;
+    }
+
+    for (int n=8;n>=4;n-=4)
+      if (x+n<=width) {
+        store_pixels_8(dst+x, weighted_uni(load_partial(src+x,n), wr, shift, offs), n);
+        x+=n;
+      }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel(((src[x]*w + rnd)>>log2WD) + o, 8);
+    }
+
+    dst += dststride;
+    src += srcstride;
+  }
+}
+
+
+void ff_hevc_put_weighted_bipred_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                        const int16_t *src1, const int16_t *src2,
+                                        ptrdiff_t srcstride, int width, int height,
+                                        int w1,int o1, int w2,int o2, int log2WD)
+{
+  const int rnd = (o1+o2+1) << log2WD;
+
+  const __m256i w     = weight_pair(w1, w2);
+  const __m128i shift = _mm_cvtsi32_si128(log2WD+1);
+  const __m256i rnd8  = _mm256_set1_epi32(rnd);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+32<=width;x+=32) {
+      __m256i a = weighted_bi(_mm256_loadu_si256((const __m256i*)(src1+x)),
+                              _mm256_loadu_si256((const __m256i*)(src2+x)), w, shift, rnd8);
+      __m256i b = weighted_bi(_mm256_loadu_si256((const __m256i*)(src1+x+16)),
+                              _mm256_loadu_si256((const __m256i*)(src2+x+16)), w, shift, rnd8);
+      __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(a,b), 0xD8);
+      _mm256_storeu_si256((__m256i*)(dst+x), r);
+    }
+
+    if (x+16<=width) {
+      __m256i a = weighted_bi(_mm256_loadu_si256((const __m256i*)(src1+x)),
+                              _mm256_loadu_si256((const __m256i*)(src2+x)), w, shift, rnd8);
+      store_pixels_8(dst+x, a, 16);
+      x+=16;
+    }
+
+    for (int n=8;n>=4;n-=4)
+      if (x+n<=width) {
+        __m256i a = weighted_bi(load_partial(src1+x,n), load_partial(src2+x,n), w, shift, rnd8);
+        store_pixels_8(dst+x, a, n);
+        x+=n;
+      }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel((src1[x]*w1 + src2[x]*w2 + rnd)>>(log2WD+1), 8);
+    }
+
+    dst  += dststride;
+    src1 += srcstride;
+    src2 += srcstride;
+  }
+}
+
+
+void ff_hevc_put_weighted_pred_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                       const int16_t *src, ptrdiff_t srcstride,
+                                       int width, int height,
+                                       int w,int o,int log2WD, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_weighted_pred_16_fallback(dst,dststride, src,srcstride, width,height,
+                                  w,o,log2WD, bit_depth);
+    return;
+  }
+
+  const int rnd = 1<<(log2WD-1);
+
+  const __m256i wr     = weight_pair(w, rnd);
+  const __m128i shift  = _mm_cvtsi32_si128(log2WD);
+  const __m256i offs   = _mm256_set1_epi32(o);
+  const __m256i maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+16<=width;x+=16) {
+      __m256i a = weighted_uni(_mm256_loadu_si256((const __m256i*)(src+x)), wr, shift, offs);
+      store_pixels_16(dst+x, a, maxval, 16);
+    }
+
+    for (int n=8;n>=4;n-=4)
+      if (x+n<=width) {
+        store_pixels_16(dst+x, weighted_uni(load_partial(src+x,n), wr, shift, offs), maxval, n);
+        x+=n;
+      }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel(((src[x]*w + rnd)>>log2WD) + o, bit_depth);
+    }
+
+    dst += dststride;
+    src += srcstride;
+  }
+}
+
+
+void ff_hevc_put_weighted_bipred_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                         const int16_t *src1, const int16_t *src2,
+                                         ptrdiff_t srcstride, int width, int height,
+                                         int w1,int o1, int w2,int o2, int log2WD,
+                                         int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_weighted_bipred_16_fallback(dst,dststride, src1,src2,srcstride, width,height,
+                                    w1,o1, w2,o2, log2WD, bit_depth);
+    return;
+  }
+
+  const int rnd = (o1+o2+1) << log2WD;
+
+  const __m256i w      = weight_pair(w1, w2);
+  const __m128i shift  = _mm_cvtsi32_si128(log2WD+1);
+  const __m256i rnd8   = _mm256_set1_epi32(rnd);
+  const __m256i maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+16<=width;x+=16) {
+      __m256i a = weighted_bi(_mm256_loadu_si256((const __m256i*)(src1+x)),
+                              _mm256_loadu_si256((const __m256i*)(src2+x)), w, shift, rnd8);
+      store_pixels_16(dst+x, a, maxval, 16);
+    }
+
+    for (int n=8;n>=4;n-=4)
+      if (x+n<=width) {
+        __m256i a = weighted_bi(load_partial(src1+x,n), load_partial(src2+x,n), w, shift, rnd8);
+        store_pixels_16(dst+x, a, maxval, n);
+        x+=n;
+      }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel((src1[x]*w1 + src2[x]*w2 + rnd)>>(log2WD+1), bit_depth);
+    }
+
+    dst  += dststride;
+    src1 += srcstride;
+    src2 += srcstride;
+  }
+}
@@ -0,0 +1,157 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AVX2_MOTION_H
+#define AVX2_MOTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+void ff_hevc_put_unweighted_pred_8_avx2(uint8_t *_dst, ptrdiff_t dststride,
+                                        const int16_t *src, ptrdiff_t srcstride,
+                                        int width, int height);
+
+void ff_hevc_put_weighted_pred_avg_8_avx2(uint8_t *_dst, ptrdiff_t dststride,
+                                          const int16_t *src1, const int16_t *src2,
+                                          ptrdiff_t srcstride, int width,
+                                          int height);
+
+void ff_hevc_put_hevc_epel_pixels_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                         const uint8_t *src, ptrdiff_t srcstride,
+                                         int width, int height,
+                                         int mx, int my, int16_t* mcbuffer);
+void ff_hevc_put_hevc_epel_h_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                    const uint8_t *src, ptrdiff_t srcstride,
+                                    int width, int height,
+                                    int mx, int my, int16_t* mcbuffer, int bit_depth);
+void ff_hevc_put_hevc_epel_v_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                    const uint8_t *src, ptrdiff_t srcstride,
+                                    int width, int height,
+                                    int mx, int my, int16_t* mcbuffer, int bit_depth);
+void ff_hevc_put_hevc_epel_hv_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                     const uint8_t *src, ptrdiff_t srcstride,
+                                     int width, int height,
+                                     int mx, int my, int16_t* mcbuffer, int bit_depth);
+
+void ff_hevc_put_hevc_qpel_pixels_8_avx2(int16_t *dst, ptrdiff_t dststride,
+                                         const uint8_t *src, ptrdiff_t srcstride,
+                                         int width, int height, int16_t* mcbuffer);
+
+#define DECLARE_QPEL_AVX2(name)                                         \
+  void ff_hevc_put_hevc_qpel_ ## name ## _8_avx2(int16_t *dst, ptrdiff_t dststride, \
+                                                 const uint8_t *src, ptrdiff_t srcstride, \
+                                                 int width, int height, int16_t* mcbuffer);
+
+DECLARE_QPEL_AVX2(v_1)
+DECLARE_QPEL_AVX2(v_2)
+DECLARE_QPEL_AVX2(v_3)
+DECLARE_QPEL_AVX2(h_1)
+DECLARE_QPEL_AVX2(h_2)
+DECLARE_QPEL_AVX2(h_3)
+DECLARE_QPEL_AVX2(h_1_v_1)
+DECLARE_QPEL_AVX2(h_1_v_2)
+DECLARE_QPEL_AVX2(h_1_v_3)
+DECLARE_QPEL_AVX2(h_2_v_1)
+DECLARE_QPEL_AVX2(h_2_v_2)
+DECLARE_QPEL_AVX2(h_2_v_3)
+DECLARE_QPEL_AVX2(h_3_v_1)
+DECLARE_QPEL_AVX2(h_3_v_2)
+DECLARE_QPEL_AVX2(h_3_v_3)
+
+#undef DECLARE_QPEL_AVX2
+
+
+// high bit depths (9-12 bit, larger bit depths use the scalar fallback)
+
+void ff_hevc_put_unweighted_pred_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                         const int16_t *src, ptrdiff_t srcstride,
+                                         int width, int height, int bit_depth);
+
+void ff_hevc_put_weighted_pred_avg_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                           const int16_t *src1, const int16_t *src2,
+                                           ptrdiff_t srcstride, int width,
+                                           int height, int bit_depth);
+
+void ff_hevc_put_hevc_epel_pixels_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                                          const uint16_t *src, ptrdiff_t srcstride,
+                                          int width, int height,
+                                          int mx, int my, int16_t* mcbuffer, int bit_depth);
+void ff_hevc_put_hevc_epel_h_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                                     const uint16_t *src, ptrdiff_t srcstride,
+                                     int width, int height,
+                                     int mx, int my, int16_t* mcbuffer, int bit_depth);
+void ff_hevc_put_hevc_epel_v_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                                     const uint16_t *src, ptrdiff_t srcstride,
+                                     int width, int height,
+                                     int mx, int my, int16_t* mcbuffer, int bit_depth);
+void ff_hevc_put_hevc_epel_hv_16_avx2(int16_t *dst, ptrdiff_t dststride,
+                                      const uint16_t *src, ptrdiff_t srcstride,
+                                      int width, int height,
+                                      int mx, int my, int16_t* mcbuffer, int bit_depth);
+
+#define DECLARE_QPEL_16_AVX2(name)                                      \
+  void ff_hevc_put_hevc_qpel_ ## name ## _16_avx2(int16_t *dst, ptrdiff_t dststride, \
+                                                  const uint16_t *src, ptrdiff_t srcstride, \
+                                                  int width, int height, int16_t* mcbuffer, \
+                                                  int bit_depth);
+
+DECLARE_QPEL_16_AVX2(pixels)
+DECLARE_QPEL_16_AVX2(v_1)
+DECLARE_QPEL_16_AVX2(v_2)
+DECLARE_QPEL_16_AVX2(v_3)
+DECLARE_QPEL_16_AVX2(h_1)
+DECLARE_QPEL_16_AVX2(h_2)
+DECLARE_QPEL_16_AVX2(h_3)
+DECLARE_QPEL_16_AVX2(h_1_v_1)
+DECLARE_QPEL_16_AVX2(h_1_v_2)
+DECLARE_QPEL_16_AVX2(h_1_v_3)
+DECLARE_QPEL_16_AVX2(h_2_v_1)
+DECLARE_QPEL_16_AVX2(h_2_v_2)
+DECLARE_QPEL_16_AVX2(h_2_v_3)
+DECLARE_QPEL_16_AVX2(h_3_v_1)
+DECLARE_QPEL_16_AVX2(h_3_v_2)
+DECLARE_QPEL_16_AVX2(h_3_v_3)
+
+#undef DECLARE_QPEL_16_AVX2
+
+
+// explicit weighted prediction
+
+void ff_hevc_put_weighted_pred_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                      const int16_t *src, ptrdiff_t srcstride,
+                                      int width, int height,
+                                      int w,int o,int log2WD);
+void ff_hevc_put_weighted_bipred_8_avx2(uint8_t *dst, ptrdiff_t dststride,
+                                        const int16_t *src1, const int16_t *src2,
+                                        ptrdiff_t srcstride, int width, int height,
+                                        int w1,int o1, int w2,int o2, int log2WD);
+
+void ff_hevc_put_weighted_pred_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                       const int16_t *src, ptrdiff_t srcstride,
+                                       int width, int height,
+                                       int w,int o,int log2WD, int bit_depth);
+void ff_hevc_put_weighted_bipred_16_avx2(uint16_t *dst, ptrdiff_t dststride,
+                                         const int16_t *src1, const int16_t *src2,
+                                         ptrdiff_t srcstride, int width, int height,
+                                         int w1,int o1, int w2,int o2, int log2WD,
+                                         int bit_depth);
+
+#endif
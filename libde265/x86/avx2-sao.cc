@@ -0,0 +1,287 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <immintrin.h>
+
+#include "x86/avx2-sao.h"
+#include "x86/sse-sao.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/* The same table lookups as in sse-sao.cc, with the tables duplicated into
+   both 128 bit lanes. Blocks are processed in full 256 bit registers, the
+   remaining columns are passed on to the SSE4.1 kernels.
+ */
+
+
+static inline __m256i broadcast_table(const void* p)
+{
+  return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)p));
+}
+
+struct offset_tables_avx2
+{
+  __m256i pos, neg;
+
+  offset_tables_avx2(const int8_t* offsets, int n, bool wide)
+  {
+    int8_t  p8[16]  = { 0 }, n8[16]  = { 0 };
+    int16_t p16[8]  = { 0 }, n16[8]  = { 0 };
+
+    for (int i=0;i<n;i++) {
+      int o = offsets[i];
+      p8[i] = p16[i] = (o>0 ?  o : 0);
+      n8[i] = n16[i] = (o<0 ? -o : 0);
+    }
+
+    pos = broadcast_table(wide ? (const void*)p16 : (const void*)p8);
+    neg = broadcast_table(wide ? (const void*)n16 : (const void*)n8);
+  }
+};
+
+static inline __m256i add_offsets_8(__m256i pix, __m256i idx, const offset_tables_avx2& t)
+{
+  return _mm256_subs_epu8(_mm256_adds_epu8(pix, _mm256_shuffle_epi8(t.pos, idx)),
+                          _mm256_shuffle_epi8(t.neg, idx));
+}
+
+static inline __m256i add_offsets_16(__m256i pix, __m256i idx, const offset_tables_avx2& t,
+                                     __m256i maxval)
+{
+  idx = _mm256_add_epi16(_mm256_or_si256(_mm256_slli_epi16(idx,1), _mm256_slli_epi16(idx,9)),
+                         _mm256_set1_epi16(0x0100));
+
+  __m256i v = _mm256_subs_epu16(_mm256_adds_epu16(pix, _mm256_shuffle_epi8(t.pos, idx)),
+                                _mm256_shuffle_epi8(t.neg, idx));
+  return _mm256_min_epu16(v, maxval);
+}
+
+
+/* Applies 'op' to the columns of the block that fill complete registers.
+   Returns the number of processed columns.
+ */
+template <class pixel_t, class Op>
+static inline int sao_block(pixel_t *out, ptrdiff_t out_stride,
+                            const pixel_t *in, ptrdiff_t in_stride,
+                            int width, int height, const Op& op)
+{
+  const int N = 32/sizeof(pixel_t);
+  const int w = width & ~(N-1);
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<w;x+=N) {
+      _mm256_storeu_si256((__m256i*)(out+x), op(in+x));
+    }
+
+    in  += in_stride;
+    out += out_stride;
+  }
+
+  return w;
+}
+
+
+// --- band offset ---
+
+struct band_8_avx2
+{
+  offset_tables_avx2 t;
+  __m256i pos;
+
+  band_8_avx2(int bandPos, const int8_t* o) : t(o,4,false)
+  {
+    pos = _mm256_set1_epi8(bandPos);
+  }
+
+  __m256i operator()(const uint8_t* in) const
+  {
+    __m256i pix  = _mm256_loadu_si256((const __m256i*)in);
+    __m256i band = _mm256_and_si256(_mm256_srli_epi16(pix,3), _mm256_set1_epi8(0x1F));
+    __m256i k    = _mm256_and_si256(_mm256_sub_epi8(band,pos), _mm256_set1_epi8(0x1F));
+    __m256i idx  = _mm256_min_epu8(k, _mm256_set1_epi8(4));
+
+    return add_offsets_8(pix, idx, t);
+  }
+};
+
+struct band_16_avx2
+{
+  offset_tables_avx2 t;
+  __m256i pos, maxval;
+  __m128i shift;
+
+  band_16_avx2(int bandPos, const int8_t* o, int bit_depth) : t(o,4,true)
+  {
+    pos    = _mm256_set1_epi16(bandPos);
+    shift  = _mm_cvtsi32_si128(bit_depth-5);
+    maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+  }
+
+  __m256i operator()(const uint16_t* in) const
+  {
+    __m256i pix  = _mm256_loadu_si256((const __m256i*)in);
+    __m256i band = _mm256_srl_epi16(pix,shift);
+    __m256i k    = _mm256_and_si256(_mm256_sub_epi16(band,pos), _mm256_set1_epi16(0x1F));
+    __m256i idx  = _mm256_min_epu16(k, _mm256_set1_epi16(4));
+
+    return add_offsets_16(pix, idx, t, maxval);
+  }
+};
+
+
+// --- edge offset ---
+
+static const int8_t hPos[4][2] = { { -1,1 }, {  0,0 }, { -1,1 }, { 1,-1 } };
+static const int8_t vPos[4][2] = { {  0,0 }, { -1,1 }, { -1,1 }, { -1,1 } };
+
+// sign(a-b) of biased (signed) values
+static inline __m256i sign_8(__m256i a, __m256i b)
+{
+  return _mm256_sub_epi8(_mm256_cmpgt_epi8(b,a), _mm256_cmpgt_epi8(a,b));
+}
+
+static inline __m256i sign_16(__m256i a, __m256i b)
+{
+  return _mm256_sub_epi16(_mm256_cmpgt_epi16(b,a), _mm256_cmpgt_epi16(a,b));
+}
+
+struct edge_8_avx2
+{
+  offset_tables_avx2 t;
+  ptrdiff_t n0, n1;
+
+  edge_8_avx2(int eoClass, ptrdiff_t stride, const int8_t* o) : t(o,5,false)
+  {
+    n0 = hPos[eoClass][0] + vPos[eoClass][0]*stride;
+    n1 = hPos[eoClass][1] + vPos[eoClass][1]*stride;
+  }
+
+  __m256i operator()(const uint8_t* in) const
+  {
+    const __m256i bias = _mm256_set1_epi8(-128);
+
+    __m256i pix = _mm256_loadu_si256((const __m256i*)in);
+    __m256i a   = _mm256_xor_si256(pix, bias);
+    __m256i b0  = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(in+n0)), bias);
+    __m256i b1  = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(in+n1)), bias);
+
+    __m256i idx = _mm256_add_epi8(_mm256_add_epi8(sign_8(a,b0), sign_8(a,b1)),
+                                  _mm256_set1_epi8(2));
+
+    return add_offsets_8(pix, idx, t);
+  }
+};
+
+struct edge_16_avx2
+{
+  offset_tables_avx2 t;
+  ptrdiff_t n0, n1;
+  __m256i maxval;
+
+  edge_16_avx2(int eoClass, ptrdiff_t stride, const int8_t* o, int bit_depth) : t(o,5,true)
+  {
+    n0 = hPos[eoClass][0] + vPos[eoClass][0]*stride;
+    n1 = hPos[eoClass][1] + vPos[eoClass][1]*stride;
+    maxval = _mm256_set1_epi16((1<<bit_depth)-1);
+  }
+
+  __m256i operator()(const uint16_t* in) const
+  {
+    const __m256i bias = _mm256_set1_epi16(-32768);
+
+    __m256i pix = _mm256_loadu_si256((const __m256i*)in);
+    __m256i a   = _mm256_xor_si256(pix, bias);
+    __m256i b0  = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(in+n0)), bias);
+    __m256i b1  = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(in+n1)), bias);
+
+    __m256i idx = _mm256_add_epi16(_mm256_add_epi16(sign_16(a,b0), sign_16(a,b1)),
+                                   _mm256_set1_epi16(2));
+
+    return add_offsets_16(pix, idx, t, maxval);
+  }
+};
+
+
+// --- exported functions ---
+
+void ff_hevc_sao_band_8_avx2(uint8_t *out, ptrdiff_t out_stride,
+                             const uint8_t *in, ptrdiff_t in_stride,
+                             int width, int height, int bandPosition, const int8_t* offsets)
+{
+  int w = sao_block(out,out_stride, in,in_stride, width,height, band_8_avx2(bandPosition,offsets));
+
+  if (w<width) {
+    ff_hevc_sao_band_8_sse(out+w,out_stride, in+w,in_stride, width-w,height,
+                           bandPosition,offsets);
+  }
+}
+
+void ff_hevc_sao_band_16_avx2(uint16_t *out, ptrdiff_t out_stride,
+                              const uint16_t *in, ptrdiff_t in_stride,
+                              int width, int height, int bandPosition, const int8_t* offsets,
+                              int bit_depth)
+{
+  int w = sao_block(out,out_stride, in,in_stride, width,height,
+                    band_16_avx2(bandPosition,offsets,bit_depth));
+
+  if (w<width) {
+    ff_hevc_sao_band_16_sse(out+w,out_stride, in+w,in_stride, width-w,height,
+                            bandPosition,offsets, bit_depth);
+  }
+}
+
+
+#define SAO_EDGE_AVX2(eoClass)                                          \
+  void ff_hevc_sao_edge_ ## eoClass ## _8_avx2(uint8_t *out, ptrdiff_t out_stride, \
+                                               const uint8_t *in, ptrdiff_t in_stride, \
+                                               int width, int height, const int8_t* offsets) \
+  {                                                                     \
+    int w = sao_block(out,out_stride, in,in_stride, width,height,       \
+                      edge_8_avx2(eoClass, in_stride, offsets));             \
+                                                                        \
+    if (w<width) {                                                      \
+      ff_hevc_sao_edge_ ## eoClass ## _8_sse(out+w,out_stride, in+w,in_stride, \
+                                             width-w,height, offsets);  \
+    }                                                                   \
+  }                                                                     \
+                                                                        \
+  void ff_hevc_sao_edge_ ## eoClass ## _16_avx2(uint16_t *out, ptrdiff_t out_stride, \
+                                                const uint16_t *in, ptrdiff_t in_stride, \
+                                                int width, int height, const int8_t* offsets, \
+                                                int bit_depth)          \
+  {                                                                     \
+    int w = sao_block(out,out_stride, in,in_stride, width,height,       \
+                      edge_16_avx2(eoClass, in_stride, offsets, bit_depth)); \
+                                                                        \
+    if (w<width) {                                                      \
+      ff_hevc_sao_edge_ ## eoClass ## _16_sse(out+w,out_stride, in+w,in_stride, \
+                                              width-w,height, offsets, bit_depth); \
+    }                                                                   \
+  }
+
+SAO_EDGE_AVX2(0)
+SAO_EDGE_AVX2(1)
+SAO_EDGE_AVX2(2)
+SAO_EDGE_AVX2(3)
+
+#undef SAO_EDGE_AVX2
@@ -19,8 +19,12 @@
  * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+#include <assert.h>
+
 #include "x86/sse-dct.h"
 #include "libde265/util.h"
+#include "libde265/fallback-dct.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -341,159 +345,6 @@ void ff_hevc_transform_skip_8_sse(uint8_t *_dst, const int16_t *coeffs, ptrdiff_
 
 
 
-#if HAVE_SSE4_1
-void ff_hevc_transform_4x4_luma_add_8_sse4(uint8_t *_dst, const int16_t *coeffs,
-                                           ptrdiff_t _stride) {
-
-    uint8_t shift_2nd = 12; // 20 - Bit depth
-    uint16_t add_2nd = 1 << 11; //(1 << (shift_2nd - 1))
-
-    uint8_t *dst = (uint8_t*) _dst;
-    ptrdiff_t stride = _stride;
-    const int16_t *src = coeffs;
-    __m128i m128iAdd, S0, S8, m128iTmp1, m128iTmp2, m128iAC, m128iBD, m128iA,
-            m128iD;
-    m128iAdd = _mm_set1_epi32(64);
-
-    S0 = _mm_load_si128((__m128i *) (src));
-    S8 = _mm_load_si128((__m128i *) (src + 8));
-
-    m128iAC = _mm_unpacklo_epi16(S0, S8);
-    m128iBD = _mm_unpackhi_epi16(S0, S8);
-
-    m128iTmp1 = _mm_madd_epi16(m128iAC,
-            _mm_load_si128((__m128i *) (transform4x4_luma[0])));
-    m128iTmp2 = _mm_madd_epi16(m128iBD,
-            _mm_load_si128((__m128i *) (transform4x4_luma[1])));
-    S0 = _mm_add_epi32(m128iTmp1, m128iTmp2);
-    S0 = _mm_add_epi32(S0, m128iAdd);
-    S0 = _mm_srai_epi32(S0, shift_1st);
-
-    m128iTmp1 = _mm_madd_epi16(m128iAC,
-            _mm_load_si128((__m128i *) (transform4x4_luma[2])));
-    m128iTmp2 = _mm_madd_epi16(m128iBD,
-            _mm_load_si128((__m128i *) (transform4x4_luma[3])));
-    S8 = _mm_add_epi32(m128iTmp1, m128iTmp2);
-    S8 = _mm_add_epi32(S8, m128iAdd);
-    S8 = _mm_srai_epi32(S8, shift_1st);
-
-    m128iA = _mm_packs_epi32(S0, S8);
-
-    m128iTmp1 = _mm_madd_epi16(m128iAC,
-            _mm_load_si128((__m128i *) (transform4x4_luma[4])));
-    m128iTmp2 = _mm_madd_epi16(m128iBD,
-            _mm_load_si128((__m128i *) (transform4x4_luma[5])));
-    S0 = _mm_add_epi32(m128iTmp1, m128iTmp2);
-    S0 = _mm_add_epi32(S0, m128iAdd);
-    S0 = _mm_srai_epi32(S0, shift_1st);
-
-    m128iTmp1 = _mm_madd_epi16(m128iAC,
-            _mm_load_si128((__m128i *) (transform4x4_luma[6])));
-    m128iTmp2 = _mm_madd_epi16(m128iBD,
-            _mm_load_si128((__m128i *) (transform4x4_luma[7])));
-    S8 = _mm_add_epi32(m128iTmp1, m128iTmp2);
-    S8 = _mm_add_epi32(S8, m128iAdd);
-    S8 = _mm_srai_epi32(S8, shift_1st);
-
-    m128iD = _mm_packs_epi32(S0, S8);
-
-    S0 = _mm_unpacklo_epi16(m128iA, m128iD);
-    S8 = _mm_unpackhi_epi16(m128iA, m128iD);
-
-    m128iA = _mm_unpacklo_epi16(S0, S8);
-    m128iD = _mm_unpackhi_epi16(S0, S8);
-
-    /*   ###################    */
-    m128iAdd = _mm_set1_epi32(add_2nd);
-
-    m128iAC = _mm_unpacklo_epi16(m128iA, m128iD);
-    m128iBD = _mm_unpackhi_epi16(m128iA, m128iD);
-
-    m128iTmp1 = _mm_madd_epi16(m128iAC,
-            _mm_load_si128((__m128i *) (transform4x4_luma[0])));
-    m128iTmp2 = _mm_madd_epi16(m128iBD,
-            _mm_load_si128((__m128i *) (transform4x4_luma[1])));
-    S0 = _mm_add_epi32(m128iTmp1, m128iTmp2);
-    S0 = _mm_add_epi32(S0, m128iAdd);
-    S0 = _mm_srai_epi32(S0, shift_2nd);
-
-    m128iTmp1 = _mm_madd_epi16(m128iAC,
-            _mm_load_si128((__m128i *) (transform4x4_luma[2])));
-    m128iTmp2 = _mm_madd_epi16(m128iBD,
-            _mm_load_si128((__m128i *) (transform4x4_luma[3])));
-    S8 = _mm_add_epi32(m128iTmp1, m128iTmp2);
-    S8 = _mm_add_epi32(S8, m128iAdd);
-    S8 = _mm_srai_epi32(S8, shift_2nd);
-
-    m128iA = _mm_packs_epi32(S0, S8);
-
-    m128iTmp1 = _mm_madd_epi16(m128iAC,
-            _mm_load_si128((__m128i *) (transform4x4_luma[4])));
-    m128iTmp2 = _mm_madd_epi16(m128iBD,
-            _mm_load_si128((__m128i *) (transform4x4_luma[5])));
-    S0 = _mm_add_epi32(m128iTmp1, m128iTmp2);
-    S0 = _mm_add_epi32(S0, m128iAdd);
-    S0 = _mm_srai_epi32(S0, shift_2nd);
-
-    m128iTmp1 = _mm_madd_epi16(m128iAC,
-            _mm_load_si128((__m128i *) (transform4x4_luma[6])));
-    m128iTmp2 = _mm_madd_epi16(m128iBD,
-            _mm_load_si128((__m128i *) (transform4x4_luma[7])));
-    S8 = _mm_add_epi32(m128iTmp1, m128iTmp2);
-    S8 = _mm_add_epi32(S8, m128iAdd);
-    S8 = _mm_srai_epi32(S8, shift_2nd);
-
-    m128iD = _mm_packs_epi32(S0, S8);
-
-//    _mm_storeu_si128((__m128i *) (src), m128iA);
-//    _mm_storeu_si128((__m128i *) (src + 8), m128iD);
-
-    S0 = _mm_move_epi64(m128iA); //contains row 0
-    S8 = _mm_move_epi64(m128iD); //row 2
-    m128iA = _mm_srli_si128(m128iA, 8); // row 1
-    m128iD = _mm_srli_si128(m128iD, 8); // row 3
-    m128iTmp1 = _mm_unpacklo_epi16(S0, m128iA);
-    m128iTmp2 = _mm_unpacklo_epi16(S8, m128iD);
-    S0 = _mm_unpacklo_epi32(m128iTmp1, m128iTmp2);
-    S8 = _mm_unpackhi_epi32(m128iTmp1, m128iTmp2);
-
-    //m128iTmp2 = _mm_set_epi32(0, 0, 0, -1);   //mask to store 4 * 8bit data
-
-    m128iA = _mm_loadl_epi64((__m128i *) dst);
-    m128iA = _mm_unpacklo_epi8(m128iA, _mm_setzero_si128());
-    m128iTmp1 = _mm_adds_epi16(S0, m128iA);	//contains first 4 values
-    m128iTmp1 = _mm_packus_epi16(m128iTmp1, _mm_setzero_si128());
-    //_mm_maskmoveu_si128(m128iTmp1, m128iTmp2, (char*) dst);
-    *((uint32_t*)(dst)) = _mm_cvtsi128_si32(m128iTmp1);
-
-    dst += stride;
-
-    m128iA = _mm_loadl_epi64((__m128i *) dst);
-    m128iA = _mm_unpacklo_epi8(m128iA, _mm_setzero_si128());
-    m128iTmp1 = _mm_adds_epi16(_mm_srli_si128(S0, 8), m128iA);
-    m128iTmp1 = _mm_packus_epi16(m128iTmp1, _mm_setzero_si128());
-    //_mm_maskmoveu_si128(m128iTmp1, m128iTmp2, (char*) dst);
-    *((uint32_t*)(dst)) = _mm_cvtsi128_si32(m128iTmp1);
-
-    dst += stride;
-
-    m128iA = _mm_loadl_epi64((__m128i *) dst);
-    m128iA = _mm_unpacklo_epi8(m128iA, _mm_setzero_si128());
-    m128iTmp1 = _mm_adds_epi16(S8, m128iA);
-    m128iTmp1 = _mm_packus_epi16(m128iTmp1, _mm_setzero_si128());
-    //_mm_maskmoveu_si128(m128iTmp1, m128iTmp2, (char*) dst);
-    *((uint32_t*)(dst)) = _mm_cvtsi128_si32(m128iTmp1);
-
-    dst += stride;
-
-    m128iA = _mm_loadl_epi64((__m128i *) dst);
-    m128iA = _mm_unpacklo_epi8(m128iA, _mm_setzero_si128());
-    m128iTmp1 = _mm_adds_epi16(_mm_srli_si128(S8, 8), m128iA);
-    m128iTmp1 = _mm_packus_epi16(m128iTmp1, _mm_setzero_si128());
-    //_mm_maskmoveu_si128(m128iTmp1, m128iTmp2, (char*) dst);
-    *((uint32_t*)(dst)) = _mm_cvtsi128_si32(m128iTmp1);
-}
-#endif // SSE4.1
 
 #if 0
 void ff_hevc_transform_4x4_luma_add_10_sse4(uint8_t *_dst, const int16_t *coeffs,
@@ -622,126 +473,6 @@ void ff_hevc_transform_4x4_luma_add_10_sse4(uint8_t *_dst, const int16_t *coeffs
 #endif
 
 
-#if HAVE_SSE4_1
-void ff_hevc_transform_4x4_add_8_sse4(uint8_t *_dst, const int16_t *coeffs,
-        ptrdiff_t _stride) {
-    uint8_t shift_2nd = 12; // 20 - Bit depth
-    uint16_t add_2nd = 1 << 11; //(1 << (shift_2nd - 1))
-
-    uint8_t *dst = (uint8_t*) _dst;
-    ptrdiff_t stride = _stride;
-    const int16_t *src = coeffs;
-
-    __m128i S0, S8, m128iAdd, m128Tmp, E1, E2, O1, O2, m128iA, m128iD, m128iTmp1,m128iTmp2;
-    S0 = _mm_load_si128((__m128i *) (src));
-    S8 = _mm_load_si128((__m128i *) (src + 8));
-    m128iAdd = _mm_set1_epi32(add_1st);
-
-    m128Tmp = _mm_unpacklo_epi16(S0, S8);
-    E1 = _mm_madd_epi16(m128Tmp, _mm_load_si128((__m128i *) (transform4x4[0])));
-    E1 = _mm_add_epi32(E1, m128iAdd);
-
-    E2 = _mm_madd_epi16(m128Tmp, _mm_load_si128((__m128i *) (transform4x4[1])));
-    E2 = _mm_add_epi32(E2, m128iAdd);
-
-    m128Tmp = _mm_unpackhi_epi16(S0, S8);
-    O1 = _mm_madd_epi16(m128Tmp, _mm_load_si128((__m128i *) (transform4x4[2])));
-    O2 = _mm_madd_epi16(m128Tmp, _mm_load_si128((__m128i *) (transform4x4[3])));
-
-    m128iA = _mm_add_epi32(E1, O1);
-    m128iA = _mm_srai_epi32(m128iA, shift_1st);        // Sum = Sum >> iShiftNum
-    m128Tmp = _mm_add_epi32(E2, O2);
-    m128Tmp = _mm_srai_epi32(m128Tmp, shift_1st);      // Sum = Sum >> iShiftNum
-    m128iA = _mm_packs_epi32(m128iA, m128Tmp);
-
-    m128iD = _mm_sub_epi32(E2, O2);
-    m128iD = _mm_srai_epi32(m128iD, shift_1st);        // Sum = Sum >> iShiftNum
-
-    m128Tmp = _mm_sub_epi32(E1, O1);
-    m128Tmp = _mm_srai_epi32(m128Tmp, shift_1st);      // Sum = Sum >> iShiftNum
-
-    m128iD = _mm_packs_epi32(m128iD, m128Tmp);
-
-    S0 = _mm_unpacklo_epi16(m128iA, m128iD);
-    S8 = _mm_unpackhi_epi16(m128iA, m128iD);
-
-    m128iA = _mm_unpacklo_epi16(S0, S8);
-    m128iD = _mm_unpackhi_epi16(S0, S8);
-
-    /*  ##########################  */
-
-    m128iAdd = _mm_set1_epi32(add_2nd);
-    m128Tmp = _mm_unpacklo_epi16(m128iA, m128iD);
-    E1 = _mm_madd_epi16(m128Tmp, _mm_load_si128((__m128i *) (transform4x4[0])));
-    E1 = _mm_add_epi32(E1, m128iAdd);
-
-    E2 = _mm_madd_epi16(m128Tmp, _mm_load_si128((__m128i *) (transform4x4[1])));
-    E2 = _mm_add_epi32(E2, m128iAdd);
-
-    m128Tmp = _mm_unpackhi_epi16(m128iA, m128iD);
-    O1 = _mm_madd_epi16(m128Tmp, _mm_load_si128((__m128i *) (transform4x4[2])));
-    O2 = _mm_madd_epi16(m128Tmp, _mm_load_si128((__m128i *) (transform4x4[3])));
-
-    m128iA = _mm_add_epi32(E1, O1);
-    m128iA = _mm_srai_epi32(m128iA, shift_2nd);
-    m128Tmp = _mm_add_epi32(E2, O2);
-    m128Tmp = _mm_srai_epi32(m128Tmp, shift_2nd);
-    m128iA = _mm_packs_epi32(m128iA, m128Tmp);
-
-    m128iD = _mm_sub_epi32(E2, O2);
-    m128iD = _mm_srai_epi32(m128iD, shift_2nd);
-
-    m128Tmp = _mm_sub_epi32(E1, O1);
-    m128Tmp = _mm_srai_epi32(m128Tmp, shift_2nd);
-
-    m128iD = _mm_packs_epi32(m128iD, m128Tmp);
-
-    S0 = _mm_move_epi64(m128iA); //contains row 0
-    S8 = _mm_move_epi64(m128iD); //row 2
-    m128iA = _mm_srli_si128(m128iA, 8); // row 1
-    m128iD = _mm_srli_si128(m128iD, 8); // row 3
-    m128iTmp1 = _mm_unpacklo_epi16(S0, m128iA);
-    m128iTmp2 = _mm_unpacklo_epi16(S8, m128iD);
-    S0 = _mm_unpacklo_epi32(m128iTmp1, m128iTmp2);
-    S8 = _mm_unpackhi_epi32(m128iTmp1, m128iTmp2);
-
-    //m128iTmp2 = _mm_set_epi32(0, 0, 0, -1);   //mask to store 4 * 8bit data
-
-    m128iA = _mm_loadl_epi64((__m128i *) dst);
-    m128iA = _mm_unpacklo_epi8(m128iA, _mm_setzero_si128());
-    m128iTmp1 = _mm_adds_epi16(S0, m128iA);	//contains first 4 values
-    m128iTmp1 = _mm_packus_epi16(m128iTmp1, _mm_setzero_si128());
-    //_mm_maskmoveu_si128(m128iTmp1, m128iTmp2, (char*) dst);
-    *((uint32_t*)(dst)) = _mm_cvtsi128_si32(m128iTmp1);
-
-    dst += stride;
-
-    m128iA = _mm_loadl_epi64((__m128i *) dst);
-    m128iA = _mm_unpacklo_epi8(m128iA, _mm_setzero_si128());
-    m128iTmp1 = _mm_adds_epi16(_mm_srli_si128(S0, 8), m128iA);
-    m128iTmp1 = _mm_packus_epi16(m128iTmp1, _mm_setzero_si128());
-    //_mm_maskmoveu_si128(m128iTmp1, m128iTmp2, (char*) dst);
-    *((uint32_t*)(dst)) = _mm_cvtsi128_si32(m128iTmp1);
-
-    dst += stride;
-
-    m128iA = _mm_loadl_epi64((__m128i *) dst);
-    m128iA = _mm_unpacklo_epi8(m128iA, _mm_setzero_si128());
-    m128iTmp1 = _mm_adds_epi16(S8, m128iA);
-    m128iTmp1 = _mm_packus_epi16(m128iTmp1, _mm_setzero_si128());
-    //_mm_maskmoveu_si128(m128iTmp1, m128iTmp2, (char*) dst);
-    *((uint32_t*)(dst)) = _mm_cvtsi128_si32(m128iTmp1);
-
-    dst += stride;
-
-    m128iA = _mm_loadl_epi64((__m128i *) dst);
-    m128iA = _mm_unpacklo_epi8(m128iA, _mm_setzero_si128());
-    m128iTmp1 = _mm_adds_epi16(_mm_srli_si128(S8, 8), m128iA);
-    m128iTmp1 = _mm_packus_epi16(m128iTmp1, _mm_setzero_si128());
-    //_mm_maskmoveu_si128(m128iTmp1, m128iTmp2, (char*) dst);
-    *((uint32_t*)(dst)) = _mm_cvtsi128_si32(m128iTmp1);
-}
-#endif
 
 #if 0
 void ff_hevc_transform_4x4_add_10_sse4(uint8_t *_dst, const int16_t *coeffs,
@@ -7092,3 +6823,614 @@ void ff_hevc_transform_32x32_add_10_sse4(uint8_t *_dst, const int16_t *coeffs,
 }
 #endif
 
+
+
+#if HAVE_SSE4_1
+
+/* Inverse transforms computed as matrix products, two basis functions at a
+   time with PMADDWD. The intermediate values are clipped to 16 bits like in
+   the scalar code.
+
+   transform_add_matrix() handles blocks with all non-zero coefficients in the
+   top-left extent x extent corner, multiplying only with the first 'extent'
+   basis functions. It is also used for the full 9-16 bit transforms, for which
+   there is no butterfly implementation. DC-only blocks add a constant.
+
+   The 4x4 transforms keep the whole block in two registers.
+ */
+
+static inline __m128i load_row8(const uint8_t* p)  { return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)p)); }
+static inline __m128i load_row8(const uint16_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+
+static inline void store_row8(uint8_t* p, __m128i lo, __m128i hi, int maxval)
+{
+  __m128i base = load_row8(p);
+  __m128i r = _mm_add_epi16(base, _mm_packs_epi32(lo,hi));
+  _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(r,r));
+}
+
+static inline void store_row8(uint16_t* p, __m128i lo, __m128i hi, int maxval)
+{
+  __m128i base = _mm_loadu_si128((const __m128i*)p);
+  lo = _mm_add_epi32(lo, _mm_cvtepu16_epi32(base));
+  hi = _mm_add_epi32(hi, _mm_unpackhi_epi16(base, _mm_setzero_si128()));
+  __m128i r = _mm_min_epu16(_mm_packus_epi32(lo,hi), _mm_set1_epi16((short)maxval));
+  _mm_storeu_si128((__m128i*)p, r);
+}
+
+static inline void add_dc(uint8_t* p, int n, int dc, int maxval)
+{
+  __m128i v;
+  if      (n==4) { int32_t d; memcpy(&d,p,4); v=_mm_cvtsi32_si128(d); }
+  else if (n==8) { v=_mm_loadl_epi64((const __m128i*)p); }
+  else           { v=_mm_loadu_si128((const __m128i*)p); }
+
+  if (dc>=0) v = _mm_adds_epu8(v, _mm_set1_epi8((char)libde265_min( dc,255)));
+  else       v = _mm_subs_epu8(v, _mm_set1_epi8((char)libde265_min(-dc,255)));
+
+  if      (n==4) { int32_t d=_mm_cvtsi128_si32(v); memcpy(p,&d,4); }
+  else if (n==8) { _mm_storel_epi64((__m128i*)p, v); }
+  else           { _mm_storeu_si128((__m128i*)p, v); }
+}
+
+static inline void add_dc(uint16_t* p, int n, int dc, int maxval)
+{
+  __m128i v;
+  if (n==4) { v=_mm_loadl_epi64((const __m128i*)p); }
+  else      { v=_mm_loadu_si128((const __m128i*)p); }
+
+  if (dc>=0) v = _mm_adds_epu16(v, _mm_set1_epi16((short)libde265_min( dc,65535)));
+  else       v = _mm_subs_epu16(v, _mm_set1_epi16((short)libde265_min(-dc,65535)));
+  v = _mm_min_epu16(v, _mm_set1_epi16((short)maxval));
+
+  if (n==4) { _mm_storel_epi64((__m128i*)p, v); }
+  else      { _mm_storeu_si128((__m128i*)p, v); }
+}
+
+// two 16 bit values in each 32 bit lane, as multiplied by PMADDWD
+static inline __m128i set1_pair(int16_t a, int16_t b)
+{
+  return _mm_set1_epi32((int)(((uint32_t)(uint16_t)b << 16) | (uint16_t)a));
+}
+
+static inline int vector_size(const uint8_t*)  { return 16; }
+static inline int vector_size(const uint16_t*) { return 8; }
+
+
+template <class pixel_t>
+static void transform_add_matrix(pixel_t *dst, ptrdiff_t stride, const int16_t *coeffs,
+                                 int nT, int extent, int bit_depth)
+{
+  const int postShift = 20-bit_depth;
+  const int rnd2 = 1<<(postShift-1);
+  const int maxval = (1<<bit_depth)-1;
+
+  if (extent==1) {
+    int g  = Clip3(-32768,32767, (64*coeffs[0] + 64)>>7);
+    int dc = (64*g + rnd2)>>postShift;
+
+    const int n = libde265_min(nT, vector_size(dst));
+    for (int y=0;y<nT;y++)
+      for (int x=0;x<nT;x+=n) {
+        add_dc(dst+y*stride+x, n, dc, maxval);
+      }
+
+    return;
+  }
+
+  assert(nT>=8);
+  assert(extent>=4 && extent<=nT);
+
+  const int fact = 32/nT;
+
+  // basis functions 2p and 2p+1 interleaved, for samples [4k .. 4k+3]
+
+  // (All loops below use the same bounds, so that the compiler can see that only written
+  // elements of 'basis' and 'w' are read.)
+
+  __m128i basis[16][8];
+  for (int p=0;p<extent/2;p++)
+    for (int k=0;k<nT/4;k+=2) {
+      __m128i b0 = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)&mat_dct[fact*(2*p  )][4*k]));
+      __m128i b1 = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)&mat_dct[fact*(2*p+1)][4*k]));
+      basis[p][k  ] = _mm_unpacklo_epi16(b0,b1);
+      basis[p][k+1] = _mm_unpackhi_epi16(b0,b1);
+    }
+
+
+  // vertical pass: g[c][i] is column c of the intermediate result (transposed)
+
+  ALIGNED_16(int16_t) g[32][32];
+
+  for (int c=0;c<extent;c++) {
+    __m128i w[16];
+    for (int p=0;p<extent/2;p++) {
+      w[p] = set1_pair(coeffs[c+2*p*nT], coeffs[c+(2*p+1)*nT]);
+    }
+
+    for (int k=0;k<nT/4;k+=2) {
+      __m128i lo = _mm_setzero_si128();
+      __m128i hi = _mm_setzero_si128();
+      for (int p=0;p<extent/2;p++) {
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(basis[p][k  ], w[p]));
+        hi = _mm_add_epi32(hi, _mm_madd_epi16(basis[p][k+1], w[p]));
+      }
+
+      lo = _mm_srai_epi32(_mm_add_epi32(lo, _mm_set1_epi32(64)), 7);
+      hi = _mm_srai_epi32(_mm_add_epi32(hi, _mm_set1_epi32(64)), 7);
+      _mm_store_si128((__m128i*)&g[c][4*k], _mm_packs_epi32(lo,hi));
+    }
+  }
+
+
+  // horizontal pass and addition to the prediction
+
+  const __m128i rnd = _mm_set1_epi32(rnd2);
+
+  for (int y=0;y<nT;y++) {
+    __m128i w[16];
+    for (int p=0;p<extent/2;p++) {
+      w[p] = set1_pair(g[2*p][y], g[2*p+1][y]);
+    }
+
+    for (int k=0;k<nT/4;k+=2) {
+      __m128i lo = _mm_setzero_si128();
+      __m128i hi = _mm_setzero_si128();
+      for (int p=0;p<extent/2;p++) {
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(basis[p][k  ], w[p]));
+        hi = _mm_add_epi32(hi, _mm_madd_epi16(basis[p][k+1], w[p]));
+      }
+
+      lo = _mm_srai_epi32(_mm_add_epi32(lo, rnd), postShift);
+      hi = _mm_srai_epi32(_mm_add_epi32(hi, rnd), postShift);
+      store_row8(dst+y*stride+4*k, lo,hi, maxval);
+    }
+  }
+}
+
+
+static const int16_t mat_dct_4x4[4][4] = {
+  { 64,  64,  64,  64 },
+  { 83,  36, -36, -83 },
+  { 64, -64, -64,  64 },
+  { 36, -83,  83, -36 }
+};
+
+static const int16_t mat_dst_4x4[4][4] = {
+  { 29,  55,  74,  84 },
+  { 74,  74,   0, -74 },
+  { 84, -29, -74,  55 },
+  { 55, -84,  74, -29 }
+};
+
+// add a row of 4 residuals (32 bit) to the prediction
+
+static inline void add_row4(uint8_t* p, __m128i r, int maxval)
+{
+  int32_t d;
+  memcpy(&d,p,4);
+  r = _mm_add_epi32(r, _mm_cvtepu8_epi32(_mm_cvtsi32_si128(d)));
+  r = _mm_packs_epi32(r,r);
+  d = _mm_cvtsi128_si32(_mm_packus_epi16(r,r));
+  memcpy(p,&d,4);
+}
+
+static inline void add_row4(uint16_t* p, __m128i r, int maxval)
+{
+  r = _mm_add_epi32(r, _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)p)));
+  r = _mm_min_epu16(_mm_packus_epi32(r,r), _mm_set1_epi16((short)maxval));
+  _mm_storel_epi64((__m128i*)p, r);
+}
+
+template <class pixel_t>
+static inline void transform_4x4_add(pixel_t *dst, ptrdiff_t stride, const int16_t *coeffs,
+                                     const int16_t mat[4][4], bool clipResidual, int bit_depth)
+{
+  const int postShift = 20-bit_depth;
+  const int maxval = (1<<bit_depth)-1;
+
+  // vertical pass: the (row 0, row 1) and (row 2, row 3) coefficient pairs
+  // of each column times the pairs of basis function values give row i of
+  // the intermediate result
+
+  __m128i r01 = _mm_loadu_si128((const __m128i*)coeffs);
+  __m128i r23 = _mm_loadu_si128((const __m128i*)(coeffs+8));
+  __m128i a = _mm_unpacklo_epi16(r01, _mm_srli_si128(r01,8));
+  __m128i b = _mm_unpacklo_epi16(r23, _mm_srli_si128(r23,8));
+
+  __m128i g[4];
+  for (int i=0;i<4;i++) {
+    __m128i s = _mm_add_epi32(_mm_madd_epi16(a, set1_pair(mat[0][i],mat[1][i])),
+                              _mm_madd_epi16(b, set1_pair(mat[2][i],mat[3][i])));
+    g[i] = _mm_srai_epi32(_mm_add_epi32(s, _mm_set1_epi32(64)), 7);
+  }
+
+  // clip to 16 bit, pairs of row elements in each 32 bit lane
+
+  __m128i g01 = _mm_packs_epi32(g[0],g[1]); // row 0 | row 1
+  __m128i g23 = _mm_packs_epi32(g[2],g[3]); // row 2 | row 3
+
+
+  // horizontal pass
+
+  const __m128i p01 = _mm_setr_epi16(mat[0][0],mat[1][0], mat[0][1],mat[1][1],
+                                     mat[0][2],mat[1][2], mat[0][3],mat[1][3]);
+  const __m128i p23 = _mm_setr_epi16(mat[2][0],mat[3][0], mat[2][1],mat[3][1],
+                                     mat[2][2],mat[3][2], mat[2][3],mat[3][3]);
+  const __m128i rnd = _mm_set1_epi32(1<<(postShift-1));
+
+  __m128i row[4];
+  row[0] = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi32(g01,0x00), p01),
+                         _mm_madd_epi16(_mm_shuffle_epi32(g01,0x55), p23));
+  row[1] = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi32(g01,0xAA), p01),
+                         _mm_madd_epi16(_mm_shuffle_epi32(g01,0xFF), p23));
+  row[2] = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi32(g23,0x00), p01),
+                         _mm_madd_epi16(_mm_shuffle_epi32(g23,0x55), p23));
+  row[3] = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi32(g23,0xAA), p01),
+                         _mm_madd_epi16(_mm_shuffle_epi32(g23,0xFF), p23));
+
+  for (int y=0;y<4;y++) {
+    __m128i r = _mm_srai_epi32(_mm_add_epi32(row[y], rnd), postShift);
+    if (clipResidual) {
+      r = _mm_max_epi32(_mm_min_epi32(r, _mm_set1_epi32(32767)), _mm_set1_epi32(-32768));
+    }
+
+    add_row4(dst+y*stride, r, maxval);
+  }
+}
+
+
+void ff_hevc_transform_4x4_luma_add_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  transform_4x4_add(dst,stride,coeffs, mat_dst_4x4, true, 8);
+}
+
+void ff_hevc_transform_4x4_add_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  transform_4x4_add(dst,stride,coeffs, mat_dct_4x4, false, 8);
+}
+
+void ff_hevc_transform_4x4_luma_add_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  transform_4x4_add(dst,stride,coeffs, mat_dst_4x4, true, bit_depth);
+}
+
+void ff_hevc_transform_4x4_add_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  transform_4x4_add(dst,stride,coeffs, mat_dct_4x4, false, bit_depth);
+}
+
+void ff_hevc_transform_8x8_add_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  transform_add_matrix(dst,stride,coeffs, 8,8,bit_depth);
+}
+
+void ff_hevc_transform_16x16_add_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  transform_add_matrix(dst,stride,coeffs, 16,16,bit_depth);
+}
+
+void ff_hevc_transform_32x32_add_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  transform_add_matrix(dst,stride,coeffs, 32,32,bit_depth);
+}
+
+
+void ff_hevc_transform_4x4_add_sparse_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent)
+{
+  transform_add_matrix(dst,stride,coeffs, 4,extent,8);
+}
+
+// For 8 bit, the butterfly implementations above are faster than the matrix product
+// for 8x8 blocks and 16x16 blocks with 8x8 coefficients.
+
+void ff_hevc_transform_8x8_add_sparse_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent)
+{
+  if (extent==1) transform_add_matrix(dst,stride,coeffs, 8,extent,8);
+  else           ff_hevc_transform_8x8_add_8_sse4(dst,coeffs,stride);
+}
+
+void ff_hevc_transform_16x16_add_sparse_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent)
+{
+  if (extent<=4) transform_add_matrix(dst,stride,coeffs, 16,extent,8);
+  else           ff_hevc_transform_16x16_add_8_sse4(dst,coeffs,stride);
+}
+
+void ff_hevc_transform_32x32_add_sparse_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent)
+{
+  transform_add_matrix(dst,stride,coeffs, 32,extent,8);
+}
+
+void ff_hevc_transform_4x4_add_sparse_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth)
+{
+  transform_add_matrix(dst,stride,coeffs, 4,extent,bit_depth);
+}
+
+void ff_hevc_transform_8x8_add_sparse_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth)
+{
+  transform_add_matrix(dst,stride,coeffs, 8,extent,bit_depth);
+}
+
+void ff_hevc_transform_16x16_add_sparse_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth)
+{
+  transform_add_matrix(dst,stride,coeffs, 16,extent,bit_depth);
+}
+
+void ff_hevc_transform_32x32_add_sparse_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth)
+{
+  transform_add_matrix(dst,stride,coeffs, 32,extent,bit_depth);
+}
+
+#endif
+
+
+
+#if HAVE_SSE4_1
+
+/* Dequantization of eight coefficients of the coefficient list at a time.
+   The 64 bit product of the scalar code is avoided by splitting the shift:
+   with X = c*m (which fits into 32 bit), the result is
+     (X + (1<<(bdShift-qPdiv6-1))) >> (bdShift-qPdiv6)   if qPdiv6 < bdShift, and
+     Clip3(X) << (qPdiv6-bdShift)                        otherwise.
+   The latter shift is at most 3, so that clipping before the shift gives
+   the same result as clipping after it.
+ */
+
+static inline __m128i dequant8(__m128i c, __m128i m, int qPdiv6, int bdShift)
+{
+  __m128i lo16 = _mm_mullo_epi16(c,m);
+  __m128i hi16 = _mm_mulhi_epi16(c,m);
+  __m128i lo = _mm_unpacklo_epi16(lo16,hi16);
+  __m128i hi = _mm_unpackhi_epi16(lo16,hi16);
+
+  if (qPdiv6 < bdShift) {
+    const __m128i shift = _mm_cvtsi32_si128(bdShift-qPdiv6);
+    const __m128i rnd   = _mm_set1_epi32(1<<(bdShift-qPdiv6-1));
+    lo = _mm_sra_epi32(_mm_add_epi32(lo,rnd), shift);
+    hi = _mm_sra_epi32(_mm_add_epi32(hi,rnd), shift);
+    return _mm_packs_epi32(lo,hi);
+  }
+  else {
+    const __m128i shift = _mm_cvtsi32_si128(qPdiv6-bdShift);
+    __m128i v = _mm_packs_epi32(lo,hi);
+    lo = _mm_sll_epi32(_mm_cvtepi16_epi32(v), shift);
+    hi = _mm_sll_epi32(_mm_cvtepi16_epi32(_mm_srli_si128(v,8)), shift);
+    return _mm_packs_epi32(lo,hi);
+  }
+}
+
+// the same computation for the remaining coefficients, 'm' is a single factor or one per position
+static inline int dequant_factor(int m, const int16_t* /*pos*/, int /*i*/) { return m; }
+static inline int dequant_factor(const int16_t* m, const int16_t* pos, int i) { return m[pos[i]]; }
+
+template <class factor_t>
+static inline void dequant_scalar(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos,
+                                  int start, int nCoeff, factor_t m, int qPdiv6, int bdShift)
+{
+  if (qPdiv6 < bdShift) {
+    const int shift = bdShift-qPdiv6;
+    const int rnd = 1<<(shift-1);
+
+    for (int i=start;i<nCoeff;i++) {
+      int X = coeffList[i] * dequant_factor(m,coeffPos,i);
+      coeffBuf[ coeffPos[i] ] = Clip3(-32768,32767, (X + rnd) >> shift);
+    }
+  }
+  else {
+    const int shift = qPdiv6-bdShift;
+
+    for (int i=start;i<nCoeff;i++) {
+      int X = coeffList[i] * dequant_factor(m,coeffPos,i);
+      coeffBuf[ coeffPos[i] ] = Clip3(-32768,32767, Clip3(-32768,32767, X) << shift);
+    }
+  }
+}
+
+static inline void dequant_scatter(int16_t* coeffBuf, const int16_t* coeffPos, __m128i v)
+{
+  coeffBuf[ coeffPos[0] ] = (int16_t)_mm_extract_epi16(v,0);
+  coeffBuf[ coeffPos[1] ] = (int16_t)_mm_extract_epi16(v,1);
+  coeffBuf[ coeffPos[2] ] = (int16_t)_mm_extract_epi16(v,2);
+  coeffBuf[ coeffPos[3] ] = (int16_t)_mm_extract_epi16(v,3);
+  coeffBuf[ coeffPos[4] ] = (int16_t)_mm_extract_epi16(v,4);
+  coeffBuf[ coeffPos[5] ] = (int16_t)_mm_extract_epi16(v,5);
+  coeffBuf[ coeffPos[6] ] = (int16_t)_mm_extract_epi16(v,6);
+  coeffBuf[ coeffPos[7] ] = (int16_t)_mm_extract_epi16(v,7);
+}
+
+
+void ff_hevc_dequant_flat_sse4(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos, int nCoeff,
+                               int m, int qPdiv6, int bdShift)
+{
+  const __m128i mv = _mm_set1_epi16((short)m);
+
+  int i;
+  for (i=0;i+8<=nCoeff;i+=8) {
+    __m128i c = _mm_loadu_si128((const __m128i*)(coeffList+i));
+    dequant_scatter(coeffBuf, coeffPos+i, dequant8(c,mv, qPdiv6,bdShift));
+  }
+
+  dequant_scalar(coeffBuf, coeffList, coeffPos, i, nCoeff, m, qPdiv6,bdShift);
+}
+
+
+void ff_hevc_dequant_scaled_sse4(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos, int nCoeff,
+                                 const int16_t* m, int qPdiv6, int bdShift)
+{
+  int i;
+  for (i=0;i+8<=nCoeff;i+=8) {
+    const int16_t* p = coeffPos+i;
+
+    __m128i mv = _mm_cvtsi32_si128(m[p[0]]);
+    mv = _mm_insert_epi16(mv, m[p[1]], 1);
+    mv = _mm_insert_epi16(mv, m[p[2]], 2);
+    mv = _mm_insert_epi16(mv, m[p[3]], 3);
+    mv = _mm_insert_epi16(mv, m[p[4]], 4);
+    mv = _mm_insert_epi16(mv, m[p[5]], 5);
+    mv = _mm_insert_epi16(mv, m[p[6]], 6);
+    mv = _mm_insert_epi16(mv, m[p[7]], 7);
+
+    __m128i c = _mm_loadu_si128((const __m128i*)(coeffList+i));
+    dequant_scatter(coeffBuf, p, dequant8(c,mv, qPdiv6,bdShift));
+  }
+
+  dequant_scalar(coeffBuf, coeffList, coeffPos, i, nCoeff, m, qPdiv6,bdShift);
+}
+
+#endif
+
+#if HAVE_SSE4_1
+
+/* Residual generation without transform (transform skip, transquant bypass,
+   RDPCM) and adding the residual to the prediction. The residual blocks are
+   stored without padding, i.e. with a stride of nT.
+ */
+
+static inline __m128i load_coeffs4(const int16_t* c)
+{
+  return _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)c));
+}
+
+// transform skip scaling: ((c << tsShift) + rnd) >> bdShift
+static inline __m128i scale_ts(__m128i c, __m128i tsShift, __m128i rnd, __m128i bdShift)
+{
+  return _mm_sra_epi32(_mm_add_epi32(_mm_sll_epi32(c, tsShift), rnd), bdShift);
+}
+
+// prefix sum over the four 32 bit elements
+static inline __m128i prefix_sum4(__m128i v)
+{
+  v = _mm_add_epi32(v, _mm_slli_si128(v,4));
+  v = _mm_add_epi32(v, _mm_slli_si128(v,8));
+  return v;
+}
+
+
+void ff_hevc_transform_skip_residual_sse4(int32_t *residual, const int16_t *coeffs, int nT,
+                                          int tsShift, int bdShift)
+{
+  const __m128i ts  = _mm_cvtsi32_si128(tsShift);
+  const __m128i bd  = _mm_cvtsi32_si128(bdShift);
+  const __m128i rnd = _mm_set1_epi32(1<<(bdShift-1));
+
+  for (int i=0;i<nT*nT;i+=4) {
+    _mm_storeu_si128((__m128i*)(residual+i), scale_ts(load_coeffs4(coeffs+i), ts,rnd,bd));
+  }
+}
+
+
+void ff_hevc_transform_bypass_sse4(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  for (int i=0;i<nT*nT;i+=4) {
+    _mm_storeu_si128((__m128i*)(residual+i), load_coeffs4(coeffs+i));
+  }
+}
+
+
+void ff_hevc_transform_bypass_rdpcm_v_sse4(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  for (int x=0;x<nT;x+=4) {
+    __m128i sum = _mm_setzero_si128();
+
+    for (int y=0;y<nT;y++) {
+      sum = _mm_add_epi32(sum, load_coeffs4(coeffs+x+y*nT));
+      _mm_storeu_si128((__m128i*)(residual+x+y*nT), sum);
+    }
+  }
+}
+
+
+void ff_hevc_transform_bypass_rdpcm_h_sse4(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  for (int y=0;y<nT;y++) {
+    __m128i sum = _mm_setzero_si128();
+
+    for (int x=0;x<nT;x+=4) {
+      sum = _mm_add_epi32(_mm_shuffle_epi32(sum, 0xFF), prefix_sum4(load_coeffs4(coeffs+x+y*nT)));
+      _mm_storeu_si128((__m128i*)(residual+x+y*nT), sum);
+    }
+  }
+}
+
+
+void ff_hevc_rdpcm_v_sse4(int32_t* residual, const int16_t* coeffs, int nT, int tsShift, int bdShift)
+{
+  const __m128i ts  = _mm_cvtsi32_si128(tsShift);
+  const __m128i bd  = _mm_cvtsi32_si128(bdShift);
+  const __m128i rnd = _mm_set1_epi32(1<<(bdShift-1));
+
+  for (int x=0;x<nT;x+=4) {
+    __m128i sum = _mm_setzero_si128();
+
+    for (int y=0;y<nT;y++) {
+      sum = _mm_add_epi32(sum, scale_ts(load_coeffs4(coeffs+x+y*nT), ts,rnd,bd));
+      _mm_storeu_si128((__m128i*)(residual+x+y*nT), sum);
+    }
+  }
+}
+
+
+void ff_hevc_rdpcm_h_sse4(int32_t* residual, const int16_t* coeffs, int nT, int tsShift, int bdShift)
+{
+  const __m128i ts  = _mm_cvtsi32_si128(tsShift);
+  const __m128i bd  = _mm_cvtsi32_si128(bdShift);
+  const __m128i rnd = _mm_set1_epi32(1<<(bdShift-1));
+
+  for (int y=0;y<nT;y++) {
+    __m128i sum = _mm_setzero_si128();
+
+    for (int x=0;x<nT;x+=4) {
+      __m128i v = scale_ts(load_coeffs4(coeffs+x+y*nT), ts,rnd,bd);
+      sum = _mm_add_epi32(_mm_shuffle_epi32(sum, 0xFF), prefix_sum4(v));
+      _mm_storeu_si128((__m128i*)(residual+x+y*nT), sum);
+    }
+  }
+}
+
+
+void ff_hevc_add_residual_8_sse4(uint8_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth)
+{
+  if (nT==4) {
+    for (int y=0;y<4;y++) {
+      int32_t d;
+      memcpy(&d, dst+y*stride, 4);
+
+      __m128i v = _mm_loadu_si128((const __m128i*)(r+4*y));
+      v = _mm_adds_epi16(_mm_packs_epi32(v,v), _mm_cvtepu8_epi16(_mm_cvtsi32_si128(d)));
+      d = _mm_cvtsi128_si32(_mm_packus_epi16(v,v));
+
+      memcpy(dst+y*stride, &d, 4);
+    }
+
+    return;
+  }
+
+  for (int y=0;y<nT;y++)
+    for (int x=0;x<nT;x+=8) {
+      uint8_t* p = dst+y*stride+x;
+
+      // saturated to 16 bit, which does not change the clipped result
+      __m128i v = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)(r+y*nT+x)),
+                                  _mm_loadu_si128((const __m128i*)(r+y*nT+x+4)));
+      v = _mm_adds_epi16(v, _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)p)));
+      _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(v,v));
+    }
+}
+
+
+void ff_hevc_add_residual_16_sse4(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth)
+{
+  const __m128i maxval = _mm_set1_epi16((short)((1<<bit_depth)-1));
+
+  for (int y=0;y<nT;y++)
+    for (int x=0;x<nT;x+=4) {
+      uint16_t* p = dst+y*stride+x;
+
+      __m128i v = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(r+y*nT+x)),
+                                _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)p)));
+      v = _mm_min_epu16(_mm_packus_epi32(v,v), maxval);
+      _mm_storel_epi64((__m128i*)p, v);
+    }
+}
+
+#endif
@@ -32,4 +32,39 @@ void ff_hevc_transform_8x8_add_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdi
 void ff_hevc_transform_16x16_add_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride);
 void ff_hevc_transform_32x32_add_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride);
 
+// 9-16 bit
+void ff_hevc_transform_4x4_luma_add_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth);
+void ff_hevc_transform_4x4_add_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth);
+void ff_hevc_transform_8x8_add_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth);
+void ff_hevc_transform_16x16_add_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth);
+void ff_hevc_transform_32x32_add_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth);
+
+// iDCT with non-zero coefficients only in the top-left 'extent' x 'extent' corner (1, 4 or 8)
+void ff_hevc_transform_4x4_add_sparse_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent);
+void ff_hevc_transform_8x8_add_sparse_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent);
+void ff_hevc_transform_16x16_add_sparse_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent);
+void ff_hevc_transform_32x32_add_sparse_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent);
+
+void ff_hevc_transform_4x4_add_sparse_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth);
+void ff_hevc_transform_8x8_add_sparse_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth);
+void ff_hevc_transform_16x16_add_sparse_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth);
+void ff_hevc_transform_32x32_add_sparse_16_sse4(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int extent, int bit_depth);
+
+// dequantization of the coefficient list, see acceleration.h
+void ff_hevc_dequant_flat_sse4(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos, int nCoeff,
+                               int m, int qPdiv6, int bdShift);
+void ff_hevc_dequant_scaled_sse4(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos, int nCoeff,
+                                 const int16_t* m, int qPdiv6, int bdShift);
+
+// residuals without transform, and adding them to the prediction
+void ff_hevc_transform_skip_residual_sse4(int32_t *residual, const int16_t *coeffs, int nT, int tsShift, int bdShift);
+void ff_hevc_transform_bypass_sse4(int32_t *residual, const int16_t *coeffs, int nT);
+void ff_hevc_transform_bypass_rdpcm_v_sse4(int32_t *residual, const int16_t *coeffs, int nT);
+void ff_hevc_transform_bypass_rdpcm_h_sse4(int32_t *residual, const int16_t *coeffs, int nT);
+void ff_hevc_rdpcm_v_sse4(int32_t* residual, const int16_t* coeffs, int nT, int tsShift, int bdShift);
+void ff_hevc_rdpcm_h_sse4(int32_t* residual, const int16_t* coeffs, int nT, int tsShift, int bdShift);
+
+void ff_hevc_add_residual_8_sse4(uint8_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth);
+void ff_hevc_add_residual_16_sse4(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth);
+
 #endif
@@ -0,0 +1,481 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+
+#include "x86/sse-deblock.h"
+#include "fallback-deblock.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/* The samples of a 4-line edge segment are held in 16 bit lanes, one
+   register per distance i from the edge:
+
+     A[i] = [ p_i of lines 0-3 | q_i of lines 0-3 ]
+
+   With the two halves swapped (B[i]), most filter equations compute the
+   new p and q samples in the same operation. The on/off decisions are made
+   in scalar code on values extracted from the registers.
+
+   All intermediate values fit into 16 bits for bit depths up to 12.
+ */
+
+#define MAX_BIT_DEPTH 12
+
+
+static inline __m128i load4(const uint8_t* p)
+{
+  int32_t v;
+  memcpy(&v, p, 4);
+  return _mm_cvtepu8_epi16(_mm_cvtsi32_si128(v));
+}
+
+static inline __m128i load4(const uint16_t* p)
+{
+  return _mm_loadl_epi64((const __m128i*)p);
+}
+
+static inline __m128i load8(const uint8_t* p)
+{
+  return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)p));
+}
+
+static inline __m128i load8(const uint16_t* p)
+{
+  return _mm_loadu_si128((const __m128i*)p);
+}
+
+static inline void store4(uint8_t* p, __m128i v)
+{
+  int32_t d = _mm_cvtsi128_si32(_mm_packus_epi16(v,v));
+  memcpy(p, &d, 4);
+}
+
+static inline void store4(uint16_t* p, __m128i v)
+{
+  _mm_storel_epi64((__m128i*)p, v);
+}
+
+static inline void store8(uint8_t* p, __m128i v)
+{
+  _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(v,v));
+}
+
+static inline void store8(uint16_t* p, __m128i v)
+{
+  _mm_storeu_si128((__m128i*)p, v);
+}
+
+static inline __m128i swap_halves(__m128i v)
+{
+  return _mm_shuffle_epi32(v, 0x4E);
+}
+
+static inline __m128i clamp(__m128i v, __m128i lo, __m128i hi)
+{
+  return _mm_min_epi16(_mm_max_epi16(v, lo), hi);
+}
+
+// mask for the p half and the q half of a register
+static inline __m128i side_mask(bool p, bool q)
+{
+  return _mm_unpacklo_epi64(_mm_set1_epi16(p ? -1 : 0), _mm_set1_epi16(q ? -1 : 0));
+}
+
+
+// --- luma ---
+
+// Loads 4 lines across a vertical edge (p3..q3 in each row) and transposes them.
+template <class pixel_t>
+static inline void load_luma_v(const pixel_t* ptr, ptrdiff_t stride, __m128i* A)
+{
+  __m128i r0 = load8(ptr-4);
+  __m128i r1 = load8(ptr-4+stride);
+  __m128i r2 = load8(ptr-4+2*stride);
+  __m128i r3 = load8(ptr-4+3*stride);
+
+  __m128i t0 = _mm_unpacklo_epi16(r0,r1);
+  __m128i t1 = _mm_unpackhi_epi16(r0,r1);
+  __m128i t2 = _mm_unpacklo_epi16(r2,r3);
+  __m128i t3 = _mm_unpackhi_epi16(r2,r3);
+
+  __m128i c01 = _mm_unpacklo_epi32(t0,t2);  // columns p3 | p2
+  __m128i c23 = _mm_unpackhi_epi32(t0,t2);  // columns p1 | p0
+  __m128i c45 = _mm_unpacklo_epi32(t1,t3);  // columns q0 | q1
+  __m128i c67 = _mm_unpackhi_epi32(t1,t3);  // columns q2 | q3
+
+  A[0] = _mm_alignr_epi8(c45,c23,8);
+  A[1] = _mm_blend_epi16(c23,c45,0xF0);
+  A[2] = _mm_alignr_epi8(c67,c01,8);
+  A[3] = _mm_blend_epi16(c01,c67,0xF0);
+}
+
+template <class pixel_t>
+static inline void store_luma_v(pixel_t* ptr, ptrdiff_t stride, const __m128i* A)
+{
+  __m128i c01 = _mm_unpacklo_epi64(A[3],A[2]);
+  __m128i c23 = _mm_unpacklo_epi64(A[1],A[0]);
+  __m128i c45 = _mm_unpackhi_epi64(A[0],A[1]);
+  __m128i c67 = _mm_unpackhi_epi64(A[2],A[3]);
+
+  __m128i v0 = _mm_unpacklo_epi16(c01,c23);
+  __m128i v1 = _mm_unpackhi_epi16(c01,c23);
+  __m128i v2 = _mm_unpacklo_epi16(c45,c67);
+  __m128i v3 = _mm_unpackhi_epi16(c45,c67);
+
+  __m128i l01 = _mm_unpacklo_epi16(v0,v1);  // lines 0,1 of p3..p0
+  __m128i l23 = _mm_unpackhi_epi16(v0,v1);
+  __m128i r01 = _mm_unpacklo_epi16(v2,v3);  // lines 0,1 of q0..q3
+  __m128i r23 = _mm_unpackhi_epi16(v2,v3);
+
+  store8(ptr-4,          _mm_unpacklo_epi64(l01,r01));
+  store8(ptr-4+stride,   _mm_unpackhi_epi64(l01,r01));
+  store8(ptr-4+2*stride, _mm_unpacklo_epi64(l23,r23));
+  store8(ptr-4+3*stride, _mm_unpackhi_epi64(l23,r23));
+}
+
+template <class pixel_t>
+static inline void load_luma_h(const pixel_t* ptr, ptrdiff_t stride, __m128i* A)
+{
+  for (int i=0;i<4;i++) {
+    A[i] = _mm_unpacklo_epi64(load4(ptr-(i+1)*stride), load4(ptr+i*stride));
+  }
+}
+
+template <class pixel_t>
+static inline void store_luma_h(pixel_t* ptr, ptrdiff_t stride, const __m128i* A)
+{
+  for (int i=0;i<3;i++) {
+    store4(ptr-(i+1)*stride, A[i]);
+    store4(ptr+ i   *stride, _mm_unpackhi_epi64(A[i],A[i]));
+  }
+}
+
+
+// 8.7.2.5.3, returns false if the segment is not filtered.
+
+static inline bool luma_decisions(const __m128i* A, int beta, int tc,
+                                  bool* strong, bool* dEp, bool* dEq)
+{
+  __m128i E = _mm_abs_epi16(_mm_sub_epi16(_mm_add_epi16(A[2],A[0]),
+                                          _mm_add_epi16(A[1],A[1])));
+  __m128i F = _mm_abs_epi16(_mm_sub_epi16(A[3],A[0]));
+  __m128i G = _mm_abs_epi16(_mm_sub_epi16(A[0],swap_halves(A[0])));
+
+  int dp0 = _mm_extract_epi16(E,0);
+  int dp3 = _mm_extract_epi16(E,3);
+  int dq0 = _mm_extract_epi16(E,4);
+  int dq3 = _mm_extract_epi16(E,7);
+
+  int dpq0 = dp0 + dq0;
+  int dpq3 = dp3 + dq3;
+
+  if (dpq0 + dpq3 >= beta) {
+    return false;
+  }
+
+  bool dSam0 = (2*dpq0 < (beta>>2) &&
+                _mm_extract_epi16(F,0) + _mm_extract_epi16(F,4) < (beta>>3) &&
+                _mm_extract_epi16(G,0) < ((5*tc+1)>>1));
+
+  bool dSam3 = (2*dpq3 < (beta>>2) &&
+                _mm_extract_epi16(F,3) + _mm_extract_epi16(F,7) < (beta>>3) &&
+                _mm_extract_epi16(G,3) < ((5*tc+1)>>1));
+
+  *strong = dSam0 && dSam3;
+  *dEp = (dp0 + dp3 < ((beta + (beta>>1))>>3));
+  *dEq = (dq0 + dq3 < ((beta + (beta>>1))>>3));
+
+  return true;
+}
+
+
+// 8.7.2.5.7
+
+static inline void luma_strong_filter(__m128i* A, int tc, __m128i side)
+{
+  const __m128i tc2 = _mm_set1_epi16(2*tc);
+
+  __m128i B0 = swap_halves(A[0]);
+  __m128i B1 = swap_halves(A[1]);
+  __m128i s  = _mm_add_epi16(A[0],B0);  // p0+q0
+
+  // (p2 + 2*p1 + 2*p0 + 2*q0 + q1 + 4) >> 3
+  __m128i n0 = _mm_add_epi16(_mm_add_epi16(A[2],B1),
+                             _mm_slli_epi16(_mm_add_epi16(A[1],s),1));
+  n0 = _mm_srli_epi16(_mm_add_epi16(n0, _mm_set1_epi16(4)), 3);
+
+  // (p2 + p1 + p0 + q0 + 2) >> 2
+  __m128i n1 = _mm_add_epi16(_mm_add_epi16(A[2],A[1]), s);
+  n1 = _mm_srli_epi16(_mm_add_epi16(n1, _mm_set1_epi16(2)), 2);
+
+  // (2*p3 + 3*p2 + p1 + p0 + q0 + 4) >> 3
+  __m128i n2 = _mm_add_epi16(_mm_slli_epi16(_mm_add_epi16(A[3],A[2]),1),
+                             _mm_add_epi16(_mm_add_epi16(A[2],A[1]), s));
+  n2 = _mm_srli_epi16(_mm_add_epi16(n2, _mm_set1_epi16(4)), 3);
+
+  __m128i n[3] = { n0,n1,n2 };
+  for (int i=0;i<3;i++) {
+    n[i] = clamp(n[i], _mm_sub_epi16(A[i],tc2), _mm_add_epi16(A[i],tc2));
+    A[i] = _mm_blendv_epi8(A[i], n[i], side);
+  }
+}
+
+static inline void luma_weak_filter(__m128i* A, int tc, __m128i side, __m128i sideE,
+                                    __m128i maxval)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i tcv  = _mm_set1_epi16(tc);
+  const __m128i tch  = _mm_set1_epi16(tc>>1);
+
+  __m128i B0 = swap_halves(A[0]);
+  __m128i B1 = swap_halves(A[1]);
+
+  // delta = (9*(q0-p0) - 3*(q1-p1) + 8) >> 4, computed in 32 bit in the p half
+  __m128i d = _mm_madd_epi16(_mm_unpacklo_epi16(_mm_sub_epi16(B0,A[0]),
+                                                _mm_sub_epi16(B1,A[1])),
+                             _mm_set1_epi32(9 | (-3 * 65536)));
+  d = _mm_srai_epi32(_mm_add_epi32(d, _mm_set1_epi32(8)), 4);
+  d = _mm_packs_epi32(d,d);
+
+  __m128i on = _mm_cmpgt_epi16(_mm_set1_epi16(10*tc), _mm_abs_epi16(d));
+
+  // [ delta | -delta ]
+  d = clamp(d, _mm_sub_epi16(zero,tcv), tcv);
+  d = _mm_sign_epi16(d, _mm_setr_epi16(1,1,1,1,-1,-1,-1,-1));
+
+  __m128i n0 = clamp(_mm_add_epi16(A[0],d), zero, maxval);
+
+  // (((p2+p0+1)>>1) - p1 + delta) >> 1
+  __m128i d1 = _mm_sub_epi16(_mm_avg_epu16(A[2],A[0]), A[1]);
+  d1 = _mm_srai_epi16(_mm_add_epi16(d1,d), 1);
+  d1 = clamp(d1, _mm_sub_epi16(zero,tch), tch);
+
+  __m128i n1 = clamp(_mm_add_epi16(A[1],d1), zero, maxval);
+
+  A[0] = _mm_blendv_epi8(A[0], n0, _mm_and_si128(on, side));
+  A[1] = _mm_blendv_epi8(A[1], n1, _mm_and_si128(on, sideE));
+}
+
+
+template <class pixel_t>
+static inline void luma_segment(pixel_t* ptr, ptrdiff_t stride, bool vertical,
+                                int beta, int tc, bool filterP, bool filterQ, int bit_depth)
+{
+  if (tc==0) {
+    return;
+  }
+
+  __m128i A[4];
+  if (vertical) load_luma_v(ptr,stride,A);
+  else          load_luma_h(ptr,stride,A);
+
+  bool strong, dEp, dEq;
+  if (!luma_decisions(A, beta, tc, &strong, &dEp, &dEq)) {
+    return;
+  }
+
+  __m128i side = side_mask(filterP, filterQ);
+
+  if (strong) {
+    luma_strong_filter(A, tc, side);
+  }
+  else {
+    __m128i sideE = side_mask(filterP && dEp, filterQ && dEq);
+    luma_weak_filter(A, tc, side, sideE, _mm_set1_epi16((1<<bit_depth)-1));
+  }
+
+  if (vertical) store_luma_v(ptr,stride,A);
+  else          store_luma_h(ptr,stride,A);
+}
+
+
+// --- chroma ---
+
+template <class pixel_t>
+static inline void load_chroma_v(const pixel_t* ptr, ptrdiff_t stride, __m128i* A)
+{
+  __m128i r01 = _mm_unpacklo_epi64(load4(ptr-2), load4(ptr-2+stride));
+  __m128i r23 = _mm_unpacklo_epi64(load4(ptr-2+2*stride), load4(ptr-2+3*stride));
+
+  __m128i t0 = _mm_unpacklo_epi16(r01,r23);
+  __m128i t1 = _mm_unpackhi_epi16(r01,r23);
+
+  __m128i c01 = _mm_unpacklo_epi16(t0,t1);  // columns p1 | p0
+  __m128i c23 = _mm_unpackhi_epi16(t0,t1);  // columns q0 | q1
+
+  A[0] = _mm_alignr_epi8(c23,c01,8);
+  A[1] = _mm_blend_epi16(c01,c23,0xF0);
+}
+
+template <class pixel_t>
+static inline void store_chroma_v(pixel_t* ptr, ptrdiff_t stride, const __m128i* A)
+{
+  __m128i c01 = _mm_unpacklo_epi64(A[1],A[0]);
+  __m128i c23 = _mm_unpackhi_epi64(A[0],A[1]);
+
+  __m128i t0 = _mm_unpacklo_epi16(c01,c23);
+  __m128i t1 = _mm_unpackhi_epi16(c01,c23);
+
+  __m128i r01 = _mm_unpacklo_epi16(t0,t1);
+  __m128i r23 = _mm_unpackhi_epi16(t0,t1);
+
+  store4(ptr-2,          r01);
+  store4(ptr-2+stride,   _mm_unpackhi_epi64(r01,r01));
+  store4(ptr-2+2*stride, r23);
+  store4(ptr-2+3*stride, _mm_unpackhi_epi64(r23,r23));
+}
+
+// 8.7.2.5.5
+static inline void chroma_filter(__m128i* A, int tc, __m128i side, __m128i maxval)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i tcv  = _mm_set1_epi16(tc);
+
+  // delta = (((q0-p0)<<2) + p1 - q1 + 4) >> 3, in the p half
+  __m128i d = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(swap_halves(A[0]),A[0]),2),
+                            _mm_sub_epi16(A[1],swap_halves(A[1])));
+  d = _mm_srai_epi16(_mm_add_epi16(d, _mm_set1_epi16(4)), 3);
+  d = _mm_unpacklo_epi64(d,d);
+
+  d = clamp(d, _mm_sub_epi16(zero,tcv), tcv);
+  d = _mm_sign_epi16(d, _mm_setr_epi16(1,1,1,1,-1,-1,-1,-1));
+
+  __m128i n0 = clamp(_mm_add_epi16(A[0],d), zero, maxval);
+  A[0] = _mm_blendv_epi8(A[0], n0, side);
+}
+
+template <class pixel_t>
+static inline void chroma_segment(pixel_t* ptr, ptrdiff_t stride, bool vertical,
+                                  int tc, bool filterP, bool filterQ, int bit_depth)
+{
+  if (tc==0) {
+    return;
+  }
+
+  __m128i A[2];
+  if (vertical) {
+    load_chroma_v(ptr,stride,A);
+  }
+  else {
+    A[0] = _mm_unpacklo_epi64(load4(ptr-stride),   load4(ptr));
+    A[1] = _mm_unpacklo_epi64(load4(ptr-2*stride), load4(ptr+stride));
+  }
+
+  chroma_filter(A, tc, side_mask(filterP,filterQ), _mm_set1_epi16((1<<bit_depth)-1));
+
+  if (vertical) {
+    store_chroma_v(ptr,stride,A);
+  }
+  else {
+    store4(ptr-stride, A[0]);
+    store4(ptr,        _mm_unpackhi_epi64(A[0],A[0]));
+  }
+}
+
+
+// --- exported functions ---
+
+void ff_hevc_deblock_luma_v_8_sse(uint8_t *ptr, ptrdiff_t stride,
+                                  const int* beta, const int* tc,
+                                  const bool* filterP, const bool* filterQ)
+{
+  luma_segment(ptr,          stride, true, beta[0],tc[0], filterP[0],filterQ[0], 8);
+  luma_segment(ptr+4*stride, stride, true, beta[1],tc[1], filterP[1],filterQ[1], 8);
+}
+
+void ff_hevc_deblock_luma_h_8_sse(uint8_t *ptr, ptrdiff_t stride,
+                                  const int* beta, const int* tc,
+                                  const bool* filterP, const bool* filterQ)
+{
+  luma_segment(ptr,   stride, false, beta[0],tc[0], filterP[0],filterQ[0], 8);
+  luma_segment(ptr+4, stride, false, beta[1],tc[1], filterP[1],filterQ[1], 8);
+}
+
+void ff_hevc_deblock_chroma_v_8_sse(uint8_t *cb, uint8_t *cr, ptrdiff_t stride,
+                                    const int* tc, bool filterP, bool filterQ)
+{
+  chroma_segment(cb, stride, true, tc[0], filterP,filterQ, 8);
+  chroma_segment(cr, stride, true, tc[1], filterP,filterQ, 8);
+}
+
+void ff_hevc_deblock_chroma_h_8_sse(uint8_t *cb, uint8_t *cr, ptrdiff_t stride,
+                                    const int* tc, bool filterP, bool filterQ)
+{
+  chroma_segment(cb, stride, false, tc[0], filterP,filterQ, 8);
+  chroma_segment(cr, stride, false, tc[1], filterP,filterQ, 8);
+}
+
+
+void ff_hevc_deblock_luma_v_16_sse(uint16_t *ptr, ptrdiff_t stride,
+                                   const int* beta, const int* tc,
+                                   const bool* filterP, const bool* filterQ, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    deblock_luma_v_16_fallback(ptr,stride, beta,tc, filterP,filterQ, bit_depth);
+    return;
+  }
+
+  luma_segment(ptr,          stride, true, beta[0],tc[0], filterP[0],filterQ[0], bit_depth);
+  luma_segment(ptr+4*stride, stride, true, beta[1],tc[1], filterP[1],filterQ[1], bit_depth);
+}
+
+void ff_hevc_deblock_luma_h_16_sse(uint16_t *ptr, ptrdiff_t stride,
+                                   const int* beta, const int* tc,
+                                   const bool* filterP, const bool* filterQ, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    deblock_luma_h_16_fallback(ptr,stride, beta,tc, filterP,filterQ, bit_depth);
+    return;
+  }
+
+  luma_segment(ptr,   stride, false, beta[0],tc[0], filterP[0],filterQ[0], bit_depth);
+  luma_segment(ptr+4, stride, false, beta[1],tc[1], filterP[1],filterQ[1], bit_depth);
+}
+
+void ff_hevc_deblock_chroma_v_16_sse(uint16_t *cb, uint16_t *cr, ptrdiff_t stride,
+                                     const int* tc, bool filterP, bool filterQ, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    deblock_chroma_v_16_fallback(cb,cr,stride, tc, filterP,filterQ, bit_depth);
+    return;
+  }
+
+  chroma_segment(cb, stride, true, tc[0], filterP,filterQ, bit_depth);
+  chroma_segment(cr, stride, true, tc[1], filterP,filterQ, bit_depth);
+}
+
+void ff_hevc_deblock_chroma_h_16_sse(uint16_t *cb, uint16_t *cr, ptrdiff_t stride,
+                                     const int* tc, bool filterP, bool filterQ, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    deblock_chroma_h_16_fallback(cb,cr,stride, tc, filterP,filterQ, bit_depth);
+    return;
+  }
+
+  chroma_segment(cb, stride, false, tc[0], filterP,filterQ, bit_depth);
+  chroma_segment(cr, stride, false, tc[1], filterP,filterQ, bit_depth);
+}
@@ -0,0 +1,641 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+
+#include "x86/sse-intrapred.h"
+#include "fallback-intrapred.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/* The [1 2 1] reference sample filter is computed with rounding averages:
+
+     (a + 2b + c + 2) >> 2  ==  avg( avg(a,c) - ((a^c)&1), b )
+
+   so that 8 bit samples do not have to be widened.
+
+   Planar prediction keeps the row-independent part of the sum per column
+   and updates it incrementally from row to row.
+
+   Angular prediction interpolates whole rows of the reference array with
+   PMADDUBSW (8 bit) or PMADDWD (16 bit). The horizontal modes (2-17) are
+   computed transposed into a temporary block, which is then transposed into
+   the output in 4x4 or 8x8 tiles. The boundary filters are scalar code.
+ */
+
+#define MAX_BLOCK_SIZE 64
+
+
+static inline int log2_size(int nT)
+{
+  int n=0;
+  while (nT>1) { n++; nT>>=1; }
+  return n;
+}
+
+static inline int min_int(int a, int b)
+{
+  return a<b ? a : b;
+}
+
+static inline int clip_pixel(int v, int maxval)
+{
+  if (v<0) return 0;
+  if (v>maxval) return maxval;
+  return v;
+}
+
+
+static inline __m128i load_pixels(const uint8_t* p, int n)
+{
+  if (n>=16)     return _mm_loadu_si128((const __m128i*)p);
+  else if (n==8) return _mm_loadl_epi64((const __m128i*)p);
+  else {
+    int32_t d;
+    memcpy(&d, p, 4);
+    return _mm_cvtsi32_si128(d);
+  }
+}
+
+static inline __m128i load_pixels(const uint16_t* p, int n)
+{
+  if (n>=8) return _mm_loadu_si128((const __m128i*)p);
+  else      return _mm_loadl_epi64((const __m128i*)p);
+}
+
+static inline void store_pixels(uint8_t* p, __m128i v, int n)
+{
+  if (n>=16)     _mm_storeu_si128((__m128i*)p, v);
+  else if (n==8) _mm_storel_epi64((__m128i*)p, v);
+  else {
+    int32_t d = _mm_cvtsi128_si32(v);
+    memcpy(p, &d, 4);
+  }
+}
+
+static inline void store_pixels(uint16_t* p, __m128i v, int n)
+{
+  if (n>=8) _mm_storeu_si128((__m128i*)p, v);
+  else      _mm_storel_epi64((__m128i*)p, v);
+}
+
+// number of pixels in one register
+static inline int vector_size(const uint8_t*)  { return 16; }
+static inline int vector_size(const uint16_t*) { return 8; }
+
+static inline __m128i set1_pixel(const uint8_t*,  int v) { return _mm_set1_epi8((char)v); }
+static inline __m128i set1_pixel(const uint16_t*, int v) { return _mm_set1_epi16((short)v); }
+
+static inline __m128i filter_121(__m128i a, __m128i b, __m128i c, const uint8_t*)
+{
+  __m128i ac = _mm_sub_epi8(_mm_avg_epu8(a,c), _mm_and_si128(_mm_xor_si128(a,c), _mm_set1_epi8(1)));
+  return _mm_avg_epu8(ac,b);
+}
+
+static inline __m128i filter_121(__m128i a, __m128i b, __m128i c, const uint16_t*)
+{
+  __m128i ac = _mm_sub_epi16(_mm_avg_epu16(a,c), _mm_and_si128(_mm_xor_si128(a,c), _mm_set1_epi16(1)));
+  return _mm_avg_epu16(ac,b);
+}
+
+
+// --- reference sample filtering ---
+
+template <class pixel_t>
+static void filter_border_121(pixel_t* p, int nT)
+{
+  pixel_t  pF_mem[4*MAX_BLOCK_SIZE+1];
+  pixel_t* pF = &pF_mem[2*MAX_BLOCK_SIZE];
+
+  // 4*nT-1 samples are filtered, the last register overlaps with the previous one
+
+  const int n = min_int(vector_size(p), 2*nT);
+  const int first = -(2*nT-1);
+  const int last  = 2*nT-1 - n+1;
+
+  for (int i=first ; ; i+=n) {
+    if (i>last) i=last;
+
+    __m128i a = load_pixels(p+i-1, n);
+    __m128i b = load_pixels(p+i  , n);
+    __m128i c = load_pixels(p+i+1, n);
+    store_pixels(pF+i, filter_121(a,b,c, p), n);
+
+    if (i==last) break;
+  }
+
+  memcpy(p+first, pF+first, (4*nT-1) * sizeof(pixel_t));
+}
+
+
+static void filter_border_strong(uint8_t* p)
+{
+  const __m128i p0 = _mm_set1_epi16(p[0]);
+  const __m128i dT = _mm_set1_epi16(p[ 64]-p[0]);
+  const __m128i dL = _mm_set1_epi16(p[-64]-p[0]);
+  const __m128i rnd = _mm_set1_epi16(32);
+
+  // i=64 reproduces the unfiltered end samples
+
+  for (int i=1;i<=57;i+=8) {
+    __m128i idx  = _mm_add_epi16(_mm_setr_epi16(0,1,2,3,4,5,6,7), _mm_set1_epi16(i));
+    __m128i idxR = _mm_add_epi16(_mm_setr_epi16(7,6,5,4,3,2,1,0), _mm_set1_epi16(i));
+
+    __m128i t = _mm_add_epi16(p0, _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(idx, dT), rnd), 6));
+    __m128i l = _mm_add_epi16(p0, _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(idxR,dL), rnd), 6));
+
+    _mm_storel_epi64((__m128i*)(p+i),   _mm_packus_epi16(t,t));
+    _mm_storel_epi64((__m128i*)(p-i-7), _mm_packus_epi16(l,l));
+  }
+}
+
+static void filter_border_strong(uint16_t* p)
+{
+  const __m128i p0 = _mm_set1_epi32(p[0]);
+  const __m128i dT = _mm_set1_epi32(p[ 64]-p[0]);
+  const __m128i dL = _mm_set1_epi32(p[-64]-p[0]);
+  const __m128i rnd = _mm_set1_epi32(32);
+
+  for (int i=1;i<=61;i+=4) {
+    __m128i idx  = _mm_add_epi32(_mm_setr_epi32(0,1,2,3), _mm_set1_epi32(i));
+    __m128i idxR = _mm_add_epi32(_mm_setr_epi32(3,2,1,0), _mm_set1_epi32(i));
+
+    __m128i t = _mm_add_epi32(p0, _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(idx, dT), rnd), 6));
+    __m128i l = _mm_add_epi32(p0, _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(idxR,dL), rnd), 6));
+
+    _mm_storel_epi64((__m128i*)(p+i),   _mm_packus_epi32(t,t));
+    _mm_storel_epi64((__m128i*)(p-i-3), _mm_packus_epi32(l,l));
+  }
+}
+
+
+void ff_hevc_intra_filter_8_sse(uint8_t *border, int nT, bool strong)
+{
+  if (strong) filter_border_strong(border);
+  else        filter_border_121(border, nT);
+}
+
+void ff_hevc_intra_filter_16_sse(uint16_t *border, int nT, bool strong)
+{
+  if (strong) filter_border_strong(border);
+  else        filter_border_121(border, nT);
+}
+
+
+// --- planar ---
+
+void ff_hevc_intra_pred_planar_8_sse(uint8_t *dst, ptrdiff_t dststride,
+                                     const uint8_t *border, int nT)
+{
+  const int shift = log2_size(nT)+1;
+  const int n = min_int(nT, 8);
+
+  const __m128i TR = _mm_set1_epi16(border[ 1+nT]);
+  const __m128i BL = _mm_set1_epi16(border[-1-nT]);
+
+  for (int x0=0;x0<nT;x0+=8) {
+    __m128i x  = _mm_add_epi16(_mm_setr_epi16(0,1,2,3,4,5,6,7), _mm_set1_epi16(x0));
+    __m128i T  = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(border+1+x0)));
+    __m128i wL = _mm_sub_epi16(_mm_set1_epi16(nT-1), x);
+
+    // (x+1)*TR + (nT-1-y)*T + (y+1)*BL + nT, for y=0
+
+    __m128i acc = _mm_mullo_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), TR);
+    acc = _mm_add_epi16(acc, _mm_mullo_epi16(T, _mm_set1_epi16(nT-1)));
+    acc = _mm_add_epi16(acc, _mm_add_epi16(BL, _mm_set1_epi16(nT)));
+
+    const __m128i dAcc = _mm_sub_epi16(BL, T);
+
+    uint8_t* out = dst+x0;
+    for (int y=0;y<nT;y++) {
+      __m128i L = _mm_set1_epi16(border[-1-y]);
+      __m128i v = _mm_srli_epi16(_mm_add_epi16(acc, _mm_mullo_epi16(wL, L)), shift);
+      store_pixels(out, _mm_packus_epi16(v,v), n);
+
+      acc = _mm_add_epi16(acc, dAcc);
+      out += dststride;
+    }
+  }
+}
+
+void ff_hevc_intra_pred_planar_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                      const uint16_t *border, int nT, int bit_depth)
+{
+  const int shift = log2_size(nT)+1;
+
+  const __m128i TR = _mm_set1_epi32(border[ 1+nT]);
+  const __m128i BL = _mm_set1_epi32(border[-1-nT]);
+
+  for (int x0=0;x0<nT;x0+=4) {
+    __m128i x  = _mm_add_epi32(_mm_setr_epi32(0,1,2,3), _mm_set1_epi32(x0));
+    __m128i T  = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(border+1+x0)));
+    __m128i wL = _mm_sub_epi32(_mm_set1_epi32(nT-1), x);
+
+    __m128i acc = _mm_mullo_epi32(_mm_add_epi32(x, _mm_set1_epi32(1)), TR);
+    acc = _mm_add_epi32(acc, _mm_mullo_epi32(T, _mm_set1_epi32(nT-1)));
+    acc = _mm_add_epi32(acc, _mm_add_epi32(BL, _mm_set1_epi32(nT)));
+
+    const __m128i dAcc = _mm_sub_epi32(BL, T);
+
+    uint16_t* out = dst+x0;
+    for (int y=0;y<nT;y++) {
+      __m128i L = _mm_set1_epi32(border[-1-y]);
+      __m128i v = _mm_srli_epi32(_mm_add_epi32(acc, _mm_mullo_epi32(wL, L)), shift);
+      _mm_storel_epi64((__m128i*)out, _mm_packus_epi32(v,v));
+
+      acc = _mm_add_epi32(acc, dAcc);
+      out += dststride;
+    }
+  }
+}
+
+
+// --- DC ---
+
+static int border_sum(const uint8_t* border, int nT)
+{
+  __m128i sum = _mm_setzero_si128();
+
+  for (int i=0;i<nT;i+=16) {
+    int n = min_int(nT,16);
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(load_pixels(border+1+i, n),   _mm_setzero_si128()));
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(load_pixels(border-n-i, n), _mm_setzero_si128()));
+  }
+
+  return _mm_cvtsi128_si32(sum) + _mm_extract_epi32(sum, 2);
+}
+
+static int border_sum(const uint16_t* border, int nT)
+{
+  __m128i sum = _mm_setzero_si128();
+
+  for (int i=0;i<nT;i+=4) {
+    sum = _mm_add_epi32(sum, _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(border+1+i))));
+    sum = _mm_add_epi32(sum, _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(border-4-i))));
+  }
+
+  sum = _mm_hadd_epi32(sum,sum);
+  sum = _mm_hadd_epi32(sum,sum);
+  return _mm_cvtsi128_si32(sum);
+}
+
+static inline __m128i dc_edge_row(const uint8_t* p, int dc3, int n)
+{
+  __m128i v = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)p));
+  v = _mm_srli_epi16(_mm_add_epi16(v, _mm_set1_epi16(dc3+2)), 2);
+  return _mm_packus_epi16(v,v);
+}
+
+static inline __m128i dc_edge_row(const uint16_t* p, int dc3, int n)
+{
+  __m128i v = load_pixels(p, n);
+  __m128i lo = _mm_cvtepu16_epi32(v);
+  __m128i hi = _mm_unpackhi_epi16(v, _mm_setzero_si128());
+  lo = _mm_srli_epi32(_mm_add_epi32(lo, _mm_set1_epi32(dc3+2)), 2);
+  hi = _mm_srli_epi32(_mm_add_epi32(hi, _mm_set1_epi32(dc3+2)), 2);
+  return _mm_packus_epi32(lo,hi);
+}
+
+template <class pixel_t>
+static void intra_pred_dc(pixel_t *dst, ptrdiff_t dststride,
+                          const pixel_t *border, int nT, int cIdx)
+{
+  const int dcVal = (border_sum(border,nT) + nT) >> (log2_size(nT)+1);
+
+  const int n = min_int(nT, vector_size(dst));
+  const __m128i dc = set1_pixel(dst, dcVal);
+
+  for (int y=0;y<nT;y++)
+    for (int x=0;x<nT;x+=n) {
+      store_pixels(dst+x+y*dststride, dc, n);
+    }
+
+  if (cIdx==0 && nT<32) {
+    // the edge row is at most 16 samples, compute it in units of 8 (or 4)
+
+    const int ne = min_int(nT, 8);
+    for (int x=0;x<nT;x+=ne) {
+      store_pixels(dst+x, dc_edge_row(border+1+x, 3*dcVal, ne), ne);
+    }
+
+    dst[0] = (border[-1] + 2*dcVal + border[1] +2) >> 2;
+
+    for (int y=1;y<nT;y++) { dst[y*dststride] = (border[-y-1] + 3*dcVal+2)>>2; }
+  }
+}
+
+void ff_hevc_intra_pred_dc_8_sse(uint8_t *dst, ptrdiff_t dststride,
+                                 const uint8_t *border, int nT, int cIdx)
+{
+  intra_pred_dc(dst,dststride, border,nT,cIdx);
+}
+
+void ff_hevc_intra_pred_dc_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                  const uint16_t *border, int nT, int cIdx, int bit_depth)
+{
+  intra_pred_dc(dst,dststride, border,nT,cIdx);
+}
+
+
+// --- angular ---
+
+static inline __m128i interpolate(const uint8_t* r, __m128i w, int n)
+{
+  __m128i a = load_pixels(r,   n);
+  __m128i b = load_pixels(r+1, n);
+
+  const __m128i rnd = _mm_set1_epi16(1<<10); // mulhrs: (v*2^10 + 2^14) >> 15 == (v+16)>>5
+
+  __m128i lo = _mm_mulhrs_epi16(_mm_maddubs_epi16(_mm_unpacklo_epi8(a,b), w), rnd);
+  __m128i hi = _mm_mulhrs_epi16(_mm_maddubs_epi16(_mm_unpackhi_epi8(a,b), w), rnd);
+
+  return _mm_packus_epi16(lo,hi);
+}
+
+static inline __m128i interpolate(const uint16_t* r, __m128i w, int n)
+{
+  __m128i a = load_pixels(r,   n);
+  __m128i b = load_pixels(r+1, n);
+
+  const __m128i rnd = _mm_set1_epi32(16);
+
+  __m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a,b), w), rnd), 5);
+  __m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a,b), w), rnd), 5);
+
+  return _mm_packus_epi32(lo,hi);
+}
+
+static inline __m128i interpolation_weights(const uint8_t*, int iFact)
+{
+  return _mm_set1_epi16((short)((iFact<<8) | (32-iFact)));
+}
+
+static inline __m128i interpolation_weights(const uint16_t*, int iFact)
+{
+  return _mm_set1_epi32((iFact<<16) | (32-iFact));
+}
+
+
+// Rows of the vertical prediction (or the columns of the horizontal prediction).
+
+template <class pixel_t>
+static void angular_rows(pixel_t* out, ptrdiff_t stride, const pixel_t* ref,
+                         int nT, int intraPredAngle)
+{
+  const int n = min_int(nT, vector_size(out));
+
+  for (int y=0;y<nT;y++) {
+    int iIdx = ((y+1)*intraPredAngle)>>5;
+    int iFact= ((y+1)*intraPredAngle)&31;
+
+    const pixel_t* r = ref+iIdx+1;
+
+    if (iFact != 0) {
+      __m128i w = interpolation_weights(out, iFact);
+
+      for (int x=0;x<nT;x+=n) {
+        store_pixels(out+x, interpolate(r+x, w, n), n);
+      }
+    }
+    else {
+      for (int x=0;x<nT;x+=n) {
+        store_pixels(out+x, load_pixels(r+x, n), n);
+      }
+    }
+
+    out += stride;
+  }
+}
+
+
+static void transpose_4x4(uint8_t* dst, ptrdiff_t dststride, const uint8_t* src, ptrdiff_t srcstride)
+{
+  __m128i r0 = load_pixels(src+0*srcstride, 4);
+  __m128i r1 = load_pixels(src+1*srcstride, 4);
+  __m128i r2 = load_pixels(src+2*srcstride, 4);
+  __m128i r3 = load_pixels(src+3*srcstride, 4);
+
+  __m128i t = _mm_unpacklo_epi16(_mm_unpacklo_epi8(r0,r1), _mm_unpacklo_epi8(r2,r3));
+
+  store_pixels(dst+0*dststride, t, 4);
+  store_pixels(dst+1*dststride, _mm_srli_si128(t,4), 4);
+  store_pixels(dst+2*dststride, _mm_srli_si128(t,8), 4);
+  store_pixels(dst+3*dststride, _mm_srli_si128(t,12), 4);
+}
+
+static void transpose_8x8(uint8_t* dst, ptrdiff_t dststride, const uint8_t* src, ptrdiff_t srcstride)
+{
+  __m128i a = _mm_unpacklo_epi8(load_pixels(src+0*srcstride, 8), load_pixels(src+1*srcstride, 8));
+  __m128i b = _mm_unpacklo_epi8(load_pixels(src+2*srcstride, 8), load_pixels(src+3*srcstride, 8));
+  __m128i c = _mm_unpacklo_epi8(load_pixels(src+4*srcstride, 8), load_pixels(src+5*srcstride, 8));
+  __m128i d = _mm_unpacklo_epi8(load_pixels(src+6*srcstride, 8), load_pixels(src+7*srcstride, 8));
+
+  __m128i ab_lo = _mm_unpacklo_epi16(a,b);
+  __m128i ab_hi = _mm_unpackhi_epi16(a,b);
+  __m128i cd_lo = _mm_unpacklo_epi16(c,d);
+  __m128i cd_hi = _mm_unpackhi_epi16(c,d);
+
+  __m128i c01 = _mm_unpacklo_epi32(ab_lo,cd_lo);
+  __m128i c23 = _mm_unpackhi_epi32(ab_lo,cd_lo);
+  __m128i c45 = _mm_unpacklo_epi32(ab_hi,cd_hi);
+  __m128i c67 = _mm_unpackhi_epi32(ab_hi,cd_hi);
+
+  store_pixels(dst+0*dststride, c01, 8);
+  store_pixels(dst+1*dststride, _mm_srli_si128(c01,8), 8);
+  store_pixels(dst+2*dststride, c23, 8);
+  store_pixels(dst+3*dststride, _mm_srli_si128(c23,8), 8);
+  store_pixels(dst+4*dststride, c45, 8);
+  store_pixels(dst+5*dststride, _mm_srli_si128(c45,8), 8);
+  store_pixels(dst+6*dststride, c67, 8);
+  store_pixels(dst+7*dststride, _mm_srli_si128(c67,8), 8);
+}
+
+static void transpose_4x4(uint16_t* dst, ptrdiff_t dststride, const uint16_t* src, ptrdiff_t srcstride)
+{
+  __m128i a = _mm_unpacklo_epi16(load_pixels(src+0*srcstride, 4), load_pixels(src+1*srcstride, 4));
+  __m128i b = _mm_unpacklo_epi16(load_pixels(src+2*srcstride, 4), load_pixels(src+3*srcstride, 4));
+
+  __m128i c01 = _mm_unpacklo_epi32(a,b);
+  __m128i c23 = _mm_unpackhi_epi32(a,b);
+
+  store_pixels(dst+0*dststride, c01, 4);
+  store_pixels(dst+1*dststride, _mm_srli_si128(c01,8), 4);
+  store_pixels(dst+2*dststride, c23, 4);
+  store_pixels(dst+3*dststride, _mm_srli_si128(c23,8), 4);
+}
+
+static void transpose_8x8(uint16_t* dst, ptrdiff_t dststride, const uint16_t* src, ptrdiff_t srcstride)
+{
+  __m128i r[8];
+  for (int i=0;i<8;i++) {
+    r[i] = load_pixels(src+i*srcstride, 8);
+  }
+
+  __m128i a0 = _mm_unpacklo_epi16(r[0],r[1]);
+  __m128i a1 = _mm_unpackhi_epi16(r[0],r[1]);
+  __m128i a2 = _mm_unpacklo_epi16(r[2],r[3]);
+  __m128i a3 = _mm_unpackhi_epi16(r[2],r[3]);
+  __m128i a4 = _mm_unpacklo_epi16(r[4],r[5]);
+  __m128i a5 = _mm_unpackhi_epi16(r[4],r[5]);
+  __m128i a6 = _mm_unpacklo_epi16(r[6],r[7]);
+  __m128i a7 = _mm_unpackhi_epi16(r[6],r[7]);
+
+  __m128i b0 = _mm_unpacklo_epi32(a0,a2);
+  __m128i b1 = _mm_unpackhi_epi32(a0,a2);
+  __m128i b2 = _mm_unpacklo_epi32(a1,a3);
+  __m128i b3 = _mm_unpackhi_epi32(a1,a3);
+  __m128i b4 = _mm_unpacklo_epi32(a4,a6);
+  __m128i b5 = _mm_unpackhi_epi32(a4,a6);
+  __m128i b6 = _mm_unpacklo_epi32(a5,a7);
+  __m128i b7 = _mm_unpackhi_epi32(a5,a7);
+
+  store_pixels(dst+0*dststride, _mm_unpacklo_epi64(b0,b4), 8);
+  store_pixels(dst+1*dststride, _mm_unpackhi_epi64(b0,b4), 8);
+  store_pixels(dst+2*dststride, _mm_unpacklo_epi64(b1,b5), 8);
+  store_pixels(dst+3*dststride, _mm_unpackhi_epi64(b1,b5), 8);
+  store_pixels(dst+4*dststride, _mm_unpacklo_epi64(b2,b6), 8);
+  store_pixels(dst+5*dststride, _mm_unpackhi_epi64(b2,b6), 8);
+  store_pixels(dst+6*dststride, _mm_unpacklo_epi64(b3,b7), 8);
+  store_pixels(dst+7*dststride, _mm_unpackhi_epi64(b3,b7), 8);
+}
+
+template <class pixel_t>
+static void transpose_block(pixel_t* dst, ptrdiff_t dststride,
+                            const pixel_t* src, ptrdiff_t srcstride, int nT)
+{
+  if (nT==4) {
+    transpose_4x4(dst,dststride, src,srcstride);
+    return;
+  }
+
+  for (int y=0;y<nT;y+=8)
+    for (int x=0;x<nT;x+=8) {
+      transpose_8x8(dst + x*dststride + y, dststride,
+                    src + y*srcstride + x, srcstride);
+    }
+}
+
+
+template <class pixel_t>
+static void intra_pred_angular(pixel_t *dst, ptrdiff_t dststride,
+                               const pixel_t *border, int nT, int mode, int cIdx,
+                               bool disableBoundaryFilter, int bit_depth)
+{
+  // The reference array is over-allocated, because full registers are read
+  // for block sizes that are smaller than a register.
+
+  pixel_t  ref_mem[4*MAX_BLOCK_SIZE+1];
+  pixel_t* ref=&ref_mem[2*MAX_BLOCK_SIZE];
+
+  const int intraPredAngle = intraPredAngle_table[mode];
+  const int maxval = (1<<bit_depth)-1;
+
+  if (mode >= 18) {
+    memcpy(ref, border, (nT+1)*sizeof(pixel_t));
+
+    if (intraPredAngle<0) {
+      int invAngle = invAngle_table[mode-11];
+
+      if ((nT*intraPredAngle)>>5 < -1) {
+        for (int x=(nT*intraPredAngle)>>5; x<=-1; x++) {
+          ref[x] = border[0-((x*invAngle+128)>>8)];
+        }
+      }
+    } else {
+      memcpy(ref+nT+1, border+nT+1, nT*sizeof(pixel_t));
+    }
+
+    angular_rows(dst,dststride, ref, nT, intraPredAngle);
+
+    if (mode==26 && cIdx==0 && nT<32 && !disableBoundaryFilter) {
+      for (int y=0;y<nT;y++) {
+        dst[0+y*dststride] = clip_pixel(border[1] + ((border[-1-y] - border[0])>>1), maxval);
+      }
+    }
+  }
+  else {
+    if (mode==10) {
+      // pure horizontal prediction, no need to transpose
+
+      for (int y=0;y<nT;y++) {
+        const int n = min_int(nT, vector_size(dst));
+        const __m128i v = set1_pixel(dst, border[-1-y]);
+
+        for (int x=0;x<nT;x+=n) {
+          store_pixels(dst+x+y*dststride, v, n);
+        }
+      }
+    }
+    else {
+      for (int x=0;x<=2*nT;x++) {
+        ref[x] = border[-x];
+      }
+
+      if (intraPredAngle<0) {
+        int invAngle = invAngle_table[mode-11];
+
+        if ((nT*intraPredAngle)>>5 < -1) {
+          for (int x=(nT*intraPredAngle)>>5; x<=-1; x++) {
+            ref[x] = border[((x*invAngle+128)>>8)];
+          }
+        }
+      }
+
+      pixel_t tmp[MAX_BLOCK_SIZE*MAX_BLOCK_SIZE];
+
+      angular_rows(tmp,MAX_BLOCK_SIZE, ref, nT, intraPredAngle);
+      transpose_block(dst,dststride, tmp,MAX_BLOCK_SIZE, nT);
+    }
+
+    if (mode==10 && cIdx==0 && nT<32 && !disableBoundaryFilter) {
+      for (int x=0;x<nT;x++) {
+        dst[x] = clip_pixel(border[-1] + ((border[1+x] - border[0])>>1), maxval);
+      }
+    }
+  }
+}
+
+void ff_hevc_intra_pred_angular_8_sse(uint8_t *dst, ptrdiff_t dststride,
+                                      const uint8_t *border, int nT, int mode, int cIdx,
+                                      bool disableBoundaryFilter)
+{
+  intra_pred_angular(dst,dststride, border,nT,mode,cIdx, disableBoundaryFilter, 8);
+}
+
+void ff_hevc_intra_pred_angular_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                       const uint16_t *border, int nT, int mode, int cIdx,
+                                       bool disableBoundaryFilter, int bit_depth)
+{
+  // PMADDWD multiplies signed 16 bit values
+
+  if (bit_depth > 15) {
+    intra_pred_angular_16_fallback(dst,dststride, border,nT,mode,cIdx,
+                                   disableBoundaryFilter, bit_depth);
+    return;
+  }
+
+  intra_pred_angular(dst,dststride, border,nT,mode,cIdx, disableBoundaryFilter, bit_depth);
+}
@@ -0,0 +1,51 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SSE_INTRAPRED_H
+#define SSE_INTRAPRED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* Intra prediction for block sizes 4 to 64, see fallback-intrapred.h for the
+   parameters. The 16 bit angular prediction is limited to 15 bit pixels,
+   16 bit pixels are passed on to the scalar fallback.
+ */
+
+void ff_hevc_intra_filter_8_sse(uint8_t *border, int nT, bool strong);
+void ff_hevc_intra_pred_planar_8_sse(uint8_t *dst, ptrdiff_t dststride,
+                                     const uint8_t *border, int nT);
+void ff_hevc_intra_pred_dc_8_sse(uint8_t *dst, ptrdiff_t dststride,
+                                 const uint8_t *border, int nT, int cIdx);
+void ff_hevc_intra_pred_angular_8_sse(uint8_t *dst, ptrdiff_t dststride,
+                                      const uint8_t *border, int nT, int mode, int cIdx,
+                                      bool disableBoundaryFilter);
+
+void ff_hevc_intra_filter_16_sse(uint16_t *border, int nT, bool strong);
+void ff_hevc_intra_pred_planar_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                      const uint16_t *border, int nT, int bit_depth);
+void ff_hevc_intra_pred_dc_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                  const uint16_t *border, int nT, int cIdx, int bit_depth);
+void ff_hevc_intra_pred_angular_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                       const uint16_t *border, int nT, int mode, int cIdx,
+                                       bool disableBoundaryFilter, int bit_depth);
+
+#endif
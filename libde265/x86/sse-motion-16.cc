@@ -0,0 +1,460 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+
+#include "x86/sse-motion-16.h"
+#include "fallback-motion.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/* The kernels compute exactly the same values as the scalar fallback.
+   Up to 12 bits, the pixels and all intermediate values of the separable
+   filters fit into 16 bits, the filter sums are accumulated in 32 bits.
+   Rows are processed in groups of 8 samples, only 'width' samples are
+   written per row.
+ */
+
+#define MAX_PB_SIZE 64  // row stride of the intermediate buffer (mcbuffer)
+#define MAX_BIT_DEPTH 12
+
+
+// Luma filters, applied to 8 samples starting 'qpel_offset' samples before
+// the current position. The 1/4 and 3/4 filters only have 7 taps.
+
+static const int16_t qpel_filters[3][8] = {
+  { -1, 4,-10, 58, 17, -5, 1, 0 },
+  { -1, 4,-11, 40, 40,-11, 4,-1 },
+  {  1,-5, 17, 58,-10,  4,-1, 0 }
+};
+
+static const int qpel_offset[3] = { 3,3,2 };
+static const int qpel_taps[3]   = { 7,8,7 };
+
+static const int16_t epel_filters[7][4] = {
+  { -2, 58, 10, -2 },
+  { -4, 54, 16, -2 },
+  { -6, 46, 28, -4 },
+  { -4, 36, 36, -4 },
+  { -4, 28, 46, -6 },
+  { -2, 16, 54, -4 },
+  { -2, 10, 58, -2 }
+};
+
+
+// two 16-bit coefficients in each 32-bit lane (for madd)
+static inline __m128i coeff_pair(int16_t c0, int16_t c1)
+{
+  return _mm_set1_epi32((int32_t)((uint16_t)c0 | ((uint32_t)(uint16_t)c1 << 16)));
+}
+
+
+// store the lowest n (<8) 16-bit values
+static inline void store_partial_epi16(int16_t* dst, __m128i v, int n)
+{
+  if (n & 4) {
+    _mm_storel_epi64((__m128i*)dst, v);
+    v = _mm_srli_si128(v, 8);
+    dst += 4;
+  }
+  if (n & 2) {
+    int32_t d = _mm_cvtsi128_si32(v);
+    memcpy(dst, &d, 4);
+    v = _mm_srli_si128(v, 4);
+    dst += 2;
+  }
+  if (n & 1) {
+    *dst = (int16_t)_mm_cvtsi128_si32(v);
+  }
+}
+
+
+/* Runs 'kernel' over all samples of the block. A kernel provides
+   filter8(), which computes 8 output samples starting at (x,y).
+ */
+template <class kernel>
+static inline void filter_block(int16_t* dst, ptrdiff_t dststride,
+                                int width, int height, const kernel& k)
+{
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+8<=width;x+=8) {
+      _mm_storeu_si128((__m128i*)(dst+x), k.filter8(y,x));
+    }
+
+    if (x<width) {
+      store_partial_epi16(dst+x, k.filter8(y,x), width-x);
+    }
+
+    dst += dststride;
+  }
+}
+
+
+// full-sample position: scale pixels to 14 bit
+
+struct pixels_kernel_16_sse
+{
+  pixels_kernel_16_sse(const uint16_t* s, ptrdiff_t st, int shift)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shift)) { }
+
+  __m128i filter8(int y,int x) const {
+    return _mm_sll_epi16(_mm_loadu_si128((const __m128i*)(src + y*stride + x)), shift);
+  }
+
+  const uint16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+};
+
+
+/* Horizontal filter. Neighboring pixels are interleaved and multiplied
+   with a pair of coefficients (madd), accumulating in 32 bits. 7-tap
+   filters are applied as 8-tap filters with a zero coefficient.
+ */
+template <int nTaps>
+struct h_kernel_16_sse
+{
+  enum { nPairs = nTaps/2 };
+
+  // 's' points to the sample below the first filter tap
+  h_kernel_16_sse(const uint16_t* s, ptrdiff_t st, const int16_t* c, int shift)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shift)) {
+    for (int j=0;j<nPairs;j++) {
+      coeff[j] = coeff_pair(c[2*j], c[2*j+1]);
+    }
+  }
+
+  __m128i filter8(int y,int x) const {
+    const int16_t* p = (const int16_t*)(src + y*stride + x);
+
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    for (int j=0;j<nPairs;j++) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(p + 2*j));
+      __m128i b = _mm_loadu_si128((const __m128i*)(p + 2*j+1));
+
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a,b), coeff[j]));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a,b), coeff[j]));
+    }
+
+    return _mm_packs_epi32(_mm_sra_epi32(lo, shift),
+                           _mm_sra_epi32(hi, shift));
+  }
+
+  const uint16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m128i coeff[nPairs];
+};
+
+
+/* Vertical filter on pixels or on the output of the horizontal pass.
+   For an odd number of taps, the last row is paired with itself and a zero
+   coefficient, such that no row outside of the filter support is read.
+   Like the scalar code, the result is truncated (not saturated) to 16 bits.
+ */
+template <int nTaps>
+struct v_kernel_16_sse
+{
+  enum { nPairs = (nTaps+1)/2 };
+
+  // 's' points to the row of the first filter tap
+  v_kernel_16_sse(const int16_t* s, ptrdiff_t st, const int16_t* c, int shift)
+    : src(s), stride(st), shift(_mm_cvtsi32_si128(shift)) {
+    for (int j=0;j<nPairs;j++) {
+      coeff[j] = coeff_pair(c[2*j], 2*j+1<nTaps ? c[2*j+1] : 0);
+    }
+  }
+
+  static int second_row(int j) { return 2*j+1<nTaps ? 2*j+1 : 2*j; }
+
+  __m128i filter8(int y,int x) const {
+    const int16_t* p = src + y*stride + x;
+
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    for (int j=0;j<nPairs;j++) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(p + 2*j          *stride));
+      __m128i b = _mm_loadu_si128((const __m128i*)(p + second_row(j)*stride));
+
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a,b), coeff[j]));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a,b), coeff[j]));
+    }
+
+    const __m128i mask = _mm_set1_epi32(0xFFFF);
+    lo = _mm_and_si128(_mm_sra_epi32(lo, shift), mask);
+    hi = _mm_and_si128(_mm_sra_epi32(hi, shift), mask);
+
+    return _mm_packus_epi32(lo,hi);
+  }
+
+  const int16_t* src;
+  ptrdiff_t stride;
+  __m128i shift;
+  __m128i coeff[nPairs];
+};
+
+
+// --- final prediction output ---
+
+static inline __m128i clip_pixels(__m128i v, __m128i maxval)
+{
+  return _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()), maxval);
+}
+
+static inline uint16_t clip_pixel(int v, int bit_depth)
+{
+  int maxval = (1<<bit_depth)-1;
+  return v<0 ? 0 : v>maxval ? maxval : v;
+}
+
+void ff_hevc_put_unweighted_pred_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                        const int16_t *src, ptrdiff_t srcstride,
+                                        int width, int height, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_unweighted_pred_16_fallback(dst,dststride, src,srcstride, width,height, bit_depth);
+    return;
+  }
+
+  // (v + (1<<(shift1-1))) >> shift1 == mulhrs(v, 1<<(15-shift1))
+  const int shift1 = 14-bit_depth;
+  const __m128i scale  = _mm_set1_epi16(1<<(15-shift1));
+  const __m128i maxval = _mm_set1_epi16((1<<bit_depth)-1);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+8<=width;x+=8) {
+      __m128i v = _mm_mulhrs_epi16(_mm_loadu_si128((const __m128i*)(src+x)), scale);
+      _mm_storeu_si128((__m128i*)(dst+x), clip_pixels(v, maxval));
+    }
+
+    if (x+4<=width) {
+      __m128i v = _mm_mulhrs_epi16(_mm_loadl_epi64((const __m128i*)(src+x)), scale);
+      _mm_storel_epi64((__m128i*)(dst+x), clip_pixels(v, maxval));
+      x+=4;
+    }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel((src[x] + (1<<(shift1-1)))>>shift1, bit_depth);
+    }
+
+    dst += dststride;
+    src += srcstride;
+  }
+}
+
+
+void ff_hevc_put_weighted_pred_avg_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                          const int16_t *src1, const int16_t *src2,
+                                          ptrdiff_t srcstride, int width,
+                                          int height, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_weighted_pred_avg_16_fallback(dst,dststride, src1,src2,srcstride, width,height, bit_depth);
+    return;
+  }
+
+  // (v + (1<<(shift2-1))) >> shift2 == mulhrs(v, 1<<(15-shift2)).
+  // The saturating add only changes values that are clipped anyway.
+  const __m128i scale  = _mm_set1_epi16(1<<bit_depth);
+  const __m128i maxval = _mm_set1_epi16((1<<bit_depth)-1);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+8<=width;x+=8) {
+      __m128i v = _mm_adds_epi16(_mm_loadu_si128((const __m128i*)(src1+x)),
+                                 _mm_loadu_si128((const __m128i*)(src2+x)));
+      v = _mm_mulhrs_epi16(v, scale);
+      _mm_storeu_si128((__m128i*)(dst+x), clip_pixels(v, maxval));
+    }
+
+    if (x+4<=width) {
+      __m128i v = _mm_adds_epi16(_mm_loadl_epi64((const __m128i*)(src1+x)),
+                                 _mm_loadl_epi64((const __m128i*)(src2+x)));
+      v = _mm_mulhrs_epi16(v, scale);
+      _mm_storel_epi64((__m128i*)(dst+x), clip_pixels(v, maxval));
+      x+=4;
+    }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel((src1[x] + src2[x] + (1<<(14-bit_depth)))>>(15-bit_depth), bit_depth);
+    }
+
+    dst  += dststride;
+    src1 += srcstride;
+    src2 += srcstride;
+  }
+}
+
+
+// --- chroma ---
+
+void ff_hevc_put_hevc_epel_pixels_16_sse(int16_t *dst, ptrdiff_t dststride,
+                                         const uint16_t *src, ptrdiff_t srcstride,
+                                         int width, int height,
+                                         int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_epel_16_fallback(dst,dststride, src,srcstride, width,height, mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block(dst,dststride, width,height, pixels_kernel_16_sse(src,srcstride, 14-bit_depth));
+}
+
+void ff_hevc_put_hevc_epel_h_16_sse(int16_t *dst, ptrdiff_t dststride,
+                                    const uint16_t *src, ptrdiff_t srcstride,
+                                    int width, int height,
+                                    int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_epel_hv_fallback(dst,dststride, src,srcstride, width,height, mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block(dst,dststride, width,height,
+               h_kernel_16_sse<4>(src-1, srcstride, epel_filters[mx-1], bit_depth-8));
+}
+
+void ff_hevc_put_hevc_epel_v_16_sse(int16_t *dst, ptrdiff_t dststride,
+                                    const uint16_t *src, ptrdiff_t srcstride,
+                                    int width, int height,
+                                    int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_epel_hv_fallback(dst,dststride, src,srcstride, width,height, mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  filter_block(dst,dststride, width,height,
+               v_kernel_16_sse<4>((const int16_t*)(src-srcstride), srcstride,
+                              epel_filters[my-1], bit_depth-8));
+}
+
+void ff_hevc_put_hevc_epel_hv_16_sse(int16_t *dst, ptrdiff_t dststride,
+                                     const uint16_t *src, ptrdiff_t srcstride,
+                                     int width, int height,
+                                     int mx, int my, int16_t* mcbuffer, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_epel_hv_fallback(dst,dststride, src,srcstride, width,height, mx,my, mcbuffer, bit_depth);
+    return;
+  }
+
+  // horizontal pass for the rows -1 .. height+1
+
+  filter_block(mcbuffer,MAX_PB_SIZE, width,height+3,
+               h_kernel_16_sse<4>(src-srcstride-1, srcstride, epel_filters[mx-1], bit_depth-8));
+
+  filter_block(dst,dststride, width,height,
+               v_kernel_16_sse<4>(mcbuffer, MAX_PB_SIZE, epel_filters[my-1], 6));
+}
+
+
+// --- luma ---
+
+static inline void qpel_h(int16_t *dst, ptrdiff_t dststride,
+                          const uint16_t *src, ptrdiff_t srcstride,
+                          int width, int height, int xFrac, int bit_depth)
+{
+  filter_block(dst,dststride, width,height,
+               h_kernel_16_sse<8>(src - qpel_offset[xFrac-1], srcstride,
+                              qpel_filters[xFrac-1], bit_depth-8));
+}
+
+static inline void qpel_v(int16_t *dst, ptrdiff_t dststride,
+                          const uint16_t *src, ptrdiff_t srcstride,
+                          int width, int height, int yFrac, int bit_depth)
+{
+  const int16_t* s = (const int16_t*)(src - qpel_offset[yFrac-1]*srcstride);
+  const int16_t* c = qpel_filters[yFrac-1];
+
+  if (qpel_taps[yFrac-1]==8) {
+    filter_block(dst,dststride, width,height, v_kernel_16_sse<8>(s,srcstride,c, bit_depth-8));
+  }
+  else {
+    filter_block(dst,dststride, width,height, v_kernel_16_sse<7>(s,srcstride,c, bit_depth-8));
+  }
+}
+
+static inline void qpel_hv(int16_t *dst, ptrdiff_t dststride,
+                           const uint16_t *src, ptrdiff_t srcstride,
+                           int width, int height, int16_t* mcbuffer,
+                           int xFrac, int yFrac, int bit_depth)
+{
+  const int16_t* c = qpel_filters[yFrac-1];
+  int nTaps = qpel_taps[yFrac-1];
+
+  // horizontal pass for all rows covered by the vertical filter
+
+  qpel_h(mcbuffer,MAX_PB_SIZE, src - qpel_offset[yFrac-1]*srcstride, srcstride,
+         width, height+nTaps-1, xFrac, bit_depth);
+
+  if (nTaps==8) {
+    filter_block(dst,dststride, width,height, v_kernel_16_sse<8>(mcbuffer,MAX_PB_SIZE,c, 6));
+  }
+  else {
+    filter_block(dst,dststride, width,height, v_kernel_16_sse<7>(mcbuffer,MAX_PB_SIZE,c, 6));
+  }
+}
+
+
+#define QPEL_FUNC(name, fallback, call)                                 \
+  void ff_hevc_put_hevc_qpel_ ## name ## _16_sse(int16_t *dst, ptrdiff_t dststride, \
+                                                 const uint16_t *src, ptrdiff_t srcstride, \
+                                                 int width, int height, int16_t* mcbuffer, \
+                                                 int bit_depth)         \
+  {                                                                     \
+    if (bit_depth > MAX_BIT_DEPTH) {                                    \
+      fallback(dst,dststride, src,srcstride, width,height, mcbuffer, bit_depth); \
+      return;                                                           \
+    }                                                                   \
+                                                                        \
+    call;                                                               \
+  }
+
+QPEL_FUNC(pixels, put_qpel_0_0_fallback_16,
+          filter_block(dst,dststride, width,height, pixels_kernel_16_sse(src,srcstride, 14-bit_depth)))
+
+QPEL_FUNC(h_1, put_qpel_1_0_fallback_16, qpel_h(dst,dststride, src,srcstride, width,height, 1, bit_depth))
+QPEL_FUNC(h_2, put_qpel_2_0_fallback_16, qpel_h(dst,dststride, src,srcstride, width,height, 2, bit_depth))
+QPEL_FUNC(h_3, put_qpel_3_0_fallback_16, qpel_h(dst,dststride, src,srcstride, width,height, 3, bit_depth))
+
+QPEL_FUNC(v_1, put_qpel_0_1_fallback_16, qpel_v(dst,dststride, src,srcstride, width,height, 1, bit_depth))
+QPEL_FUNC(v_2, put_qpel_0_2_fallback_16, qpel_v(dst,dststride, src,srcstride, width,height, 2, bit_depth))
+QPEL_FUNC(v_3, put_qpel_0_3_fallback_16, qpel_v(dst,dststride, src,srcstride, width,height, 3, bit_depth))
+
+QPEL_FUNC(h_1_v_1, put_qpel_1_1_fallback_16, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 1,1, bit_depth))
+QPEL_FUNC(h_1_v_2, put_qpel_1_2_fallback_16, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 1,2, bit_depth))
+QPEL_FUNC(h_1_v_3, put_qpel_1_3_fallback_16, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 1,3, bit_depth))
+QPEL_FUNC(h_2_v_1, put_qpel_2_1_fallback_16, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 2,1, bit_depth))
+QPEL_FUNC(h_2_v_2, put_qpel_2_2_fallback_16, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 2,2, bit_depth))
+QPEL_FUNC(h_2_v_3, put_qpel_2_3_fallback_16, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 2,3, bit_depth))
+QPEL_FUNC(h_3_v_1, put_qpel_3_1_fallback_16, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 3,1, bit_depth))
+QPEL_FUNC(h_3_v_2, put_qpel_3_2_fallback_16, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 3,2, bit_depth))
+QPEL_FUNC(h_3_v_3, put_qpel_3_3_fallback_16, qpel_hv(dst,dststride, src,srcstride, width,height, mcbuffer, 3,3, bit_depth))
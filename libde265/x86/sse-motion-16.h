@@ -0,0 +1,83 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SSE_MOTION_16_H
+#define SSE_MOTION_16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* Motion compensation for 9 to 12 bit pixels. Larger bit depths are passed
+   on to the scalar fallback functions.
+ */
+
+void ff_hevc_put_unweighted_pred_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                        const int16_t *src, ptrdiff_t srcstride,
+                                        int width, int height, int bit_depth);
+
+void ff_hevc_put_weighted_pred_avg_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                          const int16_t *src1, const int16_t *src2,
+                                          ptrdiff_t srcstride, int width,
+                                          int height, int bit_depth);
+
+void ff_hevc_put_hevc_epel_pixels_16_sse(int16_t *dst, ptrdiff_t dststride,
+                                         const uint16_t *src, ptrdiff_t srcstride,
+                                         int width, int height,
+                                         int mx, int my, int16_t* mcbuffer, int bit_depth);
+void ff_hevc_put_hevc_epel_h_16_sse(int16_t *dst, ptrdiff_t dststride,
+                                    const uint16_t *src, ptrdiff_t srcstride,
+                                    int width, int height,
+                                    int mx, int my, int16_t* mcbuffer, int bit_depth);
+void ff_hevc_put_hevc_epel_v_16_sse(int16_t *dst, ptrdiff_t dststride,
+                                    const uint16_t *src, ptrdiff_t srcstride,
+                                    int width, int height,
+                                    int mx, int my, int16_t* mcbuffer, int bit_depth);
+void ff_hevc_put_hevc_epel_hv_16_sse(int16_t *dst, ptrdiff_t dststride,
+                                     const uint16_t *src, ptrdiff_t srcstride,
+                                     int width, int height,
+                                     int mx, int my, int16_t* mcbuffer, int bit_depth);
+
+#define DECLARE_QPEL_16_SSE(name)                                       \
+  void ff_hevc_put_hevc_qpel_ ## name ## _16_sse(int16_t *dst, ptrdiff_t dststride, \
+                                                 const uint16_t *src, ptrdiff_t srcstride, \
+                                                 int width, int height, int16_t* mcbuffer, \
+                                                 int bit_depth);
+
+DECLARE_QPEL_16_SSE(pixels)
+DECLARE_QPEL_16_SSE(v_1)
+DECLARE_QPEL_16_SSE(v_2)
+DECLARE_QPEL_16_SSE(v_3)
+DECLARE_QPEL_16_SSE(h_1)
+DECLARE_QPEL_16_SSE(h_2)
+DECLARE_QPEL_16_SSE(h_3)
+DECLARE_QPEL_16_SSE(h_1_v_1)
+DECLARE_QPEL_16_SSE(h_1_v_2)
+DECLARE_QPEL_16_SSE(h_1_v_3)
+DECLARE_QPEL_16_SSE(h_2_v_1)
+DECLARE_QPEL_16_SSE(h_2_v_2)
+DECLARE_QPEL_16_SSE(h_2_v_3)
+DECLARE_QPEL_16_SSE(h_3_v_1)
+DECLARE_QPEL_16_SSE(h_3_v_2)
+DECLARE_QPEL_16_SSE(h_3_v_3)
+
+#undef DECLARE_QPEL_16_SSE
+
+#endif
@@ -0,0 +1,359 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+
+#include "x86/sse-sao.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/* Both SAO types are implemented as a table lookup of the offset with PSHUFB,
+   indexed with the band (relative to the band position) or the edge class.
+   To clip the result without widening 8 bit pixels, the positive and the
+   negative part of the offsets are looked up separately and added/subtracted
+   with unsigned saturation. The same also avoids overflows for 16 bit pixels.
+
+   16 bit pixels use byte pair indices (2i, 2i+1) into 16 bit tables.
+
+   Rows are processed in full registers, remaining pixels with 8 and 4 pixel
+   wide loads, and a scalar loop for the rest.
+ */
+
+
+static inline __m128i load_pixels(const uint8_t* p, int n)
+{
+  if (n==16)     return _mm_loadu_si128((const __m128i*)p);
+  else if (n==8) return _mm_loadl_epi64((const __m128i*)p);
+  else {
+    int32_t d;
+    memcpy(&d, p, 4);
+    return _mm_cvtsi32_si128(d);
+  }
+}
+
+static inline __m128i load_pixels(const uint16_t* p, int n)
+{
+  if (n==8) return _mm_loadu_si128((const __m128i*)p);
+  else      return _mm_loadl_epi64((const __m128i*)p);
+}
+
+static inline void store_pixels(uint8_t* p, __m128i v, int n)
+{
+  if (n==16)     _mm_storeu_si128((__m128i*)p, v);
+  else if (n==8) _mm_storel_epi64((__m128i*)p, v);
+  else {
+    int32_t d = _mm_cvtsi128_si32(v);
+    memcpy(p, &d, 4);
+  }
+}
+
+static inline void store_pixels(uint16_t* p, __m128i v, int n)
+{
+  if (n==8) _mm_storeu_si128((__m128i*)p, v);
+  else      _mm_storel_epi64((__m128i*)p, v);
+}
+
+
+// positive and negative part of the offsets, as 8 or 16 bit table entries
+
+struct offset_tables
+{
+  __m128i pos, neg;
+
+  offset_tables(const int8_t* offsets, int n, bool wide)
+  {
+    int8_t  p8[16]  = { 0 }, n8[16]  = { 0 };
+    int16_t p16[8]  = { 0 }, n16[8]  = { 0 };
+
+    for (int i=0;i<n;i++) {
+      int o = offsets[i];
+      p8[i] = p16[i] = (o>0 ?  o : 0);
+      n8[i] = n16[i] = (o<0 ? -o : 0);
+    }
+
+    if (wide) {
+      pos = _mm_loadu_si128((const __m128i*)p16);
+      neg = _mm_loadu_si128((const __m128i*)n16);
+    }
+    else {
+      pos = _mm_loadu_si128((const __m128i*)p8);
+      neg = _mm_loadu_si128((const __m128i*)n8);
+    }
+  }
+};
+
+static inline __m128i add_offsets_8(__m128i pix, __m128i idx, const offset_tables& t)
+{
+  return _mm_subs_epu8(_mm_adds_epu8(pix, _mm_shuffle_epi8(t.pos, idx)),
+                       _mm_shuffle_epi8(t.neg, idx));
+}
+
+static inline __m128i add_offsets_16(__m128i pix, __m128i idx, const offset_tables& t,
+                                     __m128i maxval)
+{
+  // byte indices (2*idx, 2*idx+1) of the 16 bit table entries
+  idx = _mm_add_epi16(_mm_or_si128(_mm_slli_epi16(idx,1), _mm_slli_epi16(idx,9)),
+                      _mm_set1_epi16(0x0100));
+
+  __m128i v = _mm_subs_epu16(_mm_adds_epu16(pix, _mm_shuffle_epi8(t.pos, idx)),
+                             _mm_shuffle_epi8(t.neg, idx));
+  return _mm_min_epu16(v, maxval);
+}
+
+
+/* Applies 'op' to all pixels of the block. 'op(in,n)' filters n pixels starting at 'in',
+   'op.scalar(in)' a single one.
+ */
+template <class pixel_t, class Op>
+static inline void sao_block(pixel_t *out, ptrdiff_t out_stride,
+                             const pixel_t *in, ptrdiff_t in_stride,
+                             int width, int height, const Op& op)
+{
+  const int N = 16/sizeof(pixel_t);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+
+    for (;x+N<=width;x+=N) {
+      store_pixels(out+x, op(in+x, N), N);
+    }
+
+    for (int n=N/2;n>=4;n/=2)
+      if (x+n<=width) {
+        store_pixels(out+x, op(in+x, n), n);
+        x+=n;
+      }
+
+    for (;x<width;x++) {
+      out[x] = op.scalar(in+x);
+    }
+
+    in  += in_stride;
+    out += out_stride;
+  }
+}
+
+
+// --- band offset ---
+
+struct band_8
+{
+  offset_tables t;
+  const int8_t* offsets;
+  int bandPosition;
+  __m128i pos;
+
+  band_8(int bandPos, const int8_t* o) : t(o,4,false), offsets(o), bandPosition(bandPos)
+  {
+    pos = _mm_set1_epi8(bandPos);
+  }
+
+  __m128i operator()(const uint8_t* in, int n) const
+  {
+    __m128i pix  = load_pixels(in,n);
+    __m128i band = _mm_and_si128(_mm_srli_epi16(pix,3), _mm_set1_epi8(0x1F));
+    __m128i k    = _mm_and_si128(_mm_sub_epi8(band,pos), _mm_set1_epi8(0x1F));
+    __m128i idx  = _mm_min_epu8(k, _mm_set1_epi8(4));
+
+    return add_offsets_8(pix, idx, t);
+  }
+
+  uint8_t scalar(const uint8_t* in) const
+  {
+    int k = ((*in>>3) - bandPosition) & 31;
+    int v = *in + (k<4 ? offsets[k] : 0);
+    return v<0 ? 0 : v>255 ? 255 : v;
+  }
+};
+
+struct band_16
+{
+  offset_tables t;
+  const int8_t* offsets;
+  int bandPosition;
+  int bitDepth;
+  __m128i pos, shift, maxval;
+
+  band_16(int bandPos, const int8_t* o, int bit_depth)
+    : t(o,4,true), offsets(o), bandPosition(bandPos), bitDepth(bit_depth)
+  {
+    pos    = _mm_set1_epi16(bandPos);
+    shift  = _mm_cvtsi32_si128(bit_depth-5);
+    maxval = _mm_set1_epi16((1<<bit_depth)-1);
+  }
+
+  __m128i operator()(const uint16_t* in, int n) const
+  {
+    __m128i pix  = load_pixels(in,n);
+    __m128i band = _mm_srl_epi16(pix,shift);
+    __m128i k    = _mm_and_si128(_mm_sub_epi16(band,pos), _mm_set1_epi16(0x1F));
+    __m128i idx  = _mm_min_epu16(k, _mm_set1_epi16(4));
+
+    return add_offsets_16(pix, idx, t, maxval);
+  }
+
+  uint16_t scalar(const uint16_t* in) const
+  {
+    int maxPixelValue = (1<<bitDepth)-1;
+    int k = ((*in>>(bitDepth-5)) - bandPosition) & 31;
+    int v = *in + (k<4 ? offsets[k] : 0);
+    return v<0 ? 0 : v>maxPixelValue ? maxPixelValue : v;
+  }
+};
+
+
+// --- edge offset ---
+
+static const int8_t hPos[4][2] = { { -1,1 }, {  0,0 }, { -1,1 }, { 1,-1 } };
+static const int8_t vPos[4][2] = { {  0,0 }, { -1,1 }, { -1,1 }, { -1,1 } };
+
+static inline int sign(int v) { return (v>0) - (v<0); }
+
+// sign(a-b) of biased (signed) values
+static inline __m128i sign_8(__m128i a, __m128i b)
+{
+  return _mm_sub_epi8(_mm_cmpgt_epi8(b,a), _mm_cmpgt_epi8(a,b));
+}
+
+static inline __m128i sign_16(__m128i a, __m128i b)
+{
+  return _mm_sub_epi16(_mm_cmpgt_epi16(b,a), _mm_cmpgt_epi16(a,b));
+}
+
+struct edge_8
+{
+  offset_tables t;
+  const int8_t* offsets;
+  ptrdiff_t n0, n1;
+
+  edge_8(int eoClass, ptrdiff_t stride, const int8_t* o) : t(o,5,false), offsets(o)
+  {
+    n0 = hPos[eoClass][0] + vPos[eoClass][0]*stride;
+    n1 = hPos[eoClass][1] + vPos[eoClass][1]*stride;
+  }
+
+  __m128i operator()(const uint8_t* in, int n) const
+  {
+    const __m128i bias = _mm_set1_epi8(-128);
+
+    __m128i pix = load_pixels(in,n);
+    __m128i a   = _mm_xor_si128(pix, bias);
+    __m128i b0  = _mm_xor_si128(load_pixels(in+n0,n), bias);
+    __m128i b1  = _mm_xor_si128(load_pixels(in+n1,n), bias);
+
+    __m128i idx = _mm_add_epi8(_mm_add_epi8(sign_8(a,b0), sign_8(a,b1)), _mm_set1_epi8(2));
+
+    return add_offsets_8(pix, idx, t);
+  }
+
+  uint8_t scalar(const uint8_t* in) const
+  {
+    int v = *in + offsets[sign(*in - in[n0]) + sign(*in - in[n1]) + 2];
+    return v<0 ? 0 : v>255 ? 255 : v;
+  }
+};
+
+struct edge_16
+{
+  offset_tables t;
+  const int8_t* offsets;
+  ptrdiff_t n0, n1;
+  int maxPixelValue;
+  __m128i maxval;
+
+  edge_16(int eoClass, ptrdiff_t stride, const int8_t* o, int bit_depth)
+    : t(o,5,true), offsets(o)
+  {
+    n0 = hPos[eoClass][0] + vPos[eoClass][0]*stride;
+    n1 = hPos[eoClass][1] + vPos[eoClass][1]*stride;
+    maxPixelValue = (1<<bit_depth)-1;
+    maxval = _mm_set1_epi16(maxPixelValue);
+  }
+
+  __m128i operator()(const uint16_t* in, int n) const
+  {
+    const __m128i bias = _mm_set1_epi16(-32768);
+
+    __m128i pix = load_pixels(in,n);
+    __m128i a   = _mm_xor_si128(pix, bias);
+    __m128i b0  = _mm_xor_si128(load_pixels(in+n0,n), bias);
+    __m128i b1  = _mm_xor_si128(load_pixels(in+n1,n), bias);
+
+    __m128i idx = _mm_add_epi16(_mm_add_epi16(sign_16(a,b0), sign_16(a,b1)), _mm_set1_epi16(2));
+
+    return add_offsets_16(pix, idx, t, maxval);
+  }
+
+  uint16_t scalar(const uint16_t* in) const
+  {
+    int v = *in + offsets[sign(*in - in[n0]) + sign(*in - in[n1]) + 2];
+    return v<0 ? 0 : v>maxPixelValue ? maxPixelValue : v;
+  }
+};
+
+
+// --- exported functions ---
+
+void ff_hevc_sao_band_8_sse(uint8_t *out, ptrdiff_t out_stride,
+                            const uint8_t *in, ptrdiff_t in_stride,
+                            int width, int height, int bandPosition, const int8_t* offsets)
+{
+  sao_block(out,out_stride, in,in_stride, width,height, band_8(bandPosition,offsets));
+}
+
+void ff_hevc_sao_band_16_sse(uint16_t *out, ptrdiff_t out_stride,
+                             const uint16_t *in, ptrdiff_t in_stride,
+                             int width, int height, int bandPosition, const int8_t* offsets,
+                             int bit_depth)
+{
+  sao_block(out,out_stride, in,in_stride, width,height, band_16(bandPosition,offsets,bit_depth));
+}
+
+
+#define SAO_EDGE_SSE(eoClass)                                           \
+  void ff_hevc_sao_edge_ ## eoClass ## _8_sse(uint8_t *out, ptrdiff_t out_stride, \
+                                              const uint8_t *in, ptrdiff_t in_stride, \
+                                              int width, int height, const int8_t* offsets) \
+  {                                                                     \
+    sao_block(out,out_stride, in,in_stride, width,height,               \
+              edge_8(eoClass, in_stride, offsets));                     \
+  }                                                                     \
+                                                                        \
+  void ff_hevc_sao_edge_ ## eoClass ## _16_sse(uint16_t *out, ptrdiff_t out_stride, \
+                                               const uint16_t *in, ptrdiff_t in_stride, \
+                                               int width, int height, const int8_t* offsets, \
+                                               int bit_depth)           \
+  {                                                                     \
+    sao_block(out,out_stride, in,in_stride, width,height,               \
+              edge_16(eoClass, in_stride, offsets, bit_depth));         \
+  }
+
+SAO_EDGE_SSE(0)
+SAO_EDGE_SSE(1)
+SAO_EDGE_SSE(2)
+SAO_EDGE_SSE(3)
+
+#undef SAO_EDGE_SSE
@@ -0,0 +1,56 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SSE_SAO_H
+#define SSE_SAO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* SAO band and edge offsets for 8 to 16 bit pixels, see fallback-sao.h for
+   the parameters.
+ */
+
+void ff_hevc_sao_band_8_sse(uint8_t *out, ptrdiff_t out_stride,
+                            const uint8_t *in, ptrdiff_t in_stride,
+                            int width, int height, int bandPosition, const int8_t* offsets);
+void ff_hevc_sao_band_16_sse(uint16_t *out, ptrdiff_t out_stride,
+                             const uint16_t *in, ptrdiff_t in_stride,
+                             int width, int height, int bandPosition, const int8_t* offsets,
+                             int bit_depth);
+
+#define DECLARE_SAO_EDGE_SSE(eoClass)                                  \
+  void ff_hevc_sao_edge_ ## eoClass ## _8_sse(uint8_t *out, ptrdiff_t out_stride, \
+                                              const uint8_t *in, ptrdiff_t in_stride, \
+                                              int width, int height, const int8_t* offsets); \
+  void ff_hevc_sao_edge_ ## eoClass ## _16_sse(uint16_t *out, ptrdiff_t out_stride, \
+                                               const uint16_t *in, ptrdiff_t in_stride, \
+                                               int width, int height, const int8_t* offsets, \
+                                               int bit_depth);
+
+DECLARE_SAO_EDGE_SSE(0)
+DECLARE_SAO_EDGE_SSE(1)
+DECLARE_SAO_EDGE_SSE(2)
+DECLARE_SAO_EDGE_SSE(3)
+
+#undef DECLARE_SAO_EDGE_SSE
+
+#endif
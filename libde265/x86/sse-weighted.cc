@@ -0,0 +1,266 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+#include <emmintrin.h>
+
+#include "x86/sse-weighted.h"
+#include "fallback-motion.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+
+/* The weighted sums are computed with 16x16->32 bit multiply-adds, which
+   is exact for all weights that can be signalled in the slice header. The
+   rounding term is folded into the multiply-add by pairing every sample
+   with a constant 1. After the shift, the 32 bit results are packed with
+   signed saturation to 16 bit; this does not change the result after
+   clipping to the pixel range.
+
+   The rounding term (1<<(log2WD-1)) has to fit into 16 bits, which is the
+   case for bit depths up to 12.
+ */
+
+#define MAX_BIT_DEPTH 12
+
+
+// Computes ((src*w + rnd) >> log2WD) + o for 8 samples.
+
+static inline __m128i weighted_uni(__m128i src, __m128i wr, __m128i shift, __m128i o)
+{
+  const __m128i one = _mm_set1_epi16(1);
+
+  __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(src, one), wr);
+  __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(src, one), wr);
+
+  lo = _mm_add_epi32(_mm_sra_epi32(lo, shift), o);
+  hi = _mm_add_epi32(_mm_sra_epi32(hi, shift), o);
+
+  return _mm_packs_epi32(lo, hi);
+}
+
+// Computes (src1*w1 + src2*w2 + rnd) >> shift for 8 samples.
+
+static inline __m128i weighted_bi(__m128i src1, __m128i src2, __m128i w,
+                                  __m128i shift, __m128i rnd)
+{
+  __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(src1, src2), w);
+  __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(src1, src2), w);
+
+  lo = _mm_sra_epi32(_mm_add_epi32(lo, rnd), shift);
+  hi = _mm_sra_epi32(_mm_add_epi32(hi, rnd), shift);
+
+  return _mm_packs_epi32(lo, hi);
+}
+
+static inline __m128i clip_pixels(__m128i v, __m128i maxval)
+{
+  return _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()), maxval);
+}
+
+static inline int clip_pixel(int v, int maxval)
+{
+  return v<0 ? 0 : v>maxval ? maxval : v;
+}
+
+static inline __m128i weight_pair(int a, int b)
+{
+  return _mm_set1_epi32((a & 0xFFFF) | (b << 16));
+}
+
+
+void ff_hevc_put_weighted_pred_8_sse(uint8_t *dst, ptrdiff_t dststride,
+                                     const int16_t *src, ptrdiff_t srcstride,
+                                     int width, int height,
+                                     int w,int o,int log2WD)
+{
+  const int rnd = 1<<(log2WD-1);
+
+  const __m128i wr    = weight_pair(w, rnd);
+  const __m128i shift = _mm_cvtsi32_si128(log2WD);
+  const __m128i offs  = _mm_set1_epi32(o);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+16<=width;x+=16) {
+      __m128i a = weighted_uni(_mm_loadu_si128((const __m128i*)(src+x  )), wr, shift, offs);
+      __m128i b = weighted_uni(_mm_loadu_si128((const __m128i*)(src+x+8)), wr, shift, offs);
+      _mm_storeu_si128((__m128i*)(dst+x), _mm_packus_epi16(a,b));
+    }
+
+    if (x+8<=width) {
+      __m128i a = weighted_uni(_mm_loadu_si128((const __m128i*)(src+x)), wr, shift, offs);
+      _mm_storel_epi64((__m128i*)(dst+x), _mm_packus_epi16(a,a));
+      x+=8;
+    }
+
+    if (x+4<=width) {
+      __m128i a = weighted_uni(_mm_loadl_epi64((const __m128i*)(src+x)), wr, shift, offs);
+      int32_t d = _mm_cvtsi128_si32(_mm_packus_epi16(a,a));
+      memcpy(dst+x, &d, 4);
+      x+=4;
+    }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel(((src[x]*w + rnd)>>log2WD) + o, 255);
+    }
+
+    dst += dststride;
+    src += srcstride;
+  }
+}
+
+
+void ff_hevc_put_weighted_bipred_8_sse(uint8_t *dst, ptrdiff_t dststride,
+                                       const int16_t *src1, const int16_t *src2,
+                                       ptrdiff_t srcstride, int width, int height,
+                                       int w1,int o1, int w2,int o2, int log2WD)
+{
+  const int rnd = (o1+o2+1) << log2WD;
+
+  const __m128i w     = weight_pair(w1, w2);
+  const __m128i shift = _mm_cvtsi32_si128(log2WD+1);
+  const __m128i rnd4  = _mm_set1_epi32(rnd);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+16<=width;x+=16) {
+      __m128i a = weighted_bi(_mm_loadu_si128((const __m128i*)(src1+x)),
+                              _mm_loadu_si128((const __m128i*)(src2+x)), w, shift, rnd4);
+      __m128i b = weighted_bi(_mm_loadu_si128((const __m128i*)(src1+x+8)),
+                              _mm_loadu_si128((const __m128i*)(src2+x+8)), w, shift, rnd4);
+      _mm_storeu_si128((__m128i*)(dst+x), _mm_packus_epi16(a,b));
+    }
+
+    if (x+8<=width) {
+      __m128i a = weighted_bi(_mm_loadu_si128((const __m128i*)(src1+x)),
+                              _mm_loadu_si128((const __m128i*)(src2+x)), w, shift, rnd4);
+      _mm_storel_epi64((__m128i*)(dst+x), _mm_packus_epi16(a,a));
+      x+=8;
+    }
+
+    if (x+4<=width) {
+      __m128i a = weighted_bi(_mm_loadl_epi64((const __m128i*)(src1+x)),
+                              _mm_loadl_epi64((const __m128i*)(src2+x)), w, shift, rnd4);
+      int32_t d = _mm_cvtsi128_si32(_mm_packus_epi16(a,a));
+      memcpy(dst+x, &d, 4);
+      x+=4;
+    }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel((src1[x]*w1 + src2[x]*w2 + rnd)>>(log2WD+1), 255);
+    }
+
+    dst  += dststride;
+    src1 += srcstride;
+    src2 += srcstride;
+  }
+}
+
+
+void ff_hevc_put_weighted_pred_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                      const int16_t *src, ptrdiff_t srcstride,
+                                      int width, int height,
+                                      int w,int o,int log2WD, int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_weighted_pred_16_fallback(dst,dststride, src,srcstride, width,height,
+                                  w,o,log2WD, bit_depth);
+    return;
+  }
+
+  const int rnd = 1<<(log2WD-1);
+  const int maxval = (1<<bit_depth)-1;
+
+  const __m128i wr    = weight_pair(w, rnd);
+  const __m128i shift = _mm_cvtsi32_si128(log2WD);
+  const __m128i offs  = _mm_set1_epi32(o);
+  const __m128i maxv  = _mm_set1_epi16(maxval);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+8<=width;x+=8) {
+      __m128i a = weighted_uni(_mm_loadu_si128((const __m128i*)(src+x)), wr, shift, offs);
+      _mm_storeu_si128((__m128i*)(dst+x), clip_pixels(a, maxv));
+    }
+
+    if (x+4<=width) {
+      __m128i a = weighted_uni(_mm_loadl_epi64((const __m128i*)(src+x)), wr, shift, offs);
+      _mm_storel_epi64((__m128i*)(dst+x), clip_pixels(a, maxv));
+      x+=4;
+    }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel(((src[x]*w + rnd)>>log2WD) + o, maxval);
+    }
+
+    dst += dststride;
+    src += srcstride;
+  }
+}
+
+
+void ff_hevc_put_weighted_bipred_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                        const int16_t *src1, const int16_t *src2,
+                                        ptrdiff_t srcstride, int width, int height,
+                                        int w1,int o1, int w2,int o2, int log2WD,
+                                        int bit_depth)
+{
+  if (bit_depth > MAX_BIT_DEPTH) {
+    put_weighted_bipred_16_fallback(dst,dststride, src1,src2,srcstride, width,height,
+                                    w1,o1, w2,o2, log2WD, bit_depth);
+    return;
+  }
+
+  const int rnd = (o1+o2+1) << log2WD;
+  const int maxval = (1<<bit_depth)-1;
+
+  const __m128i w     = weight_pair(w1, w2);
+  const __m128i shift = _mm_cvtsi32_si128(log2WD+1);
+  const __m128i rnd4  = _mm_set1_epi32(rnd);
+  const __m128i maxv  = _mm_set1_epi16(maxval);
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+    for (;x+8<=width;x+=8) {
+      __m128i a = weighted_bi(_mm_loadu_si128((const __m128i*)(src1+x)),
+                              _mm_loadu_si128((const __m128i*)(src2+x)), w, shift, rnd4);
+      _mm_storeu_si128((__m128i*)(dst+x), clip_pixels(a, maxv));
+    }
+
+    if (x+4<=width) {
+      __m128i a = weighted_bi(_mm_loadl_epi64((const __m128i*)(src1+x)),
+                              _mm_loadl_epi64((const __m128i*)(src2+x)), w, shift, rnd4);
+      _mm_storel_epi64((__m128i*)(dst+x), clip_pixels(a, maxv));
+      x+=4;
+    }
+
+    for (;x<width;x++) {
+      dst[x] = clip_pixel((src1[x]*w1 + src2[x]*w2 + rnd)>>(log2WD+1), maxval);
+    }
+
+    dst  += dststride;
+    src1 += srcstride;
+    src2 += srcstride;
+  }
+}
@@ -0,0 +1,53 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SSE_WEIGHTED_H
+#define SSE_WEIGHTED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* Explicit weighted prediction (uni- and bi-directional). The 16 bit
+   variants handle bit depths up to 12, larger bit depths are passed on to
+   the scalar fallback functions.
+ */
+
+void ff_hevc_put_weighted_pred_8_sse(uint8_t *dst, ptrdiff_t dststride,
+                                     const int16_t *src, ptrdiff_t srcstride,
+                                     int width, int height,
+                                     int w,int o,int log2WD);
+void ff_hevc_put_weighted_bipred_8_sse(uint8_t *dst, ptrdiff_t dststride,
+                                       const int16_t *src1, const int16_t *src2,
+                                       ptrdiff_t srcstride, int width, int height,
+                                       int w1,int o1, int w2,int o2, int log2WD);
+
+void ff_hevc_put_weighted_pred_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                      const int16_t *src, ptrdiff_t srcstride,
+                                      int width, int height,
+                                      int w,int o,int log2WD, int bit_depth);
+void ff_hevc_put_weighted_bipred_16_sse(uint16_t *dst, ptrdiff_t dststride,
+                                        const int16_t *src1, const int16_t *src2,
+                                        ptrdiff_t srcstride, int width, int height,
+                                        int w1,int o1, int w2,int o2, int log2WD,
+                                        int bit_depth);
+
+#endif
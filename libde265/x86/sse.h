@@ -25,4 +25,7 @@
 
 void init_acceleration_functions_sse(struct acceleration_functions* accel);
 
+// Only installs the AVX2 functions when the CPU and OS support AVX2.
+void init_acceleration_functions_avx2(struct acceleration_functions* accel);
+
 #endif
@@ -0,0 +1,276 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures the cost of dispatching tasks through the thread pool, compared to a
+   pool with a single task queue behind one mutex (the previous implementation).
+
+   usage: threadpool-speed [nTasks] [workPerTask]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <deque>
+#include <atomic>
+
+#include "libde265/threads.h"
+
+
+// --- reference: single queue behind one mutex ---
+
+class single_queue_pool
+{
+public:
+  void start(int nThreads);
+  void stop();
+  void add_task(thread_task* task);
+
+private:
+  static void* worker(void* pool_ptr);
+
+  bool stopped;
+  std::deque<thread_task*> tasks;
+
+  de265_thread thread[MAX_THREADS];
+  int num_threads;
+
+  de265_mutex mutex;
+  de265_cond  cond_var;
+};
+
+
+void* single_queue_pool::worker(void* pool_ptr)
+{
+  single_queue_pool* pool = (single_queue_pool*)pool_ptr;
+
+  de265_mutex_lock(&pool->mutex);
+
+  for (;;) {
+    while (!pool->stopped && pool->tasks.empty()) {
+      de265_cond_wait(&pool->cond_var, &pool->mutex);
+    }
+
+    if (pool->stopped) {
+      break;
+    }
+
+    thread_task* task = pool->tasks.front();
+    pool->tasks.pop_front();
+
+    de265_mutex_unlock(&pool->mutex);
+    task->work();
+    de265_mutex_lock(&pool->mutex);
+  }
+
+  de265_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+
+void single_queue_pool::start(int nThreads)
+{
+  stopped = false;
+  num_threads = nThreads;
+
+  de265_mutex_init(&mutex);
+  de265_cond_init(&cond_var);
+
+  for (int i=0;i<nThreads;i++) {
+    de265_thread_create(&thread[i], worker, this);
+  }
+}
+
+
+void single_queue_pool::stop()
+{
+  de265_mutex_lock(&mutex);
+  stopped = true;
+  de265_mutex_unlock(&mutex);
+
+  de265_cond_broadcast(&cond_var, &mutex);
+
+  for (int i=0;i<num_threads;i++) {
+    de265_thread_join(thread[i]);
+    de265_thread_destroy(&thread[i]);
+  }
+
+  de265_mutex_destroy(&mutex);
+  de265_cond_destroy(&cond_var);
+}
+
+
+void single_queue_pool::add_task(thread_task* task)
+{
+  de265_mutex_lock(&mutex);
+  tasks.push_back(task);
+  de265_cond_signal(&cond_var);
+  de265_mutex_unlock(&mutex);
+}
+
+
+// --- libde265 thread pool ---
+
+class libde265_pool
+{
+public:
+  void start(int nThreads) { start_thread_pool(&pool, nThreads); }
+  void stop() { stop_thread_pool(&pool); }
+  void add_task(thread_task* task) { ::add_task(&pool, task); }
+
+private:
+  thread_pool pool;
+};
+
+
+// --- benchmark tasks ---
+
+std::atomic<int> nTasksDone;
+de265_progress_lock allTasksDone;
+int nTasksTotal;
+int workPerTask;
+
+std::atomic<int> dummy;
+
+
+void count_task_done()
+{
+  if (nTasksDone.fetch_add(1)+1 == nTasksTotal) {
+    allTasksDone.set_progress(1);
+  }
+}
+
+
+class work_task : public thread_task
+{
+public:
+  virtual void work() {
+    int sum=0;
+    for (int i=0;i<workPerTask;i++) { sum += i*i; }
+    dummy.store(sum, std::memory_order_relaxed);
+
+    count_task_done();
+  }
+};
+
+
+// Adds all other tasks from within a worker thread.
+
+template <class Pool> class spawning_task : public thread_task
+{
+public:
+  Pool* pool;
+  work_task* children;
+  int nChildren;
+
+  virtual void work() {
+    for (int i=0;i<nChildren;i++) {
+      pool->add_task(&children[i]);
+    }
+
+    count_task_done();
+  }
+};
+
+
+double now_in_us()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec*1000000.0 + tv.tv_usec;
+}
+
+
+// returns the time per task in nanoseconds
+
+template <class Pool> double measure(int nThreads, int nTasks, bool spawnFromWorker)
+{
+  Pool pool;
+  pool.start(nThreads);
+
+  work_task* tasks = new work_task[nTasks];
+  spawning_task<Pool> root;
+
+  nTasksDone = 0;
+  nTasksTotal = nTasks;
+  allTasksDone.reset(0);
+
+  double start = now_in_us();
+
+  if (spawnFromWorker) {
+    root.pool = &pool;
+    root.children = tasks;
+    root.nChildren = nTasks-1;
+    pool.add_task(&root);
+  }
+  else {
+    for (int i=0;i<nTasks;i++) {
+      pool.add_task(&tasks[i]);
+    }
+  }
+
+  allTasksDone.wait_for_progress(1);
+
+  double end = now_in_us();
+
+  pool.stop();
+  delete[] tasks;
+
+  return (end-start)*1000.0 / nTasks;
+}
+
+
+int main(int argc, char** argv)
+{
+  int nTasks = 100000;
+  workPerTask = 0;
+
+  if (argc>=2) { nTasks = atoi(argv[1]); }
+  if (argc>=3) { workPerTask = atoi(argv[2]); }
+
+  if (nTasks < 2) {
+    fprintf(stderr,"usage: threadpool-speed [nTasks] [workPerTask]\n");
+    return 5;
+  }
+
+  printf("%d tasks, work per task: %d\n", nTasks, workPerTask);
+  printf("time per task [ns]   single-queue pool  |  libde265 pool\n");
+  printf("threads               main    worker    |  main    worker\n");
+
+  const int threadCounts[] = { 1,2,4,8,16,32 };
+
+  for (int i=0;i<6;i++) {
+    int nThreads = threadCounts[i];
+
+    double refMain   = measure<single_queue_pool>(nThreads, nTasks, false);
+    double refWorker = measure<single_queue_pool>(nThreads, nTasks, true);
+    double own       = measure<libde265_pool>(nThreads, nTasks, false);
+    double worker    = measure<libde265_pool>(nThreads, nTasks, true);
+
+    printf("%2d                 %7.1f  %7.1f     | %7.1f  %7.1f\n",
+           nThreads, refMain, refWorker, own, worker);
+  }
+
+  return 0;
+}